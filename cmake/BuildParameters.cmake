@@ -20,6 +20,7 @@
 # Misc option
 #-------------------------------------------------------------------------------
 option(LIBRETRO "Enables building the libretro core" ON)
+option(BUILD_BENCHMARK "Build the headless benchmark runner (lrps2_bench, Linux only)" OFF)
 
 #-------------------------------------------------------------------------------
 # Compiler extra
@@ -105,6 +105,13 @@ extern void MemProtect(void *baseaddr, size_t size, const PageProtectionMode &mo
 
 extern void Munmap(void *base, size_t size);
 
+// Asks the OS to back the block with large (2MB) pages where it can.  Does
+// nothing unless enabled with SetHugePages, or on hosts without transparent
+// huge pages.  Pages that get a different protection later on are split
+// back to small ones by the OS, so page granular MemProtect keeps working.
+extern void SetHugePages(bool enable);
+extern void MmapAdviseHugePages(void *base, size_t size);
+
 template <uint size>
 void MemProtectStatic(u8 (&arr)[size], const PageProtectionMode &mode)
 {
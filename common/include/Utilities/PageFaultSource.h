@@ -177,6 +177,9 @@ protected:
     // Protection mode to be applied to committed blocks.
     PageProtectionMode m_prot_mode;
 
+    // Committed blocks may be backed by huge pages (see HostSys::MmapAdviseHugePages).
+    bool m_huge_pages;
+
     // Allows the implementation to decide how much memory it needs to allocate if someone requests the given size
     // Should translate requests of size 0 to m_defsize
     virtual size_t GetSize(size_t requestedSize);
@@ -220,6 +223,7 @@ public:
     const u8 *GetPtrEnd() const { return (u8 *)m_baseptr + (m_pages_reserved * PCSX2_PAGESIZE); }
 
     VirtualMemoryReserve &SetPageAccessOnCommit(const PageProtectionMode &mode);
+    VirtualMemoryReserve &SetHugePagesOnCommit(bool enable);
 
     operator void *() { return m_baseptr; }
     operator const void *() const { return m_baseptr; }
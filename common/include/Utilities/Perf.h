@@ -0,0 +1,70 @@
+/*  PCSX2 - PS2 Emulator for PCs
+ *  Copyright (C) 2002-2021  PCSX2 Dev Team
+ *
+ *  PCSX2 is free software: you can redistribute it and/or modify it under the terms
+ *  of the GNU Lesser General Public License as published by the Free Software Found-
+ *  ation, either version 3 of the License, or (at your option) any later version.
+ *
+ *  PCSX2 is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ *  without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ *  PURPOSE.  See the GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along with PCSX2.
+ *  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+#include "Pcsx2Types.h"
+#include <cstdio>
+#include <string>
+#include <vector>
+
+// Symbols for recompiled code, in the /tmp/perf-<pid>.map format Linux perf
+// reads to name addresses in anonymous executable memory. Each recompiler
+// maps its blocks as it compiles them, and drops them again when their code
+// is thrown away. The file always lists the code that is currently live.
+//
+// Callers check Perf::enabled before building a symbol name, everything
+// else is a no-op while it is off.
+namespace Perf
+{
+	extern bool enabled;
+
+	struct Info
+	{
+		uptr x86;
+		u32 size;
+		std::string symbol;
+	};
+
+	class InfoVector
+	{
+		const char* m_prefix;
+		std::vector<Info> m_v;
+
+	public:
+		InfoVector(const char* prefix);
+
+		// "<prefix> <symbol>"
+		void map(uptr x86, u32 size, const char* symbol);
+		// "<prefix> 0x<pc>", for code translated from a single guest address
+		void map(uptr x86, u32 size, u32 pc);
+		// Drops the symbols of code in [lo, hi)
+		void unmap(uptr lo, uptr hi);
+		void reset();
+
+		// Used by the map file writer, with the lock held
+		void write(FILE* fp) const;
+		void clear() { m_v.clear(); }
+	};
+
+	// Starts a fresh map file for this process (or stops writing it)
+	void SetEnabled(bool enable);
+
+	extern InfoVector any;
+	extern InfoVector ee;
+	extern InfoVector iop;
+	extern InfoVector vu[2];
+	extern InfoVector vif;
+	extern InfoVector gs;
+}
@@ -0,0 +1,70 @@
+/*  PCSX2 - PS2 Emulator for PCs
+ *  Copyright (C) 2002-2021  PCSX2 Dev Team
+ *
+ *  PCSX2 is free software: you can redistribute it and/or modify it under the terms
+ *  of the GNU Lesser General Public License as published by the Free Software Found-
+ *  ation, either version 3 of the License, or (at your option) any later version.
+ *
+ *  PCSX2 is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ *  without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ *  PURPOSE.  See the GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along with PCSX2.
+ *  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+// CPU affinity of the emulator threads. The placement is computed once from
+// the CPU topology (Linux sysfs), restricted to the CPUs the process may run
+// on, so instances packed on one host can be given disjoint CPU sets with
+// taskset or cgroups and each places its threads within its own set.
+namespace Threading
+{
+	enum ThreadRole
+	{
+		ThreadRole_EE,     // EE core thread
+		ThreadRole_VU1,    // MTVU
+		ThreadRole_GS,     // thread running the MTGS ring buffer
+		ThreadRole_Worker, // GS rasterizer and texture decode workers
+		ThreadRole_Count
+	};
+
+	enum PlacementPolicy
+	{
+		// Threads float, the scheduler decides
+		Placement_None,
+		// EE, VU1 and GS each get a physical core of their own, in the L3
+		// domain with the most cores. Workers get the other cores there,
+		// else the SMT siblings of the three.
+		Placement_Dedicated,
+		// Every thread may run on any CPU of that L3 domain, nothing is
+		// pinned to a single core
+		Placement_Domain,
+	};
+
+	// Takes effect for threads placed afterwards
+	extern void SetPlacementPolicy(PlacementPolicy policy);
+
+	// Applies the policy to the calling thread. Cheap once the thread has
+	// been placed, so it can be called every time a loop is entered.
+	// Only for threads the emulator owns.
+	extern void PlaceCurrentThread(ThreadRole role);
+
+	// Places a thread the emulator doesn't own (the frontend's) for as long as
+	// it runs emulator work, and gives it its own affinity back after
+	class ScopedThreadPlacement
+	{
+	public:
+		explicit ScopedThreadPlacement(ThreadRole role);
+		~ScopedThreadPlacement();
+
+	private:
+		ScopedThreadPlacement(const ScopedThreadPlacement&) = delete;
+		ScopedThreadPlacement& operator=(const ScopedThreadPlacement&) = delete;
+
+		bool m_restore;
+		// The thread's cpu_set_t
+		unsigned char m_saved[128];
+	};
+}
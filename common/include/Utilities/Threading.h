@@ -56,6 +56,10 @@ extern void SpinWait(void);
 // sleeps the current thread for the given number of milliseconds.
 extern void sleep(int ms);
 
+// Names the calling thread so it shows up in top/perf and /proc/<pid>/task/*/comm.
+// Linux truncates the name to 15 characters.
+extern void SetNameOfCurrentThread(const char *name);
+
 class Semaphore
 {
 protected:
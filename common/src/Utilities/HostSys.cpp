@@ -211,3 +211,21 @@ void HostSys::MemProtect(void *baseaddr, size_t size, const PageProtectionMode &
     _memprotect(baseaddr, size, mode);
 #endif
 }
+
+static bool s_huge_pages = false;
+
+void HostSys::SetHugePages(bool enable)
+{
+    s_huge_pages = enable;
+}
+
+void HostSys::MmapAdviseHugePages(void *base, size_t size)
+{
+#if defined(__linux__) && defined(MADV_HUGEPAGE)
+    if (!s_huge_pages || !base || !size)
+        return;
+    // The kernel only uses huge pages for the 2MB aligned parts of the range,
+    // and doesn't complain if there are none.
+    madvise(base, size, MADV_HUGEPAGE);
+#endif
+}
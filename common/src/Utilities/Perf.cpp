@@ -0,0 +1,158 @@
+/*  PCSX2 - PS2 Emulator for PCs
+ *  Copyright (C) 2002-2021  PCSX2 Dev Team
+ *
+ *  PCSX2 is free software: you can redistribute it and/or modify it under the terms
+ *  of the GNU Lesser General Public License as published by the Free Software Found-
+ *  ation, either version 3 of the License, or (at your option) any later version.
+ *
+ *  PCSX2 is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ *  without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ *  PURPOSE.  See the GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along with PCSX2.
+ *  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <algorithm>
+#include <cstdio>
+#include <mutex>
+
+#ifndef _WIN32
+#include <unistd.h>
+#endif
+
+#include "Perf.h"
+
+namespace Perf
+{
+	bool enabled = false;
+
+	// Blocks are compiled on the EE, MTVU, microVU compile and GS threads
+	static std::mutex s_lock;
+	static FILE* s_fp = NULL;
+	static char s_path[64];
+
+	InfoVector any("");
+	InfoVector ee("EE");
+	InfoVector iop("IOP");
+	InfoVector vu[2] = {InfoVector("mVU0"), InfoVector("mVU1")};
+	InfoVector vif("VIF");
+	InfoVector gs("GS");
+
+	static InfoVector* const s_all[] = {&any, &ee, &iop, &vu[0], &vu[1], &vif, &gs};
+
+	static void writeLine(FILE* fp, const Info& info)
+	{
+		fprintf(fp, "%zx %x %s\n", (size_t)info.x86, info.size, info.symbol.c_str());
+	}
+
+	// perf only reads the file once it reports, so dropped symbols are
+	// simply left out of a new copy
+	static void rewrite()
+	{
+		if (!s_fp)
+			return;
+
+		fclose(s_fp);
+		s_fp = fopen(s_path, "w");
+		if (!s_fp)
+			return;
+
+		for (const InfoVector* v : s_all)
+			v->write(s_fp);
+		fflush(s_fp);
+	}
+
+	InfoVector::InfoVector(const char* prefix)
+		: m_prefix(prefix)
+	{
+	}
+
+	void InfoVector::map(uptr x86, u32 size, const char* symbol)
+	{
+		if (!enabled || !size)
+			return;
+
+		std::lock_guard<std::mutex> lock(s_lock);
+
+		Info info = {x86, size, *m_prefix ? std::string(m_prefix) + " " + symbol : std::string(symbol)};
+		if (s_fp)
+		{
+			writeLine(s_fp, info);
+			fflush(s_fp);
+		}
+		m_v.push_back(std::move(info));
+	}
+
+	void InfoVector::map(uptr x86, u32 size, u32 pc)
+	{
+		if (!enabled)
+			return;
+
+		char symbol[16];
+		snprintf(symbol, sizeof(symbol), "0x%08x", pc);
+		map(x86, size, symbol);
+	}
+
+	void InfoVector::unmap(uptr lo, uptr hi)
+	{
+		if (!enabled)
+			return;
+
+		std::lock_guard<std::mutex> lock(s_lock);
+
+		const size_t count = m_v.size();
+		m_v.erase(std::remove_if(m_v.begin(), m_v.end(), [&](const Info& info) {
+			return info.x86 >= lo && info.x86 < hi;
+		}), m_v.end());
+
+		if (m_v.size() != count)
+			rewrite();
+	}
+
+	void InfoVector::reset()
+	{
+		if (!enabled)
+			return;
+
+		std::lock_guard<std::mutex> lock(s_lock);
+
+		if (m_v.empty())
+			return;
+
+		m_v.clear();
+		rewrite();
+	}
+
+	void InfoVector::write(FILE* fp) const
+	{
+		for (const Info& info : m_v)
+			writeLine(fp, info);
+	}
+
+	void SetEnabled(bool enable)
+	{
+#ifdef __linux__
+		std::lock_guard<std::mutex> lock(s_lock);
+
+		if (s_fp)
+		{
+			fclose(s_fp);
+			s_fp = NULL;
+		}
+
+		// Code compiled while it was off isn't known, so start over
+		for (InfoVector* v : s_all)
+			v->clear();
+
+		enabled = enable;
+		if (!enable)
+			return;
+
+		snprintf(s_path, sizeof(s_path), "/tmp/perf-%d.map", (int)getpid());
+		s_fp = fopen(s_path, "w");
+#else
+		enabled = false;
+#endif
+	}
+}
@@ -0,0 +1,248 @@
+/*  PCSX2 - PS2 Emulator for PCs
+ *  Copyright (C) 2002-2021  PCSX2 Dev Team
+ *
+ *  PCSX2 is free software: you can redistribute it and/or modify it under the terms
+ *  of the GNU Lesser General Public License as published by the Free Software Found-
+ *  ation, either version 3 of the License, or (at your option) any later version.
+ *
+ *  PCSX2 is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ *  without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ *  PURPOSE.  See the GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along with PCSX2.
+ *  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <atomic>
+#include <mutex>
+
+#include "ThreadPlacement.h"
+
+#ifdef __linux__
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <map>
+#include <string>
+#include <vector>
+
+#include <pthread.h>
+#include <sched.h>
+
+namespace Threading
+{
+	static std::mutex s_lock;
+	static std::atomic<int> s_generation(0); // Bumped on every policy change
+	static PlacementPolicy s_policy = Placement_None;
+	static bool s_planned = false;
+	static bool s_have_allowed = false;
+	static cpu_set_t s_allowed; // CPUs of the process, before any thread got pinned
+	static cpu_set_t s_masks[ThreadRole_Count];
+
+	static thread_local int t_generation = 0;
+	static thread_local ThreadRole t_role = ThreadRole_Count;
+
+	static std::string ReadLine(const char* fmt, int cpu, int index = 0)
+	{
+		char path[128];
+		snprintf(path, sizeof(path), fmt, cpu, index);
+
+		std::string line;
+		if (FILE* fp = fopen(path, "r"))
+		{
+			char buf[256];
+			if (fgets(buf, sizeof(buf), fp))
+				line.assign(buf, strcspn(buf, "\n"));
+			fclose(fp);
+		}
+		return line;
+	}
+
+	// Key shared by the CPUs behind one L3 cache (the package if the cache
+	// isn't described)
+	static std::string L3Domain(int cpu)
+	{
+		for (int index = 0; index < 8; index++)
+		{
+			const std::string level = ReadLine("/sys/devices/system/cpu/cpu%d/cache/index%d/level", cpu, index);
+			if (level.empty())
+				break;
+			if (level == "3")
+				return ReadLine("/sys/devices/system/cpu/cpu%d/cache/index%d/shared_cpu_list", cpu, index);
+		}
+		return "package " + ReadLine("/sys/devices/system/cpu/cpu%d/topology/physical_package_id", cpu);
+	}
+
+	static void Plan()
+	{
+		for (cpu_set_t& mask : s_masks)
+			mask = s_allowed;
+
+		if (s_policy == Placement_None)
+			return;
+
+		// L3 domain -> physical core -> logical CPUs
+		typedef std::map<std::string, std::vector<int>> Cores;
+		std::map<std::string, Cores> domains;
+
+		for (int cpu = 0; cpu < CPU_SETSIZE; cpu++)
+		{
+			if (!CPU_ISSET(cpu, &s_allowed))
+				continue;
+
+			const std::string core = ReadLine("/sys/devices/system/cpu/cpu%d/topology/physical_package_id", cpu) + ":" +
+			                         ReadLine("/sys/devices/system/cpu/cpu%d/topology/core_id", cpu);
+			domains[L3Domain(cpu)][core].push_back(cpu);
+		}
+
+		if (domains.empty())
+			return;
+
+		auto best = std::max_element(domains.begin(), domains.end(), [](const auto& a, const auto& b) {
+			return a.second.size() < b.second.size();
+		});
+
+		std::vector<std::vector<int>> cores;
+		for (const auto& kv : best->second)
+			cores.push_back(kv.second);
+
+		cpu_set_t domain;
+		CPU_ZERO(&domain);
+		for (const auto& core : cores)
+			for (int cpu : core)
+				CPU_SET(cpu, &domain);
+
+		for (cpu_set_t& mask : s_masks)
+			mask = domain;
+
+		if (s_policy != Placement_Dedicated || cores.size() < 2)
+			return;
+
+		// EE, VU1, GS on the first thread of a core each. With two cores VU1
+		// and GS share the second one, on siblings if it has SMT.
+		const ThreadRole critical[] = {ThreadRole_EE, ThreadRole_VU1, ThreadRole_GS};
+		cpu_set_t siblings;
+		CPU_ZERO(&siblings);
+
+		for (int i = 0; i < 3; i++)
+		{
+			const std::vector<int>& core = cores[std::min<size_t>(i, cores.size() - 1)];
+			const size_t thread = i < (int)cores.size() ? 0 : std::min<size_t>(1, core.size() - 1);
+
+			CPU_ZERO(&s_masks[critical[i]]);
+			CPU_SET(core[thread], &s_masks[critical[i]]);
+
+			for (size_t j = 1; j < core.size(); j++)
+				CPU_SET(core[j], &siblings);
+		}
+
+		// Workers on the remaining cores, else on the siblings of the three,
+		// else anywhere in the domain
+		if (cores.size() > 3)
+		{
+			CPU_ZERO(&s_masks[ThreadRole_Worker]);
+			for (size_t i = 3; i < cores.size(); i++)
+				for (int cpu : cores[i])
+					CPU_SET(cpu, &s_masks[ThreadRole_Worker]);
+		}
+		else if (cores.size() == 3 && CPU_COUNT(&siblings) > 0)
+			s_masks[ThreadRole_Worker] = siblings;
+	}
+
+	void SetPlacementPolicy(PlacementPolicy policy)
+	{
+		std::lock_guard<std::mutex> lock(s_lock);
+		if (!s_have_allowed)
+		{
+			if (sched_getaffinity(0, sizeof(s_allowed), &s_allowed) != 0)
+				CPU_ZERO(&s_allowed);
+			s_have_allowed = true;
+		}
+
+		s_policy  = policy;
+		s_planned = false;
+		s_generation.fetch_add(1, std::memory_order_release);
+	}
+
+	static cpu_set_t GetMask(ThreadRole role)
+	{
+		std::lock_guard<std::mutex> lock(s_lock);
+		if (!s_planned)
+		{
+			Plan();
+			s_planned = true;
+		}
+		return s_masks[role];
+	}
+
+	void PlaceCurrentThread(ThreadRole role)
+	{
+		// Nothing to do until a policy has been set
+		const int generation = s_generation.load(std::memory_order_acquire);
+		if (generation == 0 || (t_generation == generation && t_role == role))
+			return;
+
+		t_generation = generation;
+		t_role       = role;
+
+		const cpu_set_t mask = GetMask(role);
+
+		// Empty if the process mask couldn't be read
+		if (CPU_COUNT(&mask) > 0)
+			pthread_setaffinity_np(pthread_self(), sizeof(mask), &mask);
+	}
+
+	ScopedThreadPlacement::ScopedThreadPlacement(ThreadRole role)
+		: m_restore(false)
+	{
+		static_assert(sizeof(cpu_set_t) <= sizeof(m_saved), "cpu_set_t doesn't fit");
+
+		if (s_generation.load(std::memory_order_acquire) == 0)
+			return;
+
+		{
+			std::lock_guard<std::mutex> lock(s_lock);
+			if (s_policy == Placement_None)
+				return;
+		}
+
+		const cpu_set_t mask = GetMask(role);
+		cpu_set_t& saved     = *(cpu_set_t*)m_saved;
+		if (CPU_COUNT(&mask) == 0 || pthread_getaffinity_np(pthread_self(), sizeof(saved), &saved) != 0 ||
+			CPU_EQUAL(&mask, &saved))
+			return;
+
+		m_restore = pthread_setaffinity_np(pthread_self(), sizeof(mask), &mask) == 0;
+	}
+
+	ScopedThreadPlacement::~ScopedThreadPlacement()
+	{
+		if (m_restore)
+			pthread_setaffinity_np(pthread_self(), sizeof(cpu_set_t), (const cpu_set_t*)m_saved);
+	}
+}
+
+#else
+
+namespace Threading
+{
+	void SetPlacementPolicy(PlacementPolicy policy)
+	{
+	}
+
+	void PlaceCurrentThread(ThreadRole role)
+	{
+	}
+
+	ScopedThreadPlacement::ScopedThreadPlacement(ThreadRole role)
+		: m_restore(false)
+	{
+	}
+
+	ScopedThreadPlacement::~ScopedThreadPlacement()
+	{
+	}
+}
+
+#endif
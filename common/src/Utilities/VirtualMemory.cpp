@@ -206,6 +206,7 @@ VirtualMemoryReserve::VirtualMemoryReserve(size_t size)
     m_pages_reserved = 0;
     m_baseptr        = nullptr;
     m_prot_mode      = PageAccess_None();
+    m_huge_pages     = false;
 }
 
 VirtualMemoryReserve &VirtualMemoryReserve::SetPageAccessOnCommit(const PageProtectionMode &mode)
@@ -214,6 +215,12 @@ VirtualMemoryReserve &VirtualMemoryReserve::SetPageAccessOnCommit(const PageProt
     return *this;
 }
 
+VirtualMemoryReserve &VirtualMemoryReserve::SetHugePagesOnCommit(bool enable)
+{
+    m_huge_pages = enable;
+    return *this;
+}
+
 size_t VirtualMemoryReserve::GetSize(size_t requestedSize)
 {
     if (requestedSize)
@@ -276,7 +283,13 @@ bool VirtualMemoryReserve::Commit()
         return true;
 
     m_pages_commited = m_pages_reserved;
-    return HostSys::MmapCommitPtr(m_baseptr, m_pages_reserved * PCSX2_PAGESIZE, m_prot_mode);
+    if (!HostSys::MmapCommitPtr(m_baseptr, m_pages_reserved * PCSX2_PAGESIZE, m_prot_mode))
+        return false;
+
+    // Reset() maps fresh pages, so this has to be repeated on every commit
+    if (m_huge_pages)
+        HostSys::MmapAdviseHugePages(m_baseptr, m_pages_reserved * PCSX2_PAGESIZE);
+    return true;
 }
 
 void VirtualMemoryReserve::ForbidModification()
@@ -0,0 +1,47 @@
+#pragma once
+
+#include "lrps2_checks.h"
+
+// Collects what a check or benchmark reports into the result array of its
+// lrps2_run_* entry point, what doesn't fit is dropped
+template <typename Result>
+class BenchResults
+{
+	Result* m_results;
+	unsigned m_max;
+	unsigned m_count;
+
+public:
+	BenchResults(Result* results, unsigned max)
+		: m_results(results)
+		, m_max(max)
+		, m_count(0)
+	{
+	}
+
+	void operator()(const Result& result)
+	{
+		if (m_count < m_max)
+			m_results[m_count++] = result;
+	}
+
+	unsigned Count() const { return m_count; }
+};
+
+template <typename Result>
+unsigned BenchRun(Result* results, unsigned max, void (*fn)(BenchResults<Result>&))
+{
+	BenchResults<Result> report(results, max);
+	fn(report);
+	return report.Count();
+}
+
+void GScheckPipeline(BenchResults<lrps2_pipeline_check>& report);
+void GSbenchmarkVertexTrace(BenchResults<lrps2_vertex_trace_bench>& report);
+void GScheckVertexTrace(BenchResults<lrps2_vertex_trace_check>& report);
+void GSbenchmarkTransfers(BenchResults<lrps2_transfer_bench>& report);
+void GScheckTransfers(BenchResults<lrps2_transfer_check>& report);
+void SndOutBenchmark(BenchResults<lrps2_audio_bench>& report);
+void McdJournalCheck(BenchResults<lrps2_mcd_journal_check>& report);
+
+bool MemorySnapshotCheck(unsigned frames, lrps2_snapshot_check& result);
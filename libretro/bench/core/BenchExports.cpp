@@ -0,0 +1,51 @@
+// Entry points of the benchmark core, see lrps2_checks.h
+
+#include "BenchCore.h"
+
+#include "Common.h"
+#include "StateHash.h"
+
+unsigned lrps2_run_pipeline_check(struct lrps2_pipeline_check* results, unsigned max)
+{
+	return BenchRun(results, max, GScheckPipeline);
+}
+
+unsigned lrps2_run_vertex_trace_bench(struct lrps2_vertex_trace_bench* results, unsigned max)
+{
+	return BenchRun(results, max, GSbenchmarkVertexTrace);
+}
+
+unsigned lrps2_run_vertex_trace_check(struct lrps2_vertex_trace_check* results, unsigned max)
+{
+	return BenchRun(results, max, GScheckVertexTrace);
+}
+
+unsigned lrps2_run_transfer_bench(struct lrps2_transfer_bench* results, unsigned max)
+{
+	return BenchRun(results, max, GSbenchmarkTransfers);
+}
+
+unsigned lrps2_run_transfer_check(struct lrps2_transfer_check* results, unsigned max)
+{
+	return BenchRun(results, max, GScheckTransfers);
+}
+
+unsigned lrps2_run_audio_bench(struct lrps2_audio_bench* results, unsigned max)
+{
+	return BenchRun(results, max, SndOutBenchmark);
+}
+
+void lrps2_force_state_hashes(bool force)
+{
+	StateHash::Force(force);
+}
+
+bool lrps2_run_snapshot_check(unsigned frames, struct lrps2_snapshot_check* result)
+{
+	return MemorySnapshotCheck(frames, *result);
+}
+
+unsigned lrps2_run_mcd_journal_check(struct lrps2_mcd_journal_check* results, unsigned max)
+{
+	return BenchRun(results, max, McdJournalCheck);
+}
@@ -0,0 +1,702 @@
+/* GS pipeline check of the benchmark core (lrps2_run_pipeline_check).
+ *
+ * The same synthetic GIF stream is rendered by the software renderer directly
+ * and through GSPipeline, with the parse stage on a thread of its own like MTGS
+ * runs it. Local memory after every frame, savestates and local -> host
+ * transfers must match. Also checks the transfer positions the parse stage
+ * keeps with GSLocalMemory::AdvanceImage, and stopping the pipeline while its
+ * parse stage waits in PostFrame(), Sync() or Wait().
+ */
+
+#include "BenchCore.h"
+
+#include "GS/GSFuncs.h"
+#include "GS/GSPipeline.h"
+#include "GS/Renderers/SW/GSRendererSW.h"
+
+#include <atomic>
+#include <chrono>
+#include <thread>
+
+// GSRendererSW without a device: draws into its local memory, never presents
+class GSPipelineCheckRenderer final : public GSRendererSW
+{
+public:
+	GSPipelineCheckRenderer(int threads)
+		: GSRendererSW(threads)
+	{
+	}
+
+	u64 Checksum()
+	{
+		Sync(0);
+
+		const u64* p = (const u64*)m_mem.m_vm8;
+		u64 h = 0xcbf29ce484222325ull;
+		for(int i = 0; i < GSLocalMemory::m_vmsize / 8; i++)
+			h = (h ^ p[i]) * 0x100000001b3ull;
+		return h;
+	}
+
+	u64 FreezeChecksum()
+	{
+		GSFreezeData fd = {0, NULL};
+		Freeze(&fd, true);
+		std::vector<u8> data(fd.size);
+		fd.data = data.data();
+
+		// Freeze() flushes but doesn't wait for the rasterizer threads
+		Flush();
+		Sync(0);
+		Freeze(&fd, false);
+
+		u64 h = 0xcbf29ce484222325ull;
+		for(u8 c : data)
+			h = (h ^ c) * 0x100000001b3ull;
+		return h;
+	}
+
+	u64 ReadChecksum(int qwc)
+	{
+		std::vector<u8> data(qwc * 16);
+		InitAndReadFIFO(data.data(), qwc);
+
+		u64 h = 0xcbf29ce484222325ull;
+		for(u8 c : data)
+			h = (h ^ c) * 0x100000001b3ull;
+		return h;
+	}
+};
+
+// One frame of GIF packets, fed in pieces of odd sizes, with a pause for a savestate
+// or a local -> host transfer halfway
+struct GSPipelineCheckFrame
+{
+	std::vector<u64> data; // qwords, low half first
+	std::vector<u32> pieces; // Transfer() sizes, in qwords
+	size_t sync; // qwords before the pause
+	int read; // qwords read back at the pause, 0 for a savestate
+};
+
+class GSPipelineCheckStream
+{
+	GSPipelineCheckFrame& m_frame;
+	u32 m_seed;
+
+public:
+	GSPipelineCheckStream(GSPipelineCheckFrame& frame, u32 seed)
+		: m_frame(frame)
+		, m_seed(seed)
+	{
+	}
+
+	u32 Rand(u32 n)
+	{
+		m_seed = m_seed * 1664525 + 1013904223;
+		return (m_seed >> 8) % n;
+	}
+
+	void Tag(u32 nloop, u32 flg, u32 nreg, u64 regs, u32 prim = 0, bool pre = false)
+	{
+		m_frame.data.push_back(nloop | 1ull << 15 | (u64)pre << 46 | (u64)prim << 47 | (u64)flg << 58 | (u64)nreg << 60);
+		m_frame.data.push_back(regs);
+	}
+
+	void AD(std::initializer_list<std::pair<u32, u64>> regs)
+	{
+		Tag((u32)regs.size(), GIF_FLG_PACKED, 1, GIF_REG_A_D);
+
+		for(const auto& r : regs)
+		{
+			m_frame.data.push_back(r.second);
+			m_frame.data.push_back(r.first);
+		}
+	}
+
+	void Image(int qwc)
+	{
+		Tag(qwc, GIF_FLG_IMAGE, 0, 0);
+
+		for(int i = 0; i < qwc * 2; i++)
+			m_frame.data.push_back((u64)Rand(1u << 24) << 40 ^ (u64)Rand(1u << 24) << 20 ^ Rand(1u << 24));
+	}
+
+	// Host -> local transfer of random pixels, the data split where asked
+	void Upload(u32 psm, u32 bp, u32 bw, int x, int y, int w, int h, int split = 0)
+	{
+		GIFRegBITBLTBUF BITBLTBUF;
+		GIFRegTRXPOS TRXPOS;
+		GIFRegTRXREG TRXREG;
+		GIFRegTRXDIR TRXDIR;
+
+		BITBLTBUF.U64 = 0;
+		BITBLTBUF.DBP = bp;
+		BITBLTBUF.DBW = bw;
+		BITBLTBUF.DPSM = psm;
+		TRXPOS.U64 = 0;
+		TRXPOS.DSAX = x;
+		TRXPOS.DSAY = y;
+		TRXREG.U64 = 0;
+		TRXREG.RRW = w;
+		TRXREG.RRH = h;
+		TRXDIR.U64 = 0;
+
+		AD({{GIF_A_D_REG_BITBLTBUF, BITBLTBUF.U64}, {GIF_A_D_REG_TRXPOS, TRXPOS.U64}, {GIF_A_D_REG_TRXREG, TRXREG.U64}, {GIF_A_D_REG_TRXDIR, TRXDIR.U64}});
+
+		const int qwc = ((w * h * GSLocalMemory::m_psm[psm].trbpp + 7) / 8 + 15) / 16;
+
+		if(split > 0 && split < qwc)
+		{
+			Image(split);
+			Image(qwc - split);
+		}
+		else
+		{
+			Image(qwc);
+		}
+	}
+
+	// The transfers before and after the TEX0 write are flushed separately
+	void UploadFlushed(u32 psm, u32 bp, u32 bw, int x, int y, int w, int h, u64 TEX0)
+	{
+		const int qwc = ((w * h * GSLocalMemory::m_psm[psm].trbpp + 7) / 8 + 15) / 16;
+		const int split = 1 + Rand(std::max(qwc - 1, 1));
+
+		Upload(psm, bp, bw, x, y, w, h, split);
+
+		// Upload() put the second piece last, move the TEX0 write in front of it
+		std::vector<u64> rest(m_frame.data.end() - (qwc - split + 1) * 2, m_frame.data.end());
+		m_frame.data.resize(m_frame.data.size() - rest.size());
+		AD({{GIF_A_D_REG_TEX0_1, TEX0}});
+		m_frame.data.insert(m_frame.data.end(), rest.begin(), rest.end());
+	}
+
+	void Move(u32 sbp, u32 sbw, int sx, int sy, u32 dbp, u32 dbw, int dx, int dy, int w, int h)
+	{
+		GIFRegBITBLTBUF BITBLTBUF;
+		GIFRegTRXPOS TRXPOS;
+		GIFRegTRXREG TRXREG;
+		GIFRegTRXDIR TRXDIR;
+
+		BITBLTBUF.U64 = 0;
+		BITBLTBUF.SBP = sbp;
+		BITBLTBUF.SBW = sbw;
+		BITBLTBUF.DBP = dbp;
+		BITBLTBUF.DBW = dbw;
+		TRXPOS.U64 = 0;
+		TRXPOS.SSAX = sx;
+		TRXPOS.SSAY = sy;
+		TRXPOS.DSAX = dx;
+		TRXPOS.DSAY = dy;
+		TRXREG.U64 = 0;
+		TRXREG.RRW = w;
+		TRXREG.RRH = h;
+		TRXDIR.U64 = 0;
+		TRXDIR.XDIR = 2;
+
+		AD({{GIF_A_D_REG_BITBLTBUF, BITBLTBUF.U64}, {GIF_A_D_REG_TRXPOS, TRXPOS.U64}, {GIF_A_D_REG_TRXREG, TRXREG.U64}, {GIF_A_D_REG_TRXDIR, TRXDIR.U64}});
+	}
+
+	// Vertices as RGBAQ, STQ or UV, and XYZ2
+	void Vertices(u32 prim, u32 iip, u32 tme, u32 fst, u32 abe, int count, int x0, int y0, int size)
+	{
+		GIFRegPRIM PRIM;
+
+		PRIM.U64 = 0;
+		PRIM.PRIM = prim;
+		PRIM.IIP = iip;
+		PRIM.TME = tme;
+		PRIM.FST = fst;
+		PRIM.ABE = abe;
+
+		const u32 regs = GIF_REG_RGBA | (fst ? GIF_REG_UV : GIF_REG_STQ) << 4 | GIF_REG_XYZ2 << 8;
+
+		Tag(count, GIF_FLG_PACKED, 3, regs, (u32)PRIM.U64, true);
+
+		for(int i = 0; i < count; i++)
+		{
+			m_frame.data.push_back(Rand(256) | (u64)Rand(256) << 32);
+			m_frame.data.push_back(Rand(256) | (u64)(0x40 + Rand(0x40)) << 32);
+
+			if(fst)
+			{
+				m_frame.data.push_back(Rand(64 << 4) | (u64)Rand(64 << 4) << 32);
+				m_frame.data.push_back(0);
+			}
+			else
+			{
+				const float s = Rand(0x10000) / 65536.0f;
+				const float t = Rand(0x10000) / 65536.0f;
+				const float q = 0.5f + Rand(0x10000) / 65536.0f;
+
+				u32 S, T, Q;
+				memcpy(&S, &s, 4);
+				memcpy(&T, &t, 4);
+				memcpy(&Q, &q, 4);
+
+				m_frame.data.push_back(S | (u64)T << 32);
+				m_frame.data.push_back(Q);
+			}
+
+			m_frame.data.push_back((x0 + Rand(size)) << 4 | (u64)((y0 + Rand(size)) << 4) << 32);
+			m_frame.data.push_back(Rand(0x10000));
+		}
+	}
+
+	void Pause(int read)
+	{
+		m_frame.sync = m_frame.data.size() / 2;
+		m_frame.read = read;
+	}
+};
+
+static u64 GSPipelineCheckTEX0(u32 tbp, u32 tbw, u32 psm, u32 tw, u32 th, u32 cbp, u32 cpsm, u32 csa, u32 cld)
+{
+	GIFRegTEX0 TEX0;
+
+	TEX0.U64 = 0;
+	TEX0.TBP0 = tbp;
+	TEX0.TBW = tbw;
+	TEX0.PSM = psm;
+	TEX0.TW = tw;
+	TEX0.TH = th;
+	TEX0.TCC = 1;
+	TEX0.CBP = cbp;
+	TEX0.CPSM = cpsm;
+	TEX0.CSM = 0;
+	TEX0.CSA = csa;
+	TEX0.CLD = cld;
+
+	return TEX0.U64;
+}
+
+// 320x224 frame buffer and Z buffer, then textures. Every frame reloads parts of the
+// textures and CLUTs, uploads a rectangle in one of the formats in two flushes,
+// draws gouraud triangles, textured sprites (32 bits, 8 and 4 bits with their CLUT),
+// copies part of the frame with a local -> local move and draws it back.
+static void GSPipelineCheckGenerate(int frame, GSPipelineCheckFrame& f)
+{
+	static const u32 formats[] =
+	{
+		PSM_PSMCT32, PSM_PSMCT24, PSM_PSMCT16, PSM_PSMCT16S, PSM_PSMT8, PSM_PSMT4, PSM_PSMT8H,
+		PSM_PSMT4HL, PSM_PSMT4HH, PSM_PSMZ32, PSM_PSMZ24, PSM_PSMZ16, PSM_PSMZ16S,
+	};
+
+	const u32 tex32 = 0x1000, tex8 = 0x1100, clut32 = 0x1140, tex4 = 0x1180, clut16 = 0x11c0, scratch = 0x1200, moved = 0x1400;
+
+	GSPipelineCheckStream s(f, 0x9e3779b9u * (frame + 1));
+
+	f.data.clear();
+	f.pieces.clear();
+	f.sync = SIZE_MAX;
+	f.read = 0;
+
+	GIFRegFRAME FRAME;
+	GIFRegZBUF ZBUF;
+	GIFRegTEST TEST;
+	GIFRegSCISSOR SCISSOR;
+	GIFRegALPHA ALPHA;
+	GIFRegTEX1 TEX1;
+
+	FRAME.U64 = 0;
+	FRAME.FBW = 5;
+	FRAME.PSM = PSM_PSMCT32;
+	ZBUF.U64 = 0;
+	ZBUF.ZBP = 35;
+	ZBUF.PSM = PSM_PSMZ24;
+	TEST.U64 = 0;
+	TEST.ZTE = 1;
+	TEST.ZTST = ZTST_GEQUAL;
+	SCISSOR.U64 = 0;
+	SCISSOR.SCAX1 = 319;
+	SCISSOR.SCAY1 = 223;
+	ALPHA.U64 = 0;
+	ALPHA.A = 0;
+	ALPHA.B = 1;
+	ALPHA.C = 0;
+	ALPHA.D = 1;
+	TEX1.U64 = 0;
+	TEX1.MMAG = frame & 1;
+	TEX1.MMIN = frame & 1;
+
+	s.AD({{GIF_A_D_REG_FRAME_1, FRAME.U64}, {GIF_A_D_REG_ZBUF_1, ZBUF.U64}, {GIF_A_D_REG_TEST_1, TEST.U64},
+		{GIF_A_D_REG_SCISSOR_1, SCISSOR.U64}, {GIF_A_D_REG_XYOFFSET_1, 0}, {GIF_A_D_REG_PRMODECONT, 1},
+		{GIF_A_D_REG_ALPHA_1, ALPHA.U64}, {GIF_A_D_REG_TEX1_1, TEX1.U64}, {GIF_A_D_REG_COLCLAMP, 1},
+		{GIF_A_D_REG_TEXA, 0x8000000080ull}});
+
+	// Textures and CLUTs
+
+	s.Upload(PSM_PSMCT32, tex32, 1, s.Rand(32), s.Rand(32), 1 + s.Rand(32), 1 + s.Rand(32));
+	s.Upload(PSM_PSMT8, tex8, 2, 0, 0, 37 + frame % 40, 20 + s.Rand(20), 3);
+	s.Upload(PSM_PSMCT32, clut32, 1, 0, 0, 16, 16);
+	s.Upload(PSM_PSMT4, tex4, 2, s.Rand(8), s.Rand(8), 33 + frame % 8, 16, 1);
+	s.Upload(PSM_PSMCT16, clut16, 1, 0, 0, 8, 2);
+
+	const u32 psm = formats[frame % ARRAY_SIZE(formats)];
+
+	s.UploadFlushed(psm, scratch, 4, s.Rand(64), s.Rand(64), 1 + s.Rand(80), 1 + s.Rand(40), GSPipelineCheckTEX0(scratch + frame, 4, PSM_PSMCT32, 6, 6, 0, 0, 0, 0));
+
+	// Draws
+
+	s.Vertices(GS_TRIANGLELIST, 1, 0, 0, frame & 1, 24, 0, 0, 320);
+
+	s.AD({{GIF_A_D_REG_TEX0_1, GSPipelineCheckTEX0(tex32, 1, PSM_PSMCT32, 6, 6, 0, 0, 0, 0)}});
+	s.Vertices(GS_SPRITE, 0, 1, 0, 0, 4, 0, 0, 320);
+
+	s.AD({{GIF_A_D_REG_TEX0_1, GSPipelineCheckTEX0(tex8, 2, PSM_PSMT8, 7, 6, clut32, PSM_PSMCT32, 0, 1)}});
+	s.Vertices(GS_SPRITE, 0, 1, 1, 1, 4, 0, 0, 320);
+
+	s.AD({{GIF_A_D_REG_TEX0_1, GSPipelineCheckTEX0(tex4, 2, PSM_PSMT4, 7, 7, clut16, PSM_PSMCT16, s.Rand(2), 1)}});
+	s.Vertices(GS_SPRITE, 0, 1, 1, 0, 4, 0, 0, 320);
+
+	if(frame % 3 == 1)
+	{
+		// The savestate finds half a strip and half an image transfer pending
+		s.AD({{GIF_A_D_REG_TEX0_1, GSPipelineCheckTEX0(scratch, 4, PSM_PSMCT32, 8, 7, 0, 0, 0, 0)}});
+		const int keep = 16 * (1 + s.Rand(6));
+		s.Upload(PSM_PSMCT32, moved + 0x80, 4, 0, 0, 32, 16, keep);
+		std::vector<u64> rest(f.data.end() - (128 - keep + 1) * 2, f.data.end());
+		f.data.resize(f.data.size() - rest.size());
+		s.Vertices(GS_TRIANGLESTRIP, 1, 1, 0, 0, 4, 0, 0, 320);
+		s.Pause(0);
+		f.data.insert(f.data.end(), rest.begin(), rest.end());
+		s.Vertices(GS_TRIANGLESTRIP, 1, 1, 0, 0, 3, 0, 0, 320);
+	}
+	else if(frame % 3 == 2)
+	{
+		GIFRegBITBLTBUF BITBLTBUF;
+		GIFRegTRXPOS TRXPOS;
+		GIFRegTRXREG TRXREG;
+
+		BITBLTBUF.U64 = 0;
+		BITBLTBUF.SBW = 5;
+		TRXPOS.U64 = 0;
+		TRXPOS.SSAX = s.Rand(256);
+		TRXPOS.SSAY = s.Rand(160);
+		TRXREG.U64 = 0;
+		TRXREG.RRW = 64;
+		TRXREG.RRH = 1 + s.Rand(64);
+
+		s.AD({{GIF_A_D_REG_BITBLTBUF, BITBLTBUF.U64}, {GIF_A_D_REG_TRXPOS, TRXPOS.U64}, {GIF_A_D_REG_TRXREG, TRXREG.U64}, {GIF_A_D_REG_TRXDIR, 1}});
+		s.Pause(TRXREG.RRH * 64 * 4 / 16);
+	}
+
+	s.Move(0, 5, s.Rand(256), s.Rand(160), moved, 4, s.Rand(64), s.Rand(64), 1 + s.Rand(64), 1 + s.Rand(64));
+
+	s.AD({{GIF_A_D_REG_TEX0_1, GSPipelineCheckTEX0(moved, 4, PSM_PSMCT32, 8, 7, 0, 0, 0, 0)}});
+	s.Vertices(GS_SPRITE, 0, 1, 1, 1, 2, 0, 0, 320);
+
+	for(size_t n = f.data.size() / 2, i = 0; i < n; )
+	{
+		u32 piece = std::min<u32>(1 + s.Rand(97), (u32)(n - i));
+		if(i < f.sync && i + piece > f.sync)
+			piece = (u32)(f.sync - i);
+		f.pieces.push_back(piece);
+		i += piece;
+	}
+}
+
+static u64 GSPipelineCheckPause(GSPipelineCheckRenderer* r, const GSPipelineCheckFrame& f)
+{
+	return f.read ? r->ReadChecksum(f.read) : r->FreezeChecksum();
+}
+
+// Feeds the frame to the renderer, or to the parse stage of the pipeline
+static void GSPipelineCheckFeed(const GSPipelineCheckFrame& f, const std::function<void(const u8*, u32)>& transfer, const std::function<void()>& pause)
+{
+	size_t pos = 0;
+
+	for(u32 piece : f.pieces)
+	{
+		if(pos == f.sync)
+			pause();
+
+		transfer((const u8*)&f.data[pos * 2], piece);
+		pos += piece;
+	}
+}
+
+void GScheckPipeline(BenchResults<lrps2_pipeline_check>& report)
+{
+	static const int frames = 48;
+
+	if (!s_gs)
+		GSinit();
+
+	// Transfer positions: GSLocalMemory::AdvanceImage against the writers, for every
+	// PSM value, with transfers flushed in random pieces
+
+	{
+		GSLocalMemory* mem = new GSLocalMemory();
+		u8* buff = (u8*)AlignedMalloc(256 * 1024, 32);
+
+		memset(buff, 0x5a, 256 * 1024);
+
+		u32 seed = 0x12345678;
+		auto rand = [&](u32 n) { seed = seed * 1664525 + 1013904223; return (int)((seed >> 8) % n); };
+
+		int cases = 0;
+		int mismatches = 0;
+
+		for(int i = 0; i < 20000; i++)
+		{
+			GIFRegBITBLTBUF BITBLTBUF;
+			GIFRegTRXPOS TRXPOS;
+			GIFRegTRXREG TRXREG;
+
+			BITBLTBUF.U64 = 0;
+			BITBLTBUF.DBP = rand(0x2000);
+			BITBLTBUF.DBW = 1 + rand(8);
+			BITBLTBUF.DPSM = i % 64;
+			TRXPOS.U64 = 0;
+			TRXPOS.DSAX = rand(70);
+			TRXPOS.DSAY = rand(70);
+			TRXREG.U64 = 0;
+			TRXREG.RRW = rand(4) ? 1 + rand(100) : rand(3);
+			TRXREG.RRH = 1 + rand(50);
+
+			const int total = (TRXREG.RRW * TRXREG.RRH * GSLocalMemory::m_psm[BITBLTBUF.DPSM].trbpp + 7) >> 3;
+
+			int tx = TRXPOS.DSAX, ty = TRXPOS.DSAY;
+			int ax = tx, ay = ty;
+
+			for(int done = 0; done < total; )
+			{
+				const int len = std::min(total - done, 1 + rand(std::max(total / 3, 1)));
+
+				(mem->*GSLocalMemory::m_psm[BITBLTBUF.DPSM].wi)(tx, ty, buff, len, BITBLTBUF, TRXPOS, TRXREG);
+				GSLocalMemory::AdvanceImage(ax, ay, len, BITBLTBUF, TRXPOS, TRXREG);
+
+				cases++;
+				if(tx != ax || ty != ay)
+				{
+					mismatches++;
+					ax = tx;
+					ay = ty;
+				}
+
+				done += len;
+			}
+		}
+
+		report({"transfer_position", cases, mismatches});
+
+		AlignedFree(buff);
+		delete mem;
+	}
+
+	std::vector<GSPipelineCheckFrame> stream(frames);
+
+	for(int i = 0; i < frames; i++)
+		GSPipelineCheckGenerate(i, stream[i]);
+
+	u8* regs = (u8*)AlignedMalloc(0x2000, 32);
+
+	memset(regs, 0, 0x2000);
+
+	// The same frames rendered directly and through the pipeline, with the parse stage
+	// on a thread of its own like MTGS runs it: local memory after every frame,
+	// savestates and local -> host transfers must be the same
+
+	for(int threads : {0, 2})
+	{
+		std::vector<u64> direct, pipelined;
+
+		{
+			GSPipelineCheckRenderer* r = new GSPipelineCheckRenderer(threads);
+			r->SetRegsMem(regs);
+
+			for(const GSPipelineCheckFrame& f : stream)
+			{
+				GSPipelineCheckFeed(f,
+					[&](const u8* mem, u32 size) { r->Transfer<3>(mem, size); },
+					[&] { direct.push_back(GSPipelineCheckPause(r, f)); });
+
+				r->Flush();
+				direct.push_back(r->Checksum());
+			}
+
+			delete r;
+		}
+
+		{
+			GSPipelineCheckRenderer* r = new GSPipelineCheckRenderer(threads);
+			r->SetRegsMem(regs);
+
+			GSPipeline* pipeline = new GSPipeline(r);
+
+			pipeline->StartParsing([&] {
+				for(const GSPipelineCheckFrame& f : stream)
+				{
+					GSPipelineCheckFeed(f,
+						[&](const u8* mem, u32 size) { pipeline->Transfer(mem, size); },
+						[&] { pipeline->Sync([&] { pipelined.push_back(GSPipelineCheckPause(r, f)); }); });
+
+					// Runs on the render stage, like the Sync() above
+					pipeline->PostFrame([&] { pipelined.push_back(r->Checksum()); });
+				}
+
+				while(!pipeline->Stopping())
+					std::this_thread::sleep_for(std::chrono::milliseconds(1));
+			});
+
+			for(int i = 0; i < frames; i++)
+				while(!pipeline->Execute())
+				{
+				}
+
+			pipeline->StopParsing();
+			delete pipeline;
+
+			delete r;
+		}
+
+		int mismatches = (int)std::max(direct.size(), pipelined.size()) - (int)std::min(direct.size(), pipelined.size());
+
+		for(size_t i = 0; i < std::min(direct.size(), pipelined.size()); i++)
+			if(direct[i] != pipelined[i])
+				mismatches++;
+
+		report({threads ? "sw_threaded" : "sw", (int)direct.size(), mismatches});
+	}
+
+	// Stopping the pipeline while the parse stage waits for the render stage: in
+	// PostFrame() with a frame already queued, and in Sync(). Everything it queued is
+	// rendered, the renderer ends up where the direct path does after as many frames.
+
+	for(int sync = 0; sync < 2; sync++)
+	{
+		GSPipelineCheckRenderer* r = new GSPipelineCheckRenderer(0);
+		r->SetRegsMem(regs);
+
+		GSPipeline* pipeline = new GSPipeline(r);
+
+		std::atomic<int> posted(0);
+		std::atomic<bool> waiting(false);
+
+		pipeline->StartParsing([&] {
+			for(const GSPipelineCheckFrame& f : stream)
+			{
+				if(pipeline->Stopping())
+					break;
+
+				GSPipelineCheckFeed(f,
+					[&](const u8* mem, u32 size) { pipeline->Transfer(mem, size); },
+					[&] {
+						if(sync)
+						{
+							waiting = true;
+							pipeline->Sync([&] { GSPipelineCheckPause(r, f); });
+						}
+					});
+
+				if(posted > 0)
+					waiting = true;
+
+				pipeline->PostFrame([] {});
+				posted++;
+			}
+
+			while(!pipeline->Stopping())
+				std::this_thread::sleep_for(std::chrono::milliseconds(1));
+		});
+
+		while(!waiting)
+			std::this_thread::sleep_for(std::chrono::milliseconds(1));
+		std::this_thread::sleep_for(std::chrono::milliseconds(20));
+
+		pipeline->StopParsing();
+		delete pipeline;
+
+		const u64 stopped = r->Checksum();
+		delete r;
+
+		r = new GSPipelineCheckRenderer(0);
+		r->SetRegsMem(regs);
+
+		for(int i = 0; i < posted; i++)
+		{
+			GSPipelineCheckFeed(stream[i],
+				[&](const u8* mem, u32 size) { r->Transfer<3>(mem, size); },
+				[&] { if(sync) GSPipelineCheckPause(r, stream[i]); });
+			r->Flush();
+		}
+
+		const u64 direct = r->Checksum();
+		delete r;
+
+		report({sync ? "stop_in_sync" : "stop_in_postframe", posted, stopped != direct});
+	}
+
+	// Stopping the pipeline while the parse stage waits for something outside it, like
+	// MTGS for the xgkick of a VU1 program MTVU doesn't get to run. Wait() must give up
+	// instead of holding up the stop; if it doesn't, the wait ends by itself after two
+	// seconds and the test fails. Everything queued before is rendered.
+
+	{
+		GSPipelineCheckRenderer* r = new GSPipelineCheckRenderer(0);
+		r->SetRegsMem(regs);
+
+		GSPipeline* pipeline = new GSPipeline(r);
+
+		std::atomic<int> posted(0);
+		std::atomic<bool> waiting(false);
+		std::atomic<bool> gave_up(false);
+
+		pipeline->StartParsing([&] {
+			for(const GSPipelineCheckFrame& f : stream)
+			{
+				// The first frames wait a couple of polls, then nothing comes
+				int polls = 0;
+				const bool ready = pipeline->Wait([&] {
+					std::this_thread::sleep_for(std::chrono::milliseconds(1));
+					polls++;
+					if(posted < 3)
+						return polls >= 2;
+					waiting = true;
+					return polls >= 2000;
+				});
+
+				if(!ready)
+				{
+					gave_up = true;
+					break;
+				}
+
+				GSPipelineCheckFeed(f, [&](const u8* mem, u32 size) { pipeline->Transfer(mem, size); }, [] {});
+
+				pipeline->PostFrame([] {});
+				posted++;
+			}
+
+			while(!pipeline->Stopping())
+				std::this_thread::sleep_for(std::chrono::milliseconds(1));
+		});
+
+		while(!waiting)
+			pipeline->Execute();
+		std::this_thread::sleep_for(std::chrono::milliseconds(20));
+
+		pipeline->StopParsing();
+		delete pipeline;
+
+		const u64 stopped = r->Checksum();
+		delete r;
+
+		r = new GSPipelineCheckRenderer(0);
+		r->SetRegsMem(regs);
+
+		for(int i = 0; i < posted; i++)
+		{
+			GSPipelineCheckFeed(stream[i], [&](const u8* mem, u32 size) { r->Transfer<3>(mem, size); }, [] {});
+			r->Flush();
+		}
+
+		const u64 direct = r->Checksum();
+		delete r;
+
+		report({"stop_in_wait", posted, !gave_up || stopped != direct});
+	}
+
+	AlignedFree(regs);
+}
@@ -0,0 +1,351 @@
+/* GS local memory transfer benchmark and check of the benchmark core
+ * (lrps2_run_transfer_bench, lrps2_run_transfer_check).
+ *
+ * The check holds the block based writers and readers of the psm table, wi
+ * and ri, against the per pixel WriteImageX and ReadImageX, for every format,
+ * rectangles on and off the block grid and transfers cut in pieces the way
+ * GIF packets cut them. The GSBlock kernels of the 24 and 4 bits readers are
+ * checked against ReadBlock32 on their own.
+ */
+
+#include "BenchCore.h"
+
+#include "GS/GSBlock.h"
+#include "GS/GSFuncs.h"
+#include "GS/GSLocalMemory.h"
+
+#include <chrono>
+
+static const struct { const char* name; u32 psm; int trbpp; } formats[] =
+{
+	{"C32", PSM_PSMCT32, 32}, {"C24", PSM_PSMCT24, 24}, {"C16", PSM_PSMCT16, 16}, {"C16S", PSM_PSMCT16S, 16},
+	{"T8", PSM_PSMT8, 8}, {"T4", PSM_PSMT4, 4}, {"T8H", PSM_PSMT8H, 8}, {"T4HL", PSM_PSMT4HL, 4}, {"T4HH", PSM_PSMT4HH, 4},
+	{"Z32", PSM_PSMZ32, 32}, {"Z24", PSM_PSMZ24, 24}, {"Z16", PSM_PSMZ16, 16}, {"Z16S", PSM_PSMZ16S, 16},
+};
+
+static void SetTransfer(u32 psm, u32 bp, u32 bw, int x, int y, int w, int h, GIFRegBITBLTBUF& BITBLTBUF, GIFRegTRXPOS& TRXPOS, GIFRegTRXREG& TRXREG)
+{
+	BITBLTBUF.U64 = 0;
+	BITBLTBUF.DBP = BITBLTBUF.SBP = bp;
+	BITBLTBUF.DBW = BITBLTBUF.SBW = bw;
+	BITBLTBUF.DPSM = BITBLTBUF.SPSM = psm;
+	TRXPOS.U64 = 0;
+	TRXPOS.DSAX = TRXPOS.SSAX = x;
+	TRXPOS.DSAY = TRXPOS.SSAY = y;
+	TRXREG.U64 = 0;
+	TRXREG.RRW = w;
+	TRXREG.RRH = h;
+}
+
+void GSbenchmarkTransfers(BenchResults<lrps2_transfer_bench>& report)
+{
+	// Whole pages, an odd rectangle starting mid block and a sprite sized one
+	static const struct { const char* name; int x, y, w, h; } cases[] =
+	{
+		{"aligned", 0, 0, 512, 256},
+		{"unaligned", 3, 5, 500, 250},
+		{"small", 5, 3, 30, 18},
+	};
+
+	// The block tables have to be set up, but a running renderer must be left alone
+	if (!s_gs)
+		GSinit();
+
+	GSLocalMemory* mem = new GSLocalMemory();
+	u8* buff = (u8*)AlignedMalloc(512 * 256 * 4, 32);
+
+	u32 seed = 0x12345678;
+	for (int i = 0; i < 512 * 256 * 4; i++)
+	{
+		seed = seed * 1664525 + 1013904223;
+		buff[i] = (u8)(seed >> 24);
+	}
+
+	for (const auto& f : formats)
+	{
+		for (const auto& c : cases)
+		{
+			for (int write = 1; write >= 0; write--)
+			{
+				GIFRegBITBLTBUF BITBLTBUF;
+				GIFRegTRXPOS TRXPOS;
+				GIFRegTRXREG TRXREG;
+
+				SetTransfer(f.psm, 0, 8, c.x, c.y, c.w, c.h, BITBLTBUF, TRXPOS, TRXREG);
+
+				const int len = ((c.w * f.trbpp + 7) >> 3) * c.h;
+				const GSLocalMemory::psm_t& psm = GSLocalMemory::m_psm[f.psm];
+
+				u64 bytes = 0;
+				const auto start = std::chrono::steady_clock::now();
+				std::chrono::duration<double> elapsed;
+
+				do
+				{
+					for (int i = 0; i < 16; i++)
+					{
+						int tx = c.x, ty = c.y;
+
+						if (write)
+							(mem->*psm.wi)(tx, ty, buff, len, BITBLTBUF, TRXPOS, TRXREG);
+						else
+							(mem->*psm.ri)(tx, ty, buff, len, BITBLTBUF, TRXPOS, TRXREG);
+					}
+
+					bytes += (u64)len * 16;
+					elapsed = std::chrono::steady_clock::now() - start;
+				} while (elapsed.count() < 0.02);
+
+				report({f.name, c.name, write, bytes / elapsed.count() / (1024.0 * 1024.0)});
+			}
+		}
+	}
+
+	AlignedFree(buff);
+	delete mem;
+}
+
+static u32 s_seed;
+
+static u32 CheckRand()
+{
+	s_seed = s_seed * 1664525 + 1013904223;
+	return (s_seed >> 16) | (s_seed << 16);
+}
+
+// Cuts a transfer in pieces: all of it (twice, for the two destination
+// offsets of the reads), quadword by quadword like the packets of a PATH3
+// upload, or a few quadwords at a time like the draws in between flush it
+static int NextPiece(int piece, int left)
+{
+	switch (piece)
+	{
+		case 0:
+		case 1: return left;
+		case 2: return std::min(left, 16);
+		default: return std::min(left, 16 * (int)(1 + CheckRand() % 8));
+	}
+}
+
+static void FillRandom(u8* p, int len)
+{
+	for (int i = 0; i < len; i++)
+		p[i] = (u8)(CheckRand() >> 8);
+}
+
+static void CheckBlocks(BenchResults<lrps2_transfer_check>& report)
+{
+	alignas(32) u8 block[256];
+	alignas(32) u32 ref32[8 * 8];
+	alignas(32) u8 out[8 * 48];
+	alignas(32) u8 ref[8 * 48];
+
+	int cases[4] = {};
+	int mismatches[4] = {};
+
+	for (int run = 0; run < 256; run++)
+	{
+		FillRandom(block, sizeof(block));
+		GSBlock::ReadBlock32(block, (u8*)ref32, 32);
+
+		// The pitch is never the packed width of the block in the transfers
+		const int pitch = 24 + (run % 4) * 8;
+
+		// ReadBlock24: the low 3 bytes of each pixel
+		memset(out, 0xcc, sizeof(out));
+		memset(ref, 0xcc, sizeof(ref));
+		GSBlock::ReadBlock24(block, out, pitch);
+		for (int y = 0; y < 8; y++)
+			for (int x = 0; x < 8; x++)
+				memcpy(&ref[y * pitch + x * 3], &ref32[y * 8 + x], 3);
+		cases[0]++;
+		mismatches[0] += memcmp(out, ref, 7 * pitch + 24) != 0;
+
+		// ReadBlock4HL/4HH: bits 24-27 or 28-31 of each pixel, the even pixel in the low nibble
+		for (int hh = 0; hh < 2; hh++)
+		{
+			memset(out, 0xcc, sizeof(out));
+			memset(ref, 0xcc, sizeof(ref));
+			if (hh)
+				GSBlock::ReadBlock4HH(block, out, pitch);
+			else
+				GSBlock::ReadBlock4HL(block, out, pitch);
+			for (int y = 0; y < 8; y++)
+				for (int x = 0; x < 8; x += 2)
+					ref[y * pitch + x / 2] = ((ref32[y * 8 + x] >> (24 + hh * 4)) & 0xf) | (((ref32[y * 8 + x + 1] >> (24 + hh * 4)) & 0xf) << 4);
+			cases[1 + hh]++;
+			mismatches[1 + hh] += memcmp(out, ref, 7 * pitch + 4) != 0;
+		}
+
+		// PackBlock4 on its own, on indices that aren't those of a real block
+		alignas(16) u8 indices[8 * 8];
+		for (int i = 0; i < 64; i++)
+			indices[i] = block[i] & 0xf;
+		memset(out, 0xcc, sizeof(out));
+		memset(ref, 0xcc, sizeof(ref));
+		GSBlock::PackBlock4(indices, out, pitch);
+		for (int y = 0; y < 8; y++)
+			for (int x = 0; x < 8; x += 2)
+				ref[y * pitch + x / 2] = indices[y * 8 + x] | (indices[y * 8 + x + 1] << 4);
+		cases[3]++;
+		mismatches[3] += memcmp(out, ref, 7 * pitch + 4) != 0;
+	}
+
+	static const char* names[4] = {"ReadBlock24", "ReadBlock4HL", "ReadBlock4HH", "PackBlock4"};
+
+	for (int i = 0; i < 4; i++)
+		report({"GSBlock", names[i], cases[i], mismatches[i]});
+}
+
+void GScheckTransfers(BenchResults<lrps2_transfer_check>& report)
+{
+	// On the block grid, starting and ending mid block, odd widths (a 4 bits
+	// row that doesn't end on a byte), single rows and pixels, a buffer width
+	// that isn't a whole number of pages and a base pointer that isn't 0
+	static const struct { u32 bp, bw; int x, y, w, h; } rects[] =
+	{
+		{0, 8, 0, 0, 64, 32},
+		{0, 8, 0, 0, 128, 64},
+		{0, 8, 3, 5, 45, 27},
+		{0, 8, 7, 1, 33, 9},
+		{0, 8, 8, 8, 16, 16},
+		{0, 8, 31, 15, 2, 2},
+		{0, 8, 13, 17, 1, 1},
+		{0, 8, 1, 2, 200, 3},
+		{0, 8, 5, 0, 1, 40},
+		{0x1a0, 3, 9, 6, 150, 21},
+		{0x2000, 2, 64, 32, 40, 40},
+	};
+
+	if (!s_gs)
+		GSinit();
+
+	CheckBlocks(report);
+
+	GSLocalMemory* mem = new GSLocalMemory();
+	GSLocalMemory* ref = new GSLocalMemory();
+
+	// Big enough for the largest rectangle at 32 bits, and an offset
+	const int size = 200 * 64 * 4 + 64;
+	u8* src = (u8*)AlignedMalloc(size, 32);
+	u8* out = (u8*)AlignedMalloc(size, 32);
+	u8* expected = (u8*)AlignedMalloc(size, 32);
+
+	// Whatever the transfers before left in memory, the reference starts from the same
+	s_seed = 0x2545f491;
+	FillRandom(mem->m_vm8, GSLocalMemory::m_vmsize);
+
+	for (const auto& f : formats)
+	{
+		const GSLocalMemory::psm_t& psm = GSLocalMemory::m_psm[f.psm];
+
+		// The 32, 16, 8 and 4 bits formats keep the writer they always had,
+		// WriteImage, only the others are held against WriteImageX. For 4 bits
+		// WriteImage doesn't place the pixels like WriteImageX and ReadImageX
+		// when the rectangle starts on an odd x or has an odd width, those
+		// don't round trip.
+		const bool masked = f.trbpp == 24 || f.psm == PSM_PSMT8H || f.psm == PSM_PSMT4HL || f.psm == PSM_PSMT4HH;
+
+		int cases[3] = {};
+		int mismatches[3] = {};
+
+		for (const auto& r : rects)
+		{
+			GIFRegBITBLTBUF BITBLTBUF;
+			GIFRegTRXPOS TRXPOS;
+			GIFRegTRXREG TRXREG;
+
+			SetTransfer(f.psm, r.bp, r.bw, r.x, r.y, r.w, r.h, BITBLTBUF, TRXPOS, TRXREG);
+
+			// Like GSState's transfer buffer, a 4 bits transfer of an odd number of pixels ends mid byte
+			const int total = (r.w * r.h * f.trbpp + 7) >> 3;
+
+			for (int piece = 0; piece < 4; piece++)
+			{
+				// Host -> local: the same memory before, the same memory and position after each piece
+				memcpy(ref->m_vm8, mem->m_vm8, GSLocalMemory::m_vmsize);
+				FillRandom(src, total);
+
+				int tx = r.x, ty = r.y;
+				int rx = r.x, ry = r.y;
+				bool match = true;
+
+				for (int done = 0, n; done < total; done += n)
+				{
+					n = NextPiece(piece, total - done);
+
+					(mem->*psm.wi)(tx, ty, src + done, n, BITBLTBUF, TRXPOS, TRXREG);
+
+					if (masked)
+					{
+						ref->WriteImageX(rx, ry, src + done, n, BITBLTBUF, TRXPOS, TRXREG);
+						match &= tx == rx && ty == ry;
+					}
+				}
+
+				if (masked)
+				{
+					match &= memcmp(mem->m_vm8, ref->m_vm8, GSLocalMemory::m_vmsize) == 0;
+
+					cases[0]++;
+					mismatches[0] += !match;
+				}
+
+				// Local -> host of what was just written, into a destination that
+				// is 16 bytes aligned or not
+				const int offset = (piece & 1) * 4;
+
+				memset(out, 0xcc, size);
+				memset(expected, 0xcc, size);
+
+				tx = rx = r.x;
+				ty = ry = r.y;
+				match = true;
+
+				for (int done = 0, n; done < total; done += n)
+				{
+					n = NextPiece(piece, total - done);
+
+					(mem->*psm.ri)(tx, ty, out + offset + done, n, BITBLTBUF, TRXPOS, TRXREG);
+					mem->ReadImageX(rx, ry, expected + offset + done, n, BITBLTBUF, TRXPOS, TRXREG);
+
+					match &= tx == rx && ty == ry;
+				}
+
+				match &= memcmp(out, expected, size) == 0;
+
+				cases[1]++;
+				mismatches[1] += !match;
+
+				// What was written must come back, but the last nibble of an odd 4 bits
+				// transfer. WriteImageX and ReadImageX drop the bytes of a 24 bits
+				// pixel cut by the end of a piece, so those only come back whole.
+				if ((f.trbpp == 24 && piece >= 2) || (!masked && f.trbpp == 4 && ((r.x | r.w) & 1)))
+					continue;
+
+				if (f.trbpp == 4 && (r.w * r.h & 1))
+				{
+					out[offset + total - 1] &= 0x0f;
+					src[total - 1] &= 0x0f;
+				}
+
+				cases[2]++;
+				mismatches[2] += memcmp(out + offset, src, total) != 0;
+			}
+		}
+
+		static const char* tests[3] = {"write", "read", "round_trip"};
+
+		for (int i = 0; i < 3; i++)
+		{
+			if (cases[i])
+				report({f.name, tests[i], cases[i], mismatches[i]});
+		}
+	}
+
+	AlignedFree(expected);
+	AlignedFree(out);
+	AlignedFree(src);
+	delete ref;
+	delete mem;
+}
@@ -0,0 +1,346 @@
+/* GS vertex trace benchmark and check of the benchmark core
+ * (lrps2_run_vertex_trace_bench, lrps2_run_vertex_trace_check).
+ *
+ * Both run every kernel the CPU can: the one the build targets, and the AVX2
+ * one GSVertexTrace picks at runtime when the CPU has AVX2.
+ */
+
+#include "BenchCore.h"
+
+#include "GS/GSFuncs.h"
+#include "GS/GSState.h"
+
+#include <chrono>
+
+// Renders nothing, only gives the benchmark its drawing environment and vertex trace
+class GSVertexTraceBench final : public GSState
+{
+public:
+	void Draw() {}
+	void PurgePool() {}
+
+	void Trace(const GSVertex* vertex, const u32* index, int count, GS_PRIM_CLASS primclass)
+	{
+		m_vt.Update(vertex, index, count, count, primclass);
+	}
+
+	void CorrectDepth(const GSVertex* vertex, int count)
+	{
+		m_vt.CorrectDepthTrace(vertex, count);
+	}
+
+	const GSVertexTrace& VertexTrace() const { return m_vt; }
+	void SelectKernels(bool avx2) { m_vt.SelectKernels(avx2); }
+	const GSDrawingContext& Context() const { return *m_context; }
+
+	// A decal with the texture alpha leaves no vertex color to trace
+	void SetPrim(u32 prim, u32 iip, u32 tme, u32 fst, bool decal = false)
+	{
+		m_env.PRIM.U64 = 0;
+		m_env.PRIM.PRIM = prim;
+		m_env.PRIM.IIP = iip;
+		m_env.PRIM.TME = tme;
+		m_env.PRIM.FST = fst;
+		// Reset() leaves PRIM pointing to PRMODE
+		m_env.PRMODECONT.AC = 1;
+		PRIM = &m_env.PRIM;
+		UpdateContext();
+
+		m_context->TEST.ZTE = 1;
+		m_context->TEST.ZTST = ZTST_GEQUAL;
+		m_context->TEX0.TW = 8;
+		m_context->TEX0.TH = 8;
+		m_context->TEX0.TFX = decal ? TFX_DECAL : TFX_MODULATE;
+		m_context->TEX0.TCC = decal;
+		m_context->TEX1.MXL = 1;
+	}
+};
+
+// The kernels of the build, and the AVX2 ones when the CPU has AVX2
+static const struct { const char* name; bool avx2; } kernels[] =
+{
+	{"sse", false},
+	{"avx2", true},
+};
+
+void GSbenchmarkVertexTrace(BenchResults<lrps2_vertex_trace_bench>& report)
+{
+	static const struct { const char* name; GS_PRIM_CLASS primclass; u32 prim; } classes[] =
+	{
+		{"point", GS_POINT_CLASS, GS_POINTLIST},
+		{"line", GS_LINE_CLASS, GS_LINELIST},
+		{"triangle", GS_TRIANGLE_CLASS, GS_TRIANGLELIST},
+		{"sprite", GS_SPRITE_CLASS, GS_SPRITE},
+	};
+
+	static const struct { const char* name; u32 iip, tme, fst; } attributes[] =
+	{
+		{"gouraud", 1, 0, 0},
+		{"gouraud_stq", 1, 1, 0},
+		{"flat_uv", 0, 1, 1},
+	};
+
+	// A HUD element, a mid sized model and a particle batch
+	static const int sizes[] = {6, 96, 4800};
+
+	if (!s_gs)
+		GSinit();
+
+	GSVertexTraceBench* state = new GSVertexTraceBench();
+	GSVertex* vertex = (GSVertex*)AlignedMalloc(sizeof(GSVertex) * 4800, 32);
+	u32* index = (u32*)AlignedMalloc(sizeof(u32) * 4800, 32);
+
+	// Sequential indices, like the vertex kick generates them. The Z is constant so
+	// that the depth is checked as well.
+	u32 seed = 0x12345678;
+	auto rand = [&]() { seed = seed * 1664525 + 1013904223; return seed >> 8; };
+
+	for (int i = 0; i < 4800; i++)
+	{
+		GSVertex& v = vertex[i];
+		v.ST.S = (float)(rand() & 0xffff) / 0x10000;
+		v.ST.T = (float)(rand() & 0xffff) / 0x10000;
+		v.RGBAQ.U32[0] = rand();
+		v.RGBAQ.Q = 0.5f + (float)(rand() & 0xffff) / 0x10000;
+		v.XYZ.X = 0x8000 + (rand() & 0x1fff);
+		v.XYZ.Y = 0x8000 + (rand() & 0x1fff);
+		v.XYZ.Z = 0x1234;
+		v.UV = rand() & 0x3fff3fff;
+		v.FOG = 0;
+		index[i] = i;
+	}
+
+	for (const auto& k : kernels)
+	{
+		if (k.avx2 && !GSVertexTrace::HasAVX2())
+			continue;
+
+		for (const auto& c : classes)
+		{
+			for (const auto& a : attributes)
+			{
+				state->SetPrim(c.prim, a.iip, a.tme, a.fst);
+				state->SelectKernels(k.avx2);
+
+				for (int size : sizes)
+				{
+					u64 vertices = 0;
+					const auto start = std::chrono::steady_clock::now();
+					std::chrono::duration<double> elapsed;
+
+					do
+					{
+						for (int i = 0; i < 4800 / size; i++)
+							state->Trace(vertex + i * size, index, size, c.primclass);
+
+						vertices += 4800 / size * size;
+						elapsed = std::chrono::steady_clock::now() - start;
+					} while (elapsed.count() < 0.02);
+
+					report({k.name, c.name, a.name, size, vertices / elapsed.count() / 1000000.0});
+				}
+			}
+		}
+	}
+
+	AlignedFree(index);
+	AlignedFree(vertex);
+	delete state;
+}
+
+// Scalar model of the vertex trace: every vertex counts for the position and the
+// texture coordinates, the color only comes from the vertex that gives a flat
+// primitive its color. Sprites take the fog and Q of their second vertex.
+static void TraceVertices(const GSDrawingContext& context, const GSVertex* vertex, const u32* index, int count, int n, bool sprite, u32 iip, u32 tme, u32 fst, u32 color, GSVertexTrace::Vertex (&r)[2])
+{
+	u32 pmin[4] = {UINT32_MAX, UINT32_MAX, UINT32_MAX, UINT32_MAX};
+	u32 pmax[4] = {0, 0, 0, 0};
+	float tmin[4] = {FLT_MAX, FLT_MAX, FLT_MAX, FLT_MAX};
+	float tmax[4] = {-FLT_MAX, -FLT_MAX, -FLT_MAX, -FLT_MAX};
+	u8 cmin[4] = {0xff, 0xff, 0xff, 0xff};
+	u8 cmax[4] = {0, 0, 0, 0};
+
+	for (int i = 0; i < count; i++)
+	{
+		const GSVertex& v = vertex[index[i]];
+		const GSVertex& last = vertex[index[i - i % n + n - 1]];
+
+		const u32 p[4] = {v.XYZ.X, v.XYZ.Y, v.XYZ.Z, sprite ? last.FOG : v.FOG};
+
+		for (int j = 0; j < 4; j++)
+		{
+			pmin[j] = std::min(pmin[j], p[j]);
+			pmax[j] = std::max(pmax[j], p[j]);
+		}
+
+		if (tme)
+		{
+			const float q = sprite ? last.RGBAQ.Q : v.RGBAQ.Q;
+			const float t[4] = {
+				fst ? (float)(v.UV & 0xffff) : v.ST.S * q,
+				fst ? (float)(v.UV >> 16) : v.ST.T * q,
+				fst ? (float)(v.UV & 0xffff) : q,
+				fst ? (float)(v.UV >> 16) : q,
+			};
+
+			for (int j = 0; j < 4; j++)
+			{
+				tmin[j] = std::min(tmin[j], t[j]);
+				tmax[j] = std::max(tmax[j], t[j]);
+			}
+		}
+
+		if (iip || i % n == n - 1)
+		{
+			for (int j = 0; j < 4; j++)
+			{
+				cmin[j] = std::min(cmin[j], (u8)(v.RGBAQ.U32[0] >> j * 8));
+				cmax[j] = std::max(cmax[j], (u8)(v.RGBAQ.U32[0] >> j * 8));
+			}
+		}
+	}
+
+	// The scaling is the same as GSVertexTrace's, it isn't what is checked
+	for (int k = 0; k < 2; k++)
+	{
+		const u32* pk = k ? pmax : pmin;
+		const float* tk = k ? tmax : tmin;
+		const u8* ck = k ? cmax : cmin;
+
+		r[k].p = (GSVector4(GSVector4i(pk[0], pk[1], pk[2], pk[3])) - GSVector4(context.XYOFFSET)) * GSVector4(1.0f / 16, 1.0f / 16, 2.0f, 1.0f);
+		r[k].p = r[k].p.insert32<0, 2>(GSVector4::load((float)pk[2]));
+
+		if (!tme)
+			r[k].t = GSVector4::zero();
+		else if (fst)
+			r[k].t = GSVector4(tk[0], tk[1], tk[2], tk[3]) * GSVector4(1.0f / 16, 1.0f).xxyy();
+		else
+			r[k].t = GSVector4(tk[0], tk[1], tk[2], tk[3]) * GSVector4(1 << context.TEX0.TW, 1 << context.TEX0.TH, 1, 1);
+
+		r[k].c = color ? GSVector4i(ck[0], ck[1], ck[2], ck[3]) : GSVector4i::zero();
+	}
+}
+
+void GScheckVertexTrace(BenchResults<lrps2_vertex_trace_check>& report)
+{
+	static const struct { const char* name; GS_PRIM_CLASS primclass; u32 prim; int n; } classes[] =
+	{
+		{"point", GS_POINT_CLASS, GS_POINTLIST, 1},
+		{"line", GS_LINE_CLASS, GS_LINELIST, 2},
+		{"triangle", GS_TRIANGLE_CLASS, GS_TRIANGLELIST, 3},
+		{"sprite", GS_SPRITE_CLASS, GS_SPRITE, 2},
+	};
+
+	static const struct { const char* name; u32 iip, tme, fst; bool decal; } attributes[] =
+	{
+		{"gouraud", 1, 0, 0, false},
+		{"flat", 0, 0, 0, false},
+		{"gouraud_stq", 1, 1, 0, false},
+		{"flat_stq", 0, 1, 0, false},
+		{"flat_uv", 0, 1, 1, false},
+		{"decal_uv", 1, 1, 1, true},
+	};
+
+	// Primitives per draw: the tails of the unrolled loops, and a long draw
+	static const int prims[] = {1, 2, 3, 4, 5, 7, 8, 13, 33, 1000};
+
+	if (!s_gs)
+		GSinit();
+
+	GSVertexTraceBench* state = new GSVertexTraceBench();
+	GSVertex* vertex = (GSVertex*)AlignedMalloc(sizeof(GSVertex) * 3000, 32);
+	u32* index = (u32*)AlignedMalloc(sizeof(u32) * 3000, 32);
+
+	u32 seed = 0x9e3779b9;
+	auto rand = [&]() { seed = seed * 1664525 + 1013904223; return (seed >> 16) | (seed << 16); };
+
+	for (const auto& k : kernels)
+	{
+		if (k.avx2 && !GSVertexTrace::HasAVX2())
+			continue;
+
+		for (const auto& c : classes)
+		{
+			for (const auto& a : attributes)
+			{
+				state->SetPrim(c.prim, a.iip, a.tme, a.fst, a.decal);
+				state->SelectKernels(k.avx2);
+
+				const GSVertexTrace& vt = state->VertexTrace();
+				const u32 color = !a.decal;
+				int cases = 0;
+				int mismatches = 0;
+
+				for (int prim : prims)
+				{
+					const int count = prim * c.n;
+
+					// Z: constant even, constant odd, one vertex off the constant, anything
+					for (int zmode = 0; zmode < 4; zmode++)
+					{
+						for (int run = 0; run < 4; run++)
+						{
+							const u32 z = (rand() & ~1u) | (zmode & 1);
+							const int odd = rand() % count;
+
+							for (int i = 0; i < count; i++)
+							{
+								GSVertex& v = vertex[i];
+								v.ST.S = (float)(s32)(rand() & 0xffff) / 0x4000 - 2.0f;
+								v.ST.T = (float)(s32)(rand() & 0xffff) / 0x4000 - 2.0f;
+								v.RGBAQ.U32[0] = rand();
+								v.RGBAQ.Q = (float)((rand() & 0xffff) + 1) / 0x4000;
+								v.XYZ.X = rand();
+								v.XYZ.Y = rand();
+								v.XYZ.Z = zmode == 3 ? rand() : zmode == 2 && i == odd ? z ^ (1u << (rand() % 32)) : z;
+								v.UV = rand();
+								v.FOG = rand();
+							}
+
+							// The vertex kick gives sprites their vertices in order, the
+							// other classes can come from an index buffer
+							for (int i = 0; i < count; i++)
+								index[i] = i;
+							if (c.primclass != GS_SPRITE_CLASS)
+								for (int i = count - 1; i > 0; i--)
+									std::swap(index[i], index[rand() % (i + 1)]);
+
+							state->Trace(vertex, index, count, c.primclass);
+
+							GSVertexTrace::Vertex r[2];
+							TraceVertices(state->Context(), vertex, index, count, c.n, c.primclass == GS_SPRITE_CLASS, a.iip, a.tme, a.fst, color, r);
+
+							// Bitwise, the float ranges must not even differ in the sign of a zero
+							const GSVertexTrace::Vertex* m[2] = {&vt.m_min, &vt.m_max};
+							bool match = true;
+							for (int k = 0; k < 2; k++)
+							{
+								match &= (m[k]->c == r[k].c).alltrue();
+								match &= (GSVector4i::cast(m[k]->p) == GSVector4i::cast(r[k].p)).alltrue();
+								match &= (GSVector4i::cast(m[k]->t) == GSVector4i::cast(r[k].t)).alltrue();
+							}
+
+							// An odd first Z must be the and of all of them, an even one their or
+							const u32 z0 = vertex[0].XYZ.Z;
+							u32 zacc = z0;
+							for (int i = 0; i < count; i++)
+								zacc = z0 & 1 ? zacc & vertex[i].XYZ.Z : zacc | vertex[i].XYZ.Z;
+
+							state->CorrectDepth(vertex, count);
+							match &= vt.m_eq.z == (zacc == z0);
+
+							cases++;
+							mismatches += !match;
+						}
+					}
+				}
+
+				report({k.name, c.name, a.name, cases, mismatches});
+			}
+		}
+	}
+
+	AlignedFree(index);
+	AlignedFree(vertex);
+	delete state;
+}
@@ -0,0 +1,237 @@
+/* Memory card journal check of the benchmark core (lrps2_run_mcd_journal_check).
+ *
+ * Card files and journals are made up in a temporary directory the way a
+ * session that crashed leaves them, then opened the way FileMcd_EmuOpen does:
+ * FileMcd_OpenNoECC for a .bin card, then FileMcd_ReplayJournal. The card has
+ * to end up with every complete record of the journal and nothing else.
+ */
+
+#include "BenchCore.h"
+
+#include "Common.h"
+#include "gui/MemoryCardFile.h"
+
+#include <wx/ffile.h>
+#include <wx/filefn.h>
+
+#include <random>
+#include <stdlib.h>
+#include <unistd.h>
+#include <utime.h>
+
+#define MCD_CHECK_SECTORS 256 // 128KB of card data
+#define MCD_CHECK_CASES   16
+
+static std::vector<u8> ReadFile(const wxString& name)
+{
+	std::vector<u8> data;
+	wxFFile f(name, L"rb");
+	if (f.IsOpened())
+	{
+		data.resize(f.Length());
+		data.resize(f.Read(data.data(), data.size()));
+	}
+	return data;
+}
+
+static bool WriteFile(const wxString& name, const std::vector<u8>& data)
+{
+	wxFFile f(name, L"wb");
+	return f.IsOpened() && f.Write(data.data(), data.size()) == data.size() && f.Close();
+}
+
+static void SetTime(const wxString& name, time_t time)
+{
+	const struct utimbuf times = {time, time};
+	utime(name.ToUTF8(), &times);
+}
+
+static std::vector<u8> RandomBytes(std::mt19937& rng, size_t size)
+{
+	std::vector<u8> data(size);
+	for (u8& b : data)
+		b = (u8)rng();
+	return data;
+}
+
+// Writes of up to an erase block and a half, anywhere on a card of 'size' bytes
+static std::vector<McdJournalChunk> RandomChunks(std::mt19937& rng, u32 count, u32 size)
+{
+	std::vector<McdJournalChunk> chunks(count);
+	for (McdJournalChunk& chunk : chunks)
+	{
+		const u32 length = 1 + rng() % (528 * 24);
+		chunk.offset = rng() % (size - length);
+		chunk.data = RandomBytes(rng, length);
+	}
+	return chunks;
+}
+
+static void Apply(std::vector<u8>& card, const std::vector<McdJournalChunk>& chunks)
+{
+	for (const McdJournalChunk& chunk : chunks)
+		memcpy(&card[chunk.offset], chunk.data.data(), chunk.data.size());
+}
+
+// The 512 bytes of every 528 bytes sector of a card with ECC
+static std::vector<u8> Sectors(const std::vector<u8>& raw)
+{
+	std::vector<u8> data;
+	for (size_t pos = 0; pos + 528 <= raw.size(); pos += 528)
+		data.insert(data.end(), raw.begin() + pos, raw.begin() + pos + 512);
+	return data;
+}
+
+// Opens the card like FileMcd_EmuOpen and returns what it holds then
+static bool Open(wxString path, std::vector<u8>& card)
+{
+	if (path.EndsWith(L".bin") && !FileMcd_OpenNoECC(path))
+		return false;
+
+	wxFFile f(path, L"r+b");
+	if (!f.IsOpened() || !FileMcd_ReplayJournal(f))
+		return false;
+	f.Close();
+
+	card = ReadFile(path);
+	return !wxFileExists(path + L".journal");
+}
+
+enum JournalEnd
+{
+	END_COMPLETE,
+	END_TORN_HEADER, // crashed while writing the header of the last record
+	END_TORN_DATA,   // or its data
+	END_BAD_CRC,     // or its data reached the disk garbled
+};
+
+// A journal whose last record ends as 'end' says, on a card with ECC
+static bool CheckReplay(const wxString& dir, std::mt19937& rng, JournalEnd end)
+{
+	const wxString card_name(dir + L"/card.ps2");
+	const wxString journal_name(card_name + L".journal");
+
+	std::vector<u8> card = RandomBytes(rng, MCD_CHECK_SECTORS * 528);
+	std::vector<McdJournalChunk> chunks = RandomChunks(rng, 1 + rng() % 6, card.size());
+	const McdJournalChunk last = chunks.back();
+	chunks.pop_back();
+
+	if (!WriteFile(card_name, card) || !FileMcd_AppendJournal(card_name, chunks))
+		return false;
+	const size_t good = ReadFile(journal_name).size();
+	if (!FileMcd_AppendJournal(card_name, {last}))
+		return false;
+
+	std::vector<u8> journal = ReadFile(journal_name);
+	if (end == END_TORN_HEADER)
+		journal.resize(good + 1 + rng() % 15);
+	else if (end == END_TORN_DATA)
+		journal.resize(journal.size() - 1 - rng() % last.data.size());
+	else if (end == END_BAD_CRC)
+		journal.back() ^= 0x40;
+	if (!WriteFile(journal_name, journal))
+		return false;
+
+	std::vector<u8> expected = card;
+	Apply(expected, chunks);
+	if (end == END_COMPLETE)
+		Apply(expected, {last});
+
+	std::vector<u8> opened;
+	return Open(card_name, opened) && opened == expected;
+}
+
+enum BinCard
+{
+	BIN_FRESH,   // no .binx, the last session closed the card
+	BIN_CRASHED, // the last session crashed and left a .binx with its journal
+	BIN_REPLACED // and the .bin was replaced after
+};
+
+// A .bin card (no ECC), opened through its .binx
+static bool CheckBin(const wxString& dir, std::mt19937& rng, BinCard state)
+{
+	const wxString bin_name(dir + L"/card.bin");
+	const wxString binx_name(bin_name + L"x");
+
+	std::vector<u8> bin = RandomBytes(rng, MCD_CHECK_SECTORS * 512);
+	if (!WriteFile(bin_name, bin))
+		return false;
+	std::vector<u8> expected = bin;
+
+	if (state != BIN_FRESH)
+	{
+		// What the crashed session wrote back to the .binx, and what it
+		// journaled but didn't get to write
+		std::vector<u8> raw = RandomBytes(rng, MCD_CHECK_SECTORS * 528);
+		const std::vector<McdJournalChunk> chunks = RandomChunks(rng, 1 + rng() % 6, raw.size());
+		if (!WriteFile(binx_name, raw) || !FileMcd_AppendJournal(binx_name, chunks))
+			return false;
+
+		const time_t now = time(NULL);
+		SetTime(bin_name, state == BIN_CRASHED ? now - 60 : now);
+		SetTime(binx_name, state == BIN_CRASHED ? now : now - 60);
+
+		if (state == BIN_CRASHED)
+		{
+			Apply(raw, chunks);
+			expected = Sectors(raw);
+		}
+	}
+
+	std::vector<u8> opened;
+	const bool ok = Open(bin_name, opened) && Sectors(opened) == expected;
+	wxRemoveFile(binx_name);
+	return ok;
+}
+
+void McdJournalCheck(BenchResults<lrps2_mcd_journal_check>& report)
+{
+	char path[] = "/tmp/lrps2_mcd.XXXXXX";
+	if (!mkdtemp(path))
+		return;
+	const wxString dir(path);
+
+	static const struct
+	{
+		const char* name;
+		JournalEnd end;
+	} replays[] = {
+		{"complete", END_COMPLETE},
+		{"torn_header", END_TORN_HEADER},
+		{"torn_data", END_TORN_DATA},
+		{"bad_crc", END_BAD_CRC},
+	};
+
+	static const struct
+	{
+		const char* name;
+		BinCard state;
+	} bins[] = {
+		{"bin_fresh", BIN_FRESH},
+		{"bin_crashed", BIN_CRASHED},
+		{"bin_replaced", BIN_REPLACED},
+	};
+
+	std::mt19937 rng(1234);
+
+	for (const auto& test : replays)
+	{
+		lrps2_mcd_journal_check r = {test.name, MCD_CHECK_CASES, 0};
+		for (int i = 0; i < MCD_CHECK_CASES; i++)
+			r.mismatches += !CheckReplay(dir, rng, test.end);
+		report(r);
+	}
+
+	for (const auto& test : bins)
+	{
+		lrps2_mcd_journal_check r = {test.name, MCD_CHECK_CASES, 0};
+		for (int i = 0; i < MCD_CHECK_CASES; i++)
+			r.mismatches += !CheckBin(dir, rng, test.state);
+		report(r);
+	}
+
+	wxRemoveFile(dir + L"/card.ps2");
+	wxRemoveFile(dir + L"/card.bin");
+	rmdir(path);
+}
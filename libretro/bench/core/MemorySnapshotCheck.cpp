@@ -0,0 +1,111 @@
+/* Copy-on-write memory snapshot check of the benchmark core
+ * (lrps2_run_snapshot_check).
+ *
+ * The EE is paused between two frames, where "Deterministic Mode" has it wait
+ * for the input of the next one. A snapshot is captured and the live memory
+ * saved with FreezeMainMemory(), some frames later Save() has to give that
+ * same data, and so does FreezeMainMemory() after Restore().
+ */
+
+#include "BenchCore.h"
+
+#include "Common.h"
+#include "IopMem.h"
+#include "SaveState.h"
+#include "MemorySnapshot.h"
+#include "gui/SysThreads.h"
+
+#include <cerrno>
+#include <chrono>
+#include <unistd.h>
+
+static u64 ElapsedUs(std::chrono::steady_clock::time_point start)
+{
+	return (u64)std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start).count();
+}
+
+static void FreezeLive(VmStateBuffer& buffer)
+{
+	memSavingState(buffer).FreezeMainMemory();
+}
+
+static uint CountPageMismatches(const VmStateBuffer& a, const VmStateBuffer& b)
+{
+	const uint size = std::min(a.GetSizeInBytes(), b.GetSizeInBytes());
+
+	uint mismatches = 0;
+	for (uint offset = 0; offset < size; offset += PCSX2_PAGESIZE)
+		mismatches += memcmp(a.GetPtr(offset), b.GetPtr(offset), std::min<uint>(PCSX2_PAGESIZE, size - offset)) != 0;
+	return mismatches;
+}
+
+// Reads into IOP RAM through the host kernel, like HostFs does, errno if it fails
+static int HostRead(u8* dst, uint size)
+{
+	int fds[2];
+	if (pipe(fds) != 0)
+		return errno;
+
+	u8 data[64];
+	for (uint i = 0; i < sizeof(data); i++)
+		data[i] = (u8)(i * 37 + 11);
+	size = std::min<uint>(size, sizeof(data));
+
+	int error = 0;
+	if (write(fds[1], data, size) != (ssize_t)size)
+		error = errno;
+	else if (read(fds[0], dst, size) != (ssize_t)size)
+		error = errno ? errno : EIO;
+
+	close(fds[0]);
+	close(fds[1]);
+	return error;
+}
+
+bool MemorySnapshotCheck(unsigned frames, lrps2_snapshot_check& result)
+{
+	if (!eeMem || !iopMem || !GetCoreThread().IsRunning())
+		return false;
+
+	result = lrps2_snapshot_check();
+
+	VmStateBuffer captured, live, saved;
+
+	GetCoreThread().Pause();
+
+	const auto start = std::chrono::steady_clock::now();
+	MemorySnapshot::Capture();
+	result.capture_us = ElapsedUs(start);
+
+	FreezeLive(captured);
+
+	// A page of IOP RAM, Restore() has to take it back like the rest
+	result.host_read_errno = HostRead(iopMem->Main + Ps2MemSize::IopRam / 2 + 0x100, 64);
+
+	GetCoreThread().Resume();
+
+	for (unsigned frame = 0; frame < frames; frame++)
+		retro_run();
+
+	GetCoreThread().Pause();
+
+	FreezeLive(live);
+	result.pages_written = CountPageMismatches(captured, live);
+	result.pages_copied = MemorySnapshot::GetCopiedPages();
+
+	memSavingState state(saved);
+	MemorySnapshot::Save(state);
+	result.save_mismatches = CountPageMismatches(captured, saved);
+
+	const auto restore = std::chrono::steady_clock::now();
+	MemorySnapshot::Restore();
+	result.restore_us = ElapsedUs(restore);
+
+	FreezeLive(live);
+	result.restore_mismatches = CountPageMismatches(captured, live);
+
+	MemorySnapshot::Release();
+
+	GetCoreThread().Resume();
+	return true;
+}
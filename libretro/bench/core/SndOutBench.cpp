@@ -0,0 +1,165 @@
+/* Audio rate control benchmark of the benchmark core (lrps2_run_audio_bench).
+ *
+ * A simulated mixer and frontend around the real ring and drain. The frontend
+ * plays its buffer at exactly 48 kHz, the mixer is off by the scenario's skew.
+ */
+
+#include "BenchCore.h"
+
+#include "SPU2/Global.h"
+#include "SPU2/SndOut.h"
+
+#include <cmath>
+#include <vector>
+
+extern retro_audio_sample_batch_t batch_cb;
+
+#define SNDOUT_BENCH_HOST_SIZE 4096
+#define SNDOUT_BENCH_FRAMES    36000
+#define SNDOUT_BENCH_WARMUP    600
+#define SNDOUT_BENCH_WINDOW    600 // host_mean, 10 seconds
+#define SNDOUT_BENCH_BAND      (SNDOUT_BENCH_HOST_SIZE / 20)
+
+static u32 s_host_fill;
+static u64 s_host_overruns;
+
+static size_t RETRO_CALLCONV BenchSink(const int16_t* data, size_t frames)
+{
+	s_host_fill += (u32)frames;
+	if (s_host_fill > SNDOUT_BENCH_HOST_SIZE)
+	{
+		s_host_overruns += s_host_fill - SNDOUT_BENCH_HOST_SIZE;
+		s_host_fill = SNDOUT_BENCH_HOST_SIZE;
+	}
+	return frames;
+}
+
+void SndOutBenchmark(BenchResults<lrps2_audio_bench>& report)
+{
+	static const struct
+	{
+		const char* name;
+		double skew;
+		bool bursty;      // mixes two frames, one, one and none, in turn
+		bool host_status; // the frontend reports its buffer occupancy
+		bool must_converge;
+	} scenarios[] = {
+		{"nominal", 0.0, false, true, true},
+		{"fast_0.2%", 0.002, false, true, true},
+		{"slow_0.2%", -0.002, false, true, true},
+		{"fast_0.5%", 0.005, false, true, true},
+		{"slow_0.5%", -0.005, false, true, true},
+		{"fast_1%", 0.01, false, true, false},
+		{"slow_1%", -0.01, false, true, false},
+		{"bursty", 0.0, true, true, true},
+		{"bursty_fast_0.2%", 0.002, true, true, true},
+		{"no_host_status", 0.002, false, false, false},
+	};
+
+	const retro_audio_sample_batch_t saved_cb = batch_cb;
+	batch_cb = BenchSink;
+
+	const double frame = 48000 / (60 / 1.001);
+	StereoOut16 sample;
+	std::vector<u32> host_fill(SNDOUT_BENCH_FRAMES);
+
+	for (const auto& sc : scenarios)
+	{
+		SndOut_Reset(true);
+		s_host_fill     = SNDOUT_BENCH_HOST_SIZE / 2;
+		s_host_overruns = 0;
+
+		lrps2_audio_bench r = {};
+		r.scenario      = sc.name;
+		r.skew          = sc.skew;
+		r.must_converge = sc.must_converge;
+		r.frames        = SNDOUT_BENCH_FRAMES - SNDOUT_BENCH_WARMUP;
+		r.fill_min      = r.host_min = UINT32_MAX;
+
+		SndOutStats stats, warm = {};
+		double mixed = 0, played = 0, fill_sum = 0;
+
+		for (u32 i = 0; i < SNDOUT_BENCH_FRAMES; i++)
+		{
+			if (i == SNDOUT_BENCH_WARMUP)
+			{
+				SndOut_GetStats(warm);
+				r.host_overruns = s_host_overruns;
+			}
+
+			static const double bursts[4] = {2, 1, 1, 0};
+			mixed += frame * (1 + sc.skew) * (sc.bursty ? bursts[i & 3] : 1);
+			for (; mixed >= SPU2_MIX_BLOCK_SIZE; mixed -= SPU2_MIX_BLOCK_SIZE)
+			{
+				StereoOut16* block = SndOut_Reserve();
+				for (u32 j = 0; j < SPU2_MIX_BLOCK_SIZE; j++)
+				{
+					/* A sawtooth at full scale, the interpolation's worst case */
+					sample.Left  = (s16)(sample.Left + 4099);
+					sample.Right = (s16)-sample.Left;
+					block[j]     = sample;
+				}
+				SndOut_Commit();
+			}
+
+			SndOut_Drain();
+
+			played += frame;
+			const u32 play = (u32)played;
+			played -= play;
+			if (play > s_host_fill)
+			{
+				if (i >= SNDOUT_BENCH_WARMUP)
+					r.host_underruns++;
+				s_host_fill = 0;
+			}
+			else
+				s_host_fill -= play;
+
+			if (sc.host_status)
+				SndOut_SetHostBufferStatus(true, s_host_fill * 100 / SNDOUT_BENCH_HOST_SIZE);
+
+			host_fill[i] = s_host_fill;
+
+			if (i >= SNDOUT_BENCH_WARMUP)
+			{
+				SndOut_GetStats(stats);
+				r.fill_min = std::min(r.fill_min, stats.fill);
+				r.fill_max = std::max(r.fill_max, stats.fill);
+				fill_sum  += stats.fill;
+				r.host_min = std::min(r.host_min, s_host_fill);
+				r.host_max = std::max(r.host_max, s_host_fill);
+			}
+		}
+
+		SndOut_GetStats(stats);
+		r.underruns     = stats.underruns - warm.underruns;
+		r.overruns      = stats.overruns - warm.overruns;
+		r.host_overruns = s_host_overruns - r.host_overruns;
+		r.fill_mean     = fill_sum / r.frames;
+
+		// Settled from the frame after the last one outside the band around
+		// where the frontend buffer ends up
+		double host_sum = 0;
+		for (u32 i = SNDOUT_BENCH_FRAMES - SNDOUT_BENCH_WINDOW; i < SNDOUT_BENCH_FRAMES; i++)
+			host_sum += host_fill[i];
+		r.host_mean = host_sum / SNDOUT_BENCH_WINDOW;
+
+		r.settled_frame = 0;
+		for (u32 i = 0; i < SNDOUT_BENCH_FRAMES; i++)
+			if (std::abs((double)host_fill[i] - r.host_mean) > SNDOUT_BENCH_BAND)
+				r.settled_frame = i + 1;
+		if (r.settled_frame > SNDOUT_BENCH_FRAMES - SNDOUT_BENCH_WINDOW)
+			r.settled_frame = -1;
+
+		// Pinned to either end, the drain ran out of deviation
+		const bool pinned = r.host_mean < SNDOUT_BENCH_BAND || r.host_mean > SNDOUT_BENCH_HOST_SIZE - SNDOUT_BENCH_BAND;
+
+		r.converged = r.settled_frame >= 0 && r.settled_frame <= SNDOUT_BENCH_WARMUP && !pinned && !r.underruns &&
+		              !r.overruns && !r.host_underruns && !r.host_overruns;
+		report(r);
+	}
+
+	SndOut_Reset(false);
+	batch_cb = saved_cb;
+}
@@ -0,0 +1,171 @@
+#ifndef LRPS2_CHECKS_H__
+#define LRPS2_CHECKS_H__
+
+#include <stdint.h>
+
+#include "libretro.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Checks and benchmarks of the benchmark core, pcsx2_libretro_bench, for the
+ * headless benchmark runner (libretro/bench). The core frontends load,
+ * pcsx2_libretro, has none of them. */
+
+/* GS pipeline check: the same synthetic GIF stream rendered by the software
+ * renderer directly and through the two stage pipeline must give the same
+ * local memory after every frame, savestates and local -> host transfers.
+ * Also checks the transfer positions the parse stage keeps, and stopping the
+ * pipeline while its parse stage waits in PostFrame, Sync or for the MTVU
+ * xgkick. One result per test ("transfer_position", "sw", "sw_threaded",
+ * "stop_in_postframe", "stop_in_sync", "stop_in_wait"). Needs no game. */
+struct lrps2_pipeline_check
+{
+   const char *test;
+   int cases;
+   int mismatches;
+};
+
+RETRO_API unsigned lrps2_run_pipeline_check(struct lrps2_pipeline_check *results, unsigned max);
+
+/* GS local memory transfer throughput, one result per format (C32, T4HL,
+ * ...), rectangle alignment ("aligned", "unaligned", "small") and
+ * direction. Needs no game. */
+struct lrps2_transfer_bench
+{
+   const char *format;
+   const char *alignment;
+   int write;        /* 1 = host to GS upload, 0 = download */
+   double mb_per_s;
+};
+
+RETRO_API unsigned lrps2_run_transfer_bench(struct lrps2_transfer_bench *results, unsigned max);
+
+/* GS local memory transfer check: the block based transfers of every format
+ * must leave the same local memory and transfer position as the per pixel
+ * ones (WriteImageX, ReadImageX), and read back what they wrote, for
+ * rectangles on and off the block grid, whole or cut in quadword pieces. One
+ * result per format and test ("write", "read", "round_trip"), and one per
+ * GSBlock kernel of the 24 and 4 bits readers (format "GSBlock", tests
+ * "ReadBlock24", "ReadBlock4HL", "ReadBlock4HH", "PackBlock4"). Needs no
+ * game. */
+struct lrps2_transfer_check
+{
+   const char *format;
+   const char *test;
+   int cases;
+   int mismatches;
+};
+
+RETRO_API unsigned lrps2_run_transfer_check(struct lrps2_transfer_check *results, unsigned max);
+
+/* GS vertex trace (bounding box, color and texture coordinate ranges of a
+ * draw) throughput, one result per kernel ("sse", and "avx2" when the CPU
+ * has AVX2), primitive class ("point", "line", "triangle", "sprite"), vertex
+ * attributes ("gouraud", "gouraud_stq", "flat_uv") and vertices per draw.
+ * Needs no game. */
+struct lrps2_vertex_trace_bench
+{
+   const char *kernel;
+   const char *primclass;
+   const char *attributes;
+   int vertices;     /* vertices per draw */
+   double mverts_per_s;
+};
+
+RETRO_API unsigned lrps2_run_vertex_trace_bench(struct lrps2_vertex_trace_bench *results, unsigned max);
+
+/* GS vertex trace check: the ranges and the constant depth detection of
+ * random draws must match those of a scalar model. One result per kernel,
+ * primitive class and vertex attributes ("gouraud", "flat", "gouraud_stq", "flat_stq",
+ * "flat_uv", "decal_uv"). Needs no game. */
+struct lrps2_vertex_trace_check
+{
+   const char *kernel;
+   const char *primclass;
+   const char *attributes;
+   int cases;
+   int mismatches;
+};
+
+RETRO_API unsigned lrps2_run_vertex_trace_check(struct lrps2_vertex_trace_check *results, unsigned max);
+
+/* Audio rate control: the output ring and its drain driven by a simulated
+ * mixer running off the nominal rate by a skew (-1% to +1%, steady or in
+ * bursts) and a simulated 4096 sample frontend buffer played at 48 kHz. One
+ * result per scenario ("nominal", "fast_0.2%", "bursty", ...), counted after
+ * the first 10 seconds. The drain converged if the frontend buffer settled
+ * within those 10 seconds, away from either end, and neither buffer ran dry
+ * or over after that. It must for skews up to 0.5% with the frontend buffer
+ * reported. Needs no game, and must not run with one loaded. */
+struct lrps2_audio_bench
+{
+   const char *scenario;
+   double skew;             /* mixer rate / nominal - 1 */
+   uint32_t frames;
+   uint64_t underruns;      /* drains that ran short of samples */
+   uint64_t overruns;       /* samples dropped because the ring was full */
+   uint32_t fill_min;       /* ring fill after the drains, in samples */
+   uint32_t fill_max;
+   double fill_mean;
+   uint64_t host_underruns; /* frames the frontend buffer ran dry */
+   uint64_t host_overruns;  /* samples that didn't fit in it */
+   uint32_t host_min;       /* frontend buffer fill, in samples */
+   uint32_t host_max;
+   double host_mean;        /* over the last 10 seconds */
+   int64_t settled_frame;   /* from the start, the frontend buffer stays within
+                               5% of its size around host_mean after it, -1 if
+                               it never does */
+   bool converged;
+   bool must_converge;
+};
+
+RETRO_API unsigned lrps2_run_audio_bench(struct lrps2_audio_bench *results, unsigned max);
+
+/* Takes the state hashes (lrps2_get_state_hashes) without "Deterministic
+ * Mode" too, to see that runs without it drift apart. Call before
+ * retro_load_game. */
+RETRO_API void lrps2_force_state_hashes(bool force);
+
+/* Copy-on-write memory snapshot check. Call between two retro_run with a
+ * game loaded and "Deterministic Mode" on, the EE then waits for the input of
+ * the next frame and can be paused there. A snapshot is captured, some bytes
+ * are read from a pipe into IOP RAM the way HostFs reads files, and after
+ * 'frames' more frames the snapshot must save and restore to what the memory
+ * was at the capture. Only the memory is restored, so the game isn't worth
+ * running on after. Returns false if no game is running. */
+struct lrps2_snapshot_check
+{
+   uint32_t pages_written;      /* pages changed between capture and restore */
+   uint32_t pages_copied;       /* pages the write fault handler copied aside */
+   uint32_t save_mismatches;    /* pages the snapshot saved wrong */
+   uint32_t restore_mismatches; /* pages the restore left wrong */
+   int32_t host_read_errno;     /* errno of the read() into IOP RAM, 0 if it worked */
+   uint64_t capture_us;
+   uint64_t restore_us;
+};
+
+RETRO_API bool lrps2_run_snapshot_check(unsigned frames, struct lrps2_snapshot_check *result);
+
+/* Memory card journal check: card files and write-back journals left by a
+ * session that crashed, opened the way the core opens a card. The card must
+ * get every complete record of the journal, and none of a torn or garbled
+ * last one ("complete", "torn_header", "torn_data", "bad_crc"). A .bin card
+ * must be opened through the .binx copy and journal the session left, unless
+ * the .bin changed since ("bin_fresh", "bin_crashed", "bin_replaced"). One
+ * result per test. Needs no game. */
+struct lrps2_mcd_journal_check
+{
+   const char *test;
+   int cases;
+   int mismatches;
+};
+
+RETRO_API unsigned lrps2_run_mcd_journal_check(struct lrps2_mcd_journal_check *results, unsigned max);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,1427 @@
+/* lrps2_bench - headless benchmark runner for the LRPS2 core.
+ *
+ * Loads the core with dlopen, boots a disc image with the CPU-only
+ * "Software" renderer and no input, runs a fixed number of frames and
+ * prints a JSON report on stdout:
+ *
+ *  - wall time of every retro_run() call,
+ *  - CPU time per frame for each emulator thread group, identified by
+ *    the thread names the core sets ("EE Core", "MTVU", "GS Raster").
+ *    The frontend thread runs MTGS, so it is reported as "mtgs",
+ *  - EE and microVU recompiler counters (lrps2_get_bench_stats),
+ *  - data and instruction TLB misses of the whole process (perf events,
+ *    null when the kernel doesn't allow them), and how much anonymous
+ *    memory ended up on huge pages, to compare runs with and without the
+ *    core's "Huge Pages" option,
+ *  - peak RSS,
+ *  - with the core's "Deterministic Mode" option, a hash of the emulated
+ *    state per frame (lrps2_get_state_hashes); two runs with the same
+ *    options diverged at the first frame whose hashes differ.
+ *
+ * With --transfers no disc is booted; the core instead measures its GS
+ * local memory upload/download paths for every pixel format and prints
+ * their throughput, and checks them against the per pixel paths; the exit
+ * status is 2 on a mismatch. --vertex-trace does the same for the per draw
+ * vertex trace (bounding box, color and texture coordinate ranges), with
+ * each of its kernels the CPU can run, and checks its results against a
+ * scalar model.
+ * --pipeline runs the GS pipeline check: a synthetic GIF stream rendered by
+ * the software renderer with and without the two stage GS pipeline, whose
+ * results must match; the exit status is 2 on a mismatch.
+ * --audio drives the audio rate control (output ring and drain) with a
+ * simulated mixer running off the nominal rate, steadily or in bursts, and a
+ * simulated frontend buffer, and reports the underruns, overruns and fill of
+ * both, and whether the frontend buffer settled. The exit status is 2 if it
+ * didn't for a skew up to 0.5%. --transfers, --vertex-trace, --pipeline and
+ * --audio need the benchmark core,
+ * pcsx2_libretro_bench.so, built with BUILD_BENCHMARK next to the core and
+ * holding the checks the core itself doesn't ship.
+ * --determinism boots a test ROM, generated in place of the BIOS, twice per
+ * option set (with and without "Deterministic Mode", MTVU and the EE cycle
+ * skip), each time in a process of its own, and compares the state hashes of
+ * the two runs. It needs the benchmark core, whose hashes can be taken
+ * without "Deterministic Mode" as well. The exit status is 2 if the hashes
+ * differ with "Deterministic Mode".
+ * --snapshot checks the copy-on-write memory snapshots on the same ROM, with
+ * and without MTVU: what a snapshot saves and restores has to match the
+ * memory at its capture, after the emulation and a host read() wrote to it.
+ * It needs the benchmark core, the exit status is 2 if a snapshot doesn't
+ * match.
+ * --mcd-journal opens memory cards and write-back journals the way a session
+ * that crashed leaves them, torn journals and .bin cards included, and checks
+ * what the cards hold after. It needs the benchmark core, the exit status is
+ * 2 on a mismatch.
+ *
+ * Usage: lrps2_bench [options] <core.so> <disc image>
+ *        lrps2_bench --transfers <bench core.so>
+ *        lrps2_bench --vertex-trace <bench core.so>
+ *        lrps2_bench --pipeline <bench core.so>
+ *        lrps2_bench --audio <bench core.so>
+ *        lrps2_bench --determinism [-n frames] <bench core.so>
+ *        lrps2_bench --snapshot <bench core.so>
+ *        lrps2_bench --mcd-journal <bench core.so>
+ */
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdarg>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <map>
+#include <string>
+#include <vector>
+
+#include <dirent.h>
+#include <dlfcn.h>
+#include <ftw.h>
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/resource.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <sys/wait.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "libretro.h"
+#include "lrps2_bench.h"
+#include "core/lrps2_checks.h"
+
+namespace
+{
+
+enum ThreadGroup
+{
+	GROUP_MTGS,
+	GROUP_EE,
+	GROUP_MTVU,
+	GROUP_GS_RASTER,
+	GROUP_OTHER,
+	GROUP_COUNT
+};
+
+const char* const group_names[GROUP_COUNT] = {"mtgs", "ee", "mtvu", "gs_raster", "other"};
+
+struct Options
+{
+	const char* core_path   = NULL;
+	const char* disc_path   = NULL;
+	const char* output_path = NULL;
+	std::string system_dir  = "system";
+	std::string save_dir    = "saves";
+	unsigned frames         = 3600;
+	unsigned skip           = 0;
+	bool per_frame          = false;
+	bool verbose            = false;
+	bool transfers          = false;
+	bool vertex_trace       = false;
+	bool pipeline           = false;
+	bool audio              = false;
+	bool determinism        = false;
+	bool snapshot           = false;
+	bool mcd_journal        = false;
+	std::map<std::string, std::string> overrides;
+};
+
+Options opts;
+
+// core option defaults, as announced by the core
+std::map<std::string, std::string> option_defaults;
+
+unsigned presented_frames = 0;
+
+struct Core
+{
+	void* handle;
+	void (*set_environment)(retro_environment_t);
+	void (*set_video_refresh)(retro_video_refresh_t);
+	void (*set_audio_sample)(retro_audio_sample_t);
+	void (*set_audio_sample_batch)(retro_audio_sample_batch_t);
+	void (*set_input_poll)(retro_input_poll_t);
+	void (*set_input_state)(retro_input_state_t);
+	void (*init)(void);
+	void (*deinit)(void);
+	void (*get_system_info)(retro_system_info*);
+	bool (*load_game)(const retro_game_info*);
+	void (*unload_game)(void);
+	void (*run)(void);
+	void (*get_stats)(lrps2_bench_stats*);
+	unsigned (*get_state_hashes)(uint64_t, uint64_t*, unsigned);
+};
+
+Core core;
+
+void log_printf(enum retro_log_level level, const char* fmt, ...)
+{
+	if (level < RETRO_LOG_WARN && !opts.verbose)
+		return;
+
+	va_list ap;
+	va_start(ap, fmt);
+	vfprintf(stderr, fmt, ap);
+	va_end(ap);
+}
+
+void add_option_defaults(const retro_core_option_v2_definition* defs)
+{
+	for (; defs && defs->key; defs++)
+		if (defs->default_value)
+			option_defaults[defs->key] = defs->default_value;
+}
+
+const char* get_option(const char* key)
+{
+	auto it = opts.overrides.find(key);
+	if (it != opts.overrides.end())
+		return it->second.c_str();
+
+	it = option_defaults.find(key);
+	if (it != option_defaults.end())
+		return it->second.c_str();
+
+	return NULL;
+}
+
+bool environment(unsigned cmd, void* data)
+{
+	switch (cmd & ~RETRO_ENVIRONMENT_EXPERIMENTAL)
+	{
+		case RETRO_ENVIRONMENT_GET_LOG_INTERFACE:
+			((retro_log_callback*)data)->log = log_printf;
+			return true;
+		case RETRO_ENVIRONMENT_GET_SYSTEM_DIRECTORY:
+		case RETRO_ENVIRONMENT_GET_CORE_ASSETS_DIRECTORY:
+			*(const char**)data = opts.system_dir.c_str();
+			return true;
+		case RETRO_ENVIRONMENT_GET_SAVE_DIRECTORY:
+			*(const char**)data = opts.save_dir.c_str();
+			return true;
+		case RETRO_ENVIRONMENT_SET_PIXEL_FORMAT:
+			return *(const retro_pixel_format*)data == RETRO_PIXEL_FORMAT_XRGB8888;
+		case RETRO_ENVIRONMENT_GET_CORE_OPTIONS_VERSION:
+			*(unsigned*)data = 2;
+			return true;
+		case RETRO_ENVIRONMENT_SET_CORE_OPTIONS_V2:
+			add_option_defaults(((const retro_core_options_v2*)data)->definitions);
+			return true;
+		case RETRO_ENVIRONMENT_SET_CORE_OPTIONS_V2_INTL:
+			add_option_defaults(((const retro_core_options_v2_intl*)data)->us->definitions);
+			return true;
+		case RETRO_ENVIRONMENT_GET_VARIABLE:
+		{
+			retro_variable* var = (retro_variable*)data;
+			var->value          = get_option(var->key);
+			return var->value != NULL;
+		}
+		case RETRO_ENVIRONMENT_GET_VARIABLE_UPDATE:
+			*(bool*)data = false;
+			return true;
+		case RETRO_ENVIRONMENT_SET_MESSAGE:
+			log_printf(RETRO_LOG_INFO, "[message] %s\n", ((const retro_message*)data)->msg);
+			return true;
+		case RETRO_ENVIRONMENT_SET_MESSAGE_EXT:
+			log_printf(RETRO_LOG_INFO, "[message] %s\n", ((const retro_message_ext*)data)->msg);
+			return true;
+		case RETRO_ENVIRONMENT_GET_CAN_DUPE:
+			*(bool*)data = true;
+			return true;
+		case RETRO_ENVIRONMENT_SET_SUPPORT_NO_GAME:
+		case RETRO_ENVIRONMENT_SET_INPUT_DESCRIPTORS:
+		case RETRO_ENVIRONMENT_SET_CONTROLLER_INFO:
+			return true;
+		default:
+			return false;
+	}
+}
+
+void video_refresh(const void* data, unsigned width, unsigned height, size_t pitch)
+{
+	if (data)
+		presented_frames++;
+}
+
+void audio_sample(int16_t left, int16_t right)
+{
+}
+
+size_t audio_sample_batch(const int16_t* data, size_t frames)
+{
+	return frames;
+}
+
+void input_poll(void)
+{
+}
+
+int16_t input_state(unsigned port, unsigned device, unsigned index, unsigned id)
+{
+	return 0;
+}
+
+template <typename T>
+bool load_symbol(T& fn, const char* name)
+{
+	fn = (T)dlsym(core.handle, name);
+	if (!fn)
+		fprintf(stderr, "lrps2_bench: %s: missing symbol %s\n", opts.core_path, name);
+	return fn != NULL;
+}
+
+bool load_core(const char* path)
+{
+	core.handle = dlopen(path, RTLD_NOW | RTLD_LOCAL);
+	if (!core.handle)
+	{
+		fprintf(stderr, "lrps2_bench: %s\n", dlerror());
+		return false;
+	}
+
+	bool ok = load_symbol(core.set_environment, "retro_set_environment")
+	       && load_symbol(core.set_video_refresh, "retro_set_video_refresh")
+	       && load_symbol(core.set_audio_sample, "retro_set_audio_sample")
+	       && load_symbol(core.set_audio_sample_batch, "retro_set_audio_sample_batch")
+	       && load_symbol(core.set_input_poll, "retro_set_input_poll")
+	       && load_symbol(core.set_input_state, "retro_set_input_state")
+	       && load_symbol(core.init, "retro_init")
+	       && load_symbol(core.deinit, "retro_deinit")
+	       && load_symbol(core.get_system_info, "retro_get_system_info")
+	       && load_symbol(core.load_game, "retro_load_game")
+	       && load_symbol(core.unload_game, "retro_unload_game")
+	       && load_symbol(core.run, "retro_run");
+
+	// optional, older cores don't export it
+	core.get_stats = (void (*)(lrps2_bench_stats*))dlsym(core.handle, "lrps2_get_bench_stats");
+	core.get_state_hashes = (unsigned (*)(uint64_t, uint64_t*, unsigned))dlsym(core.handle, "lrps2_get_state_hashes");
+	return ok;
+}
+
+void init_core()
+{
+	core.set_environment(environment);
+	core.set_video_refresh(video_refresh);
+	core.set_audio_sample(audio_sample);
+	core.set_audio_sample_batch(audio_sample_batch);
+	core.set_input_poll(input_poll);
+	core.set_input_state(input_state);
+	core.init();
+}
+
+// ----------------------------------------------------------------------------
+// Per-thread CPU accounting
+// ----------------------------------------------------------------------------
+
+uint64_t clock_ns(clockid_t clock)
+{
+	struct timespec ts;
+	if (clock_gettime(clock, &ts) != 0)
+		return 0;
+	return (uint64_t)ts.tv_sec * 1000000000ull + ts.tv_nsec;
+}
+
+// Linux encodes per-thread CPU clocks for arbitrary tids this way
+// (MAKE_THREAD_CPUCLOCK(tid, CPUCLOCK_SCHED) in the kernel).
+clockid_t thread_cpu_clock(pid_t tid)
+{
+	return (clockid_t)((~(unsigned)tid << 3) | 6);
+}
+
+ThreadGroup classify(const char* comm)
+{
+	if (!strcmp(comm, "EE Core"))
+		return GROUP_EE;
+	if (!strcmp(comm, "MTVU"))
+		return GROUP_MTVU;
+	if (!strcmp(comm, "GS Raster"))
+		return GROUP_GS_RASTER;
+	return GROUP_OTHER;
+}
+
+struct ThreadSample
+{
+	uint64_t cpu_ns;
+	ThreadGroup group;
+};
+
+std::map<pid_t, ThreadSample> thread_samples;
+
+// Adds the CPU time every worker thread used since the last call to 'delta'.
+void sample_threads(pid_t self, uint64_t delta[GROUP_COUNT])
+{
+	DIR* dir = opendir("/proc/self/task");
+	if (!dir)
+		return;
+
+	while (struct dirent* ent = readdir(dir))
+	{
+		pid_t tid = (pid_t)atoi(ent->d_name);
+		if (tid <= 0 || tid == self)
+			continue;
+
+		// Threads name themselves after they start, so the name is
+		// read again every time rather than cached.
+		char path[64], comm[32] = "";
+		snprintf(path, sizeof(path), "/proc/self/task/%d/comm", tid);
+		if (FILE* f = fopen(path, "r"))
+		{
+			if (fgets(comm, sizeof(comm), f))
+				comm[strcspn(comm, "\n")] = 0;
+			fclose(f);
+		}
+
+		uint64_t now = clock_ns(thread_cpu_clock(tid));
+		ThreadGroup group = classify(comm);
+
+		auto it = thread_samples.find(tid);
+		if (it != thread_samples.end() && now >= it->second.cpu_ns)
+			delta[group] += now - it->second.cpu_ns;
+
+		thread_samples[tid] = {now, group};
+	}
+
+	closedir(dir);
+}
+
+// ----------------------------------------------------------------------------
+// TLB miss counters
+// ----------------------------------------------------------------------------
+
+enum TlbCounter
+{
+	TLB_DATA,
+	TLB_INSTRUCTION,
+	TLB_COUNT
+};
+
+int tlb_fds[TLB_COUNT] = {-1, -1};
+
+// Opens the counters disabled. 'inherit' makes them follow every thread
+// created afterwards, so this has to run before the core starts any.
+void tlb_open()
+{
+	const uint64_t caches[TLB_COUNT] = {PERF_COUNT_HW_CACHE_DTLB, PERF_COUNT_HW_CACHE_ITLB};
+
+	for (int i = 0; i < TLB_COUNT; i++)
+	{
+		perf_event_attr attr = {};
+		attr.size           = sizeof(attr);
+		attr.type           = PERF_TYPE_HW_CACHE;
+		attr.config         = caches[i] | (PERF_COUNT_HW_CACHE_OP_READ << 8) | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16);
+		attr.disabled       = 1;
+		attr.inherit        = 1;
+		attr.exclude_kernel = 1;
+		attr.exclude_hv     = 1;
+
+		tlb_fds[i] = (int)syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0);
+		if (tlb_fds[i] < 0 && opts.verbose)
+			fprintf(stderr, "lrps2_bench: TLB counter %d unavailable: %s\n", i, strerror(errno));
+	}
+}
+
+void tlb_enable(bool enable)
+{
+	for (int fd : tlb_fds)
+		if (fd >= 0)
+			ioctl(fd, enable ? PERF_EVENT_IOC_ENABLE : PERF_EVENT_IOC_DISABLE, 0);
+}
+
+// Returns false if the counter couldn't be opened
+bool tlb_read(TlbCounter counter, uint64_t& value)
+{
+	value = 0;
+	return tlb_fds[counter] >= 0 && read(tlb_fds[counter], &value, sizeof(value)) == (ssize_t)sizeof(value);
+}
+
+// AnonHugePages of the whole process, -1 if the kernel doesn't report it
+long anon_huge_pages_kb()
+{
+	FILE* f = fopen("/proc/self/smaps_rollup", "r");
+	if (!f)
+		return -1;
+
+	long kb = -1;
+	char line[256];
+	while (fgets(line, sizeof(line), f))
+		if (sscanf(line, "AnonHugePages: %ld kB", &kb) == 1)
+			break;
+
+	fclose(f);
+	return kb;
+}
+
+// ----------------------------------------------------------------------------
+// Report
+// ----------------------------------------------------------------------------
+
+double percentile(std::vector<double> sorted, double p)
+{
+	if (sorted.empty())
+		return 0.0;
+	std::sort(sorted.begin(), sorted.end());
+	size_t idx = (size_t)(p * (sorted.size() - 1) + 0.5);
+	return sorted[idx];
+}
+
+void print_series(FILE* out, const char* name, const std::vector<double>& values, bool last, const char* unit = "ms")
+{
+	double total = 0.0, max = 0.0;
+	for (double v : values)
+	{
+		total += v;
+		max = std::max(max, v);
+	}
+
+	fprintf(out, "    \"%s\": {\"total_%s\": %.3f, \"mean_%s\": %.3f, \"p50_%s\": %.3f, "
+	             "\"p95_%s\": %.3f, \"p99_%s\": %.3f, \"max_%s\": %.3f",
+	        name, unit, total, unit, values.empty() ? 0.0 : total / values.size(),
+	        unit, percentile(values, 0.50), unit, percentile(values, 0.95),
+	        unit, percentile(values, 0.99), unit, max);
+
+	if (opts.per_frame)
+	{
+		fprintf(out, ", \"frames\": [");
+		for (size_t i = 0; i < values.size(); i++)
+			fprintf(out, "%s%.3f", i ? ", " : "", values[i]);
+		fprintf(out, "]");
+	}
+
+	fprintf(out, "}%s\n", last ? "" : ",");
+}
+
+void print_string(FILE* out, const char* str)
+{
+	fputc('"', out);
+	for (; *str; str++)
+	{
+		if (*str == '"' || *str == '\\')
+			fputc('\\', out);
+		if ((unsigned char)*str < 0x20)
+			fprintf(out, "\\u%04x", *str);
+		else
+			fputc(*str, out);
+	}
+	fputc('"', out);
+}
+
+void usage(const char* argv0)
+{
+	fprintf(stderr,
+		"Usage: %s [options] <core.so> <disc image>\n"
+		"       %s --transfers [-w FILE] <bench core.so>\n"
+		"       %s --vertex-trace [-w FILE] <bench core.so>\n"
+		"       %s --pipeline [-w FILE] <bench core.so>\n"
+		"       %s --audio [-w FILE] <bench core.so>\n"
+		"       %s --determinism [-n N] [-w FILE] <bench core.so>\n"
+		"       %s --snapshot [-w FILE] <bench core.so>\n"
+		"       %s --mcd-journal [-w FILE] <bench core.so>\n"
+		"  -n, --frames N        frames to run (default 3600)\n"
+		"  -k, --skip N          leading frames left out of the statistics (default 0)\n"
+		"  -s, --system DIR      system directory holding pcsx2/bios (default ./system)\n"
+		"  -d, --save DIR        save directory (default ./saves)\n"
+		"  -o, --option KEY=VAL  override a core option, may be repeated\n"
+		"  -f, --per-frame       include per-frame values in the report\n"
+		"  -w, --output FILE     write the report to FILE instead of stdout\n"
+		"  -v, --verbose         forward core info/debug logs to stderr\n"
+		"  -t, --transfers       measure GS transfer throughput instead of running a game\n"
+		"  -r, --vertex-trace    measure GS vertex trace throughput instead of running a game\n"
+		"  -p, --pipeline        check the GS pipeline against the direct path instead of running a game\n"
+		"  -a, --audio           drive the audio rate control with a skewed mixer instead of running a game\n"
+		"  -e, --determinism     compare the state hashes of two runs of a test ROM, per option set\n"
+		"  -m, --snapshot        check the copy-on-write memory snapshots on a test ROM\n"
+		"  -j, --mcd-journal     check opening memory cards left by a crash\n",
+		argv0, argv0, argv0, argv0, argv0, argv0, argv0, argv0);
+}
+
+bool parse_args(int argc, char** argv)
+{
+	for (int i = 1; i < argc; i++)
+	{
+		std::string arg = argv[i];
+		auto value = [&]() -> const char* {
+			if (i + 1 >= argc)
+			{
+				fprintf(stderr, "lrps2_bench: %s needs a value\n", arg.c_str());
+				return NULL;
+			}
+			return argv[++i];
+		};
+
+		if (arg == "-n" || arg == "--frames" || arg == "-k" || arg == "--skip")
+		{
+			const char* v = value();
+			if (!v)
+				return false;
+			(arg == "-n" || arg == "--frames" ? opts.frames : opts.skip) = (unsigned)strtoul(v, NULL, 10);
+		}
+		else if (arg == "-s" || arg == "--system" || arg == "-d" || arg == "--save")
+		{
+			const char* v = value();
+			if (!v)
+				return false;
+			(arg == "-s" || arg == "--system" ? opts.system_dir : opts.save_dir) = v;
+		}
+		else if (arg == "-o" || arg == "--option")
+		{
+			const char* v  = value();
+			const char* eq = v ? strchr(v, '=') : NULL;
+			if (!eq)
+			{
+				fprintf(stderr, "lrps2_bench: expected KEY=VALUE after %s\n", arg.c_str());
+				return false;
+			}
+			opts.overrides[std::string(v, eq - v)] = eq + 1;
+		}
+		else if (arg == "-w" || arg == "--output")
+		{
+			if (!(opts.output_path = value()))
+				return false;
+		}
+		else if (arg == "-f" || arg == "--per-frame")
+			opts.per_frame = true;
+		else if (arg == "-v" || arg == "--verbose")
+			opts.verbose = true;
+		else if (arg == "-t" || arg == "--transfers")
+			opts.transfers = true;
+		else if (arg == "-r" || arg == "--vertex-trace")
+			opts.vertex_trace = true;
+		else if (arg == "-p" || arg == "--pipeline")
+			opts.pipeline = true;
+		else if (arg == "-a" || arg == "--audio")
+			opts.audio = true;
+		else if (arg == "-e" || arg == "--determinism")
+			opts.determinism = true;
+		else if (arg == "-m" || arg == "--snapshot")
+			opts.snapshot = true;
+		else if (arg == "-j" || arg == "--mcd-journal")
+			opts.mcd_journal = true;
+		else if (arg[0] == '-')
+		{
+			fprintf(stderr, "lrps2_bench: unknown option %s\n", arg.c_str());
+			return false;
+		}
+		else if (!opts.core_path)
+			opts.core_path = argv[i];
+		else if (!opts.disc_path)
+			opts.disc_path = argv[i];
+		else
+			return false;
+	}
+
+	if (opts.transfers + opts.vertex_trace + opts.pipeline + opts.audio + opts.determinism + opts.snapshot + opts.mcd_journal > 1)
+		return false;
+	if (opts.transfers || opts.vertex_trace || opts.pipeline || opts.audio || opts.determinism || opts.snapshot || opts.mcd_journal)
+		return opts.core_path && !opts.disc_path;
+
+	return opts.core_path && opts.disc_path && opts.frames > opts.skip;
+}
+
+FILE* open_output()
+{
+	FILE* out = opts.output_path ? fopen(opts.output_path, "w") : stdout;
+	if (!out)
+		fprintf(stderr, "lrps2_bench: %s: %s\n", opts.output_path, strerror(errno));
+	return out;
+}
+
+// ----------------------------------------------------------------------------
+// Checks of the benchmark core
+// ----------------------------------------------------------------------------
+
+// Opens the output of a check and starts its report, up to the first entry of
+// its 'name' array
+FILE* begin_report(const char* name)
+{
+	FILE* out = open_output();
+	if (!out)
+		return NULL;
+
+	fprintf(out, "{\n  \"core\": ");
+	print_string(out, opts.core_path);
+	fprintf(out, ",\n  \"%s\": [\n", name);
+	return out;
+}
+
+// Ends the array begun by begin_report() and starts the next one
+void next_report(FILE* out, const char* name)
+{
+	fprintf(out, "  ],\n  \"%s\": [\n", name);
+}
+
+// Ends the report and returns the exit status of the check
+int end_report(FILE* out, bool failed)
+{
+	fprintf(out, "  ]\n}\n");
+
+	if (out != stdout)
+		fclose(out);
+
+	return failed ? 2 : 0;
+}
+
+// Calls a check of the benchmark core, which fills up to N results
+template <typename T, unsigned N>
+bool run_check(const char* symbol, T (&results)[N], unsigned& count)
+{
+	unsigned (*run)(T*, unsigned);
+	if (!load_symbol(run, symbol))
+		return false;
+
+	count = run(results, N);
+	return true;
+}
+
+// A check whose results are {test, cases, mismatches}; it fails on a mismatch
+// or when it has no results at all
+template <typename T>
+int run_test_check(const char* symbol, const char* name)
+{
+	T results[16];
+	unsigned count;
+	if (!run_check(symbol, results, count))
+		return 1;
+
+	core.deinit();
+
+	FILE* out = begin_report(name);
+	if (!out)
+		return 1;
+
+	int mismatches = 0;
+
+	for (unsigned i = 0; i < count; i++)
+	{
+		fprintf(out, "    {\"test\": \"%s\", \"cases\": %d, \"mismatches\": %d}%s\n",
+		        results[i].test, results[i].cases, results[i].mismatches, i + 1 < count ? "," : "");
+		mismatches += results[i].mismatches;
+	}
+
+	const int status = end_report(out, mismatches || !count);
+	dlclose(core.handle);
+	return status;
+}
+
+int run_transfers()
+{
+	lrps2_transfer_bench results[256];
+	lrps2_transfer_check checks[64];
+	unsigned count, check_count;
+	if (!run_check("lrps2_run_transfer_bench", results, count) ||
+	    !run_check("lrps2_run_transfer_check", checks, check_count))
+		return 1;
+
+	core.deinit();
+
+	FILE* out = begin_report("transfers");
+	if (!out)
+		return 1;
+
+	for (unsigned i = 0; i < count; i++)
+		fprintf(out, "    {\"format\": \"%s\", \"alignment\": \"%s\", \"direction\": \"%s\", \"mb_per_s\": %.1f}%s\n",
+		        results[i].format, results[i].alignment, results[i].write ? "write" : "read",
+		        results[i].mb_per_s, i + 1 < count ? "," : "");
+	next_report(out, "transfer_check");
+
+	int mismatches = 0;
+
+	for (unsigned i = 0; i < check_count; i++)
+	{
+		fprintf(out, "    {\"format\": \"%s\", \"test\": \"%s\", \"cases\": %d, \"mismatches\": %d}%s\n",
+		        checks[i].format, checks[i].test, checks[i].cases, checks[i].mismatches,
+		        i + 1 < check_count ? "," : "");
+		mismatches += checks[i].mismatches;
+	}
+
+	const int status = end_report(out, mismatches);
+	dlclose(core.handle);
+	return status;
+}
+
+int run_vertex_trace()
+{
+	lrps2_vertex_trace_bench results[128];
+	lrps2_vertex_trace_check checks[64];
+	unsigned count, check_count;
+	if (!run_check("lrps2_run_vertex_trace_bench", results, count) ||
+	    !run_check("lrps2_run_vertex_trace_check", checks, check_count))
+		return 1;
+
+	core.deinit();
+
+	FILE* out = begin_report("vertex_trace");
+	if (!out)
+		return 1;
+
+	for (unsigned i = 0; i < count; i++)
+		fprintf(out, "    {\"kernel\": \"%s\", \"primclass\": \"%s\", \"attributes\": \"%s\", \"vertices\": %d, \"mverts_per_s\": %.1f}%s\n",
+		        results[i].kernel, results[i].primclass, results[i].attributes, results[i].vertices,
+		        results[i].mverts_per_s, i + 1 < count ? "," : "");
+	next_report(out, "vertex_trace_check");
+
+	int mismatches = 0;
+
+	for (unsigned i = 0; i < check_count; i++)
+	{
+		fprintf(out, "    {\"kernel\": \"%s\", \"primclass\": \"%s\", \"attributes\": \"%s\", \"cases\": %d, \"mismatches\": %d}%s\n",
+		        checks[i].kernel, checks[i].primclass, checks[i].attributes, checks[i].cases, checks[i].mismatches,
+		        i + 1 < check_count ? "," : "");
+		mismatches += checks[i].mismatches;
+	}
+
+	const int status = end_report(out, mismatches);
+	dlclose(core.handle);
+	return status;
+}
+
+int run_pipeline()
+{
+	return run_test_check<lrps2_pipeline_check>("lrps2_run_pipeline_check", "pipeline");
+}
+
+int run_mcd_journal()
+{
+	return run_test_check<lrps2_mcd_journal_check>("lrps2_run_mcd_journal_check", "mcd_journal");
+}
+
+int run_audio()
+{
+	lrps2_audio_bench results[16];
+	unsigned count;
+	if (!run_check("lrps2_run_audio_bench", results, count))
+		return 1;
+
+	core.deinit();
+
+	FILE* out = begin_report("audio");
+	if (!out)
+		return 1;
+
+	int failures = 0;
+
+	for (unsigned i = 0; i < count; i++)
+	{
+		const lrps2_audio_bench& r = results[i];
+		fprintf(out, "    {\"scenario\": \"%s\", \"skew\": %.4f, \"frames\": %u, \"underruns\": %llu, "
+		             "\"overruns\": %llu, \"fill_min\": %u, \"fill_mean\": %.1f, \"fill_max\": %u, "
+		             "\"host_underruns\": %llu, \"host_overruns\": %llu, \"host_min\": %u, \"host_mean\": %.1f, "
+		             "\"host_max\": %u, \"settled_frame\": %lld, \"converged\": %s, \"must_converge\": %s}%s\n",
+		        r.scenario, r.skew, r.frames, (unsigned long long)r.underruns, (unsigned long long)r.overruns,
+		        r.fill_min, r.fill_mean, r.fill_max, (unsigned long long)r.host_underruns,
+		        (unsigned long long)r.host_overruns, r.host_min, r.host_mean, r.host_max, (long long)r.settled_frame,
+		        r.converged ? "true" : "false", r.must_converge ? "true" : "false", i + 1 < count ? "," : "");
+		failures += r.must_converge && !r.converged;
+	}
+
+	const int status = end_report(out, failures);
+	dlclose(core.handle);
+	return status;
+}
+
+
+// ----------------------------------------------------------------------------
+// Determinism check
+// ----------------------------------------------------------------------------
+
+// A ROM in place of the BIOS, so that the check needs no dump of one. The EE
+// uploads a VU1 microprogram through the VIF1 FIFO, then forever starts it and
+// counts to 200. Each run of the microprogram loops a different number of
+// times. With MTVU the EE cycle skip follows the cycle counts of the programs
+// the VU1 thread has finished, how many that are depends on the host unless
+// the core's "Deterministic Mode" pins it. The IOP spins in place.
+std::vector<uint32_t> determinism_rom()
+{
+	enum { zero = 0, t0 = 8, t1 = 9, t2 = 10, a0 = 4, a1 = 5, a2 = 6, s0 = 16, s1 = 17, s2 = 18 };
+
+	std::vector<uint32_t> rom(0x500 / 4);
+	size_t pc = 0;
+
+	auto i_type = [&](uint32_t op, int rs, int rt, int imm) { rom[pc++] = op << 26 | rs << 21 | rt << 16 | (imm & 0xffff); };
+	auto branch = [&](uint32_t op, int rs, int rt, size_t target) { i_type(op, rs, rt, (int)(target - pc - 1)); };
+	auto lui    = [&](int rt, int imm) { i_type(0x0f, 0, rt, imm); };
+	auto ori    = [&](int rt, int rs, int imm) { i_type(0x0d, rs, rt, imm); };
+	auto addiu  = [&](int rt, int rs, int imm) { i_type(0x09, rs, rt, imm); };
+	auto sw     = [&](int rt, int offset, int base) { i_type(0x2b, base, rt, offset); };
+	auto lq     = [&](int rt, int offset, int base) { i_type(0x1e, base, rt, offset); };
+	auto sq     = [&](int rt, int offset, int base) { i_type(0x1f, base, rt, offset); };
+	auto nop    = [&]() { rom[pc++] = 0; };
+
+	const size_t ee_code = 0x200 / 4;
+	const size_t stream  = 0x400 / 4;
+	const int stream_qwc = 9;
+
+	// 0xbfc00000, both CPUs: PRId 0x2exx is the EE, 0x1f the IOP
+	rom[pc++] = 0x10 << 26 | t0 << 16 | 15 << 11; // mfc0 t0, PRId
+	nop();
+	rom[pc++] = t0 << 16 | t0 << 11 | 8 << 6 | 0x02; // srl t0, t0, 8
+	branch(0x05, t0, zero, ee_code);                 // bne t0, zero, ee_code
+	nop();
+	branch(0x04, zero, zero, pc);                    // IOP: b .
+	nop();
+
+	// ROMDIR, the BIOS detection looks for it and for ROMVER
+	struct RomDirEntry { char name[10]; uint16_t ext_info; uint32_t size; };
+	const RomDirEntry romdir[] = {{"RESET", 0, 0x100}, {"ROMDIR", 0, 0x40}, {"ROMVER", 0, 0x10}, {}};
+	memcpy(&rom[0x100 / 4], romdir, sizeof(romdir));
+	memcpy(&rom[0x140 / 4], "0100PD20010101", 14);
+
+	pc = ee_code;
+	lui(a0, 0xbfc0);
+	ori(a0, a0, stream * 4);
+	lui(a1, 0xbfc0);
+	ori(a1, a1, stream * 4 + stream_qwc * 16);
+	lui(a2, 0xb000);
+	ori(a2, a2, 0x5000); // VIF1 FIFO
+	const size_t upload = pc;
+	lq(t1, 0, a0);
+	addiu(a0, a0, 16);
+	sq(t1, 0, a2);
+	branch(0x05, a0, a1, upload);
+	nop();
+	lq(s2, 0, a0);       // MSCAL 0
+	lui(s1, 0xa010);     // where the count goes, main memory
+	addiu(s0, zero, 0);
+	const size_t kick = pc;
+	sq(s2, 0, a2);
+	addiu(s0, s0, 1);
+	sw(s0, 0, s1);
+	addiu(t2, zero, 200);
+	const size_t wait = pc;
+	addiu(t2, t2, -1);
+	branch(0x05, t2, zero, wait);
+	nop();
+	branch(0x04, zero, zero, kick);
+	nop();
+
+	// VU1 microprogram, lower and upper instruction. The count at VU1 address
+	// 0 goes up by 97 per run, it loops (count & 1023) + 1 times.
+	const uint32_t upper_nop = 0x000002ff, upper_nop_e = 0x400002ff, lower_nop = 0x8000033c;
+	const uint32_t microprogram[] = {
+		0x09020000,                                 upper_nop,   // ilw.x vi02, 0(vi00)
+		lower_nop,                                  upper_nop,
+		lower_nop,                                  upper_nop,
+		0x10000000 | 2 << 16 | 2 << 11 | 97,        upper_nop,   // iaddiu vi02, vi02, 97
+		0x10000000 | 3 << 16 | 0x3ff,               upper_nop,   // iaddiu vi03, vi00, 1023
+		0x0b020000,                                 upper_nop,   // isw.x vi02, 0(vi00)
+		0x80000034 | 3 << 16 | 2 << 11 | 1 << 6,    upper_nop,   // iand vi01, vi02, vi03
+		lower_nop,                                  upper_nop,
+		0x10000000 | 1 << 16 | 1 << 11 | 1,         upper_nop,   // iaddiu vi01, vi01, 1
+		lower_nop,                                  upper_nop,
+		0x80000032 | 1 << 16 | 1 << 11 | 0x1f << 6, upper_nop,   // iaddi vi01, vi01, -1
+		lower_nop,                                  upper_nop,
+		0x52000000 | 1 << 16 | 0x7fd,               upper_nop,   // ibne vi01, vi00, -3
+		lower_nop,                                  upper_nop,
+		lower_nop,                                  upper_nop_e,
+		lower_nop,                                  upper_nop,
+	};
+
+	pc = stream;
+	rom[pc++] = 0;
+	rom[pc++] = 0x4a000000 | 16 << 16; // MPG 16 instructions at 0, 64-bit aligned
+	memcpy(&rom[pc], microprogram, sizeof(microprogram));
+	pc += sizeof(microprogram) / 4 + 2;
+	rom[pc++] = 0x14000000; // MSCAL 0, loaded as a whole qword
+
+	return rom;
+}
+
+int remove_entry(const char* path, const struct stat*, int, struct FTW*)
+{
+	return remove(path);
+}
+
+// Runs child(fd) in a process of its own, which exits with 1 if it returns
+// false, and parent(fd) meanwhile. What the child writes to its fd the parent
+// reads from its own. True if both succeeded.
+template <typename Child, typename Parent>
+bool run_in_child(Child child, Parent parent)
+{
+	int fds[2];
+	if (pipe(fds) != 0)
+		return false;
+
+	fflush(NULL);
+	pid_t pid = fork();
+	if (pid < 0)
+	{
+		close(fds[0]);
+		close(fds[1]);
+		return false;
+	}
+
+	if (pid == 0)
+	{
+		close(fds[0]);
+		_exit(child(fds[1]) ? 0 : 1);
+	}
+
+	close(fds[1]);
+	const bool ok = parent(fds[0]);
+	close(fds[0]);
+
+	int status = 0;
+	return waitpid(pid, &status, 0) == pid && WIFEXITED(status) && WEXITSTATUS(status) == 0 && ok;
+}
+
+// Boots the ROM with the given options in a child of its own, whose state
+// hashes come back through a pipe
+bool determinism_run(const std::map<std::string, std::string>& options, std::vector<uint64_t>& hashes)
+{
+	auto child = [&](int fd) {
+		for (const auto& kv : options)
+			opts.overrides[kv.first] = kv.second;
+
+		void (*force)(bool);
+		if (!load_core(opts.core_path) || !core.get_state_hashes || !load_symbol(force, "lrps2_force_state_hashes"))
+			return false;
+
+		init_core();
+		force(true);
+		if (!core.load_game(NULL))
+			return false;
+
+		for (unsigned frame = 0; frame < opts.frames; frame++)
+			core.run();
+
+		uint64_t chunk[256];
+		uint64_t first = 0;
+		while (unsigned count = core.get_state_hashes(first, chunk, 256))
+		{
+			if (write(fd, chunk, count * sizeof(uint64_t)) != (ssize_t)(count * sizeof(uint64_t)))
+				return false;
+			first += count;
+		}
+
+		core.unload_game();
+		core.deinit();
+		return true;
+	};
+
+	auto parent = [&](int fd) {
+		uint64_t hash;
+		while (read(fd, &hash, sizeof(hash)) == sizeof(hash))
+			hashes.push_back(hash);
+		return true;
+	};
+
+	return run_in_child(child, parent);
+}
+
+// Runs the memory snapshot check of the benchmark core on the ROM, in a
+// process of its own since the emulation is left with restored memory but not
+// registers. The EE has to wait between frames, so "Deterministic Mode" is on.
+bool snapshot_run(const char* preset, lrps2_snapshot_check& result)
+{
+	auto child = [&](int fd) {
+		opts.overrides["pcsx2_bios"]               = "determinism.bin";
+		opts.overrides["pcsx2_deterministic"]      = "enabled";
+		opts.overrides["pcsx2_speedhacks_presets"] = preset;
+
+		bool (*run)(unsigned, lrps2_snapshot_check*);
+		if (!load_core(opts.core_path) || !load_symbol(run, "lrps2_run_snapshot_check"))
+			return false;
+
+		init_core();
+		if (!core.load_game(NULL))
+			return false;
+
+		// Into the ROM's main loop first
+		for (unsigned frame = 0; frame < 60; frame++)
+			core.run();
+
+		lrps2_snapshot_check r = {};
+		return run(120, &r) && write(fd, &r, sizeof(r)) == (ssize_t)sizeof(r);
+	};
+
+	auto parent = [&](int fd) {
+		return read(fd, &result, sizeof(result)) == (ssize_t)sizeof(result);
+	};
+
+	return run_in_child(child, parent);
+}
+
+// Writes the ROM as the BIOS of a system directory under a temporary one,
+// which remove_rom_dir() deletes
+bool make_rom_dir(std::string& dir)
+{
+	char path[] = "/tmp/lrps2_bench.XXXXXX";
+	if (!mkdtemp(path))
+	{
+		fprintf(stderr, "lrps2_bench: mkdtemp: %s\n", strerror(errno));
+		return false;
+	}
+	dir = path;
+
+	opts.system_dir = dir + "/system";
+	opts.save_dir   = dir + "/saves";
+	const std::string bios_dir = opts.system_dir + "/pcsx2/bios";
+	mkdir(opts.system_dir.c_str(), 0755);
+	mkdir((opts.system_dir + "/pcsx2").c_str(), 0755);
+	mkdir(bios_dir.c_str(), 0755);
+	mkdir(opts.save_dir.c_str(), 0755);
+
+	const std::vector<uint32_t> rom = determinism_rom();
+	FILE* f = fopen((bios_dir + "/determinism.bin").c_str(), "wb");
+	const bool ok = f && fwrite(rom.data(), sizeof(uint32_t), rom.size(), f) == rom.size();
+	if (f)
+		fclose(f);
+	return ok;
+}
+
+void remove_rom_dir(const std::string& dir)
+{
+	nftw(dir.c_str(), remove_entry, 16, FTW_DEPTH | FTW_PHYS);
+}
+
+int run_determinism()
+{
+	// "Balanced" turns MTVU on, "Mostly Harmful" adds the EE cycle skip that MTVU
+	// takes from the VU1 programs' cycle counts
+	static const struct
+	{
+		const char* name;
+		const char* deterministic;
+		const char* preset;
+		bool must_match;
+	} configs[] = {
+		{"deterministic", "enabled", "1", true},
+		{"deterministic_mtvu", "enabled", "2", true},
+		{"deterministic_mtvu_cycle_skip", "enabled", "5", true},
+		{"mtvu", "disabled", "2", false},
+		{"mtvu_cycle_skip", "disabled", "5", false},
+	};
+
+	std::string dir;
+	bool ok = make_rom_dir(dir);
+
+	struct Result
+	{
+		size_t frames[2];
+		long first_difference;
+	};
+
+	std::vector<Result> results;
+	for (const auto& c : configs)
+	{
+		if (!ok)
+			break;
+
+		const std::map<std::string, std::string> options = {
+			{"pcsx2_bios", "determinism.bin"},
+			{"pcsx2_deterministic", c.deterministic},
+			{"pcsx2_speedhacks_presets", c.preset},
+		};
+
+		std::vector<uint64_t> hashes[2];
+		for (int run = 0; run < 2 && ok; run++)
+			ok = determinism_run(options, hashes[run]);
+
+		Result r = {{hashes[0].size(), hashes[1].size()}, -1};
+		const size_t frames = std::min(hashes[0].size(), hashes[1].size());
+		for (size_t i = 0; i < frames && r.first_difference < 0; i++)
+			if (hashes[0][i] != hashes[1][i])
+				r.first_difference = (long)i;
+		results.push_back(r);
+	}
+
+	if (!dir.empty())
+		remove_rom_dir(dir);
+
+	if (!ok)
+	{
+		fprintf(stderr, "lrps2_bench: the determinism check could not boot its ROM, it needs the benchmark core\n");
+		return 1;
+	}
+
+	FILE* out = begin_report("determinism");
+	if (!out)
+		return 1;
+
+	int failures = 0;
+
+	for (size_t i = 0; i < results.size(); i++)
+	{
+		const Result& r = results[i];
+		const bool match = r.first_difference < 0 && r.frames[0] == r.frames[1] && r.frames[0] > 0;
+		fprintf(out, "    {\"config\": \"%s\", \"must_match\": %s, \"hashed_frames\": [%zu, %zu], \"first_difference\": ",
+		        configs[i].name, configs[i].must_match ? "true" : "false", r.frames[0], r.frames[1]);
+		if (r.first_difference < 0)
+			fprintf(out, "null");
+		else
+			fprintf(out, "%ld", r.first_difference);
+		fprintf(out, ", \"match\": %s}%s\n", match ? "true" : "false", i + 1 < results.size() ? "," : "");
+		failures += configs[i].must_match && !match;
+	}
+
+	return end_report(out, failures);
+}
+
+int run_snapshot()
+{
+	// With and without MTVU, whose thread writes VU1 memory on its own
+	static const struct
+	{
+		const char* name;
+		const char* preset;
+	} configs[] = {
+		{"snapshot", "1"},
+		{"snapshot_mtvu", "2"},
+	};
+
+	std::string dir;
+	bool ok = make_rom_dir(dir);
+
+	std::vector<lrps2_snapshot_check> results;
+	for (const auto& c : configs)
+	{
+		lrps2_snapshot_check r = {};
+		if (ok)
+			ok = snapshot_run(c.preset, r);
+		results.push_back(r);
+	}
+
+	if (!dir.empty())
+		remove_rom_dir(dir);
+
+	if (!ok)
+	{
+		fprintf(stderr, "lrps2_bench: the snapshot check could not run, it needs the benchmark core\n");
+		return 1;
+	}
+
+	FILE* out = begin_report("snapshot");
+	if (!out)
+		return 1;
+
+	int failures = 0;
+
+	for (size_t i = 0; i < results.size(); i++)
+	{
+		const lrps2_snapshot_check& r = results[i];
+		fprintf(out, "    {\"config\": \"%s\", \"pages_written\": %u, \"pages_copied\": %u, \"save_mismatches\": %u, "
+		             "\"restore_mismatches\": %u, \"host_read_errno\": %d, \"capture_us\": %llu, \"restore_us\": %llu}%s\n",
+		        configs[i].name, r.pages_written, r.pages_copied, r.save_mismatches, r.restore_mismatches, r.host_read_errno,
+		        (unsigned long long)r.capture_us, (unsigned long long)r.restore_us, i + 1 < results.size() ? "," : "");
+		failures += r.pages_written == 0 || r.save_mismatches || r.restore_mismatches || r.host_read_errno;
+	}
+
+	return end_report(out, failures);
+}
+
+} // namespace
+
+int main(int argc, char** argv)
+{
+	if (!parse_args(argc, argv))
+	{
+		usage(argv[0]);
+		return 1;
+	}
+
+	// The CPU-only presentation path needs no GL context.
+	if (!opts.overrides.count("pcsx2_renderer"))
+		opts.overrides["pcsx2_renderer"] = "Software";
+
+	// Each run in a process of its own
+	if (opts.determinism)
+		return run_determinism();
+	if (opts.snapshot)
+		return run_snapshot();
+
+	if (!load_core(opts.core_path))
+		return 1;
+
+	if (!opts.transfers && !opts.vertex_trace && !opts.pipeline && !opts.audio && !opts.mcd_journal)
+		tlb_open();
+
+	init_core();
+
+	if (opts.transfers)
+		return run_transfers();
+	if (opts.vertex_trace)
+		return run_vertex_trace();
+	if (opts.pipeline)
+		return run_pipeline();
+	if (opts.audio)
+		return run_audio();
+	if (opts.mcd_journal)
+		return run_mcd_journal();
+
+	retro_game_info game = {};
+	game.path            = opts.disc_path;
+	if (!core.load_game(&game))
+	{
+		fprintf(stderr, "lrps2_bench: failed to load %s\n", opts.disc_path);
+		core.deinit();
+		return 1;
+	}
+
+	const pid_t self = (pid_t)syscall(SYS_gettid);
+	std::vector<double> wall_ms;
+	std::vector<double> group_ms[GROUP_COUNT];
+	std::vector<double> decode_ms, decode_kb;
+	uint64_t unused[GROUP_COUNT] = {};
+
+	lrps2_bench_stats frame_stats = {};
+	if (core.get_stats)
+		core.get_stats(&frame_stats);
+
+	sample_threads(self, unused);
+
+	uint64_t run_start = clock_ns(CLOCK_MONOTONIC);
+	for (unsigned frame = 0; frame < opts.frames; frame++)
+	{
+		if (frame == opts.skip)
+			tlb_enable(true);
+
+		uint64_t delta[GROUP_COUNT] = {};
+		uint64_t wall0 = clock_ns(CLOCK_MONOTONIC);
+		uint64_t cpu0  = clock_ns(CLOCK_THREAD_CPUTIME_ID);
+
+		core.run();
+
+		uint64_t cpu1  = clock_ns(CLOCK_THREAD_CPUTIME_ID);
+		uint64_t wall1 = clock_ns(CLOCK_MONOTONIC);
+
+		delta[GROUP_MTGS] = cpu1 - cpu0;
+		sample_threads(self, delta);
+
+		// Texture decode counters are running totals, keep the per frame delta
+		uint64_t decode_bytes = 0, decode_ns = 0;
+		if (core.get_stats)
+		{
+			lrps2_bench_stats now = {};
+			core.get_stats(&now);
+			decode_bytes = now.tex_decode_bytes - frame_stats.tex_decode_bytes;
+			decode_ns    = now.tex_decode_ns - frame_stats.tex_decode_ns;
+			frame_stats  = now;
+		}
+
+		if (frame < opts.skip)
+			continue;
+
+		wall_ms.push_back((wall1 - wall0) / 1e6);
+		for (int g = 0; g < GROUP_COUNT; g++)
+			group_ms[g].push_back(delta[g] / 1e6);
+		decode_ms.push_back(decode_ns / 1e6);
+		decode_kb.push_back(decode_bytes / 1024.0);
+	}
+	double run_ms = (clock_ns(CLOCK_MONOTONIC) - run_start) / 1e6;
+	tlb_enable(false);
+
+	uint64_t tlb_misses[TLB_COUNT];
+	bool have_tlb = tlb_read(TLB_DATA, tlb_misses[TLB_DATA]) && tlb_read(TLB_INSTRUCTION, tlb_misses[TLB_INSTRUCTION]);
+	long huge_kb  = anon_huge_pages_kb();
+
+	lrps2_bench_stats stats = {};
+	if (core.get_stats)
+		core.get_stats(&stats);
+
+	std::vector<uint64_t> state_hashes;
+	if (core.get_state_hashes)
+	{
+		uint64_t chunk[256];
+		while (unsigned count = core.get_state_hashes(state_hashes.size(), chunk, 256))
+			state_hashes.insert(state_hashes.end(), chunk, chunk + count);
+	}
+
+	core.unload_game();
+	core.deinit();
+
+	struct rusage usage = {};
+	getrusage(RUSAGE_SELF, &usage);
+
+	FILE* out = open_output();
+	if (!out)
+		return 1;
+
+	fprintf(out, "{\n  \"core\": ");
+	print_string(out, opts.core_path);
+	fprintf(out, ",\n  \"disc\": ");
+	print_string(out, opts.disc_path);
+	fprintf(out, ",\n  \"options\": {");
+	bool first = true;
+	for (const auto& kv : opts.overrides)
+	{
+		fprintf(out, "%s", first ? "" : ", ");
+		print_string(out, kv.first.c_str());
+		fprintf(out, ": ");
+		print_string(out, kv.second.c_str());
+		first = false;
+	}
+	fprintf(out, "},\n");
+	fprintf(out, "  \"frames\": %u,\n  \"skipped_frames\": %u,\n  \"presented_frames\": %u,\n",
+	        opts.frames, opts.skip, presented_frames);
+	fprintf(out, "  \"run_ms\": %.3f,\n", run_ms);
+	fprintf(out, "  \"frame_time\": {\n");
+	print_series(out, "wall", wall_ms, false);
+	for (int g = 0; g < GROUP_COUNT; g++)
+		print_series(out, group_names[g], group_ms[g], g == GROUP_COUNT - 1);
+	fprintf(out, "  },\n");
+
+	if (core.get_stats)
+	{
+		fprintf(out, "  \"texture_decode\": {\n");
+		print_series(out, "time", decode_ms, false);
+		print_series(out, "size", decode_kb, true, "kb");
+		fprintf(out, "  },\n");
+		fprintf(out, "  \"texture_hash\": {\"hits\": %llu, \"misses\": %llu},\n",
+		        (unsigned long long)stats.tex_hash_hits, (unsigned long long)stats.tex_hash_misses);
+		fprintf(out, "  \"audio\": {\"underruns\": %llu, \"overruns\": %llu, \"fill\": %u},\n",
+		        (unsigned long long)stats.audio_underruns, (unsigned long long)stats.audio_overruns, stats.audio_fill);
+	}
+	else
+	{
+		fprintf(out, "  \"texture_decode\": null,\n");
+		fprintf(out, "  \"texture_hash\": null,\n");
+		fprintf(out, "  \"audio\": null,\n");
+	}
+
+	if (core.get_stats)
+	{
+		fprintf(out, "  \"recompiler\": {\"ee_blocks\": %u, \"ee_compiled\": %llu, \"ee_resets\": %u, "
+		             "\"ee_evictions\": %u, \"ee_evicted\": %llu, "
+		             "\"ee_code_used\": %u, \"ee_code_reserved\": %u",
+		        stats.ee_blocks, (unsigned long long)stats.ee_compiled, stats.ee_resets,
+		        stats.ee_evictions, (unsigned long long)stats.ee_evicted,
+		        stats.ee_code_used, stats.ee_code_reserved);
+		for (int i = 0; i < 2; i++)
+			fprintf(out, ", \"vu%d_programs\": %u, \"vu%d_resets\": %u, \"vu%d_evictions\": %u, "
+			             "\"vu%d_evicted\": %llu, \"vu%d_code_used\": %u, \"vu%d_code_reserved\": %u",
+			        i, stats.vu[i].programs, i, stats.vu[i].resets, i, stats.vu[i].evictions,
+			        i, (unsigned long long)stats.vu[i].evicted, i, stats.vu[i].code_used,
+			        i, stats.vu[i].code_reserved);
+		fprintf(out, "},\n");
+	}
+	else
+		fprintf(out, "  \"recompiler\": null,\n");
+
+	if (have_tlb)
+	{
+		const double frames = std::max<size_t>(wall_ms.size(), 1);
+		fprintf(out, "  \"tlb\": {\"dtlb_misses\": %llu, \"itlb_misses\": %llu, "
+		             "\"dtlb_misses_per_frame\": %.0f, \"itlb_misses_per_frame\": %.0f},\n",
+		        (unsigned long long)tlb_misses[TLB_DATA], (unsigned long long)tlb_misses[TLB_INSTRUCTION],
+		        tlb_misses[TLB_DATA] / frames, tlb_misses[TLB_INSTRUCTION] / frames);
+	}
+	else
+		fprintf(out, "  \"tlb\": null,\n");
+
+	if (core.get_state_hashes)
+	{
+		fprintf(out, "  \"state_hashes\": [");
+		for (size_t i = 0; i < state_hashes.size(); i++)
+			fprintf(out, "%s\"%016llx\"", i ? ", " : "", (unsigned long long)state_hashes[i]);
+		fprintf(out, "],\n");
+	}
+	else
+		fprintf(out, "  \"state_hashes\": null,\n");
+
+	fprintf(out, "  \"anon_huge_pages_kb\": %ld,\n", huge_kb);
+	fprintf(out, "  \"peak_rss_kb\": %ld\n}\n", usage.ru_maxrss);
+
+	if (out != stdout)
+		fclose(out);
+
+	dlclose(core.handle);
+	return 0;
+}
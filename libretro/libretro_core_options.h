@@ -131,6 +131,62 @@ struct retro_core_option_v2_definition option_defs_us[] = {
       },
       "disabled"
    },
+   {
+      BOOL_PCSX2_OPT_PRELOAD_DISC,
+      "System: Preload Disc Image",
+      "Preload Disc Image",
+      "Read the whole disc image into RAM in the background after boot, decompressing CHD and CSO images along the way. Removes disc access stutter once loaded, but needs as much free RAM as the uncompressed image. (Content restart required)",
+      NULL,
+      "system_options",
+      {
+         {"disabled", NULL},
+         {"enabled", NULL},
+         {NULL, NULL},
+      },
+      "disabled"
+   },
+   {
+      BOOL_PCSX2_OPT_SHARED_DISC_CACHE,
+      "System: Share Disc Cache",
+      "Share Disc Cache",
+      "Keep decoded disc sectors in shared memory, so that other instances running the same disc image reuse them instead of reading and decompressing their own copy. Combine with Preload Disc Image to load the whole image once for all instances. Linux/macOS only. (Content restart required)",
+      NULL,
+      "system_options",
+      {
+         {"disabled", NULL},
+         {"enabled", NULL},
+         {NULL, NULL},
+      },
+      "disabled"
+   },
+   {
+      BOOL_PCSX2_OPT_VU_PROGRAM_CACHE,
+      "System: Persistent VU Program Cache",
+      "Persistent VU Program Cache",
+      "Keep the VU microprograms each game runs in the save directory, and recompile them when the game boots instead of the first time they run. Reduces stutter in the first minutes of play. (Content restart required)",
+      NULL,
+      "system_options",
+      {
+         {"disabled", NULL},
+         {"enabled", NULL},
+         {NULL, NULL},
+      },
+      "disabled"
+   },
+   {
+      BOOL_PCSX2_OPT_VU_BACKGROUND_COMPILE,
+      "System: Background VU1 Compile",
+      "Background VU1 Compile",
+      "Interpret new VU1 microprograms while a worker thread recompiles them, instead of pausing emulation for the recompile. Reduces stutter when a game uploads new microprograms, at the cost of slower first runs. Has no effect with MTVU. (Content restart required)",
+      NULL,
+      "system_options",
+      {
+         {"disabled", NULL},
+         {"enabled", NULL},
+         {NULL, NULL},
+      },
+      "disabled"
+   },
    {
       BOOL_PCSX2_OPT_FASTBOOT,
       "System: Fast Boot",
@@ -145,6 +201,105 @@ struct retro_core_option_v2_definition option_defs_us[] = {
       },
       "enabled"
    },
+   {
+      STRING_PCSX2_OPT_THREAD_PLACEMENT,
+      "System: Thread Placement",
+      "Thread Placement",
+      "Pin the emulator threads to CPU cores. 'Dedicated Cores' gives the EE, VU1 and GS threads a physical core each within one L3 cache domain, and the GS workers the other cores there. 'Same L3 Domain' only keeps all threads within that domain. Only the CPUs the process is allowed to use are considered, so several instances on one host can be given separate CPU sets. Linux only. (Content restart required)",
+      NULL,
+      "system_options",
+      {
+         {"disabled", NULL},
+         {"dedicated", "Dedicated Cores"},
+         {"domain", "Same L3 Domain"},
+         {NULL, NULL},
+      },
+      "disabled"
+   },
+   {
+      BOOL_PCSX2_OPT_HUGE_PAGES,
+      "System: Huge Pages",
+      "Huge Pages",
+      "Back the PS2 memory, the GS memory and the recompiler code caches with 2MB pages where the OS allows it (transparent huge pages in 'madvise' or 'always' mode), which reduces TLB misses. EE memory pages holding recompiled code still get 4KB protection. Uses a bit more memory. Linux only. (Content restart required)",
+      NULL,
+      "system_options",
+      {
+         {"disabled", NULL},
+         {"enabled", NULL},
+         {NULL, NULL},
+      },
+      "disabled"
+   },
+   {
+      BOOL_PCSX2_OPT_PERF_MAP,
+      "System: Export JIT Symbols",
+      "Export JIT Symbols",
+      "Write the guest code blocks, VU programs, VIF unpacks and GS kernels the recompilers produce to /tmp/perf-<pid>.map, so that Linux perf can name them in its profiles. Slows down compilation a little. Linux only. (Content restart required)",
+      NULL,
+      "system_options",
+      {
+         {"disabled", NULL},
+         {"enabled", NULL},
+         {NULL, NULL},
+      },
+      "disabled"
+   },
+   {
+      BOOL_PCSX2_OPT_GUEST_PROFILER,
+      "System: Guest Profiler",
+      "Guest Profiler",
+      "Sample the EE, IOP and VU1 program counters while a game runs, and write the time spent per game function to a profile_<crc>_<time>.txt file in the save directory when the game is closed. Time the game is paused is left out. (Content restart required)",
+      NULL,
+      "system_options",
+      {
+         {"disabled", NULL},
+         {"enabled", NULL},
+         {NULL, NULL},
+      },
+      "disabled"
+   },
+   {
+      BOOL_PCSX2_OPT_GS_PIPELINE,
+      "System: GS Pipeline",
+      "GS Pipeline",
+      "Parse the GS packets on a thread of their own, so that the renderer only executes the draws and memory transfers. Helps when the GS thread is the bottleneck, at the cost of up to one frame of extra latency. Software renderer only. GS dumps aren't available while it's enabled. (Content restart required)",
+      NULL,
+      "system_options",
+      {
+         {"disabled", NULL},
+         {"enabled", NULL},
+         {NULL, NULL},
+      },
+      "disabled"
+   },
+   {
+      BOOL_PCSX2_OPT_AUDIO_RATE_CONTROL,
+      "System: Audio Rate Control",
+      "Audio Rate Control",
+      "Buffer the audio and hand it to the frontend once per frame, slightly resampled to follow the host audio clock. Keeps the audio latency low and stable when the emulation runs a little faster or slower than the host. (Content restart required)",
+      NULL,
+      "system_options",
+      {
+         {"disabled", NULL},
+         {"enabled", NULL},
+         {NULL, NULL},
+      },
+      "disabled"
+   },
+   {
+      BOOL_PCSX2_OPT_DETERMINISTIC,
+      "System: Deterministic Mode",
+      "Deterministic Mode",
+      "Make every run of the same content with the same inputs produce the same emulated state, frame for frame: the VU1 thread is synchronized at fixed emulated cycles, the real-time clock starts at a fixed date and the VU1 background compile is off. Slightly slower with MTVU. For replays, netplay and regression testing. (Content restart required)",
+      NULL,
+      "system_options",
+      {
+         {"disabled", NULL},
+         {"enabled", NULL},
+         {NULL, NULL},
+      },
+      "disabled"
+   },
    {
       BOOL_PCSX2_OPT_BOOT_TO_BIOS,
       "System: Boot to BIOS",
@@ -187,7 +342,7 @@ struct retro_core_option_v2_definition option_defs_us[] = {
       STRING_PCSX2_OPT_RENDERER,
       "Video: Renderer",
       "Renderer",
-      "Content restart required.",
+      "Software renders and presents on the CPU only and needs no GPU. Content restart required.",
       NULL,
       "video_options",
       {
@@ -196,6 +351,7 @@ struct retro_core_option_v2_definition option_defs_us[] = {
          {"D3D11", NULL},
 #endif
          {"OpenGL", NULL},
+         {"Software", NULL},
          {NULL, NULL},
       },
       "Auto"
@@ -446,6 +602,22 @@ struct retro_core_option_v2_definition option_defs_us[] = {
       },
       "disabled"
    },
+   {
+      BOOL_PCSX2_OPT_TEXTURE_HASH_CACHE,
+      "Video: Texture Hash Cache",
+      "Texture Hash Cache",
+      "Enabled: a texture uploaded again with the same content reuses the already converted texture. \
+      \nDisabled: every upload is converted again. \
+      \nSaves CPU and GPU time in games that stream textures, at the cost of hashing new textures.",
+      NULL,
+      "video_options",
+      {
+         {"disabled", NULL},
+         {"enabled", NULL},
+         {NULL, NULL},
+      },
+      "disabled"
+   },
    {
       BOOL_PCSX2_OPT_FRAMESKIP,
       "Video: Frame Skip",
@@ -719,6 +891,24 @@ struct retro_core_option_v2_definition option_defs_us[] = {
       },
       "2"
    },
+   {
+      INT_PCSX2_OPT_GS_DUMP_FRAMES,
+      "Emulation: Record GS Dump",
+      "Record GS Dump",
+      "Records the GS state and every GS packet for the given number of frames to a gsdump_<crc>_<time>.gs file in the 'pcsx2' save folder. Loading that file as content replays it without emulating the rest of the console, which is useful to benchmark and regression-test the renderers. Switch to another value to record a new dump.",
+      NULL,
+      "emulation_options",
+      {
+         {"0", "disabled"},
+         {"1", "1 frame"},
+         {"60", "60 frames"},
+         {"300", "300 frames"},
+         {"600", "600 frames"},
+         {"1800", "1800 frames"},
+         {NULL, NULL},
+      },
+      "0"
+   },
    {
       INT_PCSX2_OPT_EE_CLAMPING_MODE,
       "Emulation: EE/FPU Clamping Mode",
@@ -0,0 +1,57 @@
+#ifndef LRPS2_BENCH_H__
+#define LRPS2_BENCH_H__
+
+#include <stdint.h>
+
+#include "libretro.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Counters exported for the headless benchmark runner (libretro/bench).
+ * Not part of the libretro API; frontends never look this up. */
+struct lrps2_bench_stats
+{
+   uint32_t ee_blocks;        /* EE recompiler blocks currently cached */
+   uint32_t ee_resets;        /* full EE recompiler cache flushes */
+   uint32_t ee_evictions;     /* EE code cache segments recycled */
+   uint64_t ee_evicted;       /* EE blocks dropped by segment recycling */
+   uint64_t ee_compiled;      /* EE blocks compiled since startup */
+   uint32_t ee_code_used;     /* bytes of EE code held by live blocks */
+   uint32_t ee_code_reserved; /* size of the EE code reserve */
+
+   /* Same for microVU0 and microVU1, per cached microprogram */
+   struct
+   {
+      uint32_t programs;
+      uint32_t resets;
+      uint32_t evictions;
+      uint64_t evicted;
+      uint32_t code_used;
+      uint32_t code_reserved;
+   } vu[2];
+
+   uint64_t tex_decode_bytes; /* texture cache source uploads decoded */
+   uint64_t tex_decode_ns;    /* time spent decoding them */
+   uint64_t tex_hash_hits;    /* sources that reused a texture of the hash cache */
+   uint64_t tex_hash_misses;  /* sources the hash cache had to decode */
+
+   uint64_t audio_underruns;  /* frames the audio drain ran short of samples */
+   uint64_t audio_overruns;   /* samples dropped because the audio ring was full */
+   uint32_t audio_fill;       /* samples left in the audio ring after the last drain */
+};
+
+RETRO_API void lrps2_get_bench_stats(struct lrps2_bench_stats *stats);
+
+/* Per frame hashes of the emulated state, with the "Deterministic Mode"
+ * option only. Copies those of frames first_frame and up (counted from the
+ * last reset), returns how many. Two runs diverged at the first frame whose
+ * hashes differ. */
+RETRO_API unsigned lrps2_get_state_hashes(uint64_t first_frame, uint64_t *hashes, unsigned max);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -30,6 +30,13 @@
 
 #include "../pcsx2/MTVU.h"
 #include "../pcsx2/GS/GSFuncs.h"
+#include "../pcsx2/GS/GSReplay.h"
+#include "../pcsx2/SPU2/SndOut.h"
+#include "../pcsx2/StateHash.h"
+#include "../pcsx2/x86/iR5900.h"
+#include "lrps2_bench.h"
+#include "Utilities/Perf.h"
+#include "Utilities/ThreadPlacement.h"
 
 #ifdef PERF_TEST
 #define RETRO_PERFORMANCE_INIT(name)                 \
@@ -53,6 +60,7 @@
 #define FILENAME_SHARED_MEMCARD_32 "Shared Memory Card (32 MB)"
 
 retro_audio_sample_t sample_cb;
+retro_audio_sample_batch_t batch_cb;
 retro_environment_t environ_cb;
 retro_video_refresh_t video_cb;
 retro_log_printf_t log_cb;
@@ -126,10 +134,13 @@ static std::vector<std::string> custom_memcard_list_slot2;
 
 static bool libretro_supports_option_categories = false;
 static bool init_failed                         = false;
+/* Set when the content is a GS dump: the GS is driven from it, nothing else runs. */
+static GSReplay* gs_replay                      = NULL;
 int option_upscale_mult                         = 1;
 int option_pad_left_deadzone                    = 0;
 int option_pad_right_deadzone                   = 0;
 bool option_palette_conversion                  = false;
+bool option_texture_hash_cache                  = false;
 bool hack_fb_conversion                         = false;
 bool hack_AutoFlush                             = false;
 bool hack_fast_invalidation                     = false;
@@ -139,6 +150,7 @@ std::string sel_bios_path                       = "";
 unsigned libretro_msg_interface_version         = 0;
 
 std::string retroarch_system_path;
+std::string retroarch_save_path;
 
 Pcsx2App* pcsx2;
 
@@ -199,6 +211,7 @@ void retro_init(void)
 	slot1_file    = wxFileName(save_dir_root.GetPath(), "");
 	slot2_file    = wxFileName(save_dir_root.GetPath(), "");
 	save_dir_root.AppendDir("pcsx2");
+	retroarch_save_path = save_dir_root.GetPath().ToStdString();
 	slot1_file.AppendDir("Slot 1");
 	slot2_file.AppendDir("Slot 2");
 	
@@ -365,11 +378,21 @@ void retro_init(void)
 	// start init some core settings
 	option_upscale_mult       = option_value(INT_PCSX2_OPT_UPSCALE_MULTIPLIER, KeyOptionInt::return_type);
 	option_palette_conversion = option_value(BOOL_PCSX2_OPT_PALETTE_CONVERSION, KeyOptionBool::return_type);
+	option_texture_hash_cache = option_value(BOOL_PCSX2_OPT_TEXTURE_HASH_CACHE, KeyOptionBool::return_type);
 	hack_fb_conversion        = option_value(BOOL_PCSX2_OPT_USERHACK_FB_CONVERSION, KeyOptionBool::return_type);
 	hack_AutoFlush            = option_value(BOOL_PCSX2_OPT_USERHACK_AUTO_FLUSH, KeyOptionBool::return_type);
 	hack_fast_invalidation    = option_value(BOOL_PCSX2_OPT_USERHACK_FAST_INVALIDATION, KeyOptionBool::return_type);
 	hack_preload_frame_data   = option_value(BOOL_PCSX2_OPT_USERHACK_PRELOAD_FRAME_DATA, KeyOptionBool::return_type);
 
+	Perf::SetEnabled(option_value(BOOL_PCSX2_OPT_PERF_MAP, KeyOptionBool::return_type));
+	HostSys::SetHugePages(option_value(BOOL_PCSX2_OPT_HUGE_PAGES, KeyOptionBool::return_type));
+
+	const char* placement = option_value(STRING_PCSX2_OPT_THREAD_PLACEMENT, KeyOptionString::return_type);
+	if (placement && !strcmp(placement, "dedicated"))
+		Threading::SetPlacementPolicy(Threading::Placement_Dedicated);
+	else if (placement && !strcmp(placement, "domain"))
+		Threading::SetPlacementPolicy(Threading::Placement_Domain);
+
 	f_bios.Assign(option_value(STRING_PCSX2_OPT_BIOS, KeyOptionString::return_type));
 
 	f_bios                    = wxFileName(bios_dir.GetFullPath(), option_value(STRING_PCSX2_OPT_BIOS, KeyOptionString::return_type));
@@ -425,6 +448,14 @@ void retro_init(void)
 
 		g_Conf->EnablePresets                              = true;
 		g_Conf->EmuOptions.Speedhacks.fastCDVD             = option_value(BOOL_PCSX2_OPT_FASTCDVD, KeyOptionBool::return_type);
+		g_Conf->EmuOptions.CdvdPreload                     = option_value(BOOL_PCSX2_OPT_PRELOAD_DISC, KeyOptionBool::return_type);
+		g_Conf->EmuOptions.CdvdSharedCache                 = option_value(BOOL_PCSX2_OPT_SHARED_DISC_CACHE, KeyOptionBool::return_type);
+		g_Conf->EmuOptions.VUProgramCache                  = option_value(BOOL_PCSX2_OPT_VU_PROGRAM_CACHE, KeyOptionBool::return_type);
+		g_Conf->EmuOptions.VUBackgroundCompile             = option_value(BOOL_PCSX2_OPT_VU_BACKGROUND_COMPILE, KeyOptionBool::return_type);
+		g_Conf->EmuOptions.GuestProfiler                   = option_value(BOOL_PCSX2_OPT_GUEST_PROFILER, KeyOptionBool::return_type);
+		g_Conf->EmuOptions.GSPipeline                      = option_value(BOOL_PCSX2_OPT_GS_PIPELINE, KeyOptionBool::return_type);
+		g_Conf->EmuOptions.AudioRateControl                = option_value(BOOL_PCSX2_OPT_AUDIO_RATE_CONTROL, KeyOptionBool::return_type);
+		g_Conf->EmuOptions.Deterministic                   = option_value(BOOL_PCSX2_OPT_DETERMINISTIC, KeyOptionBool::return_type);
 
 		g_Conf->EmuOptions.EnableNointerlacingPatches      = (option_value(INT_PCSX2_OPT_DEINTERLACING_MODE, KeyOptionInt::return_type) == -1);
 		g_Conf->EmuOptions.Enable60fpsPatches              = (option_value(BOOL_PCSX2_OPT_ENABLE_60FPS_PATCHES, KeyOptionBool::return_type));
@@ -513,7 +544,7 @@ void retro_get_system_info(retro_system_info* info)
 	info->library_version               = version;
 #endif
 	info->library_name                  = "LRPS2 (alpha)";
-	info->valid_extensions              = "elf|iso|ciso|chd|cso|cue|bin|m3u";
+	info->valid_extensions              = "elf|iso|ciso|chd|cso|cue|bin|m3u|gs";
 	info->need_fullpath                 = true;
 	info->block_extract                 = true;
 }
@@ -551,11 +582,20 @@ void retro_reset(void)
 
 static void context_reset(void)
 {
-	GetMTGS().OpenGS();
+	if (gs_replay)
+		gs_replay->Open();
+	else
+		GetMTGS().OpenGS();
 }
 
 static void context_destroy(void)
 {
+	if (gs_replay)
+	{
+		gs_replay->Close();
+		return;
+	}
+
 	GetMTGS().FinishTaskInThread();
 
 	while (pcsx2->HasPendingEvents())
@@ -663,6 +703,46 @@ static wxVector<wxString> read_m3u_file(const wxFileName& m3u_file)
 	return result;
 }
 
+static bool init_renderer(void)
+{
+	retro_hw_context_type context_type = RETRO_HW_CONTEXT_OPENGL;
+	const char* option_renderer = option_value(STRING_PCSX2_OPT_RENDERER, KeyOptionString::return_type);
+	log_cb(RETRO_LOG_INFO, "Renderer option set to: %s\n", option_renderer);
+
+	if (!std::strcmp(option_renderer,"Auto"))
+	{
+		environ_cb(RETRO_ENVIRONMENT_GET_PREFERRED_HW_RENDER, &context_type);
+		/* Check if the selected video driver is supported, switch to OpenGL otherwise. */
+		if (context_type != RETRO_HW_CONTEXT_NONE && set_hw_render(context_type))
+			return true;
+
+		context_type = RETRO_HW_CONTEXT_OPENGL;
+		log_cb(RETRO_LOG_INFO, "The video driver found is not compatible, switched to OpenGL.\n");
+	}
+#ifdef _WIN32
+	else if (!std::strcmp(option_renderer, "D3D11"))
+		context_type = RETRO_HW_CONTEXT_DIRECT3D;
+#endif
+	else if (!std::strcmp(option_renderer, "Null"))
+		context_type = RETRO_HW_CONTEXT_NONE;
+	else if (!std::strcmp(option_renderer, "Software"))
+	{
+		/* CPU-only: frames are handed over as plain XRGB8888 buffers,
+		 * so no HW context is requested at all. */
+		hw_render.context_type = RETRO_HW_CONTEXT_NONE;
+		return true;
+	}
+
+	if (!set_hw_render(context_type))
+		return false;
+	return true;
+}
+
+static void RETRO_CALLCONV audio_buffer_status_cb(bool active, unsigned occupancy, bool underrun_likely)
+{
+	SndOut_SetHostBufferStatus(active, occupancy);
+}
+
 bool retro_load_game(const struct retro_game_info* game)
 {
 	static const struct retro_controller_description ds2_desc[] = {
@@ -688,6 +768,18 @@ bool retro_load_game(const struct retro_game_info* game)
 
 	ResetContentStuffs();
 
+	if (game && game->path && GSReplay::IsDump(game->path))
+	{
+		gs_replay = new GSReplay();
+		if (!gs_replay->Load(game->path))
+		{
+			delete gs_replay;
+			gs_replay = NULL;
+			return false;
+		}
+		return init_renderer();
+	}
+
 	if (sel_bios_path.empty())
 	{
 		log_cb(RETRO_LOG_ERROR, "Could not find any valid PS2 BIOS File in %s\n", (const char*)bios_dir.GetFullPath());
@@ -789,6 +881,9 @@ bool retro_load_game(const struct retro_game_info* game)
 
 	}
 
+	/* The pads read the input the EE takes at every vsync, before the EE starts */
+	PADsetInputLatching(g_Conf->EmuOptions.Deterministic);
+
 	if (game)
 	{
 		u32 magic = 0;
@@ -860,6 +955,13 @@ bool retro_load_game(const struct retro_game_info* game)
 
 	environ_cb(RETRO_ENVIRONMENT_GET_RUMBLE_INTERFACE, &rumble);
 	environ_cb(RETRO_ENVIRONMENT_SET_CONTROLLER_INFO, (void*)ports);
+
+	if (g_Conf->EmuOptions.AudioRateControl)
+	{
+		/* The audio drain also keeps the frontend buffer half full when it reports it */
+		static const retro_audio_buffer_status_callback audio_buffer_status = {audio_buffer_status_cb};
+		environ_cb(RETRO_ENVIRONMENT_SET_AUDIO_BUFFER_STATUS_CALLBACK, (void*)&audio_buffer_status);
+	}
 	//	environ_cb(RETRO_ENVIRONMENT_SET_INPUT_DESCRIPTORS, desc);
 
 	Input_RumbleEnabled(
@@ -867,34 +969,18 @@ bool retro_load_game(const struct retro_game_info* game)
 			option_value(INT_PCSX2_OPT_GAMEPAD_RUMBLE_FORCE, KeyOptionInt::return_type)
 			);
 
-	retro_hw_context_type context_type = RETRO_HW_CONTEXT_OPENGL;
-	const char* option_renderer = option_value(STRING_PCSX2_OPT_RENDERER, KeyOptionString::return_type);
-	log_cb(RETRO_LOG_INFO, "Renderer option set to: %s\n", option_renderer);
-
-	if (!std::strcmp(option_renderer,"Auto"))
-	{
-		environ_cb(RETRO_ENVIRONMENT_GET_PREFERRED_HW_RENDER, &context_type);
-		/* Check if the selected video driver is supported, switch to OpenGL otherwise. */
-		if (context_type != RETRO_HW_CONTEXT_NONE && set_hw_render(context_type))
-			return true;
-
-		context_type = RETRO_HW_CONTEXT_OPENGL;
-		log_cb(RETRO_LOG_INFO, "The video driver found is not compatible, switched to OpenGL.\n");
-	}
-#ifdef _WIN32
-	else if (!std::strcmp(option_renderer, "D3D11"))
-		context_type = RETRO_HW_CONTEXT_DIRECT3D;
-#endif
-	else if (!std::strcmp(option_renderer, "Null"))
-		context_type = RETRO_HW_CONTEXT_NONE;
-
-	if (!set_hw_render(context_type))
-		return false;
-	return true;
+	return init_renderer();
 }
 
 void retro_unload_game(void)
 {
+	if (gs_replay)
+	{
+		delete gs_replay;
+		gs_replay = NULL;
+		return;
+	}
+
 	//	GetMTGS().FinishTaskInThread();
 	//		GetMTGS().CloseGS();
 	GetMTGS().FinishTaskInThread();
@@ -922,7 +1008,9 @@ void retro_run(void)
 	if (environ_cb(RETRO_ENVIRONMENT_GET_VARIABLE_UPDATE, &updated) && updated)
 	{
 		EmuConfig.GS.VsyncQueueSize = option_value(INT_PCSX2_OPT_VSYNC_MTGS_QUEUE, KeyOptionInt::return_type);
-		GSUpdateOptions();
+		/* The GS is only opened from the first frame without a HW context. */
+		if (s_gs)
+			GSUpdateOptions();
 		Input_RumbleEnabled(
 			option_value(BOOL_PCSX2_OPT_GAMEPAD_RUMBLE_ENABLE, KeyOptionBool::return_type),
 			option_value(INT_PCSX2_OPT_GAMEPAD_RUMBLE_FORCE, KeyOptionInt::return_type)
@@ -938,11 +1026,29 @@ void retro_run(void)
 		for (unsigned slot = 0; slot < 4; slot++)
 			pads[port][slot].rumble(port);
 
+	if (gs_replay)
+	{
+		if (hw_render.context_type == RETRO_HW_CONTEXT_NONE)
+			gs_replay->Open();
+		gs_replay->RunFrame();
+		return;
+	}
+
+	/* No context_reset will come to open the GS from. */
+	if (hw_render.context_type == RETRO_HW_CONTEXT_NONE)
+		GetMTGS().OpenGS();
+
+	/* The EE waits for it at the vsync this frame ends with */
+	if (EmuConfig.Deterministic)
+		PADqueueInput();
+
 	RETRO_PERFORMANCE_INIT(pcsx2_run);
 	RETRO_PERFORMANCE_START(pcsx2_run);
 
 	GetMTGS().ExecuteTaskInThread();
 
+	SndOut_Drain();
+
 	RETRO_PERFORMANCE_STOP(pcsx2_run);
 }
 
@@ -961,12 +1067,52 @@ void* retro_get_memory_data(unsigned id)              { return NULL; }
 void retro_cheat_reset(void)                                         { }
 void retro_cheat_set(unsigned index, bool enabled, const char* code) { }
 
-/* TODO/FIXME - should maybe go for sample batch cb for improved
- * efficiency */
-void retro_set_audio_sample_batch(retro_audio_sample_batch_t cb) {}
+void retro_set_audio_sample_batch(retro_audio_sample_batch_t cb) { batch_cb = cb; }
 void retro_set_audio_sample(retro_audio_sample_t cb)             {sample_cb = cb; }
 
 wxEventLoopBase* Pcsx2AppTraits::CreateEventLoop()
 {
 	return new wxEventLoop();
 }
+
+void lrps2_get_bench_stats(struct lrps2_bench_stats* stats)
+{
+	recStats rec;
+	recGetStats(rec);
+
+	stats->ee_blocks        = rec.blocks;
+	stats->ee_resets        = rec.resets;
+	stats->ee_evictions     = rec.evictions;
+	stats->ee_evicted       = rec.evicted;
+	stats->ee_compiled      = rec.compiled;
+	stats->ee_code_used     = rec.code_used;
+	stats->ee_code_reserved = rec.code_reserved;
+
+	for (u32 i = 0; i < 2; i++)
+	{
+		microVUStats vu;
+		mVUgetStats(i, vu);
+
+		stats->vu[i].programs      = vu.programs;
+		stats->vu[i].resets        = vu.resets;
+		stats->vu[i].evictions     = vu.evictions;
+		stats->vu[i].evicted       = vu.evicted;
+		stats->vu[i].code_used     = vu.code_used;
+		stats->vu[i].code_reserved = vu.code_reserved;
+	}
+
+	GSgetTextureDecodeStats(&stats->tex_decode_bytes, &stats->tex_decode_ns);
+	GSgetTextureHashStats(&stats->tex_hash_hits, &stats->tex_hash_misses);
+
+	SndOutStats audio;
+	SndOut_GetStats(audio);
+
+	stats->audio_underruns = audio.underruns;
+	stats->audio_overruns  = audio.overruns;
+	stats->audio_fill      = audio.fill;
+}
+
+unsigned lrps2_get_state_hashes(uint64_t first_frame, uint64_t* hashes, unsigned max)
+{
+	return StateHash::Get(first_frame, (u64*)hashes, max);
+}
@@ -3,6 +3,16 @@
 
 #define BOOL_PCSX2_OPT_FASTCDVD                               "pcsx2_fastcdvd"
 #define BOOL_PCSX2_OPT_FASTBOOT                               "pcsx2_fastboot"
+#define BOOL_PCSX2_OPT_PRELOAD_DISC                           "pcsx2_preload_disc"
+#define BOOL_PCSX2_OPT_SHARED_DISC_CACHE                      "pcsx2_shared_disc_cache"
+#define BOOL_PCSX2_OPT_VU_PROGRAM_CACHE                       "pcsx2_vu_program_cache"
+#define BOOL_PCSX2_OPT_VU_BACKGROUND_COMPILE                  "pcsx2_vu_background_compile"
+#define BOOL_PCSX2_OPT_PERF_MAP                               "pcsx2_perf_map"
+#define BOOL_PCSX2_OPT_GUEST_PROFILER                         "pcsx2_guest_profiler"
+#define BOOL_PCSX2_OPT_GS_PIPELINE                            "pcsx2_gs_pipeline"
+#define BOOL_PCSX2_OPT_AUDIO_RATE_CONTROL                     "pcsx2_audio_rate_control"
+#define BOOL_PCSX2_OPT_DETERMINISTIC                          "pcsx2_deterministic"
+#define BOOL_PCSX2_OPT_HUGE_PAGES                             "pcsx2_huge_pages"
 #define BOOL_PCSX2_OPT_ENABLE_WIDESCREEN_PATCHES              "pcsx2_enable_widescreen_patches"
 #define BOOL_PCSX2_OPT_ENABLE_60FPS_PATCHES                   "pcsx2_enable_60fps_patches"
 #define BOOL_PCSX2_OPT_FRAMESKIP                              "pcsx2_frameskip"
@@ -12,12 +22,14 @@
 #define BOOL_PCSX2_OPT_CONSERVATIVE_BUFFER                    "pcsx2_conservative_buffer"
 #define BOOL_PCSX2_OPT_ACCURATE_DATE                          "pcsx2_accurate_date"
 #define BOOL_PCSX2_OPT_PALETTE_CONVERSION                     "pcsx2_palette_conversion"
+#define BOOL_PCSX2_OPT_TEXTURE_HASH_CACHE                     "pcsx2_texture_hash_cache"
 
 #define STRING_PCSX2_OPT_BIOS                                 "pcsx2_bios"
 #define STRING_PCSX2_OPT_RENDERER                             "pcsx2_renderer"
 #define STRING_PCSX2_OPT_SYSTEM_LANGUAGE                      "pcsx2_system_language"
 #define STRING_PCSX2_OPT_MEMCARD_SLOT_1                       "pcsx2_memcard_slot_1"
 #define STRING_PCSX2_OPT_MEMCARD_SLOT_2                       "pcsx2_memcard_slot_2"
+#define STRING_PCSX2_OPT_THREAD_PLACEMENT                     "pcsx2_thread_placement"
 
 #define INT_PCSX2_OPT_ASPECT_RATIO                            "pcsx2_aspect_ratio"
 #define INT_PCSX2_OPT_UPSCALE_MULTIPLIER                      "pcsx2_upscale_multiplier"
@@ -30,6 +42,7 @@
 #define INT_PCSX2_OPT_FXAA                                    "pcsx2_fxaa"
 #define INT_PCSX2_OPT_TEXTURE_FILTERING                       "pcsx2_texture_filtering"
 #define INT_PCSX2_OPT_VSYNC_MTGS_QUEUE                        "pcsx2_vsync_mtgs_queue"
+#define INT_PCSX2_OPT_GS_DUMP_FRAMES                          "pcsx2_gs_dump_frames"
 #define INT_PCSX2_OPT_MIPMAPPING                              "pcsx2_mipmapping"
 #define INT_PCSX2_OPT_EE_CLAMPING_MODE                        "pcsx2_clamping_mode"
 #define INT_PCSX2_OPT_EE_ROUND_MODE                           "pcsx2_round_mode"
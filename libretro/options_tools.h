@@ -10,6 +10,7 @@ extern int option_upscale_mult;
 extern int option_pad_left_deadzone;
 extern int option_pad_right_deadzone;
 extern bool option_palette_conversion;
+extern bool option_texture_hash_cache;
 extern bool hack_fb_conversion;
 extern bool hack_AutoFlush;
 extern bool hack_fast_invalidation;
@@ -22,6 +23,7 @@ extern bool hack_preload_frame_data;
 */
 extern std::string sel_bios_path;
 extern std::string retroarch_system_path;
+extern std::string retroarch_save_path;
 
 /*
  * Options tools
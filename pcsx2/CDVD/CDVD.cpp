@@ -619,7 +619,8 @@ void cdvdReset(void)
 
 	// CDVD internally uses GMT+9.  If you think the time's wrong, you're wrong.
 	// Set up your time zone and winter/summer in the BIOS.  No PS2 BIOS I know of features automatic DST.
-	wxDateTime curtime(wxDateTime::GetTimeNow());
+	// The deterministic mode starts at 2001-01-01 00:00:00 GMT instead of the host time.
+	wxDateTime curtime(EmuConfig.Deterministic ? (time_t)978307200 : wxDateTime::GetTimeNow());
 	cdvd.RTC.second = (u8)curtime.GetSecond();
 	cdvd.RTC.minute = (u8)curtime.GetMinute();
 	cdvd.RTC.hour = (u8)curtime.GetHour(wxDateTime::GMT9);
@@ -224,6 +224,11 @@ bool InputIsoFile::Open(const wxString& srcfile, bool testOnly)
 
 	m_blocks = m_reader->GetBlockCount();
 
+	// Blockdumps are sparse and indexed by their own table, so they are left
+	// to be read from the file.
+	if ((EmuConfig.CdvdPreload || EmuConfig.CdvdSharedCache) && !isBlockdump)
+		m_reader = PreloadFileReader::Wrap(m_reader, EmuConfig.CdvdPreload, EmuConfig.CdvdSharedCache);
+
 	return true;
 }
 
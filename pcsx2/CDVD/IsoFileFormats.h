@@ -18,6 +18,7 @@
 #include "CDVD.h"
 #include "AsyncFileReader.h"
 #include "CompressedFileReader.h"
+#include "PreloadFileReader.h"
 #include <memory>
 
 enum isoType
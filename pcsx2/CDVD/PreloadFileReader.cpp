@@ -0,0 +1,288 @@
+/*  PCSX2 - PS2 Emulator for PCs
+*  Copyright (C) 2002-2014  PCSX2 Dev Team
+*
+*  PCSX2 is free software: you can redistribute it and/or modify it under the terms
+*  of the GNU Lesser General Public License as published by the Free Software Found-
+*  ation, either version 3 of the License, or (at your option) any later version.
+*
+*  PCSX2 is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+*  without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+*  PURPOSE.  See the GNU General Public License for more details.
+*
+*  You should have received a copy of the GNU General Public License along with PCSX2.
+*  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "PreloadFileReader.h"
+#include "CompressedFileReaderUtils.h"
+#include "Utilities/General.h"
+
+#include <algorithm>
+#include <cstring> /* memcpy */
+#include <vector>
+#ifndef _WIN32
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+static u8* AllocImage(size_t size)
+{
+#ifdef _WIN32
+	return (u8*)VirtualAlloc(NULL, size, MEM_RESERVE | MEM_COMMIT, PAGE_READWRITE);
+#else
+	void* ptr = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+	if (ptr == MAP_FAILED)
+		return NULL;
+#ifdef MADV_HUGEPAGE
+	// A whole DVD image is a lot of 4k pages; ask for transparent huge pages so
+	// the preload and later reads don't spend their time on TLB misses.
+	madvise(ptr, size, MADV_HUGEPAGE);
+#endif
+	return (u8*)ptr;
+#endif
+}
+
+// Hashed regions of an image file: its first and last MB, where the volume
+// descriptors, directories and the start of the data sit, and evenly spaced
+// ones in between. A few MB to read instead of several GB at every boot.
+#define HASH_EDGE_BYTES   (1 << 20)
+#define HASH_REGION_BYTES (64 << 10)
+#define HASH_REGIONS      32
+
+// FNV-1a on qwords in four independent lanes, the tail bytewise
+static void HashBytes(u64 (&h)[4], const u8* data, size_t bytes)
+{
+	const u64* p = (const u64*)data;
+	const size_t qwords = bytes / 8 & ~3;
+	for (size_t i = 0; i < qwords; i += 4)
+	{
+		h[0] = (h[0] ^ p[i + 0]) * 0x100000001b3ull;
+		h[1] = (h[1] ^ p[i + 1]) * 0x100000001b3ull;
+		h[2] = (h[2] ^ p[i + 2]) * 0x100000001b3ull;
+		h[3] = (h[3] ^ p[i + 3]) * 0x100000001b3ull;
+	}
+	const u8* tail = (const u8*)(p + qwords);
+	for (size_t i = 0; i < bytes - qwords * 8; i++)
+		h[0] = (h[0] ^ tail[i]) * 0x100000001b3ull;
+}
+
+// Keys the shared segment on the image file's size and the contents of fixed
+// regions of it rather than its path, so copies of one image in different
+// places still share it, while a different image of the same size doesn't
+// pick up a segment holding another one. The modification time is left out,
+// copying an image or touching it doesn't change what it holds.
+// Images split over several files aren't shared.
+static bool HashImage(AsyncFileReader* source, SharedSectorCache::Key& key)
+{
+#ifdef _WIN32
+	return false;
+#else
+	if (dynamic_cast<MultipartFileReader*>(source))
+		return false;
+
+	FILE* fp = PX_fopen_rb(source->GetFilename());
+	if (!fp)
+		return false;
+
+	struct stat st;
+	if (fstat(fileno(fp), &st) != 0)
+	{
+		fclose(fp);
+		return false;
+	}
+
+	const u64 size = (u64)st.st_size;
+
+	// Small files are hashed whole
+	std::vector<std::pair<u64, u64>> regions;
+	if (size <= 2 * HASH_EDGE_BYTES + HASH_REGIONS * HASH_REGION_BYTES)
+		regions.emplace_back(0, size);
+	else
+	{
+		regions.emplace_back(0, HASH_EDGE_BYTES);
+		const u64 stride = (size - 2 * HASH_EDGE_BYTES) / HASH_REGIONS;
+		for (u64 i = 0; i < HASH_REGIONS; i++)
+			regions.emplace_back(HASH_EDGE_BYTES + i * stride, HASH_REGION_BYTES);
+		regions.emplace_back(size - HASH_EDGE_BYTES, HASH_EDGE_BYTES);
+	}
+
+	u64 h[4] = {0xcbf29ce484222325ull, 0xcbf29ce484222325ull, 0xcbf29ce484222325ull, 0xcbf29ce484222325ull};
+	std::vector<u64> buffer(1 << 17);
+	bool ok = true;
+	for (const auto& region : regions)
+	{
+		for (u64 offset = region.first, end = region.first + region.second; offset < end && ok;)
+		{
+			const size_t want = (size_t)std::min<u64>(buffer.size() * 8, end - offset);
+			const ssize_t bytes = pread(fileno(fp), buffer.data(), want, (off_t)offset);
+			ok = bytes == (ssize_t)want;
+			if (ok)
+				HashBytes(h, (const u8*)buffer.data(), want);
+			offset += want;
+		}
+	}
+
+	fclose(fp);
+	if (!ok)
+		return false;
+
+	key.hash = h[0] ^ (h[1] * 31) ^ (h[2] * 961) ^ (h[3] * 29791);
+	key.filesize = size;
+	return true;
+#endif
+}
+
+AsyncFileReader* PreloadFileReader::Wrap(AsyncFileReader* source, bool preload, bool shared)
+{
+	const uint blocks = source->GetBlockCount();
+	const uint chunks = (blocks + PRELOAD_CHUNK_SECTORS - 1) / PRELOAD_CHUNK_SECTORS;
+	const u64 size = (u64)blocks * source->GetBlockSize();
+	if (size == 0 || size > (u64)SIZE_MAX)
+		return source;
+
+	if (shared)
+	{
+		SharedSectorCache::Key key;
+		SharedSectorCache* cache = HashImage(source, key) ? SharedSectorCache::Attach(key, blocks, source->GetBlockSize(), chunks) : NULL;
+		if (cache)
+			return new PreloadFileReader(source, cache->GetImage(), cache->GetChunkStates(), (size_t)size, cache, preload);
+	}
+
+	// Without a segment to share, the image is cached privately instead
+	if (!preload && !shared)
+		return source;
+
+	u8* image = AllocImage((size_t)size);
+	if (!image)
+		return source;
+
+	std::atomic<u8>* states = new std::atomic<u8>[chunks];
+	for (uint i = 0; i < chunks; i++)
+		states[i].store(SharedSectorCache::ChunkEmpty, std::memory_order_relaxed);
+
+	return new PreloadFileReader(source, image, states, (size_t)size, NULL, preload);
+}
+
+PreloadFileReader::PreloadFileReader(AsyncFileReader* source, u8* image, std::atomic<u8>* states, size_t size, SharedSectorCache* shared, bool preload)
+	: m_source(source)
+	, m_image(image)
+	, m_size(size)
+	, m_blocks(source->GetBlockCount())
+	, m_states(states)
+	, m_chunks((m_blocks + PRELOAD_CHUNK_SECTORS - 1) / PRELOAD_CHUNK_SECTORS)
+	, m_shared(shared)
+	, m_quit(false)
+	, m_bytesRead(-1)
+{
+	m_filename = source->GetFilename();
+	m_blocksize = source->GetBlockSize();
+
+	if (preload)
+		m_thread = std::thread(&PreloadFileReader::PreloadThread, this);
+}
+
+// Returns the chunk's state, filling it from the source first if nobody has yet.
+u8 PreloadFileReader::FillChunk(uint chunk)
+{
+	u8 state = m_states[chunk].load(std::memory_order_acquire);
+	if (state != SharedSectorCache::ChunkEmpty)
+		return state;
+	if (!m_states[chunk].compare_exchange_strong(state, SharedSectorCache::ChunkFilling, std::memory_order_acquire))
+		return state;
+
+	const uint first = chunk * PRELOAD_CHUNK_SECTORS;
+	const uint count = std::min<uint>(PRELOAD_CHUNK_SECTORS, m_blocks - first);
+
+	int ret;
+	{
+		std::lock_guard<std::mutex> lock(m_lock);
+		ret = m_source->ReadSync(m_image + (size_t)first * m_blocksize, first, count);
+	}
+
+	// Chunks that can't be read (the image is shorter than its header claims,
+	// or damaged) are left to the source for good.
+	state = (ret == (int)(count * m_blocksize)) ? SharedSectorCache::ChunkReady : SharedSectorCache::ChunkFailed;
+	m_states[chunk].store(state, std::memory_order_release);
+	return state;
+}
+
+void PreloadFileReader::PreloadThread()
+{
+	for (uint chunk = 0; chunk < m_chunks && !m_quit.load(std::memory_order_relaxed); chunk++)
+		FillChunk(chunk);
+}
+
+bool PreloadFileReader::Open(const wxString& fileName)
+{
+	// The source was already opened by the time it got wrapped.
+	return m_source != NULL;
+}
+
+int PreloadFileReader::ReadSync(void* pBuffer, uint sector, uint count)
+{
+	if (!m_source)
+		return -1;
+
+	if (count > 0 && (u64)sector + count <= m_blocks)
+	{
+		bool hit = true;
+		for (uint chunk = sector / PRELOAD_CHUNK_SECTORS; chunk <= (sector + count - 1) / PRELOAD_CHUNK_SECTORS; chunk++)
+			hit &= (FillChunk(chunk) == SharedSectorCache::ChunkReady);
+
+		if (hit)
+		{
+			const int bytes = (int)(count * m_blocksize);
+			memcpy(pBuffer, m_image + (size_t)sector * m_blocksize, bytes);
+			return bytes;
+		}
+	}
+
+	std::lock_guard<std::mutex> lock(m_lock);
+	return m_source->ReadSync(pBuffer, sector, count);
+}
+
+void PreloadFileReader::BeginRead(void* pBuffer, uint sector, uint count)
+{
+	// Misses are rare once the cache is warm, so they're simply read
+	// synchronously instead of being queued behind the preload's own reads.
+	m_bytesRead = ReadSync(pBuffer, sector, count);
+}
+
+int PreloadFileReader::FinishRead(void)
+{
+	int res = m_bytesRead;
+	m_bytesRead = -1;
+	return res;
+}
+
+void PreloadFileReader::CancelRead(void)
+{
+}
+
+void PreloadFileReader::Close(void)
+{
+	m_quit = true;
+	if (m_thread.joinable())
+		m_thread.join();
+
+	if (m_source)
+	{
+		delete m_source;
+		m_source = NULL;
+	}
+
+	if (m_shared)
+	{
+		delete m_shared;
+		m_shared = NULL;
+	}
+	else if (m_image)
+	{
+		HostSys::Munmap(m_image, m_size);
+		delete[] m_states;
+	}
+
+	m_image = NULL;
+	m_states = NULL;
+}
@@ -0,0 +1,84 @@
+/*  PCSX2 - PS2 Emulator for PCs
+*  Copyright (C) 2002-2014  PCSX2 Dev Team
+*
+*  PCSX2 is free software: you can redistribute it and/or modify it under the terms
+*  of the GNU Lesser General Public License as published by the Free Software Found-
+*  ation, either version 3 of the License, or (at your option) any later version.
+*
+*  PCSX2 is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+*  without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+*  PURPOSE.  See the GNU General Public License for more details.
+*
+*  You should have received a copy of the GNU General Public License along with PCSX2.
+*  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include "AsyncFileReader.h"
+#include "SharedSectorCache.h"
+
+#include <atomic>
+#include <mutex>
+#include <thread>
+
+// Sectors per cached chunk. Small enough that a read which has to go to the
+// source while the preload holds it only waits a moment.
+#define PRELOAD_CHUNK_SECTORS 64
+
+// Wraps an opened and fully configured reader (block size and data offset already
+// set) and keeps the decoded image in one RAM buffer, filled a chunk at a time.
+// Reads that miss fill their chunks from the source first.
+//
+// With preload on, a background thread walks the whole image. With the shared
+// cache on, the buffer is a SharedSectorCache segment, so chunks filled by one
+// process are hits in every other process using the same image. If no segment can
+// be had for the image, it gets a private buffer like with preload alone.
+class PreloadFileReader : public AsyncFileReader
+{
+	DeclareNoncopyableObject(PreloadFileReader);
+
+public:
+	virtual ~PreloadFileReader(void) { Close(); };
+
+	// Takes ownership of source. Returns source itself if no buffer for the
+	// whole image can be allocated.
+	static AsyncFileReader* Wrap(AsyncFileReader* source, bool preload, bool shared);
+
+	virtual bool Open(const wxString& fileName);
+
+	virtual int ReadSync(void* pBuffer, uint sector, uint count);
+
+	virtual void BeginRead(void* pBuffer, uint sector, uint count);
+	virtual int FinishRead(void);
+	virtual void CancelRead(void);
+
+	virtual void Close(void);
+
+	virtual uint GetBlockCount(void) const { return m_blocks; }
+
+private:
+	PreloadFileReader(AsyncFileReader* source, u8* image, std::atomic<u8>* states, size_t size, SharedSectorCache* shared, bool preload);
+
+	u8 FillChunk(uint chunk);
+	void PreloadThread();
+
+	AsyncFileReader* m_source;
+	u8* m_image;
+	size_t m_size;
+	uint m_blocks;
+
+	// One SharedSectorCache::ChunkState per PRELOAD_CHUNK_SECTORS sectors.
+	std::atomic<u8>* m_states;
+	uint m_chunks;
+	// Owns m_image and m_states when set, otherwise they are private allocations.
+	SharedSectorCache* m_shared;
+
+	std::atomic<bool> m_quit;
+	// Serializes access to m_source between the preload and the emulator.
+	std::mutex m_lock;
+	std::thread m_thread;
+
+	// The result of a read is stored here between BeginRead() and FinishRead().
+	int m_bytesRead;
+};
@@ -0,0 +1,295 @@
+/*  PCSX2 - PS2 Emulator for PCs
+*  Copyright (C) 2002-2014  PCSX2 Dev Team
+*
+*  PCSX2 is free software: you can redistribute it and/or modify it under the terms
+*  of the GNU Lesser General Public License as published by the Free Software Found-
+*  ation, either version 3 of the License, or (at your option) any later version.
+*
+*  PCSX2 is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+*  without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+*  PURPOSE.  See the GNU General Public License for more details.
+*
+*  You should have received a copy of the GNU General Public License along with PCSX2.
+*  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "SharedSectorCache.h"
+
+#include <chrono>
+#include <cerrno>
+#include <limits>
+#include <cstdio>
+#include <thread>
+#ifndef _WIN32
+#include <fcntl.h>
+#include <signal.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+static const u32 SharedCacheMagic = 0x43445332; // "2SDC"
+static const u32 SharedCacheFailed = 0x4c494146; // "FAIL", the creator gave up
+static const u32 SharedCacheVersion = 3;
+
+// How long an opener waits for the creator to size the header and write its pid
+// there, both immediate. Backing the rest of the segment has no limit.
+static const int SharedCacheAttachTries = 1000;
+
+// Processes attached to one segment at a time.
+static const int SharedCacheMaxUsers = 64;
+
+struct SharedSectorCache::Header
+{
+	// SharedCacheMagic once the segment is ready
+	std::atomic<u32> magic;
+	std::atomic<s32> creator;
+	u32 version;
+	u64 hash;
+	u64 filesize;
+	u32 blocks;
+	u32 blocksize;
+	u32 chunks;
+	// The pid of each attached process, 0 for a free slot.
+	std::atomic<s32> users[SharedCacheMaxUsers];
+};
+
+static size_t AlignUp(size_t size, size_t align)
+{
+	return (size + align - 1) & ~(align - 1);
+}
+
+SharedSectorCache::SharedSectorCache(const std::string& name, void* base, size_t size, int slot)
+	: m_name(name)
+	, m_base(base)
+	, m_size(size)
+	, m_slot(slot)
+{
+	m_header = (Header*)base;
+	m_states = (std::atomic<u8>*)((u8*)base + AlignUp(sizeof(Header), 64));
+	m_image = (u8*)base + AlignUp(AlignUp(sizeof(Header), 64) + m_header->chunks, 4096);
+}
+
+#ifdef _WIN32
+
+SharedSectorCache* SharedSectorCache::Attach(const Key& key, uint blocks, uint blocksize, uint chunks)
+{
+	return NULL;
+}
+
+SharedSectorCache::~SharedSectorCache()
+{
+}
+
+#else
+
+// Frees the slots of processes that died without detaching. A pid that got
+// reused keeps its slot, which only delays the unlink.
+static void ReleaseStaleUsers(std::atomic<s32>* users)
+{
+	for (int i = 0; i < SharedCacheMaxUsers; i++)
+	{
+		s32 pid = users[i].load(std::memory_order_acquire);
+		if (pid != 0 && kill(pid, 0) != 0 && errno == ESRCH)
+			users[i].compare_exchange_strong(pid, 0, std::memory_order_acq_rel);
+	}
+}
+
+static bool HasUsers(const std::atomic<s32>* users, int except)
+{
+	for (int i = 0; i < SharedCacheMaxUsers; i++)
+		if (i != except && users[i].load(std::memory_order_acquire) != 0)
+			return true;
+	return false;
+}
+
+// Waits for the creator to make the segment ready. False if it gave up, or died
+// before, in which case the segment is unlinked.
+static bool WaitReady(const std::atomic<u32>& magic, const std::atomic<s32>& creator_pid, const char* name)
+{
+	int tries = 0;
+	for (;;)
+	{
+		const u32 state = magic.load(std::memory_order_acquire);
+		if (state == SharedCacheMagic)
+			return true;
+		if (state == SharedCacheFailed)
+			return false;
+
+		const s32 creator = creator_pid.load(std::memory_order_acquire);
+		if ((creator == 0 && ++tries >= SharedCacheAttachTries) || (creator != 0 && kill(creator, 0) != 0 && errno == ESRCH))
+		{
+			shm_unlink(name);
+			return false;
+		}
+
+		std::this_thread::sleep_for(std::chrono::milliseconds(1));
+	}
+}
+
+SharedSectorCache* SharedSectorCache::Attach(const Key& key, uint blocks, uint blocksize, uint chunks)
+{
+	const size_t header_size = AlignUp(sizeof(Header), 4096);
+	const u64 total = AlignUp(AlignUp(sizeof(Header), 64) + chunks, 4096) + (u64)blocks * blocksize;
+	if (total > (u64)SIZE_MAX || total > (u64)std::numeric_limits<off_t>::max())
+		return NULL;
+	const size_t size = (size_t)total;
+
+	char name[96];
+	snprintf(name, sizeof(name), "/lrps2-disc-%016llx-%llx-%u",
+		(unsigned long long)key.hash, (unsigned long long)key.filesize, blocksize);
+
+	bool creator = true;
+	int fd = shm_open(name, O_RDWR | O_CREAT | O_EXCL, 0600);
+	if (fd < 0)
+	{
+		creator = false;
+		fd = shm_open(name, O_RDWR, 0600);
+		if (fd < 0)
+			return NULL;
+	}
+
+	if (creator)
+	{
+		if (ftruncate(fd, (off_t)header_size) != 0)
+		{
+			close(fd);
+			shm_unlink(name);
+			return NULL;
+		}
+	}
+	else
+	{
+		// Only the instant between the creator's shm_open and ftruncate, a
+		// segment still empty after the wait belongs to a creator that died
+		struct stat st;
+		int tries = 0;
+		while (fstat(fd, &st) == 0 && st.st_size == 0 && ++tries < SharedCacheAttachTries)
+			std::this_thread::sleep_for(std::chrono::milliseconds(1));
+		if (st.st_size < (off_t)header_size)
+		{
+			if (st.st_size == 0)
+				shm_unlink(name);
+			close(fd);
+			return NULL;
+		}
+	}
+
+	Header* hdr = (Header*)mmap(NULL, header_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+	if (hdr == MAP_FAILED)
+	{
+		close(fd);
+		if (creator)
+			shm_unlink(name);
+		return NULL;
+	}
+
+	const s32 pid = (s32)getpid();
+	bool ready;
+	if (creator)
+	{
+		hdr->creator.store(pid, std::memory_order_release);
+
+		// Backs the whole segment up front, so a full /dev/shm fails here
+		// instead of with a SIGBUS on the first write to a missing page.
+		// The new pages are zeroed, which leaves every chunk Empty.
+#ifdef __APPLE__
+		const int err = ftruncate(fd, (off_t)size) != 0 ? errno : 0;
+#else
+		const int err = posix_fallocate(fd, 0, (off_t)size);
+#endif
+		ready = err == 0;
+		if (!ready)
+		{
+			hdr->magic.store(SharedCacheFailed, std::memory_order_release);
+			shm_unlink(name);
+		}
+	}
+	else
+	{
+		struct stat st;
+		ready = WaitReady(hdr->magic, hdr->creator, name) && fstat(fd, &st) == 0 && st.st_size == (off_t)size;
+	}
+
+	void* base = ready ? mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0) : MAP_FAILED;
+	close(fd);
+	if (base == MAP_FAILED && creator && ready)
+	{
+		hdr->magic.store(SharedCacheFailed, std::memory_order_release);
+		shm_unlink(name);
+	}
+	munmap(hdr, header_size);
+	if (base == MAP_FAILED)
+		return NULL;
+
+#ifdef MADV_HUGEPAGE
+	madvise(base, size, MADV_HUGEPAGE);
+#endif
+
+	hdr = (Header*)base;
+	int slot = 0;
+	if (creator)
+	{
+		hdr->version = SharedCacheVersion;
+		hdr->hash = key.hash;
+		hdr->filesize = key.filesize;
+		hdr->blocks = blocks;
+		hdr->blocksize = blocksize;
+		hdr->chunks = chunks;
+		hdr->users[slot].store(pid, std::memory_order_relaxed);
+		hdr->magic.store(SharedCacheMagic, std::memory_order_release);
+	}
+	else
+	{
+		if (hdr->version != SharedCacheVersion || hdr->hash != key.hash || hdr->filesize != key.filesize ||
+			hdr->blocks != blocks || hdr->blocksize != blocksize || hdr->chunks != chunks)
+		{
+			munmap(base, size);
+			return NULL;
+		}
+
+		ReleaseStaleUsers(hdr->users);
+
+		for (slot = 0; slot < SharedCacheMaxUsers; slot++)
+		{
+			s32 free = 0;
+			if (hdr->users[slot].compare_exchange_strong(free, pid, std::memory_order_acq_rel))
+				break;
+		}
+		if (slot == SharedCacheMaxUsers)
+		{
+			munmap(base, size);
+			return NULL;
+		}
+
+		// Alone in a segment that was left behind: whoever was filling a
+		// chunk in it is gone, so those chunks are up for grabs again.
+		// Anyone attaching from here on sees this process in the table.
+		if (!HasUsers(hdr->users, slot))
+		{
+			std::atomic<u8>* states = (std::atomic<u8>*)((u8*)base + AlignUp(sizeof(Header), 64));
+			for (uint i = 0; i < chunks; i++)
+			{
+				u8 filling = ChunkFilling;
+				states[i].compare_exchange_strong(filling, ChunkEmpty, std::memory_order_relaxed);
+			}
+		}
+	}
+
+	return new SharedSectorCache(name, base, size, slot);
+}
+
+SharedSectorCache::~SharedSectorCache()
+{
+	m_header->users[m_slot].store(0, std::memory_order_release);
+
+	// A process attaching between the last detach and the unlink keeps a
+	// working mapping; it just won't be found by anyone after it.
+	ReleaseStaleUsers(m_header->users);
+	if (!HasUsers(m_header->users, -1))
+		shm_unlink(m_name.c_str());
+
+	munmap(m_base, m_size);
+}
+
+#endif
@@ -0,0 +1,86 @@
+/*  PCSX2 - PS2 Emulator for PCs
+*  Copyright (C) 2002-2014  PCSX2 Dev Team
+*
+*  PCSX2 is free software: you can redistribute it and/or modify it under the terms
+*  of the GNU Lesser General Public License as published by the Free Software Found-
+*  ation, either version 3 of the License, or (at your option) any later version.
+*
+*  PCSX2 is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+*  without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+*  PURPOSE.  See the GNU General Public License for more details.
+*
+*  You should have received a copy of the GNU General Public License along with PCSX2.
+*  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include "Pcsx2Defs.h"
+#include "Utilities/Dependencies.h"
+
+#include <atomic>
+#include <string>
+
+// A decoded disc image in a named POSIX shared memory segment, so that several
+// emulator processes running the same image hold (and decompress) it only once.
+//
+// The segment is named after the image file's size and a hash of fixed regions of
+// it, not after its path. It holds a header, one state byte per
+// chunk of sectors and the image itself. Whoever moves a chunk from Empty to
+// Filling owns it until it stores Ready; lookups only need an acquire load of the
+// state.
+//
+// Backing the segment of a large image takes a while. Its creator sizes the header
+// first and writes its pid there, then backs the rest and sets the header's magic
+// once it is ready. Others wait for that as long as the creator lives; a segment
+// whose creator died before it was ready is unlinked.
+//
+// The header lists the pids of the attached processes. The last process to detach
+// unlinks the segment, and pids that no longer exist are dropped from the list on
+// every attach and detach, so a segment left behind by crashed processes goes away
+// with the next one to use and leave it. A process that dies while filling leaves
+// that chunk in Filling; the others read it from their own source, until the
+// segment is found with nobody else attached and such chunks are emptied again.
+class SharedSectorCache
+{
+	DeclareNoncopyableObject(SharedSectorCache);
+
+public:
+	enum ChunkState : u8
+	{
+		ChunkEmpty = 0,
+		ChunkFilling,
+		ChunkReady,
+		ChunkFailed,
+	};
+
+	// Identifies the image file a segment holds.
+	struct Key
+	{
+		u64 hash;
+		u64 filesize;
+	};
+
+	// Returns NULL where shared memory is unavailable, the segment can't be
+	// created and backed, it doesn't match the image, or it's full of users.
+	static SharedSectorCache* Attach(const Key& key, uint blocks, uint blocksize, uint chunks);
+	~SharedSectorCache();
+
+	u8* GetImage() const { return m_image; }
+	std::atomic<u8>* GetChunkStates() const { return m_states; }
+
+private:
+	struct Header;
+
+	SharedSectorCache(const std::string& name, void* base, size_t size, int slot);
+
+	std::string m_name;
+	void* m_base;
+	size_t m_size;
+	// This process's entry in the header's user list.
+	int m_slot;
+
+	Header* m_header;
+	std::atomic<u8>* m_states;
+	u8* m_image;
+};
@@ -262,6 +262,14 @@ struct Pcsx2Config
 	BITFIELD32()
 		bool
 			CdvdShareWrite		:1,		// allows the iso to be modified while it's loaded
+			CdvdPreload			:1,		// reads the whole disc image into RAM in the background
+			CdvdSharedCache		:1,		// shares decoded disc sectors with other processes
+			VUProgramCache		:1,		// keeps compiled microVU programs' code and entry points on disk
+			VUBackgroundCompile	:1,		// interprets new VU1 programs while a worker thread recompiles them
+			GuestProfiler		:1,		// samples the EE/IOP/VU1 PCs and writes a flat profile per game
+			GSPipeline			:1,		// parses GIF packets on a thread of their own, ahead of the renderer
+			AudioRateControl	:1,		// buffers the SPU2 output and resamples it to the frontend's pace
+			Deterministic		:1,		// same inputs, same emulated state: fixed thread sync points and RTC
 			EnablePatches		:1,		// enables patch detection and application
 			EnableCheats		:1,		// enables cheat detection and application
 			EnableWideScreenPatches		:1,
@@ -33,6 +33,8 @@
 #include "ps2/HwInternal.h"
 
 #include "Sio.h"
+#include "StateHash.h"
+#include "PAD/PAD.h"
 
 #define EECNT_FUTURE_TARGET 0x10000000
 
@@ -182,6 +184,8 @@ void rcntInit(void)
 		counters[i].sCycleT = cpuRegs.cycle;
 	}
 	cpuRcntSet();
+
+	StateHash::Reset();
 }
 
 
@@ -602,6 +606,18 @@ static __fi void rcntUpdate_vSync(void)
 			ApplyLoadedPatches(PPT_CONTINUOUSLY);
 			Cpu->CheckExecutionState();
 
+			// Lockstep with the frontend, this frame's input is taken here. A state
+			// change request leaves the EE before anything of the vsync was done, it
+			// starts over when resumed.
+			if (EmuConfig.Deterministic)
+			{
+				while (!PADlatchInput())
+					Cpu->CheckExecutionState();
+			}
+
+			if (StateHash::Enabled())
+				StateHash::Update();
+
 			hwIntcIrq(INTC_VBLANK_S);
 			psxVBlankStart();
 
@@ -0,0 +1,179 @@
+/*  PCSX2 - PS2 Emulator for PCs
+ *  Copyright (C) 2002-2014  PCSX2 Dev Team
+ *
+ *  PCSX2 is free software: you can redistribute it and/or modify it under the terms
+ *  of the GNU Lesser General Public License as published by the Free Software Found-
+ *  ation, either version 3 of the License, or (at your option) any later version.
+ *
+ *  PCSX2 is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ *  without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ *  PURPOSE.  See the GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along with PCSX2.
+ *  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <ctime>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include "Profiler.h"
+#include "SymbolMap.h"
+#include "../Common.h"
+#include "../R3000A.h"
+#include "../VUmicro.h"
+#include "options_tools.h"
+
+namespace GuestProfiler
+{
+	enum Processor
+	{
+		PROC_EE,
+		PROC_IOP,
+		PROC_VU1,
+	};
+
+	static const int SampleRate = 1000; // per second
+
+	// Sample key: processor in the upper 32 bits, then the EE function
+	// start (or PC if there is no function there), the IOP PC, or for VU1
+	// the program start PC and current PC packed in 16 bits each
+	static std::unordered_map<u64, u32> s_samples;
+	// Samples taken, and dropped because the EE didn't run
+	static u32 s_taken;
+	static u32 s_dropped;
+	static u32 s_last_cycle;
+	static u32 s_crc;
+	static time_t s_started;
+
+	static std::thread s_thread;
+	static std::mutex s_mutex;
+	static std::condition_variable s_cv;
+	static bool s_quit;
+
+	static void Sample()
+	{
+		// The cycle count only moves while the EE runs, a paused VM would
+		// otherwise pile its samples on wherever it stopped
+		const u32 cycle = cpuRegs.cycle;
+		if (cycle == s_last_cycle)
+		{
+			s_dropped++;
+			return;
+		}
+		s_last_cycle = cycle;
+		s_taken++;
+
+		const u32 ee = cpuRegs.pc;
+		const u32 func = symbolMap.GetFunctionStart(ee);
+		s_samples[((u64)PROC_EE << 32) | (func != SymbolMap::INVALID_ADDRESS ? func : ee)]++;
+
+		s_samples[((u64)PROC_IOP << 32) | psxRegs.pc]++;
+
+		// VU1 idle time is left out, it would only dwarf the programs
+		if (VU0.VI[REG_VPU_STAT].UL & 0x100)
+			s_samples[((u64)PROC_VU1 << 32) | ((VU1.start_pc & 0xffff) << 16) | (VU1.VI[REG_TPC].UL & 0xffff)]++;
+	}
+
+	static void ThreadProc()
+	{
+		Threading::SetNameOfCurrentThread("Guest Profiler");
+
+		const auto period = std::chrono::microseconds(1000000 / SampleRate);
+		auto next = std::chrono::steady_clock::now();
+
+		std::unique_lock<std::mutex> lock(s_mutex);
+		while (!s_cv.wait_until(lock, next += period, [] { return s_quit; }))
+			Sample();
+	}
+
+	static void Write()
+	{
+		char name[64];
+		strftime(name, sizeof(name), "%Y%m%d-%H%M%S", localtime(&s_started));
+
+		char file[96];
+		snprintf(file, sizeof(file), "/profile_%08X_%s.txt", s_crc, name);
+
+		const std::string path = retroarch_save_path + file;
+		FILE* fp = fopen(path.c_str(), "w");
+		if (!fp)
+		{
+			log_cb(RETRO_LOG_WARN, "Guest profiler: could not write %s\n", path.c_str());
+			return;
+		}
+
+		// Busiest first, per processor
+		std::vector<std::pair<u64, u32>> samples(s_samples.begin(), s_samples.end());
+		std::sort(samples.begin(), samples.end(), [](const std::pair<u64, u32>& a, const std::pair<u64, u32>& b) {
+			return (a.first >> 32) != (b.first >> 32) ? a.first < b.first : a.second > b.second;
+		});
+
+		// Shares are of all samples taken, VU1's add up to the time it was busy
+		fprintf(fp, "# %u samples at %d Hz, %u dropped while the EE was stopped\n", s_taken, SampleRate, s_dropped);
+		fprintf(fp, "# samples  share  cpu  function\n");
+		for (const auto& kv : samples)
+		{
+			const u32 addr = (u32)kv.first;
+			const double share = s_taken ? 100.0 * kv.second / s_taken : 0.0;
+			fprintf(fp, "%9u %5.1f%%  ", kv.second, share);
+
+			switch (kv.first >> 32)
+			{
+				case PROC_EE:
+				{
+					const std::string label = symbolMap.GetLabelString(addr);
+					if (!label.empty())
+						fprintf(fp, "EE   %s\n", label.c_str());
+					else
+						fprintf(fp, "EE   0x%08x\n", addr);
+					break;
+				}
+				case PROC_IOP:
+					fprintf(fp, "IOP  0x%08x\n", addr);
+					break;
+				case PROC_VU1:
+					fprintf(fp, "VU1  prog 0x%04x at 0x%04x\n", addr >> 16, addr & 0xffff);
+					break;
+			}
+		}
+
+		fclose(fp);
+		log_cb(RETRO_LOG_INFO, "Guest profiler: %u samples written to %s\n", s_taken, path.c_str());
+	}
+
+	void Start(u32 crc)
+	{
+		Stop();
+
+		s_samples.clear();
+		s_taken      = 0;
+		s_dropped    = 0;
+		s_last_cycle = cpuRegs.cycle;
+		s_crc        = crc;
+		s_started    = time(NULL);
+		s_quit       = false;
+		s_thread     = std::thread(ThreadProc);
+	}
+
+	void Stop()
+	{
+		if (!s_thread.joinable())
+			return;
+
+		{
+			std::lock_guard<std::mutex> lock(s_mutex);
+			s_quit = true;
+		}
+		s_cv.notify_all();
+		s_thread.join();
+
+		Write();
+		s_samples.clear();
+	}
+}
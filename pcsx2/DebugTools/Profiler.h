@@ -0,0 +1,39 @@
+/*  PCSX2 - PS2 Emulator for PCs
+ *  Copyright (C) 2002-2014  PCSX2 Dev Team
+ *
+ *  PCSX2 is free software: you can redistribute it and/or modify it under the terms
+ *  of the GNU Lesser General Public License as published by the Free Software Found-
+ *  ation, either version 3 of the License, or (at your option) any later version.
+ *
+ *  PCSX2 is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ *  without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ *  PURPOSE.  See the GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along with PCSX2.
+ *  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include "Pcsx2Types.h"
+
+// Guest sampling profiler. A timer thread samples the EE and IOP PCs and
+// the running VU1 program a thousand times per second, and counts the
+// samples per guest function (as found by the SymbolMap). Samples taken while
+// the EE cycle count stands still (the VM paused, or waiting for the next
+// frame's input in deterministic mode) are dropped. When the session ends,
+// the counts are written to the save directory as a flat profile, one line
+// per function with its share of the samples, busiest first. There are no
+// call stacks: the guest code keeps no frame records to unwind.
+//
+// The PCs are read without synchronisation. The recompilers only store the
+// PC between blocks, so samples land on the function of the block that ran
+// last, which is accurate enough for finding the hot routines.
+namespace GuestProfiler
+{
+	// Starts a session for the game with the given CRC, ending the
+	// running one first
+	void Start(u32 crc);
+	// Ends the session and writes its profile
+	void Stop();
+}
@@ -355,6 +355,15 @@ void SymbolMap::AddLabel(const char* name, u32 address, int moduleIndex) {
 	}
 }
 
+std::string SymbolMap::GetLabelString(u32 address) const {
+	std::lock_guard<std::recursive_mutex> guard(m_lock);
+	auto it = activeLabels.find(address);
+	if (it == activeLabels.end())
+		return "";
+
+	return it->second.name;
+}
+
 bool SymbolMap::GetLabelValue(const char* name, u32& dest) {
 	std::lock_guard<std::recursive_mutex> guard(m_lock);
 	for (auto it = activeLabels.begin(); it != activeLabels.end(); it++) {
@@ -71,6 +71,7 @@ public:
 	u32 GetFunctionSize(u32 startAddress) const;
 
 	void AddLabel(const char* name, u32 address, int moduleIndex = -1);
+	std::string GetLabelString(u32 address) const;
 	bool GetLabelValue(const char* name, u32& dest);
 
 	void AddData(u32 address, u32 size, DataType type, int moduleIndex = -1);
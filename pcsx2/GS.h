@@ -15,6 +15,8 @@
 
 #pragma once
 
+#include <thread>
+
 #include "Common.h"
 #include "gui/SysThreads.h"
 #include "Gif.h"
@@ -231,6 +233,8 @@ enum MTGS_RingCommand
 };
 
 
+class GSPipeline;
+
 struct MTGS_FreezeData
 {
 	freezeData*	fdata;
@@ -277,6 +281,10 @@ public:
 	uint			m_packet_size;		// size of the packet (data only, ie. not including the 16 byte command!)
 	uint			m_packet_writepos;	// index of the data location in the ringbuffer.
 
+	// With EmuConfig.GSPipeline, the parse thread of m_pipeline consumes the ring buffer and
+	// parses the GIF packets into it, the MTGS thread renders what was parsed.
+	GSPipeline*		m_pipeline;
+
 public:
 	SysMtgsThread();
 	virtual ~SysMtgsThread();
@@ -315,6 +323,12 @@ protected:
 
 	void GenericStall( uint size );
 
+	bool ProcessRingBuffer();
+	void GifTransfer( const u8* mem, u32 size );
+	void ParseThreadProc();
+	void StartPipeline();
+	void StopPipeline();
+
 	// Used internally by SendSimplePacket type functions
 	void _FinishSimplePacket();
 };
@@ -22,6 +22,7 @@
 #include "GS.h"
 #include "GSUtil.h"
 #include "Renderers/SW/GSRendererSW.h"
+#include "Renderers/SW/GSDeviceSW.h"
 #include "Renderers/OpenGL/GSDeviceOGL.h"
 #include "Renderers/OpenGL/GSRendererOGL.h"
 
@@ -109,6 +110,8 @@ void GSclose(void)
 static int _GSopen(GSRendererType renderer, int threads, u8 *basemem)
 {
 	GSDevice* dev = NULL;
+	// Without a frontend context the software renderer presents from the CPU.
+	const bool cpu_present = renderer == GSRendererType::OGL_SW && hw_render.context_type == RETRO_HW_CONTEXT_NONE;
 
 	is_d3d       = false;
 
@@ -129,6 +132,8 @@ static int _GSopen(GSRendererType renderer, int threads, u8 *basemem)
 	{
 		case GSRendererType::OGL_HW:
 		case GSRendererType::OGL_SW:
+			if (cpu_present)
+				break;
 			// Load mandatory function pointer
 #define GL_EXT_LOAD(ext)     *(void**)&(ext) = (void*)hw_render.get_proc_address(#ext)
 			// Load extra function pointer
@@ -406,7 +411,10 @@ GL_EXT_LOAD_OPT(glTextureBarrier);
 			dev = new GSDeviceOGL();
 			break;
 		case GSRendererType::OGL_SW:
-			dev = new GSDeviceOGL();
+			if (cpu_present)
+				dev = new GSDeviceSW();
+			else
+				dev = new GSDeviceOGL();
 			break;
 	}
 
@@ -471,7 +479,8 @@ int GSopen2(u32 flags, u8 *basemem)
 			break;
 	}
 	
-	if (m_current_renderer_type != GSRendererType::Undefined && stored_toggle_state != toggle_state)
+	// There is no context to switch to a hardware renderer with
+	if (m_current_renderer_type != GSRendererType::Undefined && stored_toggle_state != toggle_state && hw_render.context_type != RETRO_HW_CONTEXT_NONE)
 	{
 		// SW -> HW and HW -> SW (F9 Switch)
 		switch (m_current_renderer_type)
@@ -497,6 +506,18 @@ int GSopen2(u32 flags, u8 *basemem)
 	return _GSopen(m_current_renderer_type, -1, basemem);
 }
 
+void GSgetTextureDecodeStats(u64* bytes, u64* ns)
+{
+	*bytes = GSTextureCache::m_decoded_bytes;
+	*ns    = GSTextureCache::m_decode_ns;
+}
+
+void GSgetTextureHashStats(u64* hits, u64* misses)
+{
+	*hits   = GSTextureCache::m_hash_hits;
+	*misses = GSTextureCache::m_hash_misses;
+}
+
 int GSfreeze(int mode, void *_data)
 {
 	GSFreezeData* data = (GSFreezeData*)_data;
@@ -550,6 +571,7 @@ void GSApp::Init()
 	m_current_configuration["clut_load_before_draw"]     = "0";
 	m_current_configuration["extrathreads"]              = "2";
 	m_current_configuration["extrathreads_height"]       = "4";
+	m_current_configuration["extrathreads_texture"]      = "2";
 	m_current_configuration["force_texture_clear"]       = "0"; /* TODO/FIXME - GL only, remove later after Burnout hack? */
 	m_current_configuration["linear_present"]            = "1";
 	m_current_configuration["NTSC_Saturation"]           = "1";
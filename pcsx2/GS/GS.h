@@ -1022,8 +1022,9 @@ struct alignas(32) GIFPath
 	u32 reg;
 	u32 type;
 	GSVector4i regs;
+	u64 vertex_regs; // REGS of TYPE_VERTEX, nreg nibbles
 
-	enum {TYPE_UNKNOWN, TYPE_ADONLY, TYPE_STQRGBAXYZF2, TYPE_STQRGBAXYZ2};
+	enum {TYPE_UNKNOWN, TYPE_ADONLY, TYPE_STQRGBAXYZF2, TYPE_STQRGBAXYZ2, TYPE_VERTEX};
 
 	GS_FORCEINLINE void SetTag(const void* mem)
 	{
@@ -1086,6 +1087,31 @@ struct alignas(32) GIFPath
 					default:
 						break;
 				}
+
+				#if defined(_M_AMD64) || defined(_WIN64)
+
+				// any other layout of vertex data only, see GSGIFPackedCodeGenerator
+
+				if(type == TYPE_UNKNOWN && nreg <= 12)
+				{
+					const u32 vertex = (1 << 0x1) | (1 << 0x2) | (1 << 0x3) | (1 << 0xa) | (1 << 0xf); // RGBA, STQ, UV, FOG, NOP
+					const u32 kick = (1 << 0x4) | (1 << 0x5) | (1 << 0xc) | (1 << 0xd); // XYZF2, XYZ2, XYZF3, XYZ3
+
+					u32 used = 0;
+
+					for(u32 i = 0; i < nreg; i++)
+					{
+						used |= 1 << regs.U8[i];
+					}
+
+					if((used & ~(vertex | kick)) == 0 && (used & kick) != 0)
+					{
+						type = TYPE_VERTEX;
+						vertex_regs = src->REGS & ((1ull << (nreg * 4)) - 1);
+					}
+				}
+
+				#endif
 			}
 		}
 	}
@@ -46,6 +46,8 @@ GSVector4i GSBlock::m_uw8hmask1;
 GSVector4i GSBlock::m_uw8hmask2;
 GSVector4i GSBlock::m_uw8hmask3;
 
+GSVector4i GSBlock::m_r24mask;
+
 void GSBlock::InitVectors()
 {
 #if _M_SSE >= 0x501
@@ -72,4 +74,6 @@ void GSBlock::InitVectors()
 	m_uw8hmask1 = GSVector4i(2, 2, 2, 2, 3, 3, 3, 3, 10, 10, 10, 10, 11, 11, 11, 11);
 	m_uw8hmask2 = GSVector4i(4, 4, 4, 4, 5, 5, 5, 5, 12, 12, 12, 12, 13, 13, 13, 13);
 	m_uw8hmask3 = GSVector4i(6, 6, 6, 6, 7, 7, 7, 7, 14, 14, 14, 14, 15, 15, 15, 15);
+
+	m_r24mask = GSVector4i(0, 1, 2, 4, 5, 6, 8, 9, 10, 12, 13, 14, -128, -128, -128, -128);
 }
@@ -54,6 +54,8 @@ class GSBlock
 	static GSVector4i m_uw8hmask2;
 	static GSVector4i m_uw8hmask3;
 
+	static GSVector4i m_r24mask;
+
 public:
 	static void InitVectors();
 
@@ -1079,6 +1081,75 @@ public:
 		#endif
 	}
 
+	// Packs 8x8 indices (one per byte, 8 bytes pitch) two per byte
+	GS_FORCEINLINE static void PackBlock4(const u8* RESTRICT src, u8* RESTRICT dst, int dstpitch)
+	{
+		const GSVector4i* s = (const GSVector4i*)src;
+
+		GSVector4i mask = GSVector4i::x00ff();
+
+		for(int i = 0; i < 4; i++, dst += dstpitch * 2)
+		{
+			GSVector4i v = s[i];
+
+			v = (v | v.srl16(4)) & mask;
+			v = v.pu16(v);
+
+			*(u32*)&dst[dstpitch * 0] = v.extract32<0>();
+			*(u32*)&dst[dstpitch * 1] = v.extract32<1>();
+		}
+	}
+
+	// Reverse of UnpackAndWriteBlock24/4HL/4HH: the pixels of a block in the
+	// packed layout of the host transfers (24 bits or 4 bits per pixel)
+
+	GS_FORCEINLINE static void ReadBlock24(const u8* RESTRICT src, u8* RESTRICT dst, int dstpitch)
+	{
+		alignas(32) u32 block[8 * 8];
+
+		ReadBlock32(src, (u8*)block, 32);
+
+		for(int i = 0; i < 8; i++, dst += dstpitch)
+		{
+			#if _M_SSE >= 0x301
+
+			const GSVector4i* s = (const GSVector4i*)&block[i * 8];
+
+			GSVector4i v0 = s[0].shuffle8(m_r24mask);
+			GSVector4i v1 = s[1].shuffle8(m_r24mask);
+
+			GSVector4i::store<false>(dst, v0 | v1.sll<12>());
+			GSVector4i::storel(dst + 16, v1.srl<4>());
+
+			#else
+
+			for(int j = 0; j < 8; j++)
+			{
+				memcpy(&dst[j * 3], &block[i * 8 + j], 3);
+			}
+
+			#endif
+		}
+	}
+
+	GS_FORCEINLINE static void ReadBlock4HL(const u8* RESTRICT src, u8* RESTRICT dst, int dstpitch)
+	{
+		alignas(16) u8 block[8 * 8];
+
+		ReadBlock4HLP(src, block, 8);
+
+		PackBlock4(block, dst, dstpitch);
+	}
+
+	GS_FORCEINLINE static void ReadBlock4HH(const u8* RESTRICT src, u8* RESTRICT dst, int dstpitch)
+	{
+		alignas(16) u8 block[8 * 8];
+
+		ReadBlock4HHP(src, block, 8);
+
+		PackBlock4(block, dst, dstpitch);
+	}
+
 	template<bool AEM, class V> GS_FORCEINLINE static V Expand24to32(const V& c, const V& TA0)
 	{
 		return c | (AEM ? TA0.andnot(c == V::zero()) : TA0); // TA0 & (c != GSVector4i::zero())
@@ -23,6 +23,7 @@
 
 #include "GSCodeBuffer.h"
 #include "stdafx.h"
+#include "Utilities/Perf.h"
 
 GSCodeBuffer::GSCodeBuffer(size_t blocksize)
 	: m_blocksize(blocksize)
@@ -34,7 +35,10 @@ GSCodeBuffer::GSCodeBuffer(size_t blocksize)
 GSCodeBuffer::~GSCodeBuffer()
 {
 	for(auto buffer : m_buffers)
+	{
+		Perf::gs.unmap((uptr)buffer, (uptr)buffer + m_blocksize);
 		vmfree(buffer, m_blocksize);
+	}
 }
 
 void* GSCodeBuffer::GetBuffer(size_t size)
@@ -0,0 +1,102 @@
+/*
+ *	Copyright (C) 2007-2009 Gabest
+ *	http://www.gabest.org
+ *
+ *  This Program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2, or (at your option)
+ *  any later version.
+ *
+ *  This Program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with GNU Make; see the file COPYING.  If not, write to
+ *  the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA USA.
+ *  http://www.gnu.org/copyleft/gpl.html
+ *
+ */
+
+#include "GSDump.h"
+
+GSDump::GSDump(const std::string& fn, u32 crc, const GSFreezeData& fd, const GSPrivRegSet* regs, int frames)
+	: m_frames(frames)
+{
+	// Favour speed over ratio, the game keeps running while we record.
+	m_gs = gzopen(fn.c_str(), "wb1");
+	if (!m_gs)
+		return;
+
+	gzbuffer(m_gs, 1 << 20);
+
+	const u32 header[4] = {GSDUMP_MAGIC, GSDUMP_VERSION, crc, (u32)fd.size};
+
+	Write(header, sizeof(header));
+	Write(fd.data, fd.size);
+	Write(regs, sizeof(*regs));
+}
+
+GSDump::~GSDump()
+{
+	if (m_gs)
+		gzclose(m_gs);
+}
+
+void GSDump::Write(const void* data, size_t size)
+{
+	if (m_gs && size && gzwrite(m_gs, data, (unsigned)size) != (int)size)
+	{
+		gzclose(m_gs);
+		m_gs = NULL;
+	}
+}
+
+void GSDump::WritePacket(GSDumpPacketType type, const void* data, size_t size)
+{
+	Write(&type, 1);
+	Write(data, size);
+}
+
+void GSDump::Transfer(int index, const u8* mem, u32 size)
+{
+	if (size == 0)
+		return;
+
+	const u8 path = (u8)index;
+
+	WritePacket(GSDUMP_TRANSFER, &path, 1);
+	Write(&size, 4);
+	Write(mem, (size_t)size * 16);
+}
+
+void GSDump::ReadFIFO(u32 size)
+{
+	WritePacket(GSDUMP_READFIFO, &size, 4);
+}
+
+void GSDump::SoftReset(u32 mask)
+{
+	WritePacket(GSDUMP_SOFTRESET, &mask, 4);
+}
+
+void GSDump::Reset()
+{
+	WritePacket(GSDUMP_RESET);
+}
+
+void GSDump::SetGameCRC(u32 crc)
+{
+	WritePacket(GSDUMP_GAMECRC, &crc, 4);
+}
+
+bool GSDump::VSync(int field, const GSPrivRegSet* regs)
+{
+	const u8 f = (u8)field;
+
+	WritePacket(GSDUMP_REGISTERS, regs, sizeof(*regs));
+	WritePacket(GSDUMP_VSYNC, &f, 1);
+
+	return --m_frames <= 0 || !m_gs;
+}
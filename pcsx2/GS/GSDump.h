@@ -0,0 +1,84 @@
+/*
+ *	Copyright (C) 2007-2009 Gabest
+ *	http://www.gabest.org
+ *
+ *  This Program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2, or (at your option)
+ *  any later version.
+ *
+ *  This Program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with GNU Make; see the file COPYING.  If not, write to
+ *  the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA USA.
+ *  http://www.gnu.org/copyleft/gpl.html
+ *
+ */
+
+#pragma once
+
+#include <string>
+#include <zlib.h>
+
+#include "GS.h"
+
+/*
+ * GS dump file, gzip compressed:
+ *
+ * Header
+ *   u32 magic ('GSDP'), u32 version
+ *   u32 game crc
+ *   u32 state size, u8 state[size]   (GSState::Freeze)
+ *   GSPrivRegSet regs
+ *
+ * Packets, until the end of the file
+ *   u8 type, followed by
+ *   Transfer:  u8 path, u32 size (qwords), u8 data[size * 16]
+ *   VSync:     u8 field
+ *   ReadFIFO:  u32 size (qwords)
+ *   Registers: GSPrivRegSet regs
+ *   SoftReset: u32 mask
+ *   Reset:     -
+ *   GameCRC:   u32 crc
+ */
+
+#define GSDUMP_MAGIC   0x50445347
+#define GSDUMP_VERSION 1
+
+enum GSDumpPacketType : u8
+{
+	GSDUMP_TRANSFER,
+	GSDUMP_VSYNC,
+	GSDUMP_READFIFO,
+	GSDUMP_REGISTERS,
+	GSDUMP_SOFTRESET,
+	GSDUMP_RESET,
+	GSDUMP_GAMECRC,
+};
+
+class GSDump
+{
+	gzFile m_gs;
+	int m_frames;
+
+	void Write(const void* data, size_t size);
+	void WritePacket(GSDumpPacketType type, const void* data = NULL, size_t size = 0);
+
+public:
+	GSDump(const std::string& fn, u32 crc, const GSFreezeData& fd, const GSPrivRegSet* regs, int frames);
+	~GSDump();
+
+	bool IsOpen() const { return m_gs != NULL; }
+
+	void Transfer(int index, const u8* mem, u32 size);
+	void ReadFIFO(u32 size);
+	void SoftReset(u32 mask);
+	void Reset();
+	void SetGameCRC(u32 crc);
+	// Returns true once the requested number of frames has been recorded.
+	bool VSync(int field, const GSPrivRegSet* regs);
+};
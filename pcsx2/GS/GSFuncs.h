@@ -23,3 +23,10 @@ void GSshutdown(void);
 #define GSUpdateOptions() s_gs->UpdateRendererOptions()
 
 int GSfreeze(int mode, void *_data);
+
+// Texture cache source uploads: bytes decoded and time spent, since startup
+void GSgetTextureDecodeStats(u64* bytes, u64* ns);
+void GSgetTextureHashStats(u64* hits, u64* misses);
+
+
+
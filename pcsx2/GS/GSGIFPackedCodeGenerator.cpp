@@ -0,0 +1,237 @@
+/*
+ *	Copyright (C) 2007-2009 Gabest
+ *	http://www.gabest.org
+ *
+ *  This Program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2, or (at your option)
+ *  any later version.
+ *
+ *  This Program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with GNU Make; see the file COPYING.  If not, write to
+ *  the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA USA.
+ *  http://www.gnu.org/copyleft/gpl.html
+ *
+ */
+
+#include "GSGIFPackedCodeGenerator.h"
+#include "../GifTypes.h"
+
+using namespace Xbyak;
+
+static const struct alignas(16)
+{
+	u32 x000000ff[4];
+	u32 x00ffffff_000000ff[4];
+} s_const =
+{
+	{0xff, 0xff, 0xff, 0xff},
+	{0xffffff, 0xff, 0, 0},
+};
+
+GSGIFPackedCodeGenerator::GSGIFPackedCodeGenerator(void* param, u64 key, void* code, size_t maxsize)
+	: GSCodeGenerator(code, maxsize)
+	, m_env(*(GSGIFPackedEnvironment*)param)
+{
+	m_sel.key = key;
+
+#if defined(_M_AMD64) || defined(_WIN64)
+	Generate();
+#else
+	ret(); // GIFPath::SetTag doesn't select these loops on x86
+#endif
+}
+
+#if defined(_M_AMD64) || defined(_WIN64)
+
+// rbx = r, r12d = nloop, r13 = &m_v (m_q and the uv hack flag are addressed from it too)
+
+void GSGIFPackedCodeGenerator::Generate()
+{
+	push(rbx);
+	push(r12);
+	push(r13);
+
+#ifdef _WIN64
+	sub(rsp, 32); // shadow space of the VertexKick calls
+
+	mov(rbx, rcx);
+	mov(r12d, edx);
+#else
+	mov(rbx, rdi);
+	mov(r12d, esi);
+#endif
+
+	mov(r13, (size_t)m_env.v);
+
+	Label loop;
+
+	L(loop);
+
+	for(u32 i = 0; i < m_sel.nreg; i++)
+	{
+		const int offset = i * sizeof(GIFPackedReg);
+
+		switch((m_sel.regs >> (i * 4)) & 0xf)
+		{
+			case GIF_REG_RGBA: RGBA(offset); break;
+			case GIF_REG_STQ: STQ(offset); break;
+			case GIF_REG_UV: UV(offset); break;
+			case GIF_REG_FOG: FOG(offset); break;
+			case GIF_REG_XYZF2: XYZF2(offset, false); break;
+			case GIF_REG_XYZF3: XYZF2(offset, true); break;
+			case GIF_REG_XYZ2: XYZ2(offset, false); break;
+			case GIF_REG_XYZ3: XYZ2(offset, true); break;
+			default: break; // NOP
+		}
+	}
+
+	add(rbx, m_sel.nreg * sizeof(GIFPackedReg));
+	dec(r12d);
+	jnz(loop, T_NEAR);
+
+#ifdef _WIN64
+	add(rsp, 32);
+#endif
+
+	pop(r13);
+	pop(r12);
+	pop(rbx);
+
+	ret();
+}
+
+void GSGIFPackedCodeGenerator::RGBA(int offset)
+{
+	// m_v.RGBAQ.U32[0] = (r & x000000ff).rgba32();
+
+	mov(rax, (size_t)s_const.x000000ff);
+
+	movdqu(xmm0, ptr[rbx + offset]);
+	pand(xmm0, ptr[rax]);
+	packssdw(xmm0, xmm0);
+	packuswb(xmm0, xmm0);
+	movd(ptr[r13 + offsetof(GSVertex, RGBAQ)], xmm0);
+
+	// m_v.RGBAQ.Q = m_q;
+
+	mov(eax, ptr[r13 + (int)((u8*)m_env.q - (u8*)m_env.v)]);
+	mov(ptr[r13 + offsetof(GSVertex, RGBAQ) + 4], eax);
+}
+
+void GSGIFPackedCodeGenerator::STQ(int offset)
+{
+	// m_v.ST = r.ST;
+
+	mov(rax, ptr[rbx + offset]);
+	mov(ptr[r13 + offsetof(GSVertex, ST)], rax);
+
+	// m_q = Q, 0 -> 1.0f, nan -> FLT_MAX (see GIFPackedRegHandlerSTQ)
+
+	mov(eax, ptr[rbx + offset + 8]);
+	mov(ecx, 0x3f800000);
+	test(eax, eax);
+	cmovz(eax, ecx);
+	mov(edx, eax);
+	and_(edx, 0x7fffffff);
+	cmp(edx, 0x7f800000);
+	mov(ecx, 0x7f7fffff);
+	cmova(eax, ecx);
+	mov(ptr[r13 + (int)((u8*)m_env.q - (u8*)m_env.v)], eax);
+}
+
+void GSGIFPackedCodeGenerator::UV(int offset)
+{
+	// m_v.UV = (U & 0x3fff) | ((V & 0x3fff) << 16);
+
+	mov(eax, ptr[rbx + offset]);
+	mov(ecx, ptr[rbx + offset + 4]);
+	and_(eax, 0x3fff);
+	and_(ecx, 0x3fff);
+	shl(ecx, 16);
+	or_(eax, ecx);
+	mov(ptr[r13 + offsetof(GSVertex, UV)], eax);
+
+	if(m_sel.uv_hack)
+	{
+		mov(byte[r13 + (int)((u8*)m_env.uv_hack_flag - (u8*)m_env.v)], 1);
+	}
+}
+
+void GSGIFPackedCodeGenerator::FOG(int offset)
+{
+	// m_v.FOG = r.FOG.F;
+
+	mov(eax, ptr[rbx + offset + 12]);
+	shr(eax, 4);
+	and_(eax, 0xff);
+	mov(ptr[r13 + offsetof(GSVertex, FOG)], eax);
+}
+
+void GSGIFPackedCodeGenerator::XYZF2(int offset, bool adc)
+{
+	// m_v.m[1] = [X | Y << 16, Z, UV, F]
+
+	mov(rax, (size_t)s_const.x00ffffff_000000ff);
+
+	movq(xmm0, ptr[rbx + offset]);
+	pshuflw(xmm0, xmm0, _MM_SHUFFLE(0, 0, 2, 0));
+	movq(xmm1, ptr[rbx + offset + 8]);
+	psrld(xmm1, 4);
+	pand(xmm1, ptr[rax]);
+	movd(xmm2, ptr[r13 + offsetof(GSVertex, UV)]);
+	punpckldq(xmm0, xmm2);
+	punpckldq(xmm0, xmm1);
+	movdqa(ptr[r13 + offsetof(GSVertex, XYZ)], xmm0);
+
+	Kick(offset, adc);
+}
+
+void GSGIFPackedCodeGenerator::XYZ2(int offset, bool adc)
+{
+	// m_v.m[1] = [X | Y << 16, Z, UV, FOG]
+
+	movq(xmm0, ptr[rbx + offset]);
+	pshuflw(xmm0, xmm0, _MM_SHUFFLE(0, 0, 2, 0));
+	movd(xmm1, ptr[rbx + offset + 8]);
+	punpckldq(xmm0, xmm1);
+	movq(xmm2, ptr[r13 + offsetof(GSVertex, UV)]);
+	punpcklqdq(xmm0, xmm2);
+	movdqa(ptr[r13 + offsetof(GSVertex, XYZ)], xmm0);
+
+	Kick(offset, adc);
+}
+
+void GSGIFPackedCodeGenerator::Kick(int offset, bool adc)
+{
+	// VertexKick<prim, auto_flush>(adc ? 1 : r.Skip());
+
+#ifdef _WIN64
+	const Reg64 state = rcx;
+	const Reg32 skip = edx;
+#else
+	const Reg64 state = rdi;
+	const Reg32 skip = esi;
+#endif
+
+	if(adc)
+	{
+		mov(skip, 1);
+	}
+	else
+	{
+		mov(skip, ptr[rbx + offset + 12]);
+		and_(skip, 0x8000);
+	}
+
+	mov(state, (size_t)m_env.state);
+	mov(rax, (size_t)m_env.kick[m_sel.prim][m_sel.auto_flush]);
+	call(rax);
+}
+
+#endif
@@ -0,0 +1,82 @@
+/*
+ *	Copyright (C) 2007-2009 Gabest
+ *	http://www.gabest.org
+ *
+ *  This Program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2, or (at your option)
+ *  any later version.
+ *
+ *  This Program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with GNU Make; see the file COPYING.  If not, write to
+ *  the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA USA.
+ *  http://www.gnu.org/copyleft/gpl.html
+ *
+ */
+
+#pragma once
+
+#include "Pcsx2Types.h"
+
+#include "GS.h"
+#include "Renderers/Common/GSCodeGenerator.h"
+#include "Renderers/Common/GSFunctionMap.h"
+#include "Renderers/Common/GSVertex.h"
+
+// Packed mode loop of a GIF tag whose registers only carry vertex data (RGBA, STQ,
+// UV, FOG, XYZ*, NOP), compiled for its register layout and the drawing primitive.
+// Registers changing the state (PRIM, A+D, TEX0, CLAMP) are left to the handlers.
+
+union GSGIFPackedSelector
+{
+	struct
+	{
+		u64 regs:48; // nreg nibbles of GIFTag::REGS
+		u64 nreg:4; // 1-12
+		u64 prim:3; // PRIM.PRIM
+		u64 auto_flush:1;
+		u64 uv_hack:1; // GIFPackedRegHandlerUV_Hack
+	};
+
+	u64 key;
+
+	operator u64() const {return key;}
+};
+
+typedef void (*GSGIFPackedLoopPtr)(const GIFPackedReg* RESTRICT r, u32 nloop);
+typedef void (*GSGIFPackedKickPtr)(void* state, u32 skip);
+
+// Everything the generated code touches, set up once by GSState
+struct GSGIFPackedEnvironment
+{
+	GSVertex* v;
+	float* q;
+	bool* uv_hack_flag;
+	void* state;
+	GSGIFPackedKickPtr kick[8][2]; // [prim][auto_flush]
+};
+
+class GSGIFPackedCodeGenerator : public GSCodeGenerator
+{
+	void operator = (const GSGIFPackedCodeGenerator&);
+
+	GSGIFPackedSelector m_sel;
+	GSGIFPackedEnvironment& m_env;
+
+	void Generate();
+	void RGBA(int offset);
+	void STQ(int offset);
+	void UV(int offset);
+	void FOG(int offset);
+	void XYZF2(int offset, bool adc);
+	void XYZ2(int offset, bool adc);
+	void Kick(int offset, bool adc);
+
+public:
+	GSGIFPackedCodeGenerator(void* param, u64 key, void* code, size_t maxsize);
+};
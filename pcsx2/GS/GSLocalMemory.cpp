@@ -31,6 +31,7 @@
 
 #include "GSLocalMemory.h"
 #include "GS.h"
+#include "Utilities/General.h"
 
 #define FOREACH_BLOCK_START(r, w, h, bpp) \
 	GSVector4i _r = (r) >> 3; \
@@ -230,6 +231,7 @@ GSLocalMemory::GSLocalMemory()
 	{
 		m_vm8 = (u8*)vmalloc(m_vmsize * 4, false);
 		m_use_fifo_alloc = false;
+		HostSys::MmapAdviseHugePages(m_vm8, m_vmsize * 4);
 	}
 
 	m_vm16 = (u16*)m_vm8;
@@ -330,7 +332,7 @@ GSLocalMemory::GSLocalMemory()
 		m_psm[i].rta = &GSLocalMemory::ReadTexel32;
 		m_psm[i].wfa = &GSLocalMemory::WritePixel32;
 		m_psm[i].wi = &GSLocalMemory::WriteImage<PSM_PSMCT32, 8, 8, 32>;
-		m_psm[i].ri = &GSLocalMemory::ReadImageX; // TODO
+		m_psm[i].ri = &GSLocalMemory::ReadImageX;
 		m_psm[i].rtx = &GSLocalMemory::ReadTexture32;
 		m_psm[i].rtxP = &GSLocalMemory::ReadTexture32;
 		m_psm[i].rtxb = &GSLocalMemory::ReadTextureBlock32;
@@ -451,19 +453,33 @@ GSLocalMemory::GSLocalMemory()
 	m_psm[PSM_PSMZ16].wfa = &GSLocalMemory::WriteFrame16;
 	m_psm[PSM_PSMZ16S].wfa = &GSLocalMemory::WriteFrame16;
 
-	m_psm[PSM_PSMCT24].wi = &GSLocalMemory::WriteImage24; // TODO
+	m_psm[PSM_PSMCT24].wi = &GSLocalMemory::WriteImageMasked<PSM_PSMCT24, 8, 8, 24>;
 	m_psm[PSM_PSMCT16].wi = &GSLocalMemory::WriteImage<PSM_PSMCT16, 16, 8, 16>;
 	m_psm[PSM_PSMCT16S].wi = &GSLocalMemory::WriteImage<PSM_PSMCT16S, 16, 8, 16>;
 	m_psm[PSM_PSMT8].wi = &GSLocalMemory::WriteImage<PSM_PSMT8, 16, 16, 8>;
 	m_psm[PSM_PSMT4].wi = &GSLocalMemory::WriteImage<PSM_PSMT4, 32, 16, 4>;
-	m_psm[PSM_PSMT8H].wi = &GSLocalMemory::WriteImage8H; // TODO
-	m_psm[PSM_PSMT4HL].wi = &GSLocalMemory::WriteImage4HL; // TODO
-	m_psm[PSM_PSMT4HH].wi = &GSLocalMemory::WriteImage4HH; // TODO
+	m_psm[PSM_PSMT8H].wi = &GSLocalMemory::WriteImageMasked<PSM_PSMT8H, 8, 8, 8>;
+	m_psm[PSM_PSMT4HL].wi = &GSLocalMemory::WriteImageMasked<PSM_PSMT4HL, 8, 8, 4>;
+	m_psm[PSM_PSMT4HH].wi = &GSLocalMemory::WriteImageMasked<PSM_PSMT4HH, 8, 8, 4>;
 	m_psm[PSM_PSMZ32].wi = &GSLocalMemory::WriteImage<PSM_PSMZ32, 8, 8, 32>;
-	m_psm[PSM_PSMZ24].wi = &GSLocalMemory::WriteImage24Z; // TODO
+	m_psm[PSM_PSMZ24].wi = &GSLocalMemory::WriteImageMasked<PSM_PSMZ24, 8, 8, 24>;
 	m_psm[PSM_PSMZ16].wi = &GSLocalMemory::WriteImage<PSM_PSMZ16, 16, 8, 16>;
 	m_psm[PSM_PSMZ16S].wi = &GSLocalMemory::WriteImage<PSM_PSMZ16S, 16, 8, 16>;
 
+	m_psm[PSM_PSMCT32].ri = &GSLocalMemory::ReadImage<PSM_PSMCT32, 8, 8, 32>;
+	m_psm[PSM_PSMCT24].ri = &GSLocalMemory::ReadImage<PSM_PSMCT24, 8, 8, 24>;
+	m_psm[PSM_PSMCT16].ri = &GSLocalMemory::ReadImage<PSM_PSMCT16, 16, 8, 16>;
+	m_psm[PSM_PSMCT16S].ri = &GSLocalMemory::ReadImage<PSM_PSMCT16S, 16, 8, 16>;
+	m_psm[PSM_PSMT8].ri = &GSLocalMemory::ReadImage<PSM_PSMT8, 16, 16, 8>;
+	m_psm[PSM_PSMT4].ri = &GSLocalMemory::ReadImage<PSM_PSMT4, 32, 16, 4>;
+	m_psm[PSM_PSMT8H].ri = &GSLocalMemory::ReadImage<PSM_PSMT8H, 8, 8, 8>;
+	m_psm[PSM_PSMT4HL].ri = &GSLocalMemory::ReadImage<PSM_PSMT4HL, 8, 8, 4>;
+	m_psm[PSM_PSMT4HH].ri = &GSLocalMemory::ReadImage<PSM_PSMT4HH, 8, 8, 4>;
+	m_psm[PSM_PSMZ32].ri = &GSLocalMemory::ReadImage<PSM_PSMZ32, 8, 8, 32>;
+	m_psm[PSM_PSMZ24].ri = &GSLocalMemory::ReadImage<PSM_PSMZ24, 8, 8, 24>;
+	m_psm[PSM_PSMZ16].ri = &GSLocalMemory::ReadImage<PSM_PSMZ16, 16, 8, 16>;
+	m_psm[PSM_PSMZ16S].ri = &GSLocalMemory::ReadImage<PSM_PSMZ16S, 16, 8, 16>;
+
 	m_psm[PSM_PSMCT24].rtx = &GSLocalMemory::ReadTexture24;
 	m_psm[PSM_PSGPU24].rtx = &GSLocalMemory::ReadTextureGPU24;
 	m_psm[PSM_PSMCT16].rtx = &GSLocalMemory::ReadTexture16;
@@ -1260,179 +1276,171 @@ void GSLocalMemory::WriteImage(int& tx, int& ty, const u8* src, int len, GIFRegB
 }
 
 
-static bool IsTopLeftAligned(int dsax, int tx, int ty, int bw, int bh)
-{
-	return ((dsax & (bw-1)) == 0 && (tx & (bw-1)) == 0 && dsax == tx && (ty & (bh-1)) == 0);
-}
+// Block kernels in the layout of the host transfers: rows of bsx pixels,
+// trbpp bits each. The 32/16/8/4 bits readers store aligned.
 
-void GSLocalMemory::WriteImage24(int& tx, int& ty, const u8* src, int len, GIFRegBITBLTBUF& BITBLTBUF, GIFRegTRXPOS& TRXPOS, GIFRegTRXREG& TRXREG)
+template<int psm>
+static void ReadTransferBlock(const u8* RESTRICT src, u8* RESTRICT dst, int dstpitch)
 {
-	if(TRXREG.RRW == 0) return;
-
-	u32 bp = BITBLTBUF.DBP;
-	u32 bw = BITBLTBUF.DBW;
-
-	int tw = TRXPOS.DSAX + TRXREG.RRW, srcpitch = TRXREG.RRW * 3;
-	int th = len / srcpitch;
-
-	bool aligned = IsTopLeftAligned(TRXPOS.DSAX, tx, ty, 8, 8);
-
-	if(!aligned || (tw & 7) || (th & 7) || (len % srcpitch))
-	{
-		// TODO
-
-		WriteImageX(tx, ty, src, len, BITBLTBUF, TRXPOS, TRXREG);
+	switch(psm)
+	{
+		case PSM_PSMCT32:
+		case PSM_PSMZ32:
+			GSBlock::ReadBlock32(src, dst, dstpitch);
+			break;
+		case PSM_PSMCT24:
+		case PSM_PSMZ24:
+			GSBlock::ReadBlock24(src, dst, dstpitch);
+			break;
+		case PSM_PSMCT16:
+		case PSM_PSMCT16S:
+		case PSM_PSMZ16:
+		case PSM_PSMZ16S:
+			GSBlock::ReadBlock16(src, dst, dstpitch);
+			break;
+		case PSM_PSMT8:
+			GSBlock::ReadBlock8(src, dst, dstpitch);
+			break;
+		case PSM_PSMT4:
+			GSBlock::ReadBlock4(src, dst, dstpitch);
+			break;
+		case PSM_PSMT8H:
+			GSBlock::ReadBlock8HP(src, dst, dstpitch);
+			break;
+		case PSM_PSMT4HL:
+			GSBlock::ReadBlock4HL(src, dst, dstpitch);
+			break;
+		case PSM_PSMT4HH:
+			GSBlock::ReadBlock4HH(src, dst, dstpitch);
+			break;
+		default:
+			break;
 	}
-	else
-	{
-		th += ty;
-
-		for(int y = ty; y < th; y += 8, src += srcpitch * 8)
-		{
-			for(int x = tx; x < tw; x += 8)
-			{
-				GSBlock::UnpackAndWriteBlock24(src + (x - tx) * 3, srcpitch, BlockPtr32(x, y, bp, bw));
-			}
-		}
+}
 
-		ty = th;
+template<int psm>
+static void WriteTransferBlock(u8* RESTRICT dst, const u8* RESTRICT src, int srcpitch)
+{
+	switch(psm)
+	{
+		case PSM_PSMCT24:
+		case PSM_PSMZ24:
+			GSBlock::UnpackAndWriteBlock24(src, srcpitch, dst);
+			break;
+		case PSM_PSMT8H:
+			GSBlock::UnpackAndWriteBlock8H(src, srcpitch, dst);
+			break;
+		case PSM_PSMT4HL:
+			GSBlock::UnpackAndWriteBlock4HL(src, srcpitch, dst);
+			break;
+		case PSM_PSMT4HH:
+			GSBlock::UnpackAndWriteBlock4HH(src, srcpitch, dst);
+			break;
+		default:
+			break;
 	}
 }
 
-void GSLocalMemory::WriteImage8H(int& tx, int& ty, const u8* src, int len, GIFRegBITBLTBUF& BITBLTBUF, GIFRegTRXPOS& TRXPOS, GIFRegTRXREG& TRXREG)
+// Copies w pixels between two transfer rows, sx/dx in pixels
+template<int trbpp>
+static void CopyTransferPixels(u8* RESTRICT dst, int dx, const u8* RESTRICT src, int sx, int w)
 {
-	if(TRXREG.RRW == 0) return;
-
-	u32 bp = BITBLTBUF.DBP;
-	u32 bw = BITBLTBUF.DBW;
-
-	int tw = TRXPOS.DSAX + TRXREG.RRW, srcpitch = TRXREG.RRW;
-	int th = len / srcpitch;
-
-	bool aligned = IsTopLeftAligned(TRXPOS.DSAX, tx, ty, 8, 8);
-
-	if(!aligned || (tw & 7) || (th & 7) || (len % srcpitch))
+	if(trbpp == 4 && ((dx | sx | w) & 1))
 	{
-		// TODO
+		for(int i = 0; i < w; i++)
+		{
+			const int s = sx + i;
+			const int d = dx + i;
+			const u8 c = (src[s >> 1] >> ((s & 1) << 2)) & 0xf;
 
-		WriteImageX(tx, ty, src, len, BITBLTBUF, TRXPOS, TRXREG);
+			dst[d >> 1] = (d & 1) ? (dst[d >> 1] & 0x0f) | (c << 4) : (dst[d >> 1] & 0xf0) | c;
+		}
 	}
 	else
 	{
-		th += ty;
-
-		for(int y = ty; y < th; y += 8, src += srcpitch * 8)
-		{
-			for(int x = tx; x < tw; x += 8)
-			{
-				GSBlock::UnpackAndWriteBlock8H(src + (x - tx), srcpitch, BlockPtr32(x, y, bp, bw));
-			}
-		}
-
-		ty = th;
+		memcpy(&dst[dx * trbpp >> 3], &src[sx * trbpp >> 3], w * trbpp >> 3);
 	}
 }
 
-void GSLocalMemory::WriteImage4HL(int& tx, int& ty, const u8* src, int len, GIFRegBITBLTBUF& BITBLTBUF, GIFRegTRXPOS& TRXPOS, GIFRegTRXREG& TRXREG)
+// 24 bits, 8H, 4HL and 4HH transfers only replace some bits of the 32 bits
+// pixels. Whole blocks are unpacked straight into memory, the blocks at the
+// edges of the transfer are read back, merged with the covered pixels and
+// written again.
+template<int psm, int bsx, int bsy, int trbpp>
+void GSLocalMemory::WriteImageMasked(int& tx, int& ty, const u8* src, int len, GIFRegBITBLTBUF& BITBLTBUF, GIFRegTRXPOS& TRXPOS, GIFRegTRXREG& TRXREG)
 {
 	if(TRXREG.RRW == 0) return;
 
-	u32 bp = BITBLTBUF.DBP;
-	u32 bw = BITBLTBUF.DBW;
+	const int l = (int)TRXPOS.DSAX;
+	const int r = l + (int)TRXREG.RRW;
 
-	int tw = TRXPOS.DSAX + TRXREG.RRW, srcpitch = TRXREG.RRW / 2;
-	int th = len / srcpitch;
-
-	bool aligned = IsTopLeftAligned(TRXPOS.DSAX, tx, ty, 8, 8);
+	// finish the incomplete row first
 
-	if(!aligned || (tw & 7) || (th & 7) || (len % srcpitch))
+	if(tx != l)
 	{
-		// TODO
-
-		WriteImageX(tx, ty, src, len, BITBLTBUF, TRXPOS, TRXREG);
+		int n = std::min(len, (r - tx) * trbpp >> 3);
+		WriteImageX(tx, ty, src, n, BITBLTBUF, TRXPOS, TRXREG);
+		src += n;
+		len -= n;
 	}
-	else
-	{
-		th += ty;
 
-		for(int y = ty; y < th; y += 8, src += srcpitch * 8)
-		{
-			for(int x = tx; x < tw; x += 8)
-			{
-				GSBlock::UnpackAndWriteBlock4HL(src + (x - tx) / 2, srcpitch, BlockPtr32(x, y, bp, bw));
-			}
-		}
+	const int srcpitch = (r - l) * trbpp >> 3;
 
-		ty = th;
-	}
-}
+	// rows of odd width 4 bits transfers don't start on a byte
 
-void GSLocalMemory::WriteImage4HH(int& tx, int& ty, const u8* src, int len, GIFRegBITBLTBUF& BITBLTBUF, GIFRegTRXPOS& TRXPOS, GIFRegTRXREG& TRXREG)
-{
-	if(TRXREG.RRW == 0) return;
+	if(!(trbpp == 4 && (TRXREG.RRW & 1)) && len >= srcpitch)
+	{
+		alignas(32) u8 buff[bsx * bsy * 4];
 
-	u32 bp = BITBLTBUF.DBP;
-	u32 bw = BITBLTBUF.DBW;
+		const int bpitch = bsx * trbpp >> 3;
+		const int h = len / srcpitch;
+		const int b = ty + h;
 
-	int tw = TRXPOS.DSAX + TRXREG.RRW, srcpitch = TRXREG.RRW / 2;
-	int th = len / srcpitch;
+		u32 bp = BITBLTBUF.DBP;
+		u32 bw = BITBLTBUF.DBW;
 
-	bool aligned = IsTopLeftAligned(TRXPOS.DSAX, tx, ty, 8, 8);
+		for(int y0 = ty & ~(bsy - 1); y0 < b; y0 += bsy)
+		{
+			const int yt = std::max(y0, ty);
+			const int yb = std::min(y0 + bsy, b);
+			const u8* s = &src[(yt - ty) * srcpitch];
 
-	if(!aligned || (tw & 7) || (th & 7) || (len % srcpitch))
-	{
-		// TODO
+			for(int x0 = l & ~(bsx - 1); x0 < r; x0 += bsx)
+			{
+				const int xl = std::max(x0, l);
+				const int xr = std::min(x0 + bsx, r);
 
-		WriteImageX(tx, ty, src, len, BITBLTBUF, TRXPOS, TRXREG);
-	}
-	else
-	{
-		th += ty;
+				u8* dst = BlockPtr(m_psm[psm].bn(x0, y0, bp, bw));
 
-		for(int y = ty; y < th; y += 8, src += srcpitch * 8)
-		{
-			for(int x = tx; x < tw; x += 8)
-			{
-				GSBlock::UnpackAndWriteBlock4HH(src + (x - tx) / 2, srcpitch, BlockPtr32(x, y, bp, bw));
+				if(yb - yt == bsy && xr - xl == bsx && (trbpp != 4 || ((xl - l) & 1) == 0))
+				{
+					WriteTransferBlock<psm>(dst, &s[(xl - l) * trbpp >> 3], srcpitch);
+				}
+				else
+				{
+					ReadTransferBlock<psm>(dst, buff, bpitch);
+
+					for(int y = yt; y < yb; y++)
+					{
+						CopyTransferPixels<trbpp>(&buff[(y - y0) * bpitch], xl - x0, &s[(y - yt) * srcpitch], xl - l, xr - xl);
+					}
+
+					WriteTransferBlock<psm>(dst, buff, bpitch);
+				}
 			}
 		}
 
-		ty = th;
+		src += srcpitch * h;
+		len -= srcpitch * h;
+		ty = b;
 	}
-}
-
-void GSLocalMemory::WriteImage24Z(int& tx, int& ty, const u8* src, int len, GIFRegBITBLTBUF& BITBLTBUF, GIFRegTRXPOS& TRXPOS, GIFRegTRXREG& TRXREG)
-{
-	if(TRXREG.RRW == 0) return;
 
-	u32 bp = BITBLTBUF.DBP;
-	u32 bw = BITBLTBUF.DBW;
-
-	int tw = TRXPOS.DSAX + TRXREG.RRW, srcpitch = TRXREG.RRW * 3;
-	int th = len / srcpitch;
-
-	bool aligned = IsTopLeftAligned(TRXPOS.DSAX, tx, ty, 8, 8);
+	// the rest
 
-	if(!aligned || (tw & 7) || (th & 7) || (len % srcpitch))
+	if(len > 0)
 	{
-		// TODO
-
 		WriteImageX(tx, ty, src, len, BITBLTBUF, TRXPOS, TRXREG);
 	}
-	else
-	{
-		th += ty;
-
-		for(int y = ty; y < th; y += 8, src += srcpitch * 8)
-		{
-			for(int x = tx; x < tw; x += 8)
-			{
-				GSBlock::UnpackAndWriteBlock24(src + (x - tx) * 3, srcpitch, BlockPtr32Z(x, y, bp, bw));
-			}
-		}
-
-		ty = th;
-	}
 }
 
 void GSLocalMemory::WriteImageX(int& tx, int& ty, const u8* src, int len, GIFRegBITBLTBUF& BITBLTBUF, GIFRegTRXPOS& TRXPOS, GIFRegTRXREG& TRXREG)
@@ -1609,8 +1617,240 @@ void GSLocalMemory::WriteImageX(int& tx, int& ty, const u8* src, int len, GIFReg
 	ty = y;
 }
 
+// WriteImageX without the pixels
+static void AdvanceImageX(int& tx, int& ty, int len, u32 psm, int sx, int ex)
+{
+	if(len <= 0) return;
+
+	int step = 1;
+
+	switch(psm)
+	{
+	case PSM_PSMCT32:
+	case PSM_PSMZ32:
+		len /= 4;
+		break;
+	case PSM_PSMCT24:
+	case PSM_PSMZ24:
+		len /= 3;
+		break;
+	case PSM_PSMCT16:
+	case PSM_PSMCT16S:
+	case PSM_PSMZ16:
+	case PSM_PSMZ16S:
+		len /= 2;
+		break;
+	case PSM_PSMT8:
+	case PSM_PSMT8H:
+		break;
+	case PSM_PSMT4:
+	case PSM_PSMT4HL:
+	case PSM_PSMT4HH:
+		step = 2;
+		break;
+	default:
+		return;
+	}
+
+	int x = tx;
+	int y = ty;
+
+	while(len > 0)
+	{
+		// what the row takes, the 4 bits writers may step over its end
+		const int n = std::max(ex - x + step - 1, 0) / step;
+
+		if(len < n)
+		{
+			x += len * step;
+			len = 0;
+		}
+		else
+		{
+			len -= n;
+			x = sx;
+			y++;
+		}
+	}
+
+	tx = x;
+	ty = y;
+}
+
+// Follows the writers picked in the constructor: the partial row, the whole rows
+// when the fast path takes them, and the rest through WriteImageX. The formats
+// without a writer of their own use WriteImage<PSM_PSMCT32>, which does not move
+// along the rows (WriteImageX skips them).
+void GSLocalMemory::AdvanceImage(int& tx, int& ty, int len, const GIFRegBITBLTBUF& BITBLTBUF, const GIFRegTRXPOS& TRXPOS, const GIFRegTRXREG& TRXREG)
+{
+	if(TRXREG.RRW == 0) return;
+
+	const u32 psm = BITBLTBUF.DPSM;
+
+	bool masked = false;
+	int bsx = 8;
+	int trbpp = 32;
+
+	switch(psm)
+	{
+	case PSM_PSMCT24:
+	case PSM_PSMZ24:
+		masked = true;
+		trbpp = 24;
+		break;
+	case PSM_PSMT8H:
+		masked = true;
+		trbpp = 8;
+		break;
+	case PSM_PSMT4HL:
+	case PSM_PSMT4HH:
+		masked = true;
+		trbpp = 4;
+		break;
+	case PSM_PSMCT16:
+	case PSM_PSMCT16S:
+	case PSM_PSMZ16:
+	case PSM_PSMZ16S:
+		bsx = 16;
+		trbpp = 16;
+		break;
+	case PSM_PSMT8:
+		bsx = 16;
+		trbpp = 8;
+		break;
+	case PSM_PSMT4:
+		bsx = 32;
+		trbpp = 4;
+		break;
+	default:
+		break;
+	}
+
+	const int l = (int)TRXPOS.DSAX;
+	const int r = l + (int)TRXREG.RRW;
+
+	if(tx != l)
+	{
+		int n = std::min(len, (r - tx) * trbpp >> 3);
+		AdvanceImageX(tx, ty, n, psm, l, r);
+		len -= n;
+	}
+
+	const bool odd4 = trbpp == 4 && (TRXREG.RRW & 1);
+
+	if(masked)
+	{
+		const int srcpitch = (r - l) * trbpp >> 3;
+
+		if(!odd4 && len >= srcpitch)
+		{
+			const int h = len / srcpitch;
+
+			len -= srcpitch * h;
+			ty += h;
+		}
+	}
+	else
+	{
+		// the odd width 4bpp slow path writes the whole rectangle and stops there
+		if(odd4) return;
+
+		const int la = (l + (bsx - 1)) & ~(bsx - 1);
+		const int ra = r & ~(bsx - 1);
+		const int srcpitch = (((r - l) * trbpp) + 7) >> 3;
+		const int h = len / srcpitch;
+
+		if(ra - la >= bsx && h > 0)
+		{
+			len -= srcpitch * h;
+			ty += h;
+		}
+	}
+
+	AdvanceImageX(tx, ty, len, psm, l, r);
+}
+
 //
 
+template<int psm, int bsx, int bsy, int trbpp>
+void GSLocalMemory::ReadImage(int& tx, int& ty, u8* dst, int len, GIFRegBITBLTBUF& BITBLTBUF, GIFRegTRXPOS& TRXPOS, GIFRegTRXREG& TRXREG) const
+{
+	if(TRXREG.RRW == 0) return;
+
+	const int l = (int)TRXPOS.SSAX;
+	const int r = l + (int)TRXREG.RRW;
+
+	// finish the incomplete row first
+
+	if(tx != l)
+	{
+		int n = std::min(len, (r - tx) * trbpp >> 3);
+		ReadImageX(tx, ty, dst, n, BITBLTBUF, TRXPOS, TRXREG);
+		dst += n;
+		len -= n;
+	}
+
+	const int dstpitch = (r - l) * trbpp >> 3;
+
+	// rows of odd width 4 bits transfers don't start on a byte
+
+	if(!(trbpp == 4 && (TRXREG.RRW & 1)) && len >= dstpitch)
+	{
+		// the kernels of the formats with their own block layout store aligned
+		const bool aligned = trbpp == 32 || trbpp == 16 || psm == PSM_PSMT8 || psm == PSM_PSMT4;
+
+		alignas(32) u8 buff[bsx * bsy * 4];
+
+		const int bpitch = bsx * trbpp >> 3;
+		const int h = len / dstpitch;
+		const int b = ty + h;
+
+		u32 bp = BITBLTBUF.SBP;
+		u32 bw = BITBLTBUF.SBW;
+
+		for(int y0 = ty & ~(bsy - 1); y0 < b; y0 += bsy)
+		{
+			const int yt = std::max(y0, ty);
+			const int yb = std::min(y0 + bsy, b);
+			u8* d = &dst[(yt - ty) * dstpitch];
+
+			for(int x0 = l & ~(bsx - 1); x0 < r; x0 += bsx)
+			{
+				const int xl = std::max(x0, l);
+				const int xr = std::min(x0 + bsx, r);
+
+				const u8* src = BlockPtr(m_psm[psm].bn(x0, y0, bp, bw));
+				u8* p = &d[(xl - l) * trbpp >> 3];
+
+				if(yb - yt == bsy && xr - xl == bsx && (trbpp != 4 || ((xl - l) & 1) == 0) && (!aligned || (((size_t)p | dstpitch) & 15) == 0))
+				{
+					ReadTransferBlock<psm>(src, p, dstpitch);
+				}
+				else
+				{
+					ReadTransferBlock<psm>(src, buff, bpitch);
+
+					for(int y = yt; y < yb; y++)
+					{
+						CopyTransferPixels<trbpp>(&d[(y - yt) * dstpitch], xl - l, &buff[(y - y0) * bpitch], xl - x0, xr - xl);
+					}
+				}
+			}
+		}
+
+		dst += dstpitch * h;
+		len -= dstpitch * h;
+		ty = b;
+	}
+
+	// the rest
+
+	if(len > 0)
+	{
+		ReadImageX(tx, ty, dst, len, BITBLTBUF, TRXPOS, TRXREG);
+	}
+}
+
 void GSLocalMemory::ReadImageX(int& tx, int& ty, u8* dst, int len, GIFRegBITBLTBUF& BITBLTBUF, GIFRegTRXPOS& TRXPOS, GIFRegTRXREG& TRXREG) const
 {
 	if(len <= 0) return;
@@ -1755,7 +1995,7 @@ void GSLocalMemory::ReadImageX(int& tx, int& ty, u8* dst, int len, GIFRegBITBLTB
 				*pb = (u8)(ReadPixel4(addr + offset[x + 0]) | (ReadPixel4(addr + offset[x + 1]) << 4));
 			}
 
-			if(x == ex) {x = sx; y++;}
+			if(x >= ex) {x = sx; y++;}
 		}
 
 		break;
@@ -1800,7 +2040,7 @@ void GSLocalMemory::ReadImageX(int& tx, int& ty, u8* dst, int len, GIFRegBITBLTB
 				*pb = (u8)(c0 | c1);
 			}
 
-			if(x == ex) {x = sx; y++;}
+			if(x >= ex) {x = sx; y++;}
 		}
 
 		break;
@@ -1820,7 +2060,7 @@ void GSLocalMemory::ReadImageX(int& tx, int& ty, u8* dst, int len, GIFRegBITBLTB
 				*pb = (u8)(c0 | c1);
 			}
 
-			if(x == ex) {x = sx; y++;}
+			if(x >= ex) {x = sx; y++;}
 		}
 
 		break;
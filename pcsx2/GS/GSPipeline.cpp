@@ -0,0 +1,584 @@
+/*
+ *	Copyright (C) 2007-2009 Gabest
+ *	http://www.gabest.org
+ *
+ *  This Program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2, or (at your option)
+ *  any later version.
+ *
+ *  This Program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with GNU Make; see the file COPYING.  If not, write to
+ *  the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA USA.
+ *  http://www.gnu.org/copyleft/gpl.html
+ *
+ */
+
+#include <algorithm>
+#include <chrono>
+#include <iterator>
+
+#include "GSPipeline.h"
+#include "Renderers/SW/GSRendererSW.h"
+
+struct alignas(32) GSPipelineRecord : public GSAlignedClass<32>
+{
+	enum Type
+	{
+		Draw,
+		WriteImage,
+		Move,
+		WriteCLUT,
+		InvalidateVideoMem,
+		InvalidateLocalMem,
+		Call,
+		Frame,
+		Sync,
+	};
+
+	int type;
+
+	// Draw
+
+	GSDrawingEnvironment env;
+	std::vector<u8> vertex;
+	std::vector<u8> index;
+	size_t vertex_head;
+	size_t vertex_next;
+	bool uv_hack;
+
+	// GSVertexTrace results
+
+	GS_PRIM_CLASS primclass;
+	GSVertexTrace::Vertex min;
+	GSVertexTrace::Vertex max;
+	GSVertexTrace::VertexAlpha alpha;
+	decltype(GSVertexTrace::m_eq) eq;
+	decltype(GSVertexTrace::m_filter) filter;
+	GSVector2 lod;
+	bool accurate_stq;
+
+	// Local memory
+
+	GIFRegBITBLTBUF BITBLTBUF;
+	GIFRegTRXPOS TRXPOS;
+	GIFRegTRXREG TRXREG;
+	GSVector4i r;
+	bool clut;
+	int tx, ty;
+	std::vector<u8> data;
+
+	GIFRegTEX0 TEX0;
+	GIFRegTEXCLUT TEXCLUT;
+
+	// Call, Frame, Sync
+
+	std::function<void()> fn;
+};
+
+// --------------------------------------------------------------------------------------
+//  GSPipelineState
+// --------------------------------------------------------------------------------------
+// The GSState of the parse stage, records what it would otherwise execute.
+
+class GSPipelineState final : public GSState
+{
+	GSPipeline& m_pipeline;
+
+protected:
+	void WriteImage(int& tx, int& ty, const u8* src, int len, GIFRegBITBLTBUF& BITBLTBUF, GIFRegTRXPOS& TRXPOS, GIFRegTRXREG& TRXREG) final;
+	void WriteCLUT(const GIFRegTEX0& TEX0, const GIFRegTEXCLUT& TEXCLUT) final;
+
+public:
+	GSPipelineState(GSPipeline& pipeline)
+		: m_pipeline(pipeline)
+	{
+	}
+
+	void Draw() final;
+	void PurgePool() final {}
+	void InvalidateVideoMem(const GIFRegBITBLTBUF& BITBLTBUF, const GSVector4i& r) final;
+	void InvalidateLocalMem(const GIFRegBITBLTBUF& BITBLTBUF, const GSVector4i& r, bool clut = false) final;
+	void Move() final;
+};
+
+void GSPipelineState::Draw()
+{
+	GSPipelineRecord* rec = m_pipeline.Alloc(GSPipelineRecord::Draw);
+
+	rec->env = m_env;
+	rec->vertex.assign((const u8*)m_vertex.buff, (const u8*)(m_vertex.buff + m_vertex.tail));
+	rec->index.assign((const u8*)m_index.buff, (const u8*)(m_index.buff + m_index.tail));
+	rec->vertex_head = m_vertex.head;
+	rec->vertex_next = m_vertex.next;
+	rec->uv_hack = m_isPackedUV_HackFlag;
+
+	rec->primclass = m_vt.m_primclass;
+	rec->min = m_vt.m_min;
+	rec->max = m_vt.m_max;
+	rec->alpha = m_vt.m_alpha;
+	rec->eq = m_vt.m_eq;
+	rec->filter = m_vt.m_filter;
+	rec->lod = m_vt.m_lod;
+	rec->accurate_stq = m_vt.m_accurate_stq;
+
+	m_pipeline.Push(rec);
+
+	// The renderers make the CLUT reload after drawing over it: GSRendererSW when the
+	// frame is at the CLUT block, GSRendererHW::OI_PointListPalette for palettes drawn
+	// with points. Their CLUT state isn't ours, so do the same here.
+
+	const u32 FBP = GIFREG_FRAME_BLOCK(m_context->FRAME);
+
+	m_mem.m_clut.Invalidate(FBP);
+
+	if(m_vt.m_primclass == GS_POINT_CLASS && !PRIM->TME && FBP >= 0x03f40 && (FBP & 0x1f) == 0)
+		m_mem.m_clut.Invalidate();
+}
+
+void GSPipelineState::InvalidateVideoMem(const GIFRegBITBLTBUF& BITBLTBUF, const GSVector4i& r)
+{
+	GSPipelineRecord* rec = m_pipeline.Alloc(GSPipelineRecord::InvalidateVideoMem);
+
+	rec->BITBLTBUF = BITBLTBUF;
+	rec->r = r;
+
+	m_pipeline.Push(rec);
+}
+
+void GSPipelineState::InvalidateLocalMem(const GIFRegBITBLTBUF& BITBLTBUF, const GSVector4i& r, bool clut)
+{
+	GSPipelineRecord* rec = m_pipeline.Alloc(GSPipelineRecord::InvalidateLocalMem);
+
+	rec->BITBLTBUF = BITBLTBUF;
+	rec->r = r;
+	rec->clut = clut;
+
+	m_pipeline.Push(rec);
+}
+
+void GSPipelineState::Move()
+{
+	GSPipelineRecord* rec = m_pipeline.Alloc(GSPipelineRecord::Move);
+
+	rec->BITBLTBUF = m_env.BITBLTBUF;
+	rec->TRXPOS = m_env.TRXPOS;
+	rec->TRXREG = m_env.TRXREG;
+
+	m_pipeline.Push(rec);
+}
+
+void GSPipelineState::WriteImage(int& tx, int& ty, const u8* src, int len, GIFRegBITBLTBUF& BITBLTBUF, GIFRegTRXPOS& TRXPOS, GIFRegTRXREG& TRXREG)
+{
+	GSPipelineRecord* rec = m_pipeline.Alloc(GSPipelineRecord::WriteImage);
+
+	rec->tx = tx;
+	rec->ty = ty;
+	rec->BITBLTBUF = BITBLTBUF;
+	rec->TRXPOS = TRXPOS;
+	rec->TRXREG = TRXREG;
+	rec->data.assign(src, src + len);
+
+	m_pipeline.Push(rec);
+
+	// Nothing reads our local memory, only the transfer position is kept
+	GSLocalMemory::AdvanceImage(tx, ty, len, BITBLTBUF, TRXPOS, TRXREG);
+}
+
+void GSPipelineState::WriteCLUT(const GIFRegTEX0& TEX0, const GIFRegTEXCLUT& TEXCLUT)
+{
+	GSPipelineRecord* rec = m_pipeline.Alloc(GSPipelineRecord::WriteCLUT);
+
+	rec->TEX0 = TEX0;
+	rec->TEXCLUT = TEXCLUT;
+
+	m_pipeline.Push(rec);
+
+	// Keeps WriteTest() going, the palette itself isn't used
+	GSState::WriteCLUT(TEX0, TEXCLUT);
+}
+
+// --------------------------------------------------------------------------------------
+//  GSPipeline
+// --------------------------------------------------------------------------------------
+
+GSPipeline::GSPipeline(GSState* renderer)
+	: m_renderer(renderer)
+	, m_frames(0)
+	, m_sync(false)
+	, m_parse_quit(false)
+	, m_parse_running(false)
+{
+	// A dump can't follow the packets parsed elsewhere, GSRenderer doesn't start one
+	// while pipelined
+	delete m_renderer->m_dump;
+	m_renderer->m_dump = NULL;
+	m_renderer->m_pipelined = true;
+
+	m_parser = new GSPipelineState(*this);
+	m_parser->SetRegsMem((u8*)m_renderer->m_regs);
+	m_parser->SetGameCRC(m_renderer->m_crc, m_renderer->m_options);
+
+	CopySettings(*m_parser, *m_renderer);
+	CopyParseState(*m_parser, *m_renderer);
+}
+
+GSPipeline::~GSPipeline()
+{
+	StopParsing();
+
+	// The parse stage has stopped, finish what it queued and hand the renderer the
+	// parse state, it may go on parsing on its own
+
+	while(Execute())
+	{
+	}
+
+	CopyParseState(*m_renderer, *m_parser);
+
+	m_renderer->m_pipelined = false;
+
+	delete m_parser;
+
+	for(GSPipelineRecord* rec : m_free)
+		delete rec;
+}
+
+bool GSPipeline::Supports(GSState* renderer)
+{
+	return dynamic_cast<GSRendererSW*>(renderer) != NULL;
+}
+
+void GSPipeline::CopySettings(GSState& dst, const GSState& src)
+{
+	dst.m_userhacks_wildhack = src.m_userhacks_wildhack;
+	dst.m_userhacks_auto_flush = src.m_userhacks_auto_flush;
+	dst.m_clut_load_before_draw = src.m_clut_load_before_draw;
+
+	dst.ResetHandlers();
+	dst.UpdateVertexKick();
+}
+
+void GSPipeline::CopyParseState(GSState& dst, GSState& src)
+{
+	dst.m_env = src.m_env;
+
+	dst.PRIM = !dst.m_env.PRMODECONT.AC ? (GIFRegPRIM*)&dst.m_env.PRMODE : &dst.m_env.PRIM;
+
+	// The offsets belong to the local memory they were looked up in
+
+	for(size_t i = 0; i < 2; i++)
+	{
+		GSDrawingContext& ctx = dst.m_env.CTXT[i];
+
+		ctx.offset.fb = dst.m_mem.GetOffset(GIFREG_FRAME_BLOCK(ctx.FRAME), ctx.FRAME.FBW, ctx.FRAME.PSM);
+		ctx.offset.zb = dst.m_mem.GetOffset(GIFREG_ZBUF_BLOCK(ctx.ZBUF), ctx.FRAME.FBW, ctx.ZBUF.PSM);
+		ctx.offset.tex = dst.m_mem.GetOffset(ctx.TEX0.TBP0, ctx.TEX0.TBW, ctx.TEX0.PSM);
+		ctx.offset.fzb = dst.m_mem.GetPixelOffset(ctx.FRAME, ctx.ZBUF);
+		ctx.offset.fzb4 = dst.m_mem.GetPixelOffset4(ctx.FRAME, ctx.ZBUF);
+	}
+
+	dst.UpdateContext();
+	dst.UpdateVertexKick();
+
+	std::copy(std::begin(src.m_path), std::end(src.m_path), std::begin(dst.m_path));
+
+	dst.m_v = src.m_v;
+	dst.m_q = src.m_q;
+	dst.m_isPackedUV_HackFlag = src.m_isPackedUV_HackFlag;
+
+	// Pending primitives, or the vertices kept for the next strip/fan primitive
+
+	while(dst.m_vertex.maxcount < src.m_vertex.maxcount)
+		dst.GrowVertexBuffer();
+
+	std::copy(src.m_vertex.buff, src.m_vertex.buff + src.m_vertex.tail, dst.m_vertex.buff);
+	memcpy(dst.m_index.buff, src.m_index.buff, sizeof(u32) * src.m_index.tail);
+	memcpy(dst.m_vertex.xy, src.m_vertex.xy, sizeof(dst.m_vertex.xy));
+
+	dst.m_vertex.head = src.m_vertex.head;
+	dst.m_vertex.tail = src.m_vertex.tail;
+	dst.m_vertex.next = src.m_vertex.next;
+	dst.m_vertex.xy_tail = src.m_vertex.xy_tail;
+	dst.m_index.tail = src.m_index.tail;
+
+	// Transfer in progress, with the data not written yet
+
+	dst.m_tr.x = src.m_tr.x;
+	dst.m_tr.y = src.m_tr.y;
+	dst.m_tr.start = src.m_tr.start;
+	dst.m_tr.end = src.m_tr.end;
+	dst.m_tr.total = src.m_tr.total;
+	dst.m_tr.overflow = src.m_tr.overflow;
+	dst.m_tr.m_blit = src.m_tr.m_blit;
+
+	if(src.m_tr.end > src.m_tr.start)
+		memcpy(&dst.m_tr.buff[src.m_tr.start], &src.m_tr.buff[src.m_tr.start], src.m_tr.end - src.m_tr.start);
+
+	// Either side may have loaded or overwritten the CLUT behind the other's back
+	dst.m_mem.m_clut.Invalidate();
+}
+
+void GSPipeline::StartParsing(std::function<void()> fn)
+{
+	m_parse_quit.store(false, std::memory_order_relaxed);
+	m_parse_running.store(true, std::memory_order_relaxed);
+
+	m_parse_thread = std::thread([this, fn] {
+		fn();
+		m_parse_running.store(false, std::memory_order_release);
+	});
+}
+
+void GSPipeline::StopParsing()
+{
+	if(!m_parse_thread.joinable()) return;
+
+	m_parse_quit.store(true, std::memory_order_release);
+
+	while(m_parse_running.load(std::memory_order_acquire))
+		Execute();
+
+	m_parse_thread.join();
+}
+
+GSPipelineRecord* GSPipeline::Alloc(int type)
+{
+	GSPipelineRecord* rec = NULL;
+
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+
+		if(!m_free.empty())
+		{
+			rec = m_free.back();
+			m_free.pop_back();
+		}
+	}
+
+	if(!rec)
+		rec = new GSPipelineRecord();
+
+	rec->type = type;
+
+	return rec;
+}
+
+void GSPipeline::Push(GSPipelineRecord* rec)
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+
+	m_queue.push_back(rec);
+	m_cv_render.notify_one();
+}
+
+void GSPipeline::Transfer(const u8* mem, u32 size)
+{
+	m_parser->Transfer<3>(mem, size);
+}
+
+void GSPipeline::Reset()
+{
+	m_parser->Reset();
+
+	GSPipelineRecord* rec = Alloc(GSPipelineRecord::Call);
+	rec->fn = [this] { m_renderer->Reset(); };
+	Push(rec);
+}
+
+void GSPipeline::SoftReset(u32 mask)
+{
+	m_parser->SoftReset(mask);
+}
+
+void GSPipeline::SetGameCRC(u32 crc, int options)
+{
+	m_parser->SetGameCRC(crc, options);
+
+	GSPipelineRecord* rec = Alloc(GSPipelineRecord::Call);
+	rec->fn = [this, crc, options] { m_renderer->SetGameCRC(crc, options); };
+	Push(rec);
+}
+
+void GSPipeline::PostFrame(std::function<void()> fn)
+{
+	// Same as GSRenderer::VSync()
+	m_parser->Flush();
+
+	GSPipelineRecord* rec = Alloc(GSPipelineRecord::Frame);
+	rec->fn = std::move(fn);
+
+	std::unique_lock<std::mutex> lock(m_mutex);
+
+	// The render stage may be one frame behind, not more
+	m_cv_parse.wait(lock, [&] { return m_frames == 0; });
+
+	m_frames++;
+	m_queue.push_back(rec);
+	m_cv_render.notify_one();
+}
+
+void GSPipeline::Sync(std::function<void()> fn)
+{
+	GSPipelineRecord* rec = Alloc(GSPipelineRecord::Sync);
+	rec->fn = std::move(fn);
+
+	std::unique_lock<std::mutex> lock(m_mutex);
+
+	m_sync = true;
+	m_queue.push_back(rec);
+	m_cv_render.notify_one();
+
+	m_cv_parse.wait(lock, [&] { return !m_sync; });
+}
+
+bool GSPipeline::Wait(const std::function<bool()>& ready)
+{
+	while(!ready())
+	{
+		if(Stopping())
+			return false;
+	}
+
+	return true;
+}
+
+bool GSPipeline::Execute()
+{
+	std::unique_lock<std::mutex> lock(m_mutex);
+
+	for(;;)
+	{
+		if(m_queue.empty() && !m_cv_render.wait_for(lock, std::chrono::milliseconds(1), [&] { return !m_queue.empty(); }))
+			return false;
+
+		GSPipelineRecord* rec = m_queue.front();
+		m_queue.pop_front();
+
+		lock.unlock();
+
+		Run(*rec);
+
+		rec->fn = nullptr;
+
+		lock.lock();
+
+		m_free.push_back(rec);
+
+		if(rec->type == GSPipelineRecord::Sync)
+		{
+			m_sync = false;
+			m_cv_parse.notify_all();
+		}
+		else if(rec->type == GSPipelineRecord::Frame)
+		{
+			m_frames--;
+			m_cv_parse.notify_all();
+
+			return true;
+		}
+	}
+}
+
+void GSPipeline::Run(GSPipelineRecord& rec)
+{
+	GSState& r = *m_renderer;
+
+	switch(rec.type)
+	{
+		case GSPipelineRecord::Draw:
+			Draw(rec);
+			break;
+
+		case GSPipelineRecord::WriteImage:
+			(r.m_mem.*GSLocalMemory::m_psm[rec.BITBLTBUF.DPSM].wi)(rec.tx, rec.ty, rec.data.data(), (int)rec.data.size(), rec.BITBLTBUF, rec.TRXPOS, rec.TRXREG);
+			break;
+
+		case GSPipelineRecord::Move:
+			r.m_env.BITBLTBUF = rec.BITBLTBUF;
+			r.m_env.TRXPOS = rec.TRXPOS;
+			r.m_env.TRXREG = rec.TRXREG;
+			r.Move();
+			break;
+
+		case GSPipelineRecord::WriteCLUT:
+			r.m_mem.m_clut.Write(rec.TEX0, rec.TEXCLUT);
+			break;
+
+		case GSPipelineRecord::InvalidateVideoMem:
+			r.InvalidateVideoMem(rec.BITBLTBUF, rec.r);
+			break;
+
+		case GSPipelineRecord::InvalidateLocalMem:
+			r.InvalidateLocalMem(rec.BITBLTBUF, rec.r, rec.clut);
+			break;
+
+		case GSPipelineRecord::Call:
+		case GSPipelineRecord::Frame:
+			rec.fn();
+			break;
+
+		case GSPipelineRecord::Sync:
+			// The parse stage waits for us, its state can be borrowed
+			CopyParseState(r, *m_parser);
+			rec.fn();
+			CopySettings(*m_parser, r);
+			CopyParseState(*m_parser, r);
+			break;
+	}
+}
+
+void GSPipeline::Draw(GSPipelineRecord& rec)
+{
+	GSState& r = *m_renderer;
+
+	r.m_env = rec.env;
+	r.PRIM = !r.m_env.PRMODECONT.AC ? (GIFRegPRIM*)&r.m_env.PRMODE : &r.m_env.PRIM;
+	r.UpdateContext();
+
+	GSDrawingContext* ctx = r.m_context;
+
+	ctx->offset.fb = r.m_mem.GetOffset(GIFREG_FRAME_BLOCK(ctx->FRAME), ctx->FRAME.FBW, ctx->FRAME.PSM);
+	ctx->offset.zb = r.m_mem.GetOffset(GIFREG_ZBUF_BLOCK(ctx->ZBUF), ctx->FRAME.FBW, ctx->ZBUF.PSM);
+	ctx->offset.tex = r.m_mem.GetOffset(ctx->TEX0.TBP0, ctx->TEX0.TBW, ctx->TEX0.PSM);
+	ctx->offset.fzb = r.m_mem.GetPixelOffset(ctx->FRAME, ctx->ZBUF);
+	ctx->offset.fzb4 = r.m_mem.GetPixelOffset4(ctx->FRAME, ctx->ZBUF);
+
+	const size_t vertices = rec.vertex.size() / sizeof(GSVertex);
+	const size_t indices = rec.index.size() / sizeof(u32);
+
+	while(r.m_vertex.maxcount < vertices || r.m_vertex.maxcount * 3 < indices)
+		r.GrowVertexBuffer();
+
+	memcpy((void*)r.m_vertex.buff, rec.vertex.data(), rec.vertex.size());
+	memcpy(r.m_index.buff, rec.index.data(), rec.index.size());
+
+	r.m_vertex.head = rec.vertex_head;
+	r.m_vertex.tail = vertices;
+	r.m_vertex.next = rec.vertex_next;
+	r.m_index.tail = indices;
+	r.m_isPackedUV_HackFlag = rec.uv_hack;
+
+	r.m_vt.m_primclass = rec.primclass;
+	r.m_vt.m_min = rec.min;
+	r.m_vt.m_max = rec.max;
+	r.m_vt.m_alpha = rec.alpha;
+	r.m_vt.m_eq = rec.eq;
+	r.m_vt.m_filter = rec.filter;
+	r.m_vt.m_lod = rec.lod;
+	r.m_vt.m_accurate_stq = rec.accurate_stq;
+
+	r.m_context->SaveReg();
+	r.Draw();
+	r.m_context->RestoreReg();
+
+	r.m_vertex.head = 0;
+	r.m_vertex.tail = 0;
+	r.m_vertex.next = 0;
+	r.m_index.tail = 0;
+}
@@ -0,0 +1,119 @@
+/*
+ *	Copyright (C) 2007-2009 Gabest
+ *	http://www.gabest.org
+ *
+ *  This Program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2, or (at your option)
+ *  any later version.
+ *
+ *  This Program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with GNU Make; see the file COPYING.  If not, write to
+ *  the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA USA.
+ *  http://www.gnu.org/copyleft/gpl.html
+ *
+ */
+
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "GSState.h"
+
+// Two stage GS: the parse stage runs the GIF packets through a GSState of its own,
+// which turns the draws (drawing environment, vertices, indices, vertex trace) and
+// the local memory accesses (image transfers, moves, CLUT loads, invalidations)
+// into records instead of executing them. The render stage executes the records in
+// order against the renderer, so both can run on threads of their own.
+//
+// The renderer only gets the parse state (registers, GIF paths, pending vertices
+// and transfer) in Sync(), for savestates and local -> host transfers. Settings the
+// parsing depends on are taken from the renderer when the pipeline is created and
+// at every Sync().
+
+class GSPipelineState;
+struct GSPipelineRecord;
+
+class GSPipeline
+{
+	friend class GSPipelineState;
+
+	GSState* m_renderer;
+	GSPipelineState* m_parser;
+
+	std::mutex m_mutex;
+	std::condition_variable m_cv_render; // records were queued
+	std::condition_variable m_cv_parse; // a frame or sync record was executed
+	std::deque<GSPipelineRecord*> m_queue;
+	std::vector<GSPipelineRecord*> m_free;
+	int m_frames; // frame records queued
+	bool m_sync;
+
+	std::thread m_parse_thread;
+	std::atomic<bool> m_parse_quit;
+	std::atomic<bool> m_parse_running;
+
+	GSPipelineRecord* Alloc(int type);
+	void Push(GSPipelineRecord* rec);
+	void Run(GSPipelineRecord& rec);
+	void Draw(GSPipelineRecord& rec);
+
+	static void CopySettings(GSState& dst, const GSState& src);
+	static void CopyParseState(GSState& dst, GSState& src);
+
+public:
+	GSPipeline(GSState* renderer);
+	virtual ~GSPipeline();
+
+	// Only the software renderer was checked against the direct path. The hardware
+	// renderers keep state of their own the records don't carry (texture cache,
+	// readbacks of targets into local memory), they run unpipelined.
+	static bool Supports(GSState* renderer);
+
+	// Runs fn on a thread of its own as the parse stage, fn returns once Stopping()
+	void StartParsing(std::function<void()> fn);
+
+	// Render stage. Stops the parse thread, rendering what it queues meanwhile: it may
+	// be waiting in PostFrame() or Sync() for that, or in Wait().
+	void StopParsing();
+
+	bool Stopping() const { return m_parse_quit.load(std::memory_order_acquire); }
+
+	// Parse stage
+
+	void Transfer(const u8* mem, u32 size);
+	void Reset();
+	void SoftReset(u32 mask);
+	void SetGameCRC(u32 crc, int options);
+
+	// Ends the frame, fn runs on the render stage when it gets there (VSync). Waits
+	// until the render stage is done with the previous frame.
+	void PostFrame(std::function<void()> fn);
+
+	// Runs fn on the render stage with the renderer holding the parse state, waits
+	// for it
+	void Sync(std::function<void()> fn);
+
+	// Waits for something outside the pipeline (the MTVU xgkick). ready must not block
+	// for more than a millisecond or so. Returns false, without ready having returned
+	// true, once the pipeline is stopping: the caller leaves its input to be parsed
+	// again after the stop.
+	bool Wait(const std::function<bool()>& ready);
+
+	// Render stage
+
+	// Executes the queued records until the end of a frame, returns false if the
+	// queue ran dry for a millisecond before that
+	bool Execute();
+};
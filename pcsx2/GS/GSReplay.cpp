@@ -0,0 +1,285 @@
+/*
+ *	Copyright (C) 2007-2009 Gabest
+ *	http://www.gabest.org
+ *
+ *  This Program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2, or (at your option)
+ *  any later version.
+ *
+ *  This Program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with GNU Make; see the file COPYING.  If not, write to
+ *  the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA USA.
+ *  http://www.gnu.org/copyleft/gpl.html
+ *
+ */
+
+#include "GSReplay.h"
+#include "GSFuncs.h"
+#include "options_tools.h"
+
+GSReplay::GSReplay()
+	: m_payload(NULL)
+	, m_fifo(NULL)
+	, m_fifo_size(0)
+	, m_crc(0)
+	, m_pos(0)
+	, m_initialized(false)
+	, m_opened(false)
+{
+	m_regs       = (GSPrivRegSet*)AlignedMalloc(sizeof(GSPrivRegSet), 32);
+	m_start_regs = (GSPrivRegSet*)AlignedMalloc(sizeof(GSPrivRegSet), 32);
+}
+
+GSReplay::~GSReplay()
+{
+	Close();
+
+	if (m_initialized)
+		GSshutdown();
+
+	AlignedFree(m_payload);
+	AlignedFree(m_fifo);
+	AlignedFree(m_regs);
+	AlignedFree(m_start_regs);
+}
+
+bool GSReplay::IsDump(const char* fn)
+{
+	u32 header[2] = {0, 0};
+
+	gzFile gs = gzopen(fn, "rb");
+	if (!gs)
+		return false;
+
+	const int read = gzread(gs, header, sizeof(header));
+	gzclose(gs);
+
+	return read == (int)sizeof(header) && header[0] == GSDUMP_MAGIC;
+}
+
+bool GSReplay::Load(const char* fn)
+{
+	std::vector<u8> buff;
+
+	gzFile gs = gzopen(fn, "rb");
+	if (!gs)
+		return false;
+
+	gzbuffer(gs, 1 << 20);
+
+	for (;;)
+	{
+		const size_t size = buff.size();
+		buff.resize(size + (4 << 20));
+
+		const int read = gzread(gs, &buff[size], 4 << 20);
+		if (read <= 0)
+		{
+			buff.resize(size);
+			break;
+		}
+		buff.resize(size + read);
+	}
+
+	gzclose(gs);
+
+	size_t pos = 0;
+	const size_t end = buff.size();
+
+	auto have = [&](size_t n) { return end - pos >= n; };
+	auto read32 = [&]() { u32 v; memcpy(&v, &buff[pos], 4); pos += 4; return v; };
+
+	if (!have(16))
+		return false;
+
+	if (read32() != GSDUMP_MAGIC || read32() != GSDUMP_VERSION)
+	{
+		log_cb(RETRO_LOG_ERROR, "GS replay: %s is not a supported GS dump\n", fn);
+		return false;
+	}
+
+	m_crc = read32();
+	const u32 state_size = read32();
+
+	if (!have((size_t)state_size + sizeof(GSPrivRegSet)))
+		return false;
+
+	m_state.assign(&buff[pos], &buff[pos] + state_size);
+	pos += state_size;
+
+	memcpy(m_start_regs, &buff[pos], sizeof(GSPrivRegSet));
+	pos += sizeof(GSPrivRegSet);
+
+	// First pass: index the packets and size the payload arena. A truncated
+	// trailing packet (recording interrupted) is dropped.
+	size_t payload_size = 0;
+	std::vector<size_t> sources;
+
+	m_packets.clear();
+
+	while (have(1))
+	{
+		Packet p = {(GSDumpPacketType)buff[pos++], 0, 0, 0};
+		size_t len = 0;
+		bool complete = true;
+
+		switch (p.type)
+		{
+			case GSDUMP_TRANSFER:
+				if ((complete = have(5)))
+				{
+					p.path = buff[pos++] & 3;
+					p.arg  = read32();
+					len    = (size_t)p.arg * 16;
+				}
+				break;
+			case GSDUMP_VSYNC:
+				if ((complete = have(1)))
+					p.arg = buff[pos++];
+				break;
+			case GSDUMP_REGISTERS:
+				len = sizeof(GSPrivRegSet);
+				break;
+			case GSDUMP_READFIFO:
+			case GSDUMP_SOFTRESET:
+			case GSDUMP_GAMECRC:
+				if ((complete = have(4)))
+					p.arg = read32();
+				break;
+			case GSDUMP_RESET:
+				break;
+			default:
+				log_cb(RETRO_LOG_WARN, "GS replay: unknown packet %d, dropping the rest of the dump\n", p.type);
+				complete = false;
+				break;
+		}
+
+		if (!complete || !have(len))
+			break;
+
+		p.offset = payload_size;
+		payload_size += (len + 15) & ~(size_t)15;
+
+		m_packets.push_back(p);
+		sources.push_back(pos);
+
+		pos += len;
+	}
+
+	// Second pass: copy the payloads to 16 bytes aligned storage, so the
+	// GIF handlers see the same alignment as with the real path buffers.
+	AlignedFree(m_payload);
+	m_payload = (u8*)AlignedMalloc(std::max<size_t>(payload_size, 16), 32);
+
+	for (size_t i = 0; i < m_packets.size(); i++)
+	{
+		const Packet& p = m_packets[i];
+		const size_t len = p.type == GSDUMP_TRANSFER ? (size_t)p.arg * 16 : p.type == GSDUMP_REGISTERS ? sizeof(GSPrivRegSet) : 0;
+
+		memcpy(m_payload + p.offset, &buff[sources[i]], len);
+	}
+
+	log_cb(RETRO_LOG_INFO, "GS replay: %s, crc %08X, %u packets\n", fn, m_crc, (unsigned)m_packets.size());
+
+	return true;
+}
+
+void GSReplay::Open()
+{
+	if (m_opened)
+		return;
+
+	if (!m_initialized)
+	{
+		GSinit();
+		m_initialized = true;
+	}
+
+	memcpy(m_regs, m_start_regs, sizeof(GSPrivRegSet));
+
+	if (GSopen2(1, (u8*)m_regs) != 0)
+		return;
+
+	m_opened = true;
+
+	GSsetGameCRC(m_crc, 0);
+
+	Rewind();
+}
+
+void GSReplay::Close()
+{
+	if (!m_opened)
+		return;
+
+	m_opened = false;
+	GSclose();
+}
+
+void GSReplay::Rewind()
+{
+	GSFreezeData fd = {(int)m_state.size(), m_state.data()};
+
+	memcpy(m_regs, m_start_regs, sizeof(GSPrivRegSet));
+	GSfreeze(FREEZE_LOAD, &fd);
+
+	m_pos = 0;
+}
+
+void GSReplay::RunFrame()
+{
+	if (!m_opened)
+		return;
+
+	if (m_pos == m_packets.size())
+		Rewind();
+
+	while (m_pos < m_packets.size())
+	{
+		const Packet& p = m_packets[m_pos++];
+		u8* data = m_payload + p.offset;
+
+		switch (p.type)
+		{
+			case GSDUMP_TRANSFER:
+				switch (p.path)
+				{
+					case 0: s_gs->Transfer<0>(data, p.arg); break;
+					case 1: s_gs->Transfer<1>(data, p.arg); break;
+					case 2: s_gs->Transfer<2>(data, p.arg); break;
+					case 3: s_gs->Transfer<3>(data, p.arg); break;
+				}
+				break;
+			case GSDUMP_VSYNC:
+				GSvsync(p.arg);
+				return;
+			case GSDUMP_READFIFO:
+				if (p.arg > m_fifo_size)
+				{
+					AlignedFree(m_fifo);
+					m_fifo      = (u8*)AlignedMalloc((size_t)p.arg * 16, 32);
+					m_fifo_size = p.arg;
+				}
+				GSInitAndReadFIFO(m_fifo, p.arg);
+				break;
+			case GSDUMP_REGISTERS:
+				memcpy(m_regs, data, sizeof(GSPrivRegSet));
+				break;
+			case GSDUMP_SOFTRESET:
+				GSgifSoftReset(p.arg);
+				break;
+			case GSDUMP_RESET:
+				GSreset();
+				break;
+			case GSDUMP_GAMECRC:
+				GSsetGameCRC(p.arg, 0);
+				break;
+		}
+	}
+}
@@ -0,0 +1,64 @@
+/*
+ *	Copyright (C) 2007-2009 Gabest
+ *	http://www.gabest.org
+ *
+ *  This Program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2, or (at your option)
+ *  any later version.
+ *
+ *  This Program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with GNU Make; see the file COPYING.  If not, write to
+ *  the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA USA.
+ *  http://www.gnu.org/copyleft/gpl.html
+ *
+ */
+
+#pragma once
+
+#include <vector>
+
+#include "GSDump.h"
+
+// Plays a GS dump back into the active renderer, one frame per RunFrame()
+// call and without any EE/IOP/VU emulation. Starts over at the end.
+class GSReplay
+{
+	struct Packet
+	{
+		GSDumpPacketType type;
+		u8 path;
+		u32 arg;       // size in qwords, field, mask or crc
+		size_t offset; // payload in m_payload, 16 bytes aligned
+	};
+
+	std::vector<Packet> m_packets;
+	std::vector<u8> m_state;
+	u8* m_payload;
+	u8* m_fifo;
+	u32 m_fifo_size;
+	GSPrivRegSet* m_regs;
+	GSPrivRegSet* m_start_regs;
+	u32 m_crc;
+	size_t m_pos;
+	bool m_initialized;
+	bool m_opened;
+
+	void Rewind();
+
+public:
+	GSReplay();
+	~GSReplay();
+
+	static bool IsDump(const char* fn);
+
+	bool Load(const char* fn);
+	void Open();
+	void Close();
+	void RunFrame();
+};
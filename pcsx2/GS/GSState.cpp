@@ -28,15 +28,20 @@
 #include "../../pcsx2/GifTypes.h"
 
 GSState::GSState()
-	: m_version(6)
+	: m_gif_packed_map("GSGIFPacked", &m_gif_packed_env)
+	, m_gif_packed_key(~0ull)
+	, m_gif_packed_loop(NULL)
+	, m_version(6)
 	, m_gsc(NULL)
 	, m_skip(0)
 	, m_skip_offset(0)
 	, m_q(1.0f)
 	, m_vt(this)
+	, m_dump(NULL)
 	, m_regs(NULL)
 	, m_crc(0)
 	, m_options(0)
+	, m_pipelined(false)
 {
 	// m_nativeres seems to be a hack. Unfortunately it impacts draw call number which make debug painful in the replayer.
 	// Let's keep it disabled to ease debug.
@@ -61,6 +66,24 @@ GSState::GSState()
 
 	m_v.RGBAQ.Q = 1.0f;
 
+	m_gif_packed_env.v = &m_v;
+	m_gif_packed_env.q = &m_q;
+	m_gif_packed_env.uv_hack_flag = &m_isPackedUV_HackFlag;
+	m_gif_packed_env.state = this;
+
+	#define SetPackedVertexKick(P) \
+		m_gif_packed_env.kick[P][0] = &GSState::GIFPackedVertexKick<P, false>; \
+		m_gif_packed_env.kick[P][1] = &GSState::GIFPackedVertexKick<P, true>; \
+
+	SetPackedVertexKick(GS_POINTLIST);
+	SetPackedVertexKick(GS_LINELIST);
+	SetPackedVertexKick(GS_LINESTRIP);
+	SetPackedVertexKick(GS_TRIANGLELIST);
+	SetPackedVertexKick(GS_TRIANGLESTRIP);
+	SetPackedVertexKick(GS_TRIANGLEFAN);
+	SetPackedVertexKick(GS_SPRITE);
+	SetPackedVertexKick(GS_INVALID);
+
 	GrowVertexBuffer();
 
 	m_sssize = 0;
@@ -123,6 +146,8 @@ GSState::GSState()
 
 GSState::~GSState()
 {
+	delete m_dump;
+
 	if(m_vertex.buff) AlignedFree(m_vertex.buff);
 	if(m_index.buff)  AlignedFree(m_index.buff);
 }
@@ -131,6 +156,9 @@ void GSState::Reset()
 {
 	Flush();
 
+	if(m_dump)
+		m_dump->Reset();
+
 	// BIOS logo not shown cut in half after reset, missing graphics in GoW after first FMV
 	memset(&m_path[0], 0, sizeof(m_path[0]) * ARRAY_SIZE(m_path));
 	memset(&m_v, 0, sizeof(m_v));
@@ -776,7 +804,7 @@ template<int i> void GSState::ApplyTEX0(GIFRegTEX0& TEX0)
 			InvalidateLocalMem(BITBLTBUF, r, true);
 		}
 
-		m_mem.m_clut.Write(m_env.CTXT[i].TEX0, m_env.TEXCLUT);
+		WriteCLUT(m_env.CTXT[i].TEX0, m_env.TEXCLUT);
 	}
 }
 
@@ -1225,9 +1253,7 @@ void GSState::FlushWrite(const int len)
 
 	InvalidateVideoMem(m_env.BITBLTBUF, r);
 
-	const GSLocalMemory::writeImage wi = GSLocalMemory::m_psm[m_env.BITBLTBUF.DPSM].wi;
-
-	(m_mem.*wi)(m_tr.x, m_tr.y, &m_tr.buff[m_tr.start], len, m_env.BITBLTBUF, m_env.TRXPOS, m_env.TRXREG);
+	WriteImage(m_tr.x, m_tr.y, &m_tr.buff[m_tr.start], len, m_env.BITBLTBUF, m_env.TRXPOS, m_env.TRXREG);
 
 	m_tr.start += len;
 }
@@ -1239,7 +1265,7 @@ void GSState::FlushPrim()
 	// Note: perf impact is likely slow enough as WriteTest will likely be false.
 	if (m_clut_load_before_draw)
 		if (m_mem.m_clut.WriteTest(m_context->TEX0, m_env.TEXCLUT))
-			m_mem.m_clut.Write(m_context->TEX0, m_env.TEXCLUT);
+			WriteCLUT(m_context->TEX0, m_env.TEXCLUT);
 
 	GSVertex buff[2];
 
@@ -1351,7 +1377,7 @@ void GSState::Write(const u8* mem, int len)
 
 		InvalidateVideoMem(blit, r);
 
-		(m_mem.*psm.wi)(m_tr.x, m_tr.y, mem, m_tr.total, blit, m_env.TRXPOS, m_env.TRXREG);
+		WriteImage(m_tr.x, m_tr.y, mem, m_tr.total, blit, m_env.TRXPOS, m_env.TRXREG);
 
 		m_tr.start = m_tr.end = m_tr.total;
 	}
@@ -1372,6 +1398,16 @@ void GSState::Write(const u8* mem, int len)
 	m_mem.m_clut.Invalidate();
 }
 
+void GSState::WriteImage(int& tx, int& ty, const u8* src, int len, GIFRegBITBLTBUF& BITBLTBUF, GIFRegTRXPOS& TRXPOS, GIFRegTRXREG& TRXREG)
+{
+	(m_mem.*GSLocalMemory::m_psm[BITBLTBUF.DPSM].wi)(tx, ty, src, len, BITBLTBUF, TRXPOS, TRXREG);
+}
+
+void GSState::WriteCLUT(const GIFRegTEX0& TEX0, const GIFRegTEXCLUT& TEXCLUT)
+{
+	m_mem.m_clut.Write(TEX0, TEXCLUT);
+}
+
 void GSState::InitAndReadFIFO(u8* mem, int len)
 {
 	const int w   = m_env.TRXREG.RRW;
@@ -1380,6 +1416,9 @@ void GSState::InitAndReadFIFO(u8* mem, int len)
 	const int sy  = m_env.TRXPOS.SSAY;
 	const u16 bpp = GSLocalMemory::m_psm[m_env.BITBLTBUF.SPSM].trbpp;
 
+	if(m_dump)
+		m_dump->ReadFIFO(len);
+
 	if(m_tr.Update(w, h, bpp, len))
 	{
 		if(m_tr.x == sx && m_tr.y == sy)
@@ -1394,7 +1433,7 @@ void GSState::InitAndReadFIFO(u8* mem, int len)
 		GSVector4i r(sx, sy, sx + w, sy + h);
 
 		if(m_tr.Update(w, h, bpp, len))
-			m_mem.ReadImageX(m_tr.x, m_tr.y, mem, len, m_env.BITBLTBUF, m_env.TRXPOS, m_env.TRXREG);
+			(m_mem.*GSLocalMemory::m_psm[m_env.BITBLTBUF.SPSM].ri)(m_tr.x, m_tr.y, mem, len, m_env.BITBLTBUF, m_env.TRXPOS, m_env.TRXREG);
 	}
 }
 
@@ -1593,6 +1632,9 @@ void GSState::Move()
 
 void GSState::SoftReset(u32 mask)
 {
+	if(m_dump)
+		m_dump->SoftReset(mask);
+
 	if(mask & 1)
 	{
 		memset(&m_path[0], 0, sizeof(GIFPath));
@@ -1616,6 +1658,10 @@ template<int index> void GSState::Transfer(const u8* mem, u32 size)
 {
 	GIFPath& path = m_path[index];
 
+	// Only what was consumed is recorded, path 1 is handed the rest of VU1 memory.
+	const u8* const start = mem;
+	const u32 total = size;
+
 	while(size > 0)
 	{
 		if(path.nloop == 0)
@@ -1661,7 +1707,11 @@ template<int index> void GSState::Transfer(const u8* mem, u32 size)
 
 				total = path.nloop * path.nreg;
 
-				if(size >= total)
+				if(total == 0 || size == 0)
+				{
+					// the tag or the data ended while getting to the start of the loop, the loops below run at least once
+				}
+				else if(size >= total)
 				{
 					size -= total;
 
@@ -1713,6 +1763,30 @@ template<int index> void GSState::Transfer(const u8* mem, u32 size)
 
 						break;
 
+					case GIFPath::TYPE_VERTEX: // other vertex only formats, compiled for their layout
+
+						{
+							GSGIFPackedSelector sel;
+
+							sel.key = path.vertex_regs;
+							sel.nreg = path.nreg;
+							sel.prim = PRIM->PRIM;
+							sel.auto_flush = m_userhacks_auto_flush;
+							sel.uv_hack = m_userhacks_wildhack;
+
+							if(sel.key != m_gif_packed_key)
+							{
+								m_gif_packed_loop = m_gif_packed_map[sel];
+								m_gif_packed_key = sel.key;
+							}
+
+							m_gif_packed_loop((GIFPackedReg*)mem, path.nloop);
+
+							mem += total * sizeof(GIFPackedReg);
+						}
+
+						break;
+
 					default:
 						break;
 					}
@@ -1808,6 +1882,9 @@ template<int index> void GSState::Transfer(const u8* mem, u32 size)
 			path.nloop = 0;
 		}
 	}
+
+	if(m_dump)
+		m_dump->Transfer(index, start, total - size);
 }
 
 template<class T> static void WriteState(u8*& dst, T* src, size_t len = sizeof(T))
@@ -1907,6 +1984,10 @@ int GSState::Defrost(const GSFreezeData* fd)
 	if(fd->size < m_sssize)
 		return -1;
 
+	// A state load breaks the recorded stream, end the dump here.
+	delete m_dump;
+	m_dump = NULL;
+
 	u8* data = fd->data;
 
 	int version;
@@ -2015,6 +2096,9 @@ int GSState::Defrost(const GSFreezeData* fd)
 
 void GSState::SetGameCRC(u32 crc, int options)
 {
+	if(m_dump)
+		m_dump->SetGameCRC(crc);
+
 	m_crc     = crc;
 	m_options = options;
 	m_game    = CRC::Lookup(m_crc_hack_level != CRCHackLevel::None ? crc : 0);
@@ -2310,6 +2394,12 @@ GS_FORCEINLINE void GSState::VertexKick(u32 skip)
 			FlushPrim();
 }
 
+template<u32 prim, bool auto_flush>
+void GSState::GIFPackedVertexKick(void* state, u32 skip)
+{
+	((GSState*)state)->VertexKick<prim, auto_flush>(skip);
+}
+
 void GSState::GetTextureMinMax(GSVector4i& r, const GIFRegTEX0& TEX0, const GIFRegCLAMP& CLAMP, bool linear)
 {
 	// TODO: some of the +1s can be removed if linear == false
@@ -33,6 +33,8 @@
 #include "Renderers/Common/GSDevice.h"
 #include "GSCrc.h"
 #include "GSAlignedClass.h"
+#include "GSDump.h"
+#include "GSGIFPackedCodeGenerator.h"
 
 struct GSFrameInfo
 {
@@ -49,6 +51,8 @@ typedef bool (*GetSkipCount)(const GSFrameInfo& fi, int& skip);
 
 class GSState : public GSAlignedClass<32>
 {
+	friend class GSPipeline;
+
 	// RESTRICT prevents multiple loads of the same part of the register when accessing its bitfields (the compiler is happy to know that memory writes in-between will not go there)
 
 	typedef void (GSState::*GIFPackedRegHandler)(const GIFPackedReg* RESTRICT r);
@@ -82,6 +86,13 @@ class GSState : public GSAlignedClass<32>
 	template<u32 prim, bool auto_flush> void GIFPackedRegHandlerSTQRGBAXYZ2(const GIFPackedReg* RESTRICT r, u32 size);
 	void GIFPackedRegHandlerNOP(const GIFPackedReg* RESTRICT r, u32 size);
 
+	GSGIFPackedEnvironment m_gif_packed_env;
+	GSCodeGeneratorFunctionMap<GSGIFPackedCodeGenerator, u64, GSGIFPackedLoopPtr> m_gif_packed_map;
+	u64 m_gif_packed_key;
+	GSGIFPackedLoopPtr m_gif_packed_loop;
+
+	template<u32 prim, bool auto_flush> static void GIFPackedVertexKick(void* state, u32 skip);
+
 	template<int i> void ApplyTEX0(GIFRegTEX0& TEX0);
 	void ApplyPRIM(u32 prim);
 
@@ -180,6 +191,10 @@ protected:
 		size_t tail;
 	} m_index;
 
+	// Local memory writes of image transfers and CLUT loads, GSPipeline records them
+	virtual void WriteImage(int& tx, int& ty, const u8* src, int len, GIFRegBITBLTBUF& BITBLTBUF, GIFRegTRXPOS& TRXPOS, GIFRegTRXREG& TRXREG);
+	virtual void WriteCLUT(const GIFRegTEX0& TEX0, const GIFRegTEXCLUT& TEXCLUT);
+
 	void UpdateContext();
 	void UpdateScissor();
 
@@ -194,6 +209,8 @@ protected:
 
 	GSVertexTrace m_vt;
 
+	GSDump* m_dump;
+
 	void GetTextureMinMax(GSVector4i& r, const GIFRegTEX0& TEX0, const GIFRegCLAMP& CLAMP, bool linear);
 	void GetAlphaMinMax();
 	bool TryAlphaTest(u32& fm, u32& zm);
@@ -214,6 +231,7 @@ public:
 	bool m_NTSC_Saturation;
 	bool m_nativeres;
 	int m_mipmap;
+	bool m_pipelined; // GIF packets are parsed by a GSPipeline, this object only renders
 
 public:
 	GSState();
@@ -239,7 +257,7 @@ public:
 	virtual void InvalidateVideoMem(const GIFRegBITBLTBUF& BITBLTBUF, const GSVector4i& r) {}
 	virtual void InvalidateLocalMem(const GIFRegBITBLTBUF& BITBLTBUF, const GSVector4i& r, bool clut = false) {}
 
-	void Move();
+	virtual void Move();
 	void Write(const u8* mem, int len);
 	void InitAndReadFIFO(u8* mem, int len);
 
@@ -24,6 +24,7 @@
 #include "Pcsx2Types.h"
 
 #include "../../GSCodeBuffer.h"
+#include "Utilities/Perf.h"
 
 template<class KEY, class VALUE> class GSFunctionMap
 {
@@ -83,13 +84,14 @@ public:
 template<class CG, class KEY, class VALUE>
 class GSCodeGeneratorFunctionMap : public GSFunctionMap<KEY, VALUE>
 {
+	const char* m_name;
 	void* m_param;
 	std::unordered_map<u64, VALUE> m_cgmap;
 	GSCodeBuffer m_cb;
 
 public:
 	GSCodeGeneratorFunctionMap(const char* name, void* param)
-		: m_param(param) { }
+		: m_name(name), m_param(param) { }
 	~GSCodeGeneratorFunctionMap() { }
 
 	VALUE GetDefaultFunction(KEY key)
@@ -108,6 +110,13 @@ public:
 
 		ret = m_cgmap[key] = (VALUE)cg->getCode();
 
+		if (Perf::enabled)
+		{
+			char symbol[64];
+			snprintf(symbol, sizeof(symbol), "%s 0x%016llx", m_name, (unsigned long long)key);
+			Perf::gs.map((uptr)cg->getCode(), (u32)cg->getSize(), symbol);
+		}
+
 		delete cg;
 
 		return ret;
@@ -19,6 +19,9 @@
  *
  */
 
+#include <ctime>
+#include <vector>
+
 #include "GSRenderer.h"
 #include "options_tools.h"
 
@@ -31,6 +34,8 @@ GSRenderer::GSRenderer()
 	m_interlace   = option_value(INT_PCSX2_OPT_DEINTERLACING_MODE, KeyOptionInt::return_type) % s_interlace_nb;
 	m_fxaa        = option_value(INT_PCSX2_OPT_FXAA, KeyOptionInt::return_type);
 	m_dithering   = option_value(INT_PCSX2_OPT_DITHERING, KeyOptionInt::return_type); // 0 off, 1 auto, 2 auto no scale
+	m_dump_option = option_value(INT_PCSX2_OPT_GS_DUMP_FRAMES, KeyOptionInt::return_type);
+	m_dump_frames = m_dump_option;
 }
 
 GSRenderer::~GSRenderer()
@@ -236,10 +241,61 @@ GSVector2i GSRenderer::GetInternalResolution()
 	return m_real_size;
 }
 
+void GSRenderer::BeginDump()
+{
+	if (m_pipelined)
+	{
+		log_cb(RETRO_LOG_WARN, "GS dump: not available while the GS pipeline is enabled\n");
+		return;
+	}
+
+	GSFreezeData fd = {0, NULL};
+	Freeze(&fd, true);
+
+	std::vector<u8> state(fd.size);
+	fd.data = state.data();
+	if (Freeze(&fd, false) != 0)
+		return;
+
+	char stamp[32];
+	const time_t now = time(NULL);
+	strftime(stamp, sizeof(stamp), "%Y%m%d-%H%M%S", localtime(&now));
+
+	char name[64];
+	snprintf(name, sizeof(name), "gsdump_%08X_%s.gs", m_crc, stamp);
+
+	const std::string fn = retroarch_save_path + "/" + name;
+
+	m_dump = new GSDump(fn, m_crc, fd, m_regs, m_dump_frames);
+	if (!m_dump->IsOpen())
+	{
+		log_cb(RETRO_LOG_ERROR, "GS dump: could not create %s\n", fn.c_str());
+		delete m_dump;
+		m_dump = NULL;
+		return;
+	}
+
+	log_cb(RETRO_LOG_INFO, "GS dump: recording %d frames to %s\n", m_dump_frames, fn.c_str());
+}
+
 void GSRenderer::VSync(int field)
 {
+	if (m_dump && m_dump->VSync(field, m_regs))
+	{
+		log_cb(RETRO_LOG_INFO, "GS dump: done\n");
+		delete m_dump;
+		m_dump = NULL;
+	}
+
 	Flush();
 
+	// Start recording from a flushed state, the next packets are replayed on top of it.
+	if (m_dump_frames > 0 && !m_dump)
+	{
+		BeginDump();
+		m_dump_frames = 0;
+	}
+
 	if(!Merge(field ? 1 : 0))
 		return;
 
@@ -256,4 +312,11 @@ void GSRenderer::PurgePool()
 
 void GSRenderer::UpdateRendererOptions()
 {
+	// Any change of the frame count (re)arms the recorder.
+	const int frames = option_value(INT_PCSX2_OPT_GS_DUMP_FRAMES, KeyOptionInt::return_type);
+	if (frames != m_dump_option)
+	{
+		m_dump_option = frames;
+		m_dump_frames = frames;
+	}
 }
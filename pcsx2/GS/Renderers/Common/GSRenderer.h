@@ -25,7 +25,11 @@
 
 class GSRenderer : public GSState
 {
+	int m_dump_option;
+	int m_dump_frames;
+
 	bool Merge(int field);
+	void BeginDump();
 
 protected:
 	int m_dithering;
@@ -24,13 +24,26 @@
 #include "GSVertexTrace.h"
 #include "../../GSUtil.h"
 #include "../../GSState.h"
+#include "../../xbyak/xbyak_util.h"
 #include "options_tools.h"
 
+#include <immintrin.h>
+
+// The AVX2 kernels are built whatever the build targets and only run when the CPU
+// has AVX2. GCC and clang need the instruction set on each function using it.
+#if defined(__GNUC__)
+#define GS_TARGET_AVX2 __attribute__((target("avx2")))
+#else
+#define GS_TARGET_AVX2
+#endif
+
 GSVector4 GSVertexTrace::s_minmax;
+bool GSVertexTrace::s_avx2 = false;
 
 void GSVertexTrace::InitVectors()
 {
 	s_minmax = GSVector4(FLT_MAX, -FLT_MAX);
+	s_avx2 = Xbyak::util::Cpu().has(Xbyak::util::Cpu::tAVX2);
 }
 
 GSVertexTrace::GSVertexTrace(const GSState* state)
@@ -39,8 +52,15 @@ GSVertexTrace::GSVertexTrace(const GSState* state)
 	m_force_filter = static_cast<BiFiltering>(option_value(INT_PCSX2_OPT_TEXTURE_FILTERING, KeyOptionInt::return_type));
 	memset(&m_alpha, 0, sizeof(m_alpha));
 
+	SelectKernels(s_avx2);
+}
+
+void GSVertexTrace::SelectKernels(bool avx2)
+{
+	m_avx2 = avx2;
+
 	#define InitUpdate3(P, IIP, TME, FST, COLOR) \
-		m_fmm[COLOR][FST][TME][IIP][P] = &GSVertexTrace::FindMinMax<P, IIP, TME, FST, COLOR>; \
+		m_fmm[COLOR][FST][TME][IIP][P] = avx2 ? &GSVertexTrace::FindMinMaxAVX2<P, IIP, TME, FST, COLOR> : &GSVertexTrace::FindMinMax<P, IIP, TME, FST, COLOR>; \
 
 	#define InitUpdate2(P, IIP, TME) \
 		InitUpdate3(P, IIP, TME, 0, 0) \
@@ -148,8 +168,6 @@ void GSVertexTrace::Update(const void* vertex, const u32* index, int v_count, in
 template<GS_PRIM_CLASS primclass, u32 iip, u32 tme, u32 fst, u32 color>
 void GSVertexTrace::FindMinMax(const void* vertex, const u32* index, int count)
 {
-	const GSDrawingContext* context = m_state->m_context;
-
 	int n = 1;
 
 	switch(primclass)
@@ -165,27 +183,40 @@ void GSVertexTrace::FindMinMax(const void* vertex, const u32* index, int count)
 			break;
 	}
 
-	GSVector4 tmin  = s_minmax.xxxx();
-	GSVector4 tmax  = s_minmax.yyyy();
-	GSVector4i cmin = GSVector4i::xffffffff();
-	GSVector4i cmax = GSVector4i::zero();
-
+	// Consecutive pairs of vertices go to alternate ranges, so that the min/max of one
+	// pair doesn't wait for those of the previous one
+	struct Range
+	{
+		GSVector4 tmin, tmax;
+		GSVector4i cmin, cmax;
 #if _M_SSE >= 0x401
-
-	GSVector4i pmin = GSVector4i::xffffffff();
-	GSVector4i pmax = GSVector4i::zero();
-
+		GSVector4i pmin, pmax;
 #else
+		GSVector4 pmin, pmax;
+#endif
+	};
 
-	GSVector4 pmin = s_minmax.xxxx();
-	GSVector4 pmax = s_minmax.yyyy();
+	Range r[2];
 
+	for (Range& ri : r)
+	{
+		ri.tmin = s_minmax.xxxx();
+		ri.tmax = s_minmax.yyyy();
+		ri.cmin = GSVector4i::xffffffff();
+		ri.cmax = GSVector4i::zero();
+#if _M_SSE >= 0x401
+		ri.pmin = GSVector4i::xffffffff();
+		ri.pmax = GSVector4i::zero();
+#else
+		ri.pmin = s_minmax.xxxx();
+		ri.pmax = s_minmax.yyyy();
 #endif
+	}
 
 	const GSVertex* RESTRICT v = (GSVertex*)vertex;
 
 	// Process 2 vertices at a time for increased efficiency
-	auto processVertices = [&](const GSVertex& v0, const GSVertex& v1, bool finalVertex)	
+	auto processVertices = [&](Range& acc, const GSVertex& v0, const GSVertex& v1, bool finalVertex)
 	{
 		if(color)
 		{
@@ -193,15 +224,15 @@ void GSVertexTrace::FindMinMax(const void* vertex, const u32* index, int count)
 			if (iip || finalVertex)
 			{
 				GSVector4i c0 = GSVector4i::load(v0.RGBAQ.U32[0]);
-				cmin          = cmin.min_u8(c0.min_u8(c1));
-				cmax          = cmax.max_u8(c0.max_u8(c1));
+				acc.cmin      = acc.cmin.min_u8(c0.min_u8(c1));
+				acc.cmax      = acc.cmax.max_u8(c0.max_u8(c1));
 			}
 			else if (n == 2)
 			{
 				// For even n, we process vertex 1 and 2 of the same prim
 				// (For odd n, we process one vertex from each of two prims)
-				cmin         = cmin.min_u8(c1);
-				cmax         = cmax.max_u8(c1);
+				acc.cmin     = acc.cmin.min_u8(c1);
+				acc.cmax     = acc.cmax.max_u8(c1);
 			}
 		}
 
@@ -227,8 +258,8 @@ void GSVertexTrace::FindMinMax(const void* vertex, const u32* index, int count)
 				stq0       = st.xyww(primclass == GS_SPRITE_CLASS ? stq1 : stq0);
 				stq1       = st.zwww(stq1);
 
-				tmin       = tmin.min(stq0.min(stq1));
-				tmax       = tmax.max(stq0.max(stq1));
+				acc.tmin   = acc.tmin.min(stq0.min(stq1));
+				acc.tmax   = acc.tmax.max(stq0.max(stq1));
 			}
 			else
 			{
@@ -236,8 +267,8 @@ void GSVertexTrace::FindMinMax(const void* vertex, const u32* index, int count)
 				GSVector4i uv1(v1.m[1]);
 				GSVector4 st0 = GSVector4(uv0.uph16()).xyxy();
 				GSVector4 st1 = GSVector4(uv1.uph16()).xyxy();
-				tmin          = tmin.min(st0.min(st1));
-				tmax          = tmax.max(st0.max(st1));
+				acc.tmin      = acc.tmin.min(st0.min(st1));
+				acc.tmax      = acc.tmax.max(st0.max(st1));
 			}
 		}
 
@@ -250,36 +281,48 @@ void GSVertexTrace::FindMinMax(const void* vertex, const u32* index, int count)
 #if _M_SSE >= 0x401
 		GSVector4i p0  = xy0.blend16<0xf0>(z0.uph32(primclass == GS_SPRITE_CLASS ? xyzf1 : xyzf0));
 		GSVector4i p1  = xy1.blend16<0xf0>(z1.uph32(xyzf1));
-		pmin           = pmin.min_u32(p0.min_u32(p1));
-		pmax           = pmax.max_u32(p0.max_u32(p1));
+		acc.pmin       = acc.pmin.min_u32(p0.min_u32(p1));
+		acc.pmax       = acc.pmax.max_u32(p0.max_u32(p1));
 #else
 		GSVector4 p0   = GSVector4(xy0.upl64(z0.srl32(1).upl32(xyzf0.wwww())));
 		GSVector4 p1   = GSVector4(xy1.upl64(z1.srl32(1).upl32(xyzf1.wwww())));
 
-		pmin           = pmin.min(p0.min(p1));
-		pmax           = pmax.max(p0.max(p1));
+		acc.pmin       = acc.pmin.min(p0.min(p1));
+		acc.pmax       = acc.pmax.max(p0.max(p1));
 #endif
 	};
 
 	if (n == 2)
 	{
-		for (int i = 0; i < count; i += 2)
+		int i = 0;
+		for (; i + 4 <= count; i += 4) // 2 prims per iteration
 		{
-			processVertices(v[index[i + 0]], v[index[i + 1]], false);
+			processVertices(r[0], v[index[i + 0]], v[index[i + 1]], false);
+			processVertices(r[1], v[index[i + 2]], v[index[i + 3]], false);
+		}
+		if (i < count)
+		{
+			processVertices(r[0], v[index[i + 0]], v[index[i + 1]], false);
 		}
 	}
 	else if (iip || n == 1) // iip means final and non-final vertexes are treated the same
 	{
 		int i = 0;
-		for (; i < (count - 1); i += 2) // 2x loop unroll
+		for (; i + 4 <= count; i += 4) // 4x loop unroll
 		{
-			processVertices(v[index[i + 0]], v[index[i + 1]], true);
+			processVertices(r[0], v[index[i + 0]], v[index[i + 1]], true);
+			processVertices(r[1], v[index[i + 2]], v[index[i + 3]], true);
+		}
+		if (i + 1 < count)
+		{
+			processVertices(r[0], v[index[i + 0]], v[index[i + 1]], true);
+			i += 2;
 		}
 		if (count & 1)
 		{
 			// Compiler optimizations go!
 			// (And if they don't, it's only one vertex out of many)
-			processVertices(v[index[i]], v[index[i]], true);
+			processVertices(r[1], v[index[i]], v[index[i]], true);
 		}
 	}
 	else if (n == 3)
@@ -287,19 +330,207 @@ void GSVertexTrace::FindMinMax(const void* vertex, const u32* index, int count)
 		int i = 0;
 		for (; i < (count - 3); i += 6)
 		{
-			processVertices(v[index[i + 0]], v[index[i + 3]], false);
-			processVertices(v[index[i + 1]], v[index[i + 4]], false);
-			processVertices(v[index[i + 2]], v[index[i + 5]], true);
+			processVertices(r[0], v[index[i + 0]], v[index[i + 3]], false);
+			processVertices(r[1], v[index[i + 1]], v[index[i + 4]], false);
+			processVertices(r[0], v[index[i + 2]], v[index[i + 5]], true);
 		}
 		if (count & 1)
 		{
-			processVertices(v[index[i + 0]], v[index[i + 1]], false);
+			processVertices(r[1], v[index[i + 0]], v[index[i + 1]], false);
 			// Compiler optimizations go!
 			// (And if they don't, it's only one vertex out of many)
-			processVertices(v[index[i + 2]], v[index[i + 2]], true);
+			processVertices(r[0], v[index[i + 2]], v[index[i + 2]], true);
 		}
 	}
 
+	GSVector4 tmin  = r[0].tmin.min(r[1].tmin);
+	GSVector4 tmax  = r[0].tmax.max(r[1].tmax);
+	GSVector4i cmin = r[0].cmin.min_u8(r[1].cmin);
+	GSVector4i cmax = r[0].cmax.max_u8(r[1].cmax);
+
+#if _M_SSE >= 0x401
+
+	GSVector4i pmin = r[0].pmin.min_u32(r[1].pmin);
+	GSVector4i pmax = r[0].pmax.max_u32(r[1].pmax);
+
+#else
+
+	GSVector4 pmin = r[0].pmin.min(r[1].pmin);
+	GSVector4 pmax = r[0].pmax.max(r[1].pmax);
+
+#endif
+
+	SetMinMax<tme, fst, color>(tmin, tmax, cmin, cmax, pmin, pmax);
+}
+
+// AVX2: both vertices of a pair go through one 256-bit register, the first in the low
+// lane and the second in the high lane. Consecutive pairs go to alternate ranges like
+// above, the lanes and ranges are folded after the loop.
+
+struct GSVertexTraceRangeAVX2
+{
+	__m256 tmin, tmax;
+	__m256i cmin, cmax, pmin, pmax;
+};
+
+template<GS_PRIM_CLASS primclass, u32 iip, u32 tme, u32 fst, u32 color>
+GS_TARGET_AVX2 static __forceinline void ProcessVerticesAVX2(GSVertexTraceRangeAVX2& acc, const GSVertex& v0, const GSVertex& v1, bool finalVertex)
+{
+	const int n = primclass == GS_LINE_CLASS || primclass == GS_SPRITE_CLASS ? 2 : primclass == GS_TRIANGLE_CLASS ? 3 : 1;
+
+	const __m256i stq  = _mm256_inserti128_si256(_mm256_castsi128_si256(v0.m[0]), v1.m[0], 1);
+	const __m256i xyzf = _mm256_inserti128_si256(_mm256_castsi128_si256(v0.m[1]), v1.m[1], 1);
+
+	if(color)
+	{
+		// RGBA is the z element of the lanes, the others are dropped when folding
+		if(iip || finalVertex)
+		{
+			acc.cmin = _mm256_min_epu8(acc.cmin, stq);
+			acc.cmax = _mm256_max_epu8(acc.cmax, stq);
+		}
+		else if(n == 2)
+		{
+			const __m256i c1 = _mm256_permute2x128_si256(stq, stq, 0x11);
+			acc.cmin = _mm256_min_epu8(acc.cmin, c1);
+			acc.cmax = _mm256_max_epu8(acc.cmax, c1);
+		}
+	}
+
+	if(tme)
+	{
+		__m256 st;
+
+		if(!fst)
+		{
+			__m256 q = _mm256_permute_ps(_mm256_castsi256_ps(stq), _MM_SHUFFLE(3, 3, 3, 3));
+			// Sprites always have indices == vertices, so we don't have to look at the index table here
+			if(primclass == GS_SPRITE_CLASS)
+				q = _mm256_permute2f128_ps(q, q, 0x11);
+
+			// [S * Q, T * Q, Q, Q], the z (rgba) field is left out of the multiplication since it's often denormal
+			st = _mm256_blend_ps(_mm256_mul_ps(_mm256_permute_ps(_mm256_castsi256_ps(stq), _MM_SHUFFLE(1, 0, 1, 0)), q), q, 0xcc);
+		}
+		else
+		{
+			st = _mm256_permute_ps(_mm256_cvtepi32_ps(_mm256_unpackhi_epi16(xyzf, _mm256_setzero_si256())), _MM_SHUFFLE(1, 0, 1, 0));
+		}
+
+		acc.tmin = _mm256_min_ps(acc.tmin, st);
+		acc.tmax = _mm256_max_ps(acc.tmax, st);
+	}
+
+	// [X, Y, Z, FOG], sprites take the fog of their second vertex
+	const __m256i xy = _mm256_unpacklo_epi16(xyzf, _mm256_setzero_si256());
+	const __m256i zf = _mm256_unpackhi_epi32(_mm256_shuffle_epi32(xyzf, _MM_SHUFFLE(1, 1, 1, 1)), primclass == GS_SPRITE_CLASS ? _mm256_permute2x128_si256(xyzf, xyzf, 0x11) : xyzf);
+	const __m256i p = _mm256_blend_epi16(xy, zf, 0xf0);
+
+	acc.pmin = _mm256_min_epu32(acc.pmin, p);
+	acc.pmax = _mm256_max_epu32(acc.pmax, p);
+}
+
+template<GS_PRIM_CLASS primclass, u32 iip, u32 tme, u32 fst, u32 color>
+GS_TARGET_AVX2 static void TraceAVX2(const GSVertex* RESTRICT v, const u32* index, int count, const GSVector4& minmax,
+	GSVector4& tmin, GSVector4& tmax, GSVector4i& cmin, GSVector4i& cmax, GSVector4i& pmin, GSVector4i& pmax)
+{
+	const int n = primclass == GS_LINE_CLASS || primclass == GS_SPRITE_CLASS ? 2 : primclass == GS_TRIANGLE_CLASS ? 3 : 1;
+
+	GSVertexTraceRangeAVX2 r[2];
+
+	for(GSVertexTraceRangeAVX2& ri : r)
+	{
+		ri.tmin = _mm256_set1_ps(minmax.x);
+		ri.tmax = _mm256_set1_ps(minmax.y);
+		ri.cmin = _mm256_set1_epi32(-1);
+		ri.cmax = _mm256_setzero_si256();
+		ri.pmin = _mm256_set1_epi32(-1);
+		ri.pmax = _mm256_setzero_si256();
+	}
+
+	#define PROCESS(acc, a, b, final) ProcessVerticesAVX2<primclass, iip, tme, fst, color>(r[acc], v[index[a]], v[index[b]], final)
+
+	if(n == 2)
+	{
+		int i = 0;
+		for(; i + 4 <= count; i += 4)
+		{
+			PROCESS(0, i + 0, i + 1, false);
+			PROCESS(1, i + 2, i + 3, false);
+		}
+		if(i < count)
+		{
+			PROCESS(0, i + 0, i + 1, false);
+		}
+	}
+	else if(iip || n == 1)
+	{
+		int i = 0;
+		for(; i + 4 <= count; i += 4)
+		{
+			PROCESS(0, i + 0, i + 1, true);
+			PROCESS(1, i + 2, i + 3, true);
+		}
+		if(i + 1 < count)
+		{
+			PROCESS(0, i + 0, i + 1, true);
+			i += 2;
+		}
+		if(count & 1)
+		{
+			PROCESS(1, i, i, true);
+		}
+	}
+	else if(n == 3)
+	{
+		int i = 0;
+		for(; i < (count - 3); i += 6)
+		{
+			PROCESS(0, i + 0, i + 3, false);
+			PROCESS(1, i + 1, i + 4, false);
+			PROCESS(0, i + 2, i + 5, true);
+		}
+		if(count & 1)
+		{
+			PROCESS(1, i + 0, i + 1, false);
+			PROCESS(0, i + 2, i + 2, true);
+		}
+	}
+
+	#undef PROCESS
+
+	const __m256 tmin8 = _mm256_min_ps(r[0].tmin, r[1].tmin);
+	const __m256 tmax8 = _mm256_max_ps(r[0].tmax, r[1].tmax);
+	const __m256i cmin8 = _mm256_min_epu8(r[0].cmin, r[1].cmin);
+	const __m256i cmax8 = _mm256_max_epu8(r[0].cmax, r[1].cmax);
+	const __m256i pmin8 = _mm256_min_epu32(r[0].pmin, r[1].pmin);
+	const __m256i pmax8 = _mm256_max_epu32(r[0].pmax, r[1].pmax);
+
+	tmin = GSVector4(_mm_min_ps(_mm256_castps256_ps128(tmin8), _mm256_extractf128_ps(tmin8, 1)));
+	tmax = GSVector4(_mm_max_ps(_mm256_castps256_ps128(tmax8), _mm256_extractf128_ps(tmax8, 1)));
+	cmin = GSVector4i(_mm_shuffle_epi32(_mm_min_epu8(_mm256_castsi256_si128(cmin8), _mm256_extracti128_si256(cmin8, 1)), _MM_SHUFFLE(2, 2, 2, 2)));
+	cmax = GSVector4i(_mm_shuffle_epi32(_mm_max_epu8(_mm256_castsi256_si128(cmax8), _mm256_extracti128_si256(cmax8, 1)), _MM_SHUFFLE(2, 2, 2, 2)));
+	pmin = GSVector4i(_mm_min_epu32(_mm256_castsi256_si128(pmin8), _mm256_extracti128_si256(pmin8, 1)));
+	pmax = GSVector4i(_mm_max_epu32(_mm256_castsi256_si128(pmax8), _mm256_extracti128_si256(pmax8, 1)));
+
+	_mm256_zeroupper();
+}
+
+template<GS_PRIM_CLASS primclass, u32 iip, u32 tme, u32 fst, u32 color>
+void GSVertexTrace::FindMinMaxAVX2(const void* vertex, const u32* index, int count)
+{
+	GSVector4 tmin, tmax;
+	GSVector4i cmin, cmax, pmin, pmax;
+
+	TraceAVX2<primclass, iip, tme, fst, color>((const GSVertex*)vertex, index, count, s_minmax, tmin, tmax, cmin, cmax, pmin, pmax);
+
+	SetMinMax<tme, fst, color>(tmin, tmax, cmin, cmax, pmin, pmax);
+}
+
+template<u32 tme, u32 fst, u32 color, class P>
+void GSVertexTrace::SetMinMax(const GSVector4& tmin, const GSVector4& tmax, const GSVector4i& cmin, const GSVector4i& cmax, const P& pmin, const P& pmax)
+{
+	const GSDrawingContext* context = m_state->m_context;
+
 	GSVector4 o(context->XYOFFSET);
 	GSVector4 s(1.0f / 16, 1.0f / 16, 2.0f, 1.0f);
 
@@ -307,8 +538,8 @@ void GSVertexTrace::FindMinMax(const void* vertex, const u32* index, int count)
 	m_max.p = (GSVector4(pmax) - o) * s;
 
 	// Fix signed int conversion
-	m_min.p = m_min.p.insert32<0, 2>(GSVector4::load((float)(u32)pmin.extract32<2>()));
-	m_max.p = m_max.p.insert32<0, 2>(GSVector4::load((float)(u32)pmax.extract32<2>()));
+	m_min.p = m_min.p.insert32<0, 2>(GSVector4::load((float)(u32)pmin.template extract32<2>()));
+	m_max.p = m_max.p.insert32<0, 2>(GSVector4::load((float)(u32)pmax.template extract32<2>()));
 
 	if(tme)
 	{
@@ -338,6 +569,79 @@ void GSVertexTrace::FindMinMax(const void* vertex, const u32* index, int count)
 	}
 }
 
+// Ands (all_ones) or ors the Z of the vertices into z
+template<bool all_ones>
+static u32 AccumulateDepth(const GSVertex* RESTRICT v, int count, u32 z)
+{
+	int i = 0;
+
+	// The second half of four vertices per iteration, in two accumulators, Z is its y element
+	GSVector4i a = GSVector4i::load<true>(&v[0].m[1]);
+	GSVector4i b = a;
+
+	for (; i + 4 <= count; i += 4)
+	{
+		if (all_ones)
+		{
+			a &= GSVector4i::load<true>(&v[i + 0].m[1]) & GSVector4i::load<true>(&v[i + 1].m[1]);
+			b &= GSVector4i::load<true>(&v[i + 2].m[1]) & GSVector4i::load<true>(&v[i + 3].m[1]);
+		}
+		else
+		{
+			a |= GSVector4i::load<true>(&v[i + 0].m[1]) | GSVector4i::load<true>(&v[i + 1].m[1]);
+			b |= GSVector4i::load<true>(&v[i + 2].m[1]) | GSVector4i::load<true>(&v[i + 3].m[1]);
+		}
+	}
+
+	u32 zv = (u32)(all_ones ? a & b : a | b).extract32<1>();
+	z = all_ones ? z & zv : z | zv;
+
+	for (; i < count; i++)
+		z = all_ones ? z & v[i].XYZ.Z : z | v[i].XYZ.Z;
+
+	return z;
+}
+
+// Same with one vertex per 256-bit register, Z is the y element of the high lane
+template<bool all_ones>
+GS_TARGET_AVX2 static u32 AccumulateDepthAVX2(const GSVertex* RESTRICT v, int count, u32 z)
+{
+	int i = 0;
+
+	__m256i a = _mm256_load_si256((const __m256i*)&v[0]);
+	__m256i b = a;
+
+	for (; i + 4 <= count; i += 4)
+	{
+		const __m256i v0 = _mm256_load_si256((const __m256i*)&v[i + 0]);
+		const __m256i v1 = _mm256_load_si256((const __m256i*)&v[i + 1]);
+		const __m256i v2 = _mm256_load_si256((const __m256i*)&v[i + 2]);
+		const __m256i v3 = _mm256_load_si256((const __m256i*)&v[i + 3]);
+
+		if (all_ones)
+		{
+			a = _mm256_and_si256(a, _mm256_and_si256(v0, v1));
+			b = _mm256_and_si256(b, _mm256_and_si256(v2, v3));
+		}
+		else
+		{
+			a = _mm256_or_si256(a, _mm256_or_si256(v0, v1));
+			b = _mm256_or_si256(b, _mm256_or_si256(v2, v3));
+		}
+	}
+
+	const __m256i ab = all_ones ? _mm256_and_si256(a, b) : _mm256_or_si256(a, b);
+	const u32 zv = (u32)_mm256_extract_epi32(ab, 5);
+	z = all_ones ? z & zv : z | zv;
+
+	_mm256_zeroupper();
+
+	for (; i < count; i++)
+		z = all_ones ? z & v[i].XYZ.Z : z | v[i].XYZ.Z;
+
+	return z;
+}
+
 void GSVertexTrace::CorrectDepthTrace(const void* vertex, int count)
 {
 	// FindMinMax isn't accurate for the depth value. Lsb bit is always 0.
@@ -345,8 +649,6 @@ void GSVertexTrace::CorrectDepthTrace(const void* vertex, int count)
 	// and will update m_min/m_max/m_eq accordingly
 	//
 	// Really impacts Xenosaga3
-	//
-	// Hopefully function is barely called so AVX/SSE will be useless here
 	const GSVertex* RESTRICT v = (GSVertex*)vertex;
 	u32 z = v[0].XYZ.Z;
 
@@ -354,14 +656,12 @@ void GSVertexTrace::CorrectDepthTrace(const void* vertex, int count)
 	if (z & 1)
 	{
 		// Check that first bit is always 1
-		for (int i = 0; i < count; i++)
-			z &= v[i].XYZ.Z;
+		z = m_avx2 ? AccumulateDepthAVX2<true>(v, count, z) : AccumulateDepth<true>(v, count, z);
 	}
 	else
 	{
 		// Check that first bit is always 0
-		for (int i = 0; i < count; i++)
-			z |= v[i].XYZ.Z;
+		z = m_avx2 ? AccumulateDepthAVX2<false>(v, count, z) : AccumulateDepth<false>(v, count, z);
 	}
 
 	if (z == v[0].XYZ.Z)
@@ -43,14 +43,22 @@ protected:
 	const GSState* m_state;
 
 	static GSVector4 s_minmax;
+	static bool s_avx2;
 
 	typedef void (GSVertexTrace::*FindMinMaxPtr)(const void* vertex, const u32* index, int count);
 
 	FindMinMaxPtr m_fmm[2][2][2][2][4];
+	bool m_avx2;
 
 	template<GS_PRIM_CLASS primclass, u32 iip, u32 tme, u32 fst, u32 color>
 	void FindMinMax(const void* vertex, const u32* index, int count);
 
+	template<GS_PRIM_CLASS primclass, u32 iip, u32 tme, u32 fst, u32 color>
+	void FindMinMaxAVX2(const void* vertex, const u32* index, int count);
+
+	template<u32 tme, u32 fst, u32 color, class P>
+	void SetMinMax(const GSVector4& tmin, const GSVector4& tmax, const GSVector4i& cmin, const GSVector4i& cmax, const P& pmin, const P& pmax);
+
 public:
 	GS_PRIM_CLASS m_primclass;
 
@@ -78,6 +86,10 @@ public:
 	GSVertexTrace(const GSState* state);
 	virtual ~GSVertexTrace() {}
 
+	// The AVX2 kernels are picked when the CPU has AVX2, whatever the build targets
+	static bool HasAVX2() {return s_avx2;}
+	void SelectKernels(bool avx2);
+
 	void Update(const void* vertex, const u32* index, int v_count, int i_count, GS_PRIM_CLASS primclass);
 
 	void CorrectDepthTrace(const void* vertex, int count);
@@ -51,6 +51,8 @@ GSRendererHW::GSRendererHW(GSTextureCache* tc)
 
 void GSRendererHW::UpdateRendererOptions()
 {
+	GSRenderer::UpdateRendererOptions();
+
 	m_large_framebuffer                             = !option_value(BOOL_PCSX2_OPT_CONSERVATIVE_BUFFER, KeyOptionBool::return_type);
 	m_mipmap                                        = option_value(INT_PCSX2_OPT_MIPMAPPING, KeyOptionInt::return_type);
 	m_accurate_date                                 = option_value(BOOL_PCSX2_OPT_ACCURATE_DATE, KeyOptionBool::return_type);
@@ -19,6 +19,8 @@
  *
  */
 
+#include <chrono>
+
 #include "Pcsx2Types.h"
 
 #include "GSTextureCache.h"
@@ -28,6 +30,11 @@
 
 bool GSTextureCache::m_disable_partial_invalidation = false;
 bool GSTextureCache::m_wrap_gs_mem = false;
+std::unique_ptr<GSTextureCache::Decoder> GSTextureCache::m_decoder;
+std::atomic<u64> GSTextureCache::m_decoded_bytes(0);
+std::atomic<u64> GSTextureCache::m_decode_ns(0);
+std::atomic<u64> GSTextureCache::m_hash_hits(0);
+std::atomic<u64> GSTextureCache::m_hash_misses(0);
 
 GSTextureCache::GSTextureCache(GSRenderer* r)
 	: m_renderer(r)
@@ -41,6 +48,7 @@ GSTextureCache::GSTextureCache(GSRenderer* r)
 	m_texture_inside_rt            = false;
 	m_wrap_gs_mem                  = false;
 	m_paltex                       = option_palette_conversion;
+	m_texture_hash_cache           = option_texture_hash_cache;
 	m_crc_hack_level               = GSUtil::GetRecommendedCRCHackLevel(GetCurrentRendererType());
 
 	// In theory 4MB is enough but 9MB is safer for overflow (8MB
@@ -48,6 +56,8 @@ GSTextureCache::GSTextureCache(GSRenderer* r)
 	// Test: onimusha 3 PAL 60Hz
 	m_temp = (u8*)AlignedMalloc(9 * 1024 * 1024, 32);
 
+	m_decoder.reset(new Decoder(theApp.GetConfigI("extrathreads_texture")));
+
 	m_texture_inside_rt_cache.reserve(m_texture_inside_rt_cache_size);
 }
 
@@ -58,6 +68,8 @@ GSTextureCache::~GSTextureCache()
 	m_texture_inside_rt_cache.clear();
 
 	AlignedFree(m_temp);
+
+	m_decoder.reset();
 }
 
 void GSTextureCache::RemovePartial()
@@ -83,6 +95,8 @@ void GSTextureCache::RemoveAll()
 		m_dst[type].clear();
 	}
 
+	ClearHashCache();
+
 	m_palette_map.Clear();
 }
 
@@ -700,7 +714,9 @@ void GSTextureCache::InvalidateVideoMem(GSOffset* off, const GSVector4i& rect, b
 
 				if(!s->m_target)
 				{
-					if(m_disable_partial_invalidation && s->m_repeating)
+					// A shared texture can't be partially updated, the other
+					// sources still use the old texels
+					if((m_disable_partial_invalidation && s->m_repeating) || s->m_hash_entry)
 					{
 						m_src.RemoveAt(s);
 					}
@@ -1008,6 +1024,21 @@ void GSTextureCache::IncAge()
 
 	m_src.m_used = false;
 
+	// Unused textures stay in the hash cache for a while, in case the same
+	// texels are uploaded again. Incomplete ones can't be shared at all.
+	for(auto i = m_hash_cache.begin(); i != m_hash_cache.end(); )
+	{
+		HashCacheEntry& e = i->second;
+
+		if(e.refs == 0 && (!e.complete || ++e.age > 30))
+		{
+			m_renderer->m_dev->Recycle(e.texture);
+			i = m_hash_cache.erase(i);
+		}
+		else
+			++i;
+	}
+
 	// Clearing of Rendertargets causes flickering in many scene transitions.
 	// Sigh, this seems to be used to invalidate surfaces. So set a huge maxage to avoid flicker,
 	// but still invalidate surfaces. (Disgaea 2 fmv when booting the game through the BIOS)
@@ -1333,16 +1364,22 @@ GSTextureCache::Source* GSTextureCache::CreateSource(const GIFRegTEX0& TEX0, con
 	}
 	else
 	{
-		if (m_paltex && psm.pal > 0)
+		if (psm.pal > 0)
+			AttachPaletteToSource(src, psm.pal, m_paltex);
+
+		// Mipmap layers are uploaded into the texture afterwards, so it can't be shared
+		const bool hashed = m_texture_hash_cache && m_renderer->m_mipmap != static_cast<int>(HWMipmapLevel::Full);
+		const u64 hash = hashed ? HashSource(src) : 0;
+
+		if (!hashed || !LookupHashCache(src, hash))
 		{
-			src->m_texture = m_renderer->m_dev->CreateTexture(tw, th, Get8bitFormat());
-			AttachPaletteToSource(src, psm.pal, true);
-		}
-		else {
-			src->m_texture = m_renderer->m_dev->CreateTexture(tw, th);
-			if (psm.pal > 0) {
-				AttachPaletteToSource(src, psm.pal, false);
-			}
+			if (m_paltex && psm.pal > 0)
+				src->m_texture = m_renderer->m_dev->CreateTexture(tw, th, Get8bitFormat());
+			else
+				src->m_texture = m_renderer->m_dev->CreateTexture(tw, th);
+
+			if (hashed)
+				AddHashCache(src, hash);
 		}
 	}
 
@@ -1351,6 +1388,106 @@ GSTextureCache::Source* GSTextureCache::CreateSource(const GIFRegTEX0& TEX0, con
 	return src;
 }
 
+// Hashes the blocks the source reads (in the order Source::Update reads
+// them) together with everything that changes how they are decoded
+u64 GSTextureCache::HashSource(const Source* src)
+{
+	const GIFRegTEX0& TEX0 = src->m_TEX0;
+	const GSVector2i& bs = GSLocalMemory::m_psm[TEX0.PSM].bs;
+	const GSOffset* off = m_renderer->m_context->offset.tex;
+	const GSLocalMemory& mem = m_renderer->m_mem;
+
+	const int tw = std::max<int>(1 << TEX0.TW, bs.x);
+	const int th = std::max<int>(1 << TEX0.TH, bs.y);
+
+	u64 h[4] = {0xcbf29ce484222325ull, TEX0.PSM | (TEX0.TW << 8) | (TEX0.TH << 12) | ((u64)m_paltex << 16), src->m_TEXA.U64, 0};
+
+	if (src->m_palette_obj && !src->m_palette)
+		h[3] = PaletteKeyHash()(src->m_palette_obj->GetPaletteKey());
+
+	for(int y = 0; y < th; y += bs.y)
+	{
+		u32 base = off->block.row[y >> 3u];
+
+		for(int x = 0; x < tw; x += bs.x)
+		{
+			u32 block = base + off->block.col[x >> 3u];
+
+			if(block < MAX_BLOCKS || m_wrap_gs_mem)
+			{
+				// Four independent lanes, a block is 32 qwords
+				const u64* RESTRICT p = (const u64*)mem.BlockPtr(block);
+
+				for(int i = 0; i < 32; i += 4)
+				{
+					h[0] = (h[0] ^ p[i + 0]) * 0x100000001b3ull;
+					h[1] = (h[1] ^ p[i + 1]) * 0x100000001b3ull;
+					h[2] = (h[2] ^ p[i + 2]) * 0x100000001b3ull;
+					h[3] = (h[3] ^ p[i + 3]) * 0x100000001b3ull;
+				}
+			}
+		}
+	}
+
+	return h[0] ^ (h[1] * 31) ^ (h[2] * 961) ^ (h[3] * 29791);
+}
+
+bool GSTextureCache::LookupHashCache(Source* src, u64 hash)
+{
+	auto i = m_hash_cache.find(hash);
+
+	if (i == m_hash_cache.end() || !i->second.complete || i->second.palette != (src->m_palette ? nullptr : src->m_palette_obj))
+		return false;
+
+	HashCacheEntry& e = i->second;
+
+	e.refs++;
+	e.age = 0;
+
+	src->m_texture = e.texture;
+	src->m_hash_entry = &e;
+	src->m_complete = true;
+
+	m_hash_hits++;
+
+	return true;
+}
+
+void GSTextureCache::AddHashCache(Source* src, u64 hash)
+{
+	m_hash_misses++;
+
+	auto i = m_hash_cache.find(hash);
+
+	if (i != m_hash_cache.end())
+	{
+		// Still being decoded by another source (or a different palette)
+		if (i->second.refs > 0)
+			return;
+
+		m_renderer->m_dev->Recycle(i->second.texture);
+		m_hash_cache.erase(i);
+	}
+
+	HashCacheEntry& e = m_hash_cache[hash];
+
+	e.texture = src->m_texture;
+	e.palette = src->m_palette ? nullptr : src->m_palette_obj;
+	e.refs = 1;
+	e.age = 0;
+	e.complete = false;
+
+	src->m_hash_entry = &e;
+}
+
+void GSTextureCache::ClearHashCache()
+{
+	for (auto& i : m_hash_cache)
+		m_renderer->m_dev->Recycle(i.second.texture);
+
+	m_hash_cache.clear();
+}
+
 GSTextureCache::Target* GSTextureCache::CreateTarget(const GIFRegTEX0& TEX0, int w, int h, int type)
 {
 	Target* t = new Target(m_renderer, TEX0, m_temp, m_can_convert_depth);
@@ -1425,6 +1562,7 @@ GSTextureCache::Source::Source(GSRenderer* r, const GIFRegTEX0& TEX0, const GIFR
 	, m_target(false)
 	, m_complete(false)
 	, m_p2t(NULL)
+	, m_hash_entry(NULL)
 	, m_from_target(NULL)
 	, m_from_target_TEX0(TEX0)
 {
@@ -1462,6 +1600,13 @@ GSTextureCache::Source::Source(GSRenderer* r, const GIFRegTEX0& TEX0, const GIFR
 GSTextureCache::Source::~Source()
 {
 	AlignedFree(m_write.rect);
+
+	// The hash cache owns the texture
+	if (m_hash_entry)
+	{
+		m_hash_entry->refs--;
+		m_texture = NULL;
+	}
 }
 
 void GSTextureCache::Source::Update(const GSVector4i& rect, int layer)
@@ -1550,6 +1695,9 @@ void GSTextureCache::Source::Update(const GSVector4i& rect, int layer)
 
 	if(blocks > 0)
 		Flush(m_write.count, layer);
+
+	if(m_hash_entry && m_complete)
+		m_hash_entry->complete = true;
 }
 
 void GSTextureCache::Source::UpdateLayer(const GIFRegTEX0& TEX0, const GSVector4i& rect, int layer)
@@ -1636,13 +1784,23 @@ void GSTextureCache::Source::Flush(u32 count, int layer)
 
 	u8* buff = m_temp;
 
+	auto read = [&](const GSVector4i& r, u8* dst, int dstpitch)
+	{
+		const auto start = std::chrono::steady_clock::now();
+
+		m_decoder->Read(mem, rtx, off, r, psm.bs.y, dst, dstpitch, m_TEXA);
+
+		m_decode_ns += std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count();
+		m_decoded_bytes += (u64)r.width() * r.height() * (m_palette ? 1 : 4);
+	};
+
 	for(u32 i = 0; i < count; i++)
 	{
 		GSVector4i r = m_write.rect[i];
 
 		if((r > tr).mask() & 0xff00)
 		{
-			(mem.*rtx)(off, r, buff, pitch, m_TEXA);
+			read(r, buff, pitch);
 
 			m_texture->Update(r.rintersect(tr), buff, pitch, layer);
 		}
@@ -1652,13 +1810,13 @@ void GSTextureCache::Source::Flush(u32 count, int layer)
 
 			if(m_texture->Map(m, &r, layer))
 			{
-				(mem.*rtx)(off, r, m.bits, m.pitch, m_TEXA);
+				read(r, m.bits, m.pitch);
 
 				m_texture->Unmap();
 			}
 			else
 			{
-				(mem.*rtx)(off, r, buff, pitch, m_TEXA);
+				read(r, buff, pitch);
 
 				m_texture->Update(r, buff, pitch, layer);
 			}
@@ -1678,6 +1836,50 @@ bool GSTextureCache::Source::ClutMatch(PaletteKey palette_key) {
 	return PaletteKeyEqual()(palette_key, m_palette_obj->GetPaletteKey());
 }
 
+// GSTextureCache::Decoder
+
+GSTextureCache::Decoder::Decoder(int threads)
+{
+	for(int i = 0; i < threads; i++)
+	{
+		m_workers.push_back(std::unique_ptr<GSJobQueue<Job, 4>>(new GSJobQueue<Job, 4>([](Job& job)
+		{
+			(job.mem->*job.rtx)(job.off, job.r, job.dst, job.dstpitch, job.TEXA);
+		}, "GS TexDecode")));
+	}
+}
+
+void GSTextureCache::Decoder::Read(GSLocalMemory& mem, GSLocalMemory::readTexture rtx, const GSOffset* off, const GSVector4i& r, int bh, u8* dst, int dstpitch, const GIFRegTEXA& TEXA)
+{
+	// Below 128x128 texels per strip, handing the work over costs more than it saves
+	int strips = std::min<int>(m_workers.size() + 1, std::min(r.height() / bh, r.width() * r.height() / (128 * 128)));
+
+	if(strips <= 1)
+	{
+		(mem.*rtx)(off, r, dst, dstpitch, TEXA);
+
+		return;
+	}
+
+	// Strips start on a block row, the last one takes the remainder
+	int rows = (r.height() / bh + strips - 1) / strips * bh;
+	int used = 0;
+
+	for(int y = r.top + rows; y < r.bottom; y += rows)
+	{
+		Job job = {GSVector4i(r.left, y, r.right, std::min(y + rows, r.bottom)), &mem, rtx, off, dst + (y - r.top) * dstpitch, dstpitch, TEXA};
+
+		m_workers[used++]->Push(job);
+	}
+
+	(mem.*rtx)(off, GSVector4i(r.left, r.top, r.right, r.top + rows), dst, dstpitch, TEXA);
+
+	for(int i = 0; i < used; i++)
+	{
+		m_workers[i]->Wait();
+	}
+}
+
 // GSTextureCache::Target
 
 GSTextureCache::Target::Target(GSRenderer* r, const GIFRegTEX0& TEX0, u8* temp, bool depth_supported)
@@ -21,6 +21,8 @@
 
 #pragma once
 
+#include <atomic>
+#include <unordered_map>
 #include <unordered_set>
 
 #include "Pcsx2Types.h"
@@ -28,12 +30,36 @@
 #include "../Common/GSRenderer.h"
 #include "../Common/GSFastList.h"
 #include "../Common/GSDirtyRect.h"
+#include "../../GSJobQueue.h"
 
 class GSTextureCache
 {
 public:
 	enum {RenderTarget, DepthStencil};
 
+	// Unswizzles large source uploads on a few worker threads, each of them
+	// decoding a strip of rows into its own part of the destination
+	class Decoder
+	{
+		struct Job
+		{
+			GSVector4i r;
+			GSLocalMemory* mem;
+			GSLocalMemory::readTexture rtx;
+			const GSOffset* off;
+			u8* dst;
+			int dstpitch;
+			GIFRegTEXA TEXA;
+		};
+
+		std::vector<std::unique_ptr<GSJobQueue<Job, 4>>> m_workers;
+
+	public:
+		Decoder(int threads);
+
+		void Read(GSLocalMemory& mem, GSLocalMemory::readTexture rtx, const GSOffset* off, const GSVector4i& r, int bh, u8* dst, int dstpitch, const GIFRegTEXA& TEXA);
+	};
+
 	class Surface : public GSAlignedClass<32>
 	{
 	protected:
@@ -100,6 +126,16 @@ public:
 		bool operator()(const PaletteKey &lhs, const PaletteKey &rhs) const;
 	};
 
+	// Decoded texture shared by the sources created from the same texels
+	struct HashCacheEntry
+	{
+		GSTexture* texture;
+		std::shared_ptr<Palette> palette; // CPU converted palette, if any
+		u32 refs;      // Sources using the texture
+		int age;       // Frames without any source
+		bool complete; // Every texel was decoded
+	};
+
 	class Source : public Surface
 	{
 		struct {GSVector4i* rect; u32 count;} m_write;
@@ -116,6 +152,7 @@ public:
 		bool m_complete;
 		bool m_repeating;
 		std::vector<GSVector2i>* m_p2t;
+		HashCacheEntry* m_hash_entry; // Texture is shared through the hash cache
 		// Keep a trace of the target origin. There is no guarantee that pointer will
 		// still be valid on future. However it ought to be good when the source is created
 		// so it can be used to access un-converted data for the current draw call.
@@ -217,8 +254,16 @@ protected:
 	static bool m_disable_partial_invalidation;
 	bool m_texture_inside_rt;
 	static bool m_wrap_gs_mem;
+	static std::unique_ptr<Decoder> m_decoder;
 	u8 m_texture_inside_rt_cache_size = 255;
 	std::vector<TexInsideRtCacheEntry> m_texture_inside_rt_cache;
+	bool m_texture_hash_cache;
+	std::unordered_map<u64, HashCacheEntry> m_hash_cache;
+
+	u64 HashSource(const Source* src);
+	bool LookupHashCache(Source* src, u64 hash);
+	void AddHashCache(Source* src, u64 hash);
+	void ClearHashCache();
 
 	virtual Source* CreateSource(const GIFRegTEX0& TEX0, const GIFRegTEXA& TEXA, Target* t = NULL, bool half_right = false, int x_offset = 0, int y_offset = 0);
 	virtual Target* CreateTarget(const GIFRegTEX0& TEX0, int w, int h, int type);
@@ -231,6 +276,15 @@ protected:
 public:
 	GSTextureCache(GSRenderer* r);
 	virtual ~GSTextureCache();
+
+	// Bytes decoded for source uploads and the time it took, since startup
+	static std::atomic<u64> m_decoded_bytes;
+	static std::atomic<u64> m_decode_ns;
+
+	// Sources that reused (or had to decode) a texture of the hash cache
+	static std::atomic<u64> m_hash_hits;
+	static std::atomic<u64> m_hash_misses;
+
 	virtual void Read(Target* t, const GSVector4i& r) = 0;
 	virtual void Read(Source* t, const GSVector4i& r) = 0;
 	void RemoveAll();
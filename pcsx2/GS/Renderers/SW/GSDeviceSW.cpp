@@ -0,0 +1,438 @@
+/*
+ *	Copyright (C) 2007-2009 Gabest
+ *	http://www.gabest.org
+ *
+ *  This Program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2, or (at your option)
+ *  any later version.
+ *
+ *  This Program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with GNU Make; see the file COPYING.  If not, write to
+ *  the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA USA.
+ *  http://www.gnu.org/copyleft/gpl.html
+ *
+ */
+
+#include <cmath>
+#include <cstring>
+
+#include "../../GS.h"
+#include "../Common/GSRenderer.h"
+#include "GSDeviceSW.h"
+
+#include <libretro.h>
+
+extern retro_environment_t environ_cb;
+extern retro_video_refresh_t video_cb;
+
+// Converts an alpha of 0-255 to a 1.15 fixed point factor, so that 255 maps to
+// 0x7fff and a full-alpha merge reproduces the source exactly.
+static GS_FORCEINLINE GSVector4i MergeFactor(const GSVector4i& a)
+{
+	return a.sll16(7) | a.srl16(1);
+}
+
+// ps_main0 (alpha < 0) blends by twice the source alpha, ps_main1 by a constant.
+static void MergeRow(u32* RESTRICT d, const u32* RESTRICT s, int n, int alpha, bool keep_alpha)
+{
+	const GSVector4i amask = GSVector4i::xff000000();
+	const GSVector4i amax = GSVector4i::x00ff();
+	const GSVector4i fconst = MergeFactor(GSVector4i::load(std::max(alpha, 0) * 0x10001).xxxx());
+
+	int i = 0;
+
+	for(; i + 4 <= n; i += 4)
+	{
+		GSVector4i sv = GSVector4i::load<false>(&s[i]);
+		GSVector4i dv = GSVector4i::load<false>(&d[i]);
+
+		GSVector4i s0 = sv.upl8();
+		GSVector4i s1 = sv.uph8();
+		GSVector4i d0 = dv.upl8();
+		GSVector4i d1 = dv.uph8();
+
+		GSVector4i f0 = fconst;
+		GSVector4i f1 = fconst;
+
+		if(alpha < 0)
+		{
+			f0 = MergeFactor(s0.wwwwlh().sll16(1).min_i16(amax));
+			f1 = MergeFactor(s1.wwwwlh().sll16(1).min_i16(amax));
+		}
+
+		d0 = d0.add16(s0.sub16(d0).modulate16<0>(f0));
+		d1 = d1.add16(s1.sub16(d1).modulate16<0>(f1));
+
+		GSVector4i r = d0.pu16(d1);
+
+		if(keep_alpha)
+			r = r.blend(dv, amask);
+
+		GSVector4i::store<false>(&d[i], r);
+	}
+
+	for(; i < n; i++)
+	{
+		const int a = alpha < 0 ? std::min<int>((s[i] >> 24) * 2, 255) : alpha;
+		const int f = (a << 7) | (a >> 1);
+
+		u32 r = 0;
+
+		for(int c = 0; c < 32; c += 8)
+		{
+			const int sc = (s[i] >> c) & 0xff;
+			const int dc = (d[i] >> c) & 0xff;
+
+			r |= (u32)(dc + (((sc - dc) * f + 0x4000) >> 15)) << c;
+		}
+
+		if(keep_alpha)
+			r = (r & 0x00ffffff) | (d[i] & 0xff000000);
+
+		d[i] = r;
+	}
+}
+
+// ps_main2 of the interlace shader: a 1-2-1 vertical filter.
+static void FilterRow(u32* RESTRICT d, const u32* a, const u32* b, const u32* c, int n)
+{
+	int i = 0;
+
+	for(; i + 4 <= n; i += 4)
+	{
+		GSVector4i va = GSVector4i::load<false>(&a[i]);
+		GSVector4i vb = GSVector4i::load<false>(&b[i]);
+		GSVector4i vc = GSVector4i::load<false>(&c[i]);
+
+		GSVector4i::store<false>(&d[i], va.avg8(vc).avg8(vb));
+	}
+
+	for(; i < n; i++)
+	{
+		u32 r = 0;
+
+		for(int k = 0; k < 32; k += 8)
+		{
+			const u32 ac = (((a[i] >> k) & 0xff) + ((c[i] >> k) & 0xff) + 1) >> 1;
+
+			r |= ((ac + ((b[i] >> k) & 0xff) + 1) >> 1) << k;
+		}
+
+		d[i] = r;
+	}
+}
+
+// GS textures hold R in the low byte; the frontend expects XRGB8888.
+static void ConvertRow(u32* RESTRICT d, const u32* RESTRICT s, int n)
+{
+	int i = 0;
+
+	for(; i + 4 <= n; i += 4)
+	{
+		GSVector4i v = GSVector4i::load<false>(&s[i]);
+
+		GSVector4i r = v.sll32(24).srl32(8);
+		GSVector4i g = v.sll32(16).srl32(24).sll32(8);
+		GSVector4i b = v.sll32(8).srl32(24);
+
+		GSVector4i::store<false>(&d[i], r | g | b);
+	}
+
+	for(; i < n; i++)
+	{
+		const u32 c = s[i];
+
+		d[i] = ((c & 0xff) << 16) | (c & 0xff00) | ((c >> 16) & 0xff);
+	}
+}
+
+GSDeviceSW::GSDeviceSW()
+{
+}
+
+GSTexture* GSDeviceSW::CreateSurface(int type, int w, int h, int format)
+{
+	return new GSTextureSW(type, w, h);
+}
+
+// Nearest-neighbour blit of the normalized sRect of sTex onto the pixel rect dRect
+// of dTex. op(dst, src, count, y) is called for each destination row, with src
+// already holding the source pixels for dst[0..count).
+template<class RowOp>
+void GSDeviceSW::Blit(GSTexture* sTex, const GSVector4& sRect, GSTexture* dTex, const GSVector4& dRect, const RowOp& op)
+{
+	if(!sTex || !dTex || sTex == dTex || dRect.z <= dRect.x || dRect.w <= dRect.y)
+		return;
+
+	const GSVector2i ss = sTex->GetSize();
+	const GSVector2i ds = dTex->GetSize();
+
+	// Pixels whose centres lie inside dRect.
+	const int left = std::max(0, (int)std::ceil(dRect.x - 0.5f));
+	const int top = std::max(0, (int)std::ceil(dRect.y - 0.5f));
+	const int right = std::min(ds.x, (int)std::ceil(dRect.z - 0.5f));
+	const int bottom = std::min(ds.y, (int)std::ceil(dRect.w - 0.5f));
+
+	if(left >= right || top >= bottom)
+		return;
+
+	const float sx = (sRect.z - sRect.x) * ss.x / (dRect.z - dRect.x);
+	const float sy = (sRect.w - sRect.y) * ss.y / (dRect.w - dRect.y);
+
+	const int count = right - left;
+
+	std::vector<int> cols(count);
+
+	bool contiguous = true;
+
+	for(int i = 0; i < count; i++)
+	{
+		const float u = sRect.x * ss.x + (left + i + 0.5f - dRect.x) * sx;
+
+		cols[i] = std::max(0, std::min(ss.x - 1, (int)std::floor(u)));
+
+		contiguous &= cols[i] == cols[0] + i;
+	}
+
+	GSTexture::GSMap sm, dm;
+
+	if(!sTex->Map(sm))
+		return;
+
+	if(!dTex->Map(dm))
+	{
+		sTex->Unmap();
+
+		return;
+	}
+
+	if(!contiguous)
+		m_row.resize(count);
+
+	for(int y = top; y < bottom; y++)
+	{
+		const float v = sRect.y * ss.y + (y + 0.5f - dRect.y) * sy;
+		const int row = std::max(0, std::min(ss.y - 1, (int)std::floor(v)));
+
+		const u32* src = (const u32*)(sm.bits + sm.pitch * row);
+		u32* dst = (u32*)(dm.bits + dm.pitch * y) + left;
+
+		if(contiguous)
+		{
+			src += cols[0];
+		}
+		else
+		{
+			for(int i = 0; i < count; i++)
+				m_row[i] = src[cols[i]];
+
+			src = m_row.data();
+		}
+
+		op(dst, src, count, y);
+	}
+
+	dTex->Unmap();
+	sTex->Unmap();
+}
+
+void GSDeviceSW::ClearRenderTarget(GSTexture* t, const GSVector4& c)
+{
+	ClearRenderTarget(t, (c * GSVector4(255.0f)).rgba32());
+}
+
+void GSDeviceSW::ClearRenderTarget(GSTexture* t, u32 c)
+{
+	GSTexture::GSMap m;
+
+	if(!t || !t->Map(m))
+		return;
+
+	for(int y = 0; y < t->GetHeight(); y++)
+	{
+		u32* dst = (u32*)(m.bits + m.pitch * y);
+
+		std::fill(dst, dst + t->GetWidth(), c);
+	}
+
+	t->Unmap();
+}
+
+void GSDeviceSW::CopyRect(GSTexture* sTex, GSTexture* dTex, const GSVector4i& r)
+{
+	const GSVector4 s = GSVector4(sTex->GetSize()).xyxy();
+
+	StretchRect(sTex, GSVector4(r) / s, dTex, GSVector4(r.rsize()), 0, false);
+}
+
+void GSDeviceSW::StretchRect(GSTexture* sTex, const GSVector4& sRect, GSTexture* dTex, const GSVector4& dRect, int shader, bool linear)
+{
+	// Only plain copies are needed by the software renderer; the other
+	// conversion shaders are hardware texture cache and post-processing paths.
+	Blit(sTex, sRect, dTex, dRect, [](u32* dst, const u32* src, int n, int y)
+	{
+		memcpy(dst, src, n * sizeof(u32));
+	});
+}
+
+void GSDeviceSW::DoMerge(GSTexture* sTex[3], GSVector4* sRect, GSTexture* dTex, GSVector4* dRect, const GSRegPMODE& PMODE, const GSRegEXTBUF& EXTBUF, const GSVector4& c)
+{
+	// Feedback writes (EXTBUF) are not emulated here.
+	ClearRenderTarget(dTex, c);
+
+	if(sTex[1] && PMODE.SLBG == 0)
+	{
+		// 2nd output is enabled and selected. Copy it to destination so we can blend it with 1st output
+		StretchRect(sTex[1], sRect[1], dTex, dRect[1]);
+	}
+
+	if(sTex[0])
+	{
+		// Blend with a constant alpha, or with 2 * input alpha
+		const int alpha = PMODE.MMOD == 1 ? (int)PMODE.ALP : -1;
+		// Keep the alpha from the 2nd output
+		const bool keep_alpha = PMODE.AMOD == 1;
+
+		Blit(sTex[0], sRect[0], dTex, dRect[0], [alpha, keep_alpha](u32* dst, const u32* src, int n, int y)
+		{
+			MergeRow(dst, src, n, alpha, keep_alpha);
+		});
+	}
+}
+
+void GSDeviceSW::DoInterlace(GSTexture* sTex, GSTexture* dTex, int shader, bool linear, float yoffset)
+{
+	const GSVector4 s = GSVector4(dTex->GetSize());
+
+	const GSVector4 sRect(0, 0, 1, 1);
+	const GSVector4 dRect(0.0f, yoffset, s.x, s.y + yoffset);
+
+	if(shader == 0 || shader == 1)
+	{
+		// Weave: write only this field's lines, the others keep the previous field.
+		const int parity = shader == 0 ? 1 : 0;
+
+		Blit(sTex, sRect, dTex, dRect, [parity](u32* dst, const u32* src, int n, int y)
+		{
+			if((y & 1) == parity)
+				memcpy(dst, src, n * sizeof(u32));
+		});
+	}
+	else if(shader == 2)
+	{
+		// Blend: source and destination are the same size.
+		GSTexture::GSMap sm, dm;
+
+		if(sTex == dTex || sTex->GetSize() != dTex->GetSize() || !sTex->Map(sm))
+			return;
+
+		if(!dTex->Map(dm))
+		{
+			sTex->Unmap();
+
+			return;
+		}
+
+		const int w = dTex->GetWidth();
+		const int h = dTex->GetHeight();
+
+		for(int y = 0; y < h; y++)
+		{
+			const u32* a = (const u32*)(sm.bits + sm.pitch * std::max(y - 1, 0));
+			const u32* b = (const u32*)(sm.bits + sm.pitch * y);
+			const u32* c = (const u32*)(sm.bits + sm.pitch * std::min(y + 1, h - 1));
+
+			FilterRow((u32*)(dm.bits + dm.pitch * y), a, b, c, w);
+		}
+
+		dTex->Unmap();
+		sTex->Unmap();
+	}
+	else
+	{
+		// Bob: the field stretched over the whole frame, shifted by yoffset.
+		StretchRect(sTex, sRect, dTex, dRect, 0, linear);
+	}
+}
+
+void GSDeviceSW::Present(const GSVector4i& r, int shader)
+{
+	const int w = std::max<int>(r.width(), 1);
+	const int h = std::max<int>(r.height(), 1);
+
+	u32* bits = NULL;
+	size_t pitch = 0;
+
+	// Render straight into the frontend's framebuffer when it offers one in our
+	// format, which saves copying every frame once more on its side.
+	retro_framebuffer fb = {};
+	fb.width = w;
+	fb.height = h;
+	fb.access_flags = RETRO_MEMORY_ACCESS_WRITE;
+
+	if(environ_cb(RETRO_ENVIRONMENT_GET_CURRENT_SOFTWARE_FRAMEBUFFER, &fb) &&
+		fb.data && fb.width == (unsigned)w && fb.height == (unsigned)h && fb.format == RETRO_PIXEL_FORMAT_XRGB8888)
+	{
+		bits = (u32*)fb.data;
+		pitch = fb.pitch;
+	}
+	else
+	{
+		m_output.resize((size_t)w * h);
+
+		bits = m_output.data();
+		pitch = (size_t)w * sizeof(u32);
+	}
+
+	GSTexture::GSMap m;
+
+	if(m_current && m_current->Map(m))
+	{
+		const GSVector2i cs = m_current->GetSize();
+
+		// Nearest-neighbour output scaling; normally only the vertical doubling
+		// of a frame-mode field is left to do here.
+		std::vector<int> cols;
+
+		if(cs.x != w)
+		{
+			cols.resize(w);
+
+			for(int x = 0; x < w; x++)
+				cols[x] = x * cs.x / w;
+
+			m_row.resize(w);
+		}
+
+		for(int y = 0; y < h; y++)
+		{
+			const u32* src = (const u32*)(m.bits + m.pitch * (y * cs.y / h));
+			u32* dst = (u32*)((u8*)bits + pitch * y);
+
+			if(cs.x != w)
+			{
+				for(int x = 0; x < w; x++)
+					m_row[x] = src[cols[x]];
+
+				src = m_row.data();
+			}
+
+			ConvertRow(dst, src, w);
+		}
+
+		m_current->Unmap();
+	}
+	else
+	{
+		for(int y = 0; y < h; y++)
+			memset((u8*)bits + pitch * y, 0, w * sizeof(u32));
+	}
+
+	video_cb(bits, w, h, pitch);
+}
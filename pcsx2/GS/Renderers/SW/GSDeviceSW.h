@@ -0,0 +1,61 @@
+/*
+ *	Copyright (C) 2007-2009 Gabest
+ *	http://www.gabest.org
+ *
+ *  This Program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2, or (at your option)
+ *  any later version.
+ *
+ *  This Program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with GNU Make; see the file COPYING.  If not, write to
+ *  the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA USA.
+ *  http://www.gnu.org/copyleft/gpl.html
+ *
+ */
+
+#pragma once
+
+#include <vector>
+
+#include "Pcsx2Types.h"
+
+#include "GSTextureSW.h"
+#include "../Common/GSDevice.h"
+
+// Presentation device for the software renderer that needs no GPU context.
+// Merge, deinterlacing and output scaling run on GSTextureSW surfaces, and the
+// final frame is converted straight into the frontend's software framebuffer
+// when it provides one.
+class GSDeviceSW final : public GSDevice
+{
+	// Scratch row for blits that don't map source pixels 1:1.
+	std::vector<u32> m_row;
+	// Output frame, used when the frontend has no framebuffer of its own to offer.
+	std::vector<u32> m_output;
+
+	template<class RowOp>
+	void Blit(GSTexture* sTex, const GSVector4& sRect, GSTexture* dTex, const GSVector4& dRect, const RowOp& op);
+
+	GSTexture* CreateSurface(int type, int w, int h, int format) final;
+
+	void DoMerge(GSTexture* sTex[3], GSVector4* sRect, GSTexture* dTex, GSVector4* dRect, const GSRegPMODE& PMODE, const GSRegEXTBUF& EXTBUF, const GSVector4& c) final;
+	void DoInterlace(GSTexture* sTex, GSTexture* dTex, int shader, bool linear, float yoffset) final;
+	u16 ConvertBlendEnum(u16 generic) final { return generic; }
+
+public:
+	GSDeviceSW();
+
+	void Present(const GSVector4i& r, int shader) final;
+
+	void ClearRenderTarget(GSTexture* t, const GSVector4& c) final;
+	void ClearRenderTarget(GSTexture* t, u32 c) final;
+
+	void CopyRect(GSTexture* sTex, GSTexture* dTex, const GSVector4i& r) final;
+	void StretchRect(GSTexture* sTex, const GSVector4& sRect, GSTexture* dTex, const GSVector4& dRect, int shader = 0, bool linear = true) final;
+};
@@ -217,6 +217,10 @@ bool GSTextureCacheSW::Texture::Update(const GSVector4i& rect)
 
 		if (!m_buff)
 			return false;
+
+		// Only the blocks a draw uses are decoded. Bilinear filtering and the wrap modes
+		// can still read a texel outside of them, it must not be leftover heap memory.
+		memset(m_buff, 0, pitch * th * 4);
 	}
 
 	GSLocalMemory& mem = m_state->m_mem;
@@ -21,9 +21,12 @@
 
 #include "GS.h"
 #include "GS/GSFuncs.h"
+#include "GS/GSPipeline.h"
 #include "Gif_Unit.h"
 #include "MTVU.h"
 #include "Elfheader.h"
+#include "Utilities/ThreadPlacement.h"
+#include "../libretro/options_tools.h"
 
 // =====================================================================================================
 //  MTGS Threaded Class Implementation
@@ -89,6 +92,7 @@ SysMtgsThread::SysMtgsThread() :
 	SysFakeThread()
 {
 	m_name = L"MTGS";
+	m_pipeline = NULL;
 
 	// All other state vars are initialized by OnStart().
 }
@@ -230,12 +234,33 @@ void SysMtgsThread::OpenGS()
 	m_sem_OpenDone.Post();
 
 	GSsetGameCRC( ElfCRC, 0 );
+
+	if (EmuConfig.GSPipeline)
+		StartPipeline();
 }
 
 void SysMtgsThread::ExecuteTaskInThread()
 {
+	if (m_pipeline)
+	{
+		// The ring buffer is consumed by the parse thread, render what it parsed
+		for (;;)
+		{
+			while (wxTheApp->HasPendingEvents())
+				wxTheApp->ProcessPendingEvents();
+
+			if (m_pipeline->Execute())
+				return;
+
+			StateCheckInThread();
+			if (!m_pipeline)
+				return;
+		}
+	}
+
 	// Threading info: run in MTGS thread
-	// m_ReadPos is only update by the MTGS thread so it is safe to load it with a relaxed atomic
+	// That's the frontend's thread, it only has the GS placement while in here
+	Threading::ScopedThreadPlacement placement(Threading::ThreadRole_GS);
         for (;;)
 	{
 		while (wxTheApp->HasPendingEvents())
@@ -248,144 +273,239 @@ void SysMtgsThread::ExecuteTaskInThread()
 		}
 		StateCheckInThread();
 
-		// note: m_ReadPos is intentionally not volatile, because it should only
-		// ever be modified by this thread.
-		while( m_ReadPos.load(std::memory_order_relaxed) != m_WritePos.load(std::memory_order_acquire))
+		if (ProcessRingBuffer())
+			return;
+	}
+}
+
+static void VsyncGS(const RingCmdPacket_Vsync& mail)
+{
+	memcpy(RingBuffer.Regs, mail.regset1, sizeof(mail.regset1));
+
+	((u32&)RingBuffer.Regs[0x1000])				= mail.csr;
+	((u32&)RingBuffer.Regs[0x1010])				= mail.imr;
+	((GSRegSIGBLID&)RingBuffer.Regs[0x1080])	= mail.siglblid;
+
+	// CSR & 0x2000; is the pageflip id.
+	GSvsync(mail.csr & 0x2000);
+}
+
+void SysMtgsThread::GifTransfer(const u8* mem, u32 size)
+{
+	if (m_pipeline)
+		m_pipeline->Transfer(mem, size);
+	else
+		GSgifTransfer((u8*)mem, size);
+}
+
+// Processes the ring buffer until it is empty, or up to and including a vsync (returns true then)
+bool SysMtgsThread::ProcessRingBuffer()
+{
+	// m_ReadPos is only update by the MTGS thread so it is safe to load it with a relaxed atomic
+	// note: m_ReadPos is intentionally not volatile, because it should only
+	// ever be modified by this thread.
+	while( m_ReadPos.load(std::memory_order_relaxed) != m_WritePos.load(std::memory_order_acquire))
+	{
+		const unsigned int local_ReadPos = m_ReadPos.load(std::memory_order_relaxed);
+		const PacketTagType& tag = (PacketTagType&)RingBuffer[local_ReadPos];
+		u32 ringposinc = 1;
+
+		switch( tag.command )
 		{
-			const unsigned int local_ReadPos = m_ReadPos.load(std::memory_order_relaxed);
-			const PacketTagType& tag = (PacketTagType&)RingBuffer[local_ReadPos];
-			u32 ringposinc = 1;
+			case GS_RINGTYPE_GSPACKET: {
+				Gif_Path& path   = gifUnit.gifPath[tag.data[2]];
+				u32       offset = tag.data[0];
+				u32       size   = tag.data[1];
+				if (offset != ~0u) GifTransfer((u8*)&path.buffer[offset], size/16);
+				path.readAmount.fetch_sub(size, std::memory_order_acq_rel);
+				break;
+			}
 
-			switch( tag.command )
-			{
-				case GS_RINGTYPE_GSPACKET: {
-					Gif_Path& path   = gifUnit.gifPath[tag.data[2]];
-					u32       offset = tag.data[0];
-					u32       size   = tag.data[1];
-					if (offset != ~0u) GSgifTransfer((u8*)&path.buffer[offset], size/16);
-					path.readAmount.fetch_sub(size, std::memory_order_acq_rel);
-					break;
+			case GS_RINGTYPE_MTVU_GSPACKET: {
+				vu1Thread.KickStart(true);
+				// Wait for MTVU to complete vu1 program
+				if (m_pipeline)
+				{
+					// Don't hold up StopPipeline(), the packet is processed again after it
+					if (!m_pipeline->Wait([] { return vu1Thread.semaXGkick.WaitWithoutYield(wxTimeSpan::Millisecond()); }))
+						return false;
 				}
-
-				case GS_RINGTYPE_MTVU_GSPACKET: {
-					vu1Thread.KickStart(true);
-					// Wait for MTVU to complete vu1 program
+				else
 					vu1Thread.semaXGkick.Wait();
-					Gif_Path& path   = gifUnit.gifPath[GIF_PATH_1];
-					GS_Packet gsPack = path.GetGSPacketMTVU(); // Get vu1 program's xgkick packet(s)
-					if (gsPack.size) GSgifTransfer((u8*)&path.buffer[gsPack.offset], gsPack.size/16);
-					path.readAmount.fetch_sub(gsPack.size + gsPack.readAmount, std::memory_order_acq_rel);
-					path.mtvu.gsPackQueue.pop(); // Should be done last, for proper Gif_MTGS_Wait()
-					break;
-				}
+				Gif_Path& path   = gifUnit.gifPath[GIF_PATH_1];
+				GS_Packet gsPack = path.GetGSPacketMTVU(); // Get vu1 program's xgkick packet(s)
+				if (gsPack.size) GifTransfer((u8*)&path.buffer[gsPack.offset], gsPack.size/16);
+				path.readAmount.fetch_sub(gsPack.size + gsPack.readAmount, std::memory_order_acq_rel);
+				path.mtvu.gsPackQueue.pop(); // Should be done last, for proper Gif_MTGS_Wait()
+				break;
+			}
 
-				default:
+			default:
+			{
+				switch( tag.command )
 				{
-					switch( tag.command )
-					{
-						case GS_RINGTYPE_VSYNC:
-							{
-								const int qsize = tag.data[0];
-								ringposinc += qsize;
-
-								// Mail in the important GS registers.
-								// This seemingly obtuse system is needed in order to handle cases where the vsync data wraps
-								// around the edge of the ringbuffer.  If not for that I'd just use a struct. >_<
-
-								uint datapos = (local_ReadPos+1) & RINGBUFFERMASK;
-								MemCopy_WrappedSrc( RingBuffer.m_Ring, datapos, RINGBUFFERSIZE, (u128*)RingBuffer.Regs, 0xf );
-
-								u32* remainder = (u32*)&RingBuffer[datapos];
-								((u32&)RingBuffer.Regs[0x1000])				= remainder[0];
-								((u32&)RingBuffer.Regs[0x1010])				= remainder[1];
-								((GSRegSIGBLID&)RingBuffer.Regs[0x1080])	= (GSRegSIGBLID&)remainder[2];
-
-								// CSR & 0x2000; is the pageflip id.
-								GSvsync(((u32&)RingBuffer.Regs[0x1000]) & 0x2000);
-
-								m_QueuedFrameCount.fetch_sub(1);
-								if (m_VsyncSignalListener.exchange(false))
-									m_sem_Vsync.Post();
-
-								// Do not StateCheckInThread() here
-								// Otherwise we could pause while there's still data in the queue
-								// Which could make the MTVU thread wait forever for it to empty
-							}
-							break;
-
-						case GS_RINGTYPE_FREEZE:
-							{
-								MTGS_FreezeData* data = (MTGS_FreezeData*)tag.pointer;
-								int mode = tag.data[0];
+					case GS_RINGTYPE_VSYNC:
+						{
+							const int qsize = tag.data[0];
+							ringposinc += qsize;
+
+							// Mail in the important GS registers.
+							// This seemingly obtuse system is needed in order to handle cases where the vsync data wraps
+							// around the edge of the ringbuffer.  If not for that I'd just use a struct. >_<
+
+							RingCmdPacket_Vsync mail;
+							uint datapos = (local_ReadPos+1) & RINGBUFFERMASK;
+							MemCopy_WrappedSrc( RingBuffer.m_Ring, datapos, RINGBUFFERSIZE, (u128*)mail.regset1, 0xf );
+
+							u32* remainder = (u32*)&RingBuffer[datapos];
+							mail.csr		= remainder[0];
+							mail.imr		= remainder[1];
+							mail.siglblid	= (GSRegSIGBLID&)remainder[2];
+
+							// The registers are the renderer's, it gets them when it gets to this vsync
+							if (m_pipeline)
+								m_pipeline->PostFrame([mail] { VsyncGS(mail); });
+							else
+								VsyncGS(mail);
+
+							m_QueuedFrameCount.fetch_sub(1);
+							if (m_VsyncSignalListener.exchange(false))
+								m_sem_Vsync.Post();
+
+							// Do not StateCheckInThread() here
+							// Otherwise we could pause while there's still data in the queue
+							// Which could make the MTVU thread wait forever for it to empty
+						}
+						break;
+
+					case GS_RINGTYPE_FREEZE:
+						{
+							MTGS_FreezeData* data = (MTGS_FreezeData*)tag.pointer;
+							int mode = tag.data[0];
+							if (m_pipeline)
+								m_pipeline->Sync([&] { data->retval = GSfreeze( mode, data->fdata ); });
+							else
 								data->retval = GSfreeze( mode, data->fdata );
-							}
-							break;
+						}
+						break;
 
-						case GS_RINGTYPE_RESET:
+					case GS_RINGTYPE_RESET:
+						if (m_pipeline)
+							m_pipeline->Reset();
+						else
 							GSreset();
-							break;
-
-						case GS_RINGTYPE_SOFTRESET:
-							{
-								int mask = tag.data[0];
+						break;
+
+					case GS_RINGTYPE_SOFTRESET:
+						{
+							int mask = tag.data[0];
+							if (m_pipeline)
+								m_pipeline->SoftReset( mask );
+							else
 								GSgifSoftReset( mask );
-							}
-							break;
+						}
+						break;
 
-						case GS_RINGTYPE_CRC:
+					case GS_RINGTYPE_CRC:
+						if (m_pipeline)
+							m_pipeline->SetGameCRC( tag.data[0], 0 );
+						else
 							GSsetGameCRC( tag.data[0], 0 );
-							break;
+						break;
 
-						case GS_RINGTYPE_INIT_AND_READ_FIFO:
+					case GS_RINGTYPE_INIT_AND_READ_FIFO:
+						if (m_pipeline)
+							m_pipeline->Sync([&] { GSInitAndReadFIFO( (u8*)tag.pointer, tag.data[0] ); });
+						else
 							GSInitAndReadFIFO( (u8*)tag.pointer, tag.data[0]);
-							break;
-						default:
-							break;
-					}
+						break;
+					default:
+						break;
 				}
 			}
+		}
 
-			uint newringpos = (m_ReadPos.load(std::memory_order_relaxed) + ringposinc) & RINGBUFFERMASK;
+		uint newringpos = (m_ReadPos.load(std::memory_order_relaxed) + ringposinc) & RINGBUFFERMASK;
 
-			m_ReadPos.store(newringpos, std::memory_order_release);
+		m_ReadPos.store(newringpos, std::memory_order_release);
 
-			if(m_SignalRingEnable.load(std::memory_order_acquire))
+		if(m_SignalRingEnable.load(std::memory_order_acquire))
+		{
+			// The EEcore has requested a signal after some amount of processed data.
+			if( m_SignalRingPosition.fetch_sub( ringposinc ) <= 0 )
 			{
-				// The EEcore has requested a signal after some amount of processed data.
-				if( m_SignalRingPosition.fetch_sub( ringposinc ) <= 0 )
-				{
-					// Make sure to post the signal after the m_ReadPos has been updated...
-					m_SignalRingEnable.store(false, std::memory_order_release);
-					m_sem_OnRingReset.Post();
-					continue;
-				}
+				// Make sure to post the signal after the m_ReadPos has been updated...
+				m_SignalRingEnable.store(false, std::memory_order_release);
+				m_sem_OnRingReset.Post();
+				continue;
 			}
-			if(tag.command == GS_RINGTYPE_VSYNC)
+		}
+		if(tag.command == GS_RINGTYPE_VSYNC)
+		{
+			if( m_SignalRingEnable.exchange(false) )
 			{
-				if( m_SignalRingEnable.exchange(false) )
-				{
-					m_SignalRingPosition.store(0, std::memory_order_release);
-					m_sem_OnRingReset.Post();
-				}
-				return;
+				m_SignalRingPosition.store(0, std::memory_order_release);
+				m_sem_OnRingReset.Post();
 			}
+			return true;
 		}
+	}
 
-		// Safety valve in case standard signals fail for some reason -- this ensures the EEcore
-		// won't sleep the eternity, even if SignalRingPosition didn't reach 0 for some reason.
-		// Important: Need to unlock the MTGS busy signal PRIOR, so that EEcore SetEvent() calls
-		// parallel to this handler aren't accidentally blocked.
-		if( m_SignalRingEnable.exchange(false) )
-		{
-			m_SignalRingPosition.store(0, std::memory_order_release);
-			m_sem_OnRingReset.Post();
-		}
+	// Safety valve in case standard signals fail for some reason -- this ensures the EEcore
+	// won't sleep the eternity, even if SignalRingPosition didn't reach 0 for some reason.
+	// Important: Need to unlock the MTGS busy signal PRIOR, so that EEcore SetEvent() calls
+	// parallel to this handler aren't accidentally blocked.
+	if( m_SignalRingEnable.exchange(false) )
+	{
+		m_SignalRingPosition.store(0, std::memory_order_release);
+		m_sem_OnRingReset.Post();
+	}
+
+	if (m_VsyncSignalListener.exchange(false))
+		m_sem_Vsync.Post();
 
-		if (m_VsyncSignalListener.exchange(false))
-			m_sem_Vsync.Post();
+	return false;
+}
+
+void SysMtgsThread::ParseThreadProc()
+{
+	SetNameOfCurrentThread("MTGS Parse");
+	Threading::PlaceCurrentThread(Threading::ThreadRole_GS);
+
+	bool more = false;
+
+	while (!m_pipeline->Stopping())
+	{
+		// After a vsync the ring buffer may hold more already
+		if (!more && !m_sem_event.WaitWithoutYield(wxTimeSpan::Millisecond()))
+			continue;
+
+		more = ProcessRingBuffer();
 	}
 }
 
+void SysMtgsThread::StartPipeline()
+{
+	if (!GSPipeline::Supports(s_gs))
+	{
+		log_cb(RETRO_LOG_WARN, "GS: the pipeline needs the software renderer, running without it\n");
+		return;
+	}
+
+	m_pipeline = new GSPipeline(s_gs);
+	m_pipeline->StartParsing([this] { ParseThreadProc(); });
+}
+
+void SysMtgsThread::StopPipeline()
+{
+	if (!m_pipeline) return;
+
+	m_pipeline->StopParsing();
+
+	delete m_pipeline;
+	m_pipeline = NULL;
+}
+
 void SysMtgsThread::FinishTaskInThread()
 {
 	if( m_SignalRingEnable.exchange(false) )
@@ -401,6 +521,7 @@ void SysMtgsThread::CloseGS()
 {
 	if( !m_Opened ) return;
 	m_Opened = false;
+	StopPipeline();
 	GSclose();
 	m_thread = {};
 }
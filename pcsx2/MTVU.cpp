@@ -18,6 +18,7 @@
 #include "MTVU.h"
 #include "newVif.h"
 #include "Gif_Unit.h"
+#include "Utilities/ThreadPlacement.h"
 #ifdef _WIN32
 #include <windows.h> /* for GetExceptionInformation */
 #endif
@@ -41,6 +42,10 @@ __aligned16 VU_Thread vu1Thread(CpuVU1, VU1);
 // Used for VU cycle stealing hack
 #define VU_Thread_Get_vuCycles() ((vuCycles[0].load(std::memory_order_acquire) + vuCycles[1].load(std::memory_order_acquire) + vuCycles[2].load(std::memory_order_acquire) + vuCycles[3].load(std::memory_order_acquire)) >> 2)
 
+// Deterministic mode: EE cycles between kicking a VU1 program and taking its GS
+// interrupts, about what a VU1 program of a few thousand VU cycles takes
+#define MTVU_RESULTS_DELAY 4096
+
 // Rounds up a size in bytes for size in u32's
 #define SIZE_U32(x) (((x) + 3) >> 2)
 
@@ -118,6 +123,10 @@ void VU_Thread::Reset(void)
 	m_write_pos     = 0;
 	m_ato_read_pos  = 0;
 	m_read_pos      = 0;
+	m_programs_done   = 0;
+	m_programs_sent   = 0;
+	m_programs_synced = 0;
+	m_results_cycle   = 0;
 	memzero(vif);
 	memzero(vifRegs);
 	for (size_t i = 0; i < 4; ++i)
@@ -127,6 +136,8 @@ void VU_Thread::Reset(void)
 
 void VU_Thread::ExecuteTaskInThread()
 {
+	Threading::PlaceCurrentThread(Threading::ThreadRole_VU1);
+
 	PCSX2_PAGEFAULT_PROTECT
 	{
 		ExecuteRingBuffer();
@@ -160,6 +171,7 @@ void VU_Thread::ExecuteRingBuffer()
 						semaXGkick.Post(); // Tell MTGS a path1 packet is complete
 						vuCycles[vuCycleIdx].store(vuRegs.cycle, std::memory_order_release);
 						vuCycleIdx = (vuCycleIdx + 1) & 3;
+						m_programs_done.fetch_add(1, std::memory_order_release);
 					}
 					break;
 				case MTVU_VU_WRITE_MICRO:
@@ -369,9 +381,28 @@ void VU_Thread::WaitVU()
 	}
 }
 
+void VU_Thread::SyncPrograms()
+{
+	while (m_programs_done.load(std::memory_order_acquire) != m_programs_sent)
+	{
+		KickStart();
+		std::this_thread::yield();
+		ScopedLock lock(mtxBusy);
+	}
+	m_programs_synced = m_programs_sent;
+	Get_GSChanges();
+}
+
 void VU_Thread::ExecuteVU(u32 vu_addr, u32 vif_top, u32 vif_itop)
 {
-	Get_GSChanges(); // Clear any pending interrupts
+	// In deterministic mode a single program is in flight, the previous one is
+	// finished here so its cycle count and interrupts don't depend on host timing
+	if (EmuConfig.Deterministic)
+		SyncPrograms();
+	else
+		Get_GSChanges(); // Clear any pending interrupts
+	// Taken before the kick in deterministic mode, it's the finished programs' then
+	u32 cycles = EmuConfig.Deterministic ? std::min(VU_Thread_Get_vuCycles(), 3000u) : 0;
 	ReserveSpace(4);
 	Write(MTVU_VU_EXECUTE);
 	Write(vu_addr);
@@ -380,11 +411,19 @@ void VU_Thread::ExecuteVU(u32 vu_addr, u32 vif_top, u32 vif_itop)
 	m_ato_write_pos.store(m_write_pos, std::memory_order_release);
 	gifUnit.TransferGSPacketData(GIF_TRANS_MTVU, NULL, 0);
 	KickStart();
-	u32 cycles     = std::min(VU_Thread_Get_vuCycles(), 3000u);
+	if (!EmuConfig.Deterministic)
+		cycles = std::min(VU_Thread_Get_vuCycles(), 3000u);
 	u32 cycle_skip = cycles * EmuConfig.Speedhacks.EECycleSkip;
 	cpuRegs.cycle += cycle_skip;
 	VU0.cycle     += cycle_skip;
-	Get_GSChanges();
+	if (EmuConfig.Deterministic)
+	{
+		m_programs_sent++;
+		m_results_cycle = cpuRegs.cycle + MTVU_RESULTS_DELAY;
+		cpuSetNextEventDelta(MTVU_RESULTS_DELAY);
+	}
+	else
+		Get_GSChanges();
 }
 
 void VU_Thread::VifUnpack(vifStruct& _vif, VIFregisters& _vifRegs, u8* data, u32 size)
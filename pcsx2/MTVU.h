@@ -31,8 +31,12 @@ class VU_Thread : public pxThread {
 	__aligned(64) std::atomic<bool> isBusy;   // Is thread processing data?
 	__aligned(64) std::atomic<int> m_ato_read_pos; // Only modified by VU thread
 	__aligned(64) std::atomic<int> m_ato_write_pos;    // Only modified by EE thread
+	__aligned(64) std::atomic<u32> m_programs_done; // Only modified by VU thread
 	__aligned(64) int  m_read_pos; // temporary read pos (local to the VU thread)
 	int  m_write_pos; // temporary write pos (local to the EE thread)
+	u32  m_programs_sent;   // VU1 programs kicked (EE thread)
+	u32  m_programs_synced; // VU1 programs whose results the EE took (EE thread)
+	u32  m_results_cycle;   // EE cycle at which the last program's results are taken
 	Mutex     mtxBusy;
 	Semaphore semaEvent;
 	BaseVUmicroCPU*& vuCPU;
@@ -68,6 +72,12 @@ public:
 
 	void Get_GSChanges();
 
+	// Deterministic mode: the EE takes the GS interrupts of a VU1 program at a fixed
+	// number of EE cycles after kicking it, waiting for the program if needed, rather
+	// than whenever the VU thread happens to be done.
+	bool ResultsDue() const { return m_programs_synced != m_programs_sent && (s32)(cpuRegs.cycle - m_results_cycle) >= 0; }
+	void SyncPrograms();
+
 	void ExecuteVU(u32 vu_addr, u32 vif_top, u32 vif_itop);
 
 	void VifUnpack(vifStruct& _vif, VIFregisters& _vifRegs, u8* data, u32 size);
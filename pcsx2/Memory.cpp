@@ -40,6 +40,7 @@ BIOS
 #include "GS.h"
 #include "VUmicro.h"
 #include "MTVU.h"
+#include "MemorySnapshot.h"
 #include "DEV9/DEV9.h"
 
 #include "ps2/HwInternal.h"
@@ -831,4 +832,5 @@ void mmap_ResetBlockTracking(void)
 {
 	memzero( m_PageProtectInfo );
 	if (eeMem) HostSys::MemProtect( eeMem->Main, Ps2MemSize::MainRam, PageAccess_ReadWrite() );
+	MemorySnapshot::Reprotect();
 }
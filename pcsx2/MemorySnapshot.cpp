@@ -0,0 +1,272 @@
+/*  PCSX2 - PS2 Emulator for PCs
+ *  Copyright (C) 2002-2022  PCSX2 Dev Team
+ *
+ *  PCSX2 is free software: you can redistribute it and/or modify it under the terms
+ *  of the GNU Lesser General Public License as published by the Free Software Found-
+ *  ation, either version 3 of the License, or (at your option) any later version.
+ *
+ *  PCSX2 is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ *  without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ *  PURPOSE.  See the GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along with PCSX2.
+ *  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "Common.h"
+#include "IopMem.h"
+#include "VUmicro.h"
+#include "MTVU.h"
+#include "SaveState.h"
+#include "MemorySnapshot.h"
+
+#include "Utilities/PageFaultSource.h"
+
+#include <vector>
+
+struct SnapshotBlock
+{
+	u8* base;
+	uint size;
+	bool eeMain;				// Pages can also be write protected by the EE block tracking
+	bool eager;					// Copied whole at the capture instead of write protected
+
+	u8* shadow;					// Copies of the pages written since the capture (same offsets)
+	std::vector<bool> copied;
+	uint copies;
+};
+
+// In FreezeMainMemory() order
+static SnapshotBlock s_blocks[5];
+static bool s_active = false;
+
+static bool IsCodeProtected(const SnapshotBlock& block, uint page)
+{
+	return block.eeMain && page * PCSX2_PAGESIZE < Ps2MemSize::MainRam &&
+		mmap_GetRamPageInfo(page * PCSX2_PAGESIZE) == ProtMode_Write;
+}
+
+// Sets the protection of the pages that weren't copied yet: read only if 'protect',
+// otherwise read/write, except for the pages the EE block tracking keeps protected.
+static void SetUncopiedAccess(SnapshotBlock& block, bool protect)
+{
+	const uint pages = block.size / PCSX2_PAGESIZE;
+	uint start = 0;
+
+	for (uint page = 0; page <= pages; page++)
+	{
+		if (page < pages && !block.copied[page] && (protect || !IsCodeProtected(block, page)))
+			continue;
+
+		if (page > start)
+			HostSys::MemProtect(block.base + start * PCSX2_PAGESIZE, (page - start) * PCSX2_PAGESIZE,
+				protect ? PageAccess_ReadOnly() : PageAccess_ReadWrite());
+		start = page + 1;
+	}
+}
+
+static void DropCopies(SnapshotBlock& block)
+{
+	if (block.copies && !block.eager)
+	{
+		// Gives the copied pages back to the OS
+		HostSys::MmapResetPtr(block.shadow, block.size);
+		HostSys::MmapCommitPtr(block.shadow, block.size, PageAccess_ReadWrite());
+	}
+	block.copied.assign(block.size / PCSX2_PAGESIZE, false);
+	block.copies = 0;
+}
+
+// The blocks the host kernel writes to can't be write protected, a read() into a
+// protected page fails with EFAULT instead of faulting into the handler. IOP RAM is
+// where HostFs reads files to, and the hardware registers are small.
+static void CopyEager(SnapshotBlock& block)
+{
+	memcpy(block.shadow, block.base, block.size);
+	block.copied.assign(block.size / PCSX2_PAGESIZE, true);
+}
+
+// --------------------------------------------------------------------------------------
+//  SnapshotPageFaultHandler
+// --------------------------------------------------------------------------------------
+// Listeners are dispatched newest first, and this one is created after the EE block
+// tracking handler, so it sees the faults first. A page that is also protected for
+// recompiled code is copied but left unhandled, the block tracking handler then clears
+// its blocks and unprotects it.
+class SnapshotPageFaultHandler : public EventListener_PageFault
+{
+public:
+	void OnPageFaultEvent(const PageFaultInfo& info, bool& handled)
+	{
+		if (!s_active)
+			return;
+
+		for (SnapshotBlock& block : s_blocks)
+		{
+			const uptr offset = info.addr - (uptr)block.base;
+			if (offset >= block.size)
+				continue;
+
+			const uint page = offset / PCSX2_PAGESIZE;
+			if (block.copied[page])
+				return;
+
+			u8* src = block.base + page * PCSX2_PAGESIZE;
+			memcpy(block.shadow + page * PCSX2_PAGESIZE, src, PCSX2_PAGESIZE);
+			block.copied[page] = true;
+			block.copies++;
+
+			if (IsCodeProtected(block, page))
+				return;
+
+			HostSys::MemProtect(src, PCSX2_PAGESIZE, PageAccess_ReadWrite());
+			handled = true;
+			return;
+		}
+	}
+};
+
+static SnapshotPageFaultHandler* s_faultHandler = NULL;
+
+// --------------------------------------------------------------------------------------
+//  MemorySnapshot  (implementations)
+// --------------------------------------------------------------------------------------
+void MemorySnapshot::Capture()
+{
+	if (!eeMem || !iopMem)
+		return;
+
+	vu1Thread.WaitVU();
+
+	if (!s_faultHandler)
+		s_faultHandler = new SnapshotPageFaultHandler();
+
+	Threading::ScopedLock lock(PageFault_Mutex);
+
+	if (!s_active)
+	{
+		const u8* bases[] = {eeMem->Main, eeHw, iopMem->Main, iopHw, VU0.Micro};
+		const uint sizes[] = {
+			Ps2MemSize::MainRam + Ps2MemSize::Scratch, Ps2MemSize::Hardware,
+			Ps2MemSize::IopRam, Ps2MemSize::IopHardware,
+			VU0_PROGSIZE + VU0_MEMSIZE + VU1_PROGSIZE + VU1_MEMSIZE,
+		};
+
+		for (uint i = 0; i < sizeof(s_blocks) / sizeof(s_blocks[0]); i++)
+		{
+			SnapshotBlock& block = s_blocks[i];
+			block.base   = (u8*)bases[i];
+			block.size   = sizes[i];
+			block.eeMain = (i == 0);
+			block.eager  = (i == 1 || i == 2 || i == 3);
+
+			if (!block.shadow)
+			{
+				block.shadow = (u8*)HostSys::MmapReserve(0, block.size);
+				HostSys::MmapCommitPtr(block.shadow, block.size, PageAccess_ReadWrite());
+			}
+		}
+	}
+
+	for (SnapshotBlock& block : s_blocks)
+	{
+		DropCopies(block);
+		if (block.eager)
+			CopyEager(block);
+		else
+			SetUncopiedAccess(block, true);
+	}
+
+	s_active = true;
+}
+
+void MemorySnapshot::Release()
+{
+	if (!s_active)
+		return;
+
+	vu1Thread.WaitVU();
+
+	Threading::ScopedLock lock(PageFault_Mutex);
+
+	for (SnapshotBlock& block : s_blocks)
+	{
+		if (!block.eager)
+			SetUncopiedAccess(block, false);
+		DropCopies(block);
+	}
+
+	s_active = false;
+}
+
+bool MemorySnapshot::IsActive()
+{
+	return s_active;
+}
+
+uint MemorySnapshot::GetCopiedPages()
+{
+	uint copies = 0;
+	for (const SnapshotBlock& block : s_blocks)
+		copies += block.copies;
+	return copies;
+}
+
+void MemorySnapshot::Save(SaveStateBase& state)
+{
+	if (!s_active)
+	{
+		state.FreezeMainMemory();
+		return;
+	}
+
+	uint total = 0;
+	for (const SnapshotBlock& block : s_blocks)
+		total += block.size;
+	state.PrepBlock(total);
+
+	// Page by page, so that the emulation is only held up for one copy when it
+	// writes to a page that is being saved
+	for (SnapshotBlock& block : s_blocks)
+	{
+		for (uint offset = 0; offset < block.size; offset += PCSX2_PAGESIZE)
+		{
+			Threading::ScopedLock lock(PageFault_Mutex);
+			const u8* src = block.copied[offset / PCSX2_PAGESIZE] ? block.shadow : block.base;
+			state.FreezeMem((void*)(src + offset), PCSX2_PAGESIZE);
+		}
+	}
+}
+
+void MemorySnapshot::Restore()
+{
+	if (!s_active)
+		return;
+
+	vu1Thread.WaitVU();
+
+	// Writing a page the EE block tracking protects faults into its handler (copied
+	// pages are ignored by ours), which clears the blocks of the page as usual.
+	for (SnapshotBlock& block : s_blocks)
+	{
+		for (uint page = 0; page < block.copied.size(); page++)
+		{
+			if (block.copied[page])
+				memcpy(block.base + page * PCSX2_PAGESIZE, block.shadow + page * PCSX2_PAGESIZE, PCSX2_PAGESIZE);
+		}
+	}
+}
+
+void MemorySnapshot::Reprotect()
+{
+	if (!s_active)
+		return;
+
+	Threading::ScopedLock lock(PageFault_Mutex);
+
+	for (SnapshotBlock& block : s_blocks)
+	{
+		if (!block.eager)
+			SetUncopiedAccess(block, true);
+	}
+}
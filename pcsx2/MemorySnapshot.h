@@ -0,0 +1,58 @@
+/*  PCSX2 - PS2 Emulator for PCs
+ *  Copyright (C) 2002-2022  PCSX2 Dev Team
+ *
+ *  PCSX2 is free software: you can redistribute it and/or modify it under the terms
+ *  of the GNU Lesser General Public License as published by the Free Software Found-
+ *  ation, either version 3 of the License, or (at your option) any later version.
+ *
+ *  PCSX2 is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ *  without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ *  PURPOSE.  See the GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along with PCSX2.
+ *  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+class SaveStateBase;
+
+// --------------------------------------------------------------------------------------
+//  MemorySnapshot
+// --------------------------------------------------------------------------------------
+// Copy-on-write snapshot of the memory FreezeMainMemory() saves: EE main memory and
+// scratchpad, EE and IOP hardware registers, IOP main memory and VU memory.
+//
+// Capture() write protects EE memory and VU memory, a page is copied aside by the page
+// fault handler the first time something writes to it afterwards. IOP memory and the
+// hardware registers are copied right away (2.1MB), the host kernel writes to IOP
+// memory for HostFs and those writes can't fault into the handler. So taking a
+// snapshot costs a few mprotect calls and that copy, and the rest of the copying is
+// limited to (and spread over) the pages the emulation actually writes before the
+// snapshot is released. With MTVU, Capture() first waits for the VU thread.
+//
+// Capture(), Restore() and Release() must be called from the EE thread (or with the EE
+// thread suspended); Save() can run on any thread while the emulation goes on.
+namespace MemorySnapshot
+{
+	// Takes a new snapshot, dropping the previous one
+	extern void Capture();
+	extern void Release();
+	extern bool IsActive();
+
+	// Pages the page fault handler copied aside since the capture
+	extern uint GetCopiedPages();
+
+	// Writes the snapshot the way FreezeMainMemory() writes the live memory
+	extern void Save(SaveStateBase& state);
+
+	// Copies the snapshot back into the guest memory, only pages written since the
+	// capture and the blocks copied at the capture are touched. The snapshot stays
+	// valid, so it can be restored again. Like loading a savestate, the caller has to
+	// clear the execution caches.
+	extern void Restore();
+
+	// Write protects the pages not copied yet again, for code that just made the
+	// guest memory writable (block tracking reset)
+	extern void Reprotect();
+}
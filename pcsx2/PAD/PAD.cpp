@@ -27,6 +27,9 @@
 #include <array>
 #include <cassert>
 #include <cmath>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
 #include "../../libretro/libretro.h"
 #include "../../libretro/input.h"
 
@@ -50,6 +53,36 @@ typedef struct
 } PADAnalog;
 
 static retro_input_state_t input_cb;
+
+// Deterministic mode: the frontend queues its input before running every frame
+// (PADqueueInput) and the EE takes one at every vsync start (PADlatchInput). The pads
+// read the latched frame, so a game sees the same input at the same emulated cycle
+// on every run, whenever the frontend happened to poll.
+struct PadInputFrame
+{
+	int16_t mask[2];         // RETRO_DEVICE_ID_JOYPAD_MASK
+	int16_t analog[2][2][2]; // left / right stick, x / y
+	int16_t pressure[2][16]; // analog buttons, by RETRO_DEVICE_ID_JOYPAD_*
+};
+
+static bool input_latching = false;
+static PadInputFrame input_latched;
+static std::deque<PadInputFrame> input_queue;
+static std::mutex input_mutex;
+static std::condition_variable input_cv;
+
+static int16_t pad_input(unsigned port, unsigned device, unsigned index, unsigned id)
+{
+	if (!input_latching)
+		return input_cb(port, device, index, id);
+	if (port > 1)
+		return 0;
+	if (device == RETRO_DEVICE_ANALOG)
+		return input_latched.analog[port][index == RETRO_DEVICE_INDEX_ANALOG_RIGHT][id == RETRO_DEVICE_ID_ANALOG_Y];
+	if (index == RETRO_DEVICE_INDEX_ANALOG_BUTTON)
+		return id < 16 ? input_latched.pressure[port][id] : 0;
+	return input_latched.mask[port];
+}
 extern struct retro_rumble_interface rumble;
 
 static int keymap[] =
@@ -161,36 +194,36 @@ static u8 key_status_get(u32 pad, u32 index)
 	{
 		case PAD_R_LEFT:
 		case PAD_R_RIGHT:
-			x   = input_cb(pad, RETRO_DEVICE_ANALOG, RETRO_DEVICE_INDEX_ANALOG_RIGHT, RETRO_DEVICE_ID_ANALOG_X);
-			y   = input_cb(pad, RETRO_DEVICE_ANALOG, RETRO_DEVICE_INDEX_ANALOG_RIGHT, RETRO_DEVICE_ID_ANALOG_Y);
+			x   = pad_input(pad, RETRO_DEVICE_ANALOG, RETRO_DEVICE_INDEX_ANALOG_RIGHT, RETRO_DEVICE_ID_ANALOG_X);
+			y   = pad_input(pad, RETRO_DEVICE_ANALOG, RETRO_DEVICE_INDEX_ANALOG_RIGHT, RETRO_DEVICE_ID_ANALOG_Y);
 			val = ApplyDeadZoneX(x, y, option_pad_right_deadzone);
 			break;
 
 		case PAD_R_DOWN:
 		case PAD_R_UP:
-			x   = input_cb(pad, RETRO_DEVICE_ANALOG, RETRO_DEVICE_INDEX_ANALOG_RIGHT, RETRO_DEVICE_ID_ANALOG_X);
-			y   = input_cb(pad, RETRO_DEVICE_ANALOG, RETRO_DEVICE_INDEX_ANALOG_RIGHT, RETRO_DEVICE_ID_ANALOG_Y);
+			x   = pad_input(pad, RETRO_DEVICE_ANALOG, RETRO_DEVICE_INDEX_ANALOG_RIGHT, RETRO_DEVICE_ID_ANALOG_X);
+			y   = pad_input(pad, RETRO_DEVICE_ANALOG, RETRO_DEVICE_INDEX_ANALOG_RIGHT, RETRO_DEVICE_ID_ANALOG_Y);
 			val = ApplyDeadZoneY(x, y, option_pad_right_deadzone);
 			break;
 
 		case PAD_L_LEFT:
 		case PAD_L_RIGHT:
-			x   = input_cb(pad, RETRO_DEVICE_ANALOG, RETRO_DEVICE_INDEX_ANALOG_LEFT, RETRO_DEVICE_ID_ANALOG_X);
-			y   = input_cb(pad, RETRO_DEVICE_ANALOG, RETRO_DEVICE_INDEX_ANALOG_LEFT, RETRO_DEVICE_ID_ANALOG_Y);
+			x   = pad_input(pad, RETRO_DEVICE_ANALOG, RETRO_DEVICE_INDEX_ANALOG_LEFT, RETRO_DEVICE_ID_ANALOG_X);
+			y   = pad_input(pad, RETRO_DEVICE_ANALOG, RETRO_DEVICE_INDEX_ANALOG_LEFT, RETRO_DEVICE_ID_ANALOG_Y);
 			val = ApplyDeadZoneX(x, y, option_pad_left_deadzone);
 			break;
 
 		case PAD_L_DOWN:
 		case PAD_L_UP:
-			x   = input_cb(pad, RETRO_DEVICE_ANALOG, RETRO_DEVICE_INDEX_ANALOG_LEFT, RETRO_DEVICE_ID_ANALOG_X);
-			y   = input_cb(pad, RETRO_DEVICE_ANALOG, RETRO_DEVICE_INDEX_ANALOG_LEFT, RETRO_DEVICE_ID_ANALOG_Y);
+			x   = pad_input(pad, RETRO_DEVICE_ANALOG, RETRO_DEVICE_INDEX_ANALOG_LEFT, RETRO_DEVICE_ID_ANALOG_X);
+			y   = pad_input(pad, RETRO_DEVICE_ANALOG, RETRO_DEVICE_INDEX_ANALOG_LEFT, RETRO_DEVICE_ID_ANALOG_Y);
 			val = ApplyDeadZoneY(x, y, option_pad_left_deadzone);
 			break;
 
 		default:
 			if (index < 16)
 			{
-				val = input_cb(pad, RETRO_DEVICE_JOYPAD, RETRO_DEVICE_INDEX_ANALOG_BUTTON, keymap[index]);
+				val = pad_input(pad, RETRO_DEVICE_JOYPAD, RETRO_DEVICE_INDEX_ANALOG_BUTTON, keymap[index]);
 				return 0xFF - (val >> 7);
 			}
 			break;
@@ -281,7 +314,7 @@ static u8 pad_poll(u8 value)
 					b1=b1 & 0x1f;
 #endif
 
-		u16 mask         = input_cb(query.port, RETRO_DEVICE_JOYPAD,
+		u16 mask         = pad_input(query.port, RETRO_DEVICE_JOYPAD,
 			0, RETRO_DEVICE_ID_JOYPAD_MASK);
 		uint16_t buttons = 0;
 		for (int i = 0; i < 16; i++)
@@ -517,6 +550,46 @@ void retro_set_input_state(retro_input_state_t cb)
 	input_cb = cb;
 }
 
+void PADsetInputLatching(bool enabled)
+{
+	std::lock_guard<std::mutex> lock(input_mutex);
+	input_latching = enabled;
+	input_queue.clear();
+	memset(&input_latched, 0, sizeof(input_latched));
+}
+
+void PADqueueInput(void)
+{
+	PadInputFrame frame;
+
+	for (unsigned port = 0; port < 2; port++)
+	{
+		frame.mask[port] = input_cb(port, RETRO_DEVICE_JOYPAD, 0, RETRO_DEVICE_ID_JOYPAD_MASK);
+		for (unsigned stick = 0; stick < 2; stick++)
+			for (unsigned axis = 0; axis < 2; axis++)
+				frame.analog[port][stick][axis] = input_cb(port, RETRO_DEVICE_ANALOG,
+					stick ? RETRO_DEVICE_INDEX_ANALOG_RIGHT : RETRO_DEVICE_INDEX_ANALOG_LEFT,
+					axis ? RETRO_DEVICE_ID_ANALOG_Y : RETRO_DEVICE_ID_ANALOG_X);
+		for (unsigned id = 0; id < 16; id++)
+			frame.pressure[port][id] = input_cb(port, RETRO_DEVICE_JOYPAD, RETRO_DEVICE_INDEX_ANALOG_BUTTON, id);
+	}
+
+	std::lock_guard<std::mutex> lock(input_mutex);
+	input_queue.push_back(frame);
+	input_cv.notify_one();
+}
+
+bool PADlatchInput(void)
+{
+	std::unique_lock<std::mutex> lock(input_mutex);
+	if (!input_cv.wait_for(lock, std::chrono::milliseconds(1), [] { return !input_queue.empty(); }))
+		return false;
+
+	input_latched = input_queue.front();
+	input_queue.pop_front();
+	return true;
+}
+
 static void GamePad_DoRumble(unsigned type, unsigned pad)
 {
 	if (!rumble_enabled)
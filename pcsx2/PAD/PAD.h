@@ -90,6 +90,14 @@ u8 PADpoll(u8 value);
 s32 PADsetSlot(u8 port, u8 slot);
 void PADshutdown(void);
 
+// Deterministic mode: the pads read the input the EE latched at vsync start.
+// PADqueueInput() is called by the frontend before every frame, PADlatchInput() by
+// the EE at every vsync start; it waits a millisecond at most and returns false if
+// the frame wasn't queued yet.
+void PADsetInputLatching(bool enabled);
+void PADqueueInput(void);
+bool PADlatchInput(void);
+
 #define MODE_DIGITAL 0x41
 #define MODE_ANALOG 0x73
 #define MODE_DS2_NATIVE 0x79
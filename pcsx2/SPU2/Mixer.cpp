@@ -13,12 +13,8 @@
  *  If not, see <http://www.gnu.org/licenses/>.
  */
 
-#include <libretro.h>
-
 #include "Global.h"
-
-/* Forward declaration */
-extern retro_audio_sample_t sample_cb;
+#include "SndOut.h"
 
 /* Performs a 64-bit multiplication between two values and returns the
  * high 32 bits as a result (discarding the fractional 32 bits).
@@ -292,6 +288,57 @@ static const s16 interpTable[0x200] = {
 	0x5997, 0x599E, 0x59A4, 0x59A9, 0x59AD, 0x59B0, 0x59B2, 0x59B3  //
 };
 
+/* Noise generator state, shared by every noise voice of both cores. */
+static u16 NoiseLFSR = 0xC0FEu;
+
+static SPU2_FORCEINLINE s32 GetNoiseValue(void)
+{
+	u16 bit   = NoiseLFSR ^ (NoiseLFSR << 3) ^ (NoiseLFSR << 4) ^ (NoiseLFSR << 5);
+	NoiseLFSR = (NoiseLFSR << 1) | (bit >> 15);
+	return (s16)NoiseLFSR;
+}
+
+static SPU2_FORCEINLINE void UpdateVoiceVolume(V_Voice& vc)
+{
+	/* Most games don't use much volume slide effects.  So only call the UpdateVolume
+	 * methods when needed by checking the flag outside the method here...
+	 * (Note: Ys 6 : Ark of Nephistm uses these effects)
+	 */
+	if ((vc.Volume.Left.Mode & VOLFLAG_SLIDE_ENABLE)  && vc.Volume.Left.Increment  != 0x7f)
+		vc.Volume.Left.Update();
+	if ((vc.Volume.Right.Mode & VOLFLAG_SLIDE_ENABLE) && vc.Volume.Right.Increment != 0x7f)
+		vc.Volume.Right.Update();
+}
+
+static SPU2_FORCEINLINE void FetchVoiceSamples(V_Core& thiscore, uint voiceidx)
+{
+	V_Voice& vc(thiscore.Voices[voiceidx]);
+
+	while (vc.SP > 0)
+	{
+		vc.PV4 = vc.PV3;
+		vc.PV3 = vc.PV2;
+		vc.PV2 = vc.PV1;
+		vc.PV1 = GetNextDataBuffered(thiscore, voiceidx);
+		vc.SP -= 0x1000;
+	}
+}
+
+/* Update ADSR (applies to normal and noise sources)
+ *
+ * Note!  It's very important that ADSR stay as accurate as possible.  By the way
+ * it is used, various sound effects can end prematurely if we truncate more than
+ * one or two bits.  Best result comes from no truncation at all, which is why we
+ * use a full 64-bit multiply/result when applying it.
+ */
+static SPU2_FORCEINLINE void UpdateVoiceEnvelope(V_Voice& vc)
+{
+	if (vc.ADSR.Phase == 0)
+		vc.ADSR.Value = 0;
+	else if (!vc.ADSR.Calculate())
+		vc.Stop();
+}
+
 static SPU2_FORCEINLINE void MixCoreVoices(VoiceMixSet& dest, const uint coreidx)
 {
 	V_Core& thiscore(Cores[coreidx]);
@@ -303,15 +350,7 @@ static SPU2_FORCEINLINE void MixCoreVoices(VoiceMixSet& dest, const uint coreidx
 
 		V_Voice& vc(thiscore.Voices[voiceidx]);
 
-		/* Most games don't use much volume slide effects.  So only call the UpdateVolume
-		 * methods when needed by checking the flag outside the method here...
-		 * (Note: Ys 6 : Ark of Nephistm uses these effects)
-		 */
-
-		if ((vc.Volume.Left.Mode & VOLFLAG_SLIDE_ENABLE)  && vc.Volume.Left.Increment  != 0x7f)
-			vc.Volume.Left.Update();
-		if ((vc.Volume.Right.Mode & VOLFLAG_SLIDE_ENABLE) && vc.Volume.Right.Increment != 0x7f)
-			vc.Volume.Right.Update();
+		UpdateVoiceVolume(vc);
 
 		/* SPU2 Note: The spu2 continues to process voices for eternity, always, so we
 		 * have to run through all the motions of updating the voice regardless of it's
@@ -333,22 +372,12 @@ static SPU2_FORCEINLINE void MixCoreVoices(VoiceMixSet& dest, const uint coreidx
 			if (vc.Noise)
 			{
 				/* Get noise values */
-				static u16 lfsr = 0xC0FEu;
-				u16 bit         = lfsr ^ (lfsr << 3) ^ (lfsr << 4) ^ (lfsr << 5);
-				lfsr            = (lfsr << 1) | (bit >> 15);
-				Value           = (s16)lfsr;
+				Value           = GetNoiseValue();
 			}
 			else
 			{         
 				/* Get voice values */
-				while (vc.SP > 0)
-				{
-					vc.PV4 = vc.PV3;
-					vc.PV3 = vc.PV2;
-					vc.PV2 = vc.PV1;
-					vc.PV1 = GetNextDataBuffered(thiscore, voiceidx);
-					vc.SP -= 0x1000;
-				}
+				FetchVoiceSamples(thiscore, voiceidx);
 
 				s32 mu  = vc.SP + 0x1000;
 				s32 pv4 = vc.PV4; 
@@ -363,17 +392,8 @@ static SPU2_FORCEINLINE void MixCoreVoices(VoiceMixSet& dest, const uint coreidx
 					+   ((interpTable[0x000 + i] * pv1) >> 15);
 			}
 
-			/* Update and Apply ADSR  (applies to normal and noise sources)
-			 *
-			 * Note!  It's very important that ADSR stay as accurate as possible.  By the way
-			 * it is used, various sound effects can end prematurely if we truncate more than
-			 * one or two bits.  Best result comes from no truncation at all, which is why we
-			 * use a full 64-bit multiply/result here.
-			 */
-			if (vc.ADSR.Phase == 0)
-				vc.ADSR.Value = 0;
-			else if (!vc.ADSR.Calculate())
-				vc.Stop();
+			/* Update and Apply ADSR */
+			UpdateVoiceEnvelope(vc);
 
 			Value    = MULSHR32(Value, vc.ADSR.Value);
 			vc.OutX  = Value;
@@ -403,6 +423,259 @@ static SPU2_FORCEINLINE void MixCoreVoices(VoiceMixSet& dest, const uint coreidx
 	}
 }
 
+// --------------------------------------------------------------------------------------
+//  Structure-of-arrays voice mixer
+// --------------------------------------------------------------------------------------
+// The per-voice state machines (volume slides, ADPCM fetch, ADSR) stay scalar and run
+// in voice order, exactly like MixCoreVoices above.  They fill a VoiceLanes block with
+// everything the rest of the voice pipeline needs, and the gaussian interpolation,
+// envelope and volume multiplies and the gate mixing are then done 8 (AVX2) or 4
+// (SSE4.1) voices per instruction.  All of it is integer math with the same rounding,
+// so the output is bit-exact with the scalar path, which is kept for validation
+// (define SPU2_SCALAR_MIXER to force it) and for the cases the SIMD path cannot
+// reproduce (see CanMixCoreVoicesSIMD).
+
+#if !defined(SPU2_SCALAR_MIXER) && (defined(__AVX2__) || defined(__SSE4_1__))
+#define SPU2_SIMD_MIXER
+#endif
+
+#ifdef SPU2_SIMD_MIXER
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#else
+#include <smmintrin.h>
+#endif
+
+struct alignas(32) VoiceLanes
+{
+	s32 Coef[4][NUM_VOICES];  // gaussian coefficients for PV4..PV1 (zero for noise voices)
+	s32 PV[4][NUM_VOICES];    // PV4..PV1
+	s32 Noise[NUM_VOICES];    // noise sample (zero for ADPCM voices)
+	s32 Active[NUM_VOICES];   // -1 if the voice was keyed on at the start of the tick
+	s32 Envelope[NUM_VOICES]; // ADSR.Value after this tick's update
+	s32 VolL[NUM_VOICES];
+	s32 VolR[NUM_VOICES];
+	s32 Gates[4][NUM_VOICES]; // DryL, DryR, WetL, WetR (sign-extended)
+	s32 Out[NUM_VOICES];      // voice value, post ADSR
+};
+
+static VoiceLanes voice_lanes;
+
+/* Pitch modulation makes each voice depend on the previous voice's output of the same
+ * tick, and voices playing from the voice output areas (0x400-0x7FF and 0xC00-0xFFF)
+ * would observe the write-back of voices 1 and 3 mid-loop.  Both need the scalar path.
+ */
+static SPU2_FORCEINLINE bool CanMixCoreVoicesSIMD(const V_Core& thiscore)
+{
+	for (uint voiceidx = 0; voiceidx < NUM_VOICES; ++voiceidx)
+	{
+		const V_Voice& vc(thiscore.Voices[voiceidx]);
+
+		if (vc.Modulated && voiceidx != 0)
+			return false;
+		if ((vc.NextA & 0xFFFFF) < 0x1008 || vc.LoopStartA < 0x1000)
+			return false;
+	}
+	return true;
+}
+
+#if defined(__AVX2__)
+
+/* Lane-wise MULSHR32: high 32 bits of the signed 64-bit products. */
+static SPU2_FORCEINLINE __m256i MulShr32_AVX2(__m256i a, __m256i b)
+{
+	const __m256i even = _mm256_mul_epi32(a, b);
+	const __m256i odd  = _mm256_mul_epi32(_mm256_srli_epi64(a, 32), _mm256_srli_epi64(b, 32));
+	return _mm256_blend_epi32(_mm256_srli_epi64(even, 32), odd, 0xAA);
+}
+
+static SPU2_FORCEINLINE s32 HSum_AVX2(__m256i v)
+{
+	__m128i r = _mm_add_epi32(_mm256_castsi256_si128(v), _mm256_extracti128_si256(v, 1));
+	r         = _mm_add_epi32(r, _mm_shuffle_epi32(r, _MM_SHUFFLE(1, 0, 3, 2)));
+	r         = _mm_add_epi32(r, _mm_shuffle_epi32(r, _MM_SHUFFLE(2, 3, 0, 1)));
+	return _mm_cvtsi128_si32(r);
+}
+
+static SPU2_FORCEINLINE void MixVoiceLanes(VoiceLanes& lanes, VoiceMixSet& dest)
+{
+	__m256i dryl = _mm256_setzero_si256();
+	__m256i dryr = _mm256_setzero_si256();
+	__m256i wetl = _mm256_setzero_si256();
+	__m256i wetr = _mm256_setzero_si256();
+
+#define LANES(arr) _mm256_load_si256((const __m256i*)&(arr)[v])
+	for (uint v = 0; v < NUM_VOICES; v += 8)
+	{
+		/* Gaussian interpolation (or noise) */
+		__m256i value = LANES(lanes.Noise);
+		for (int k = 0; k < 4; k++)
+			value = _mm256_add_epi32(value, _mm256_srai_epi32(_mm256_mullo_epi32(LANES(lanes.Coef[k]), LANES(lanes.PV[k])), 15));
+
+		/* Apply ADSR */
+		value = _mm256_and_si256(MulShr32_AVX2(value, LANES(lanes.Envelope)), LANES(lanes.Active));
+		_mm256_store_si256((__m256i*)&lanes.Out[v], value);
+
+		/* APPLY_VOLUME */
+		value             = _mm256_slli_epi32(value, 1);
+		const __m256i l   = MulShr32_AVX2(value, LANES(lanes.VolL));
+		const __m256i r   = MulShr32_AVX2(value, LANES(lanes.VolR));
+
+		dryl = _mm256_add_epi32(dryl, _mm256_and_si256(l, LANES(lanes.Gates[0])));
+		dryr = _mm256_add_epi32(dryr, _mm256_and_si256(r, LANES(lanes.Gates[1])));
+		wetl = _mm256_add_epi32(wetl, _mm256_and_si256(l, LANES(lanes.Gates[2])));
+		wetr = _mm256_add_epi32(wetr, _mm256_and_si256(r, LANES(lanes.Gates[3])));
+	}
+#undef LANES
+
+	dest.Dry.Left  += HSum_AVX2(dryl);
+	dest.Dry.Right += HSum_AVX2(dryr);
+	dest.Wet.Left  += HSum_AVX2(wetl);
+	dest.Wet.Right += HSum_AVX2(wetr);
+}
+
+#else
+
+/* Lane-wise MULSHR32: high 32 bits of the signed 64-bit products. */
+static SPU2_FORCEINLINE __m128i MulShr32_SSE4(__m128i a, __m128i b)
+{
+	const __m128i even = _mm_mul_epi32(a, b);
+	const __m128i odd  = _mm_mul_epi32(_mm_srli_epi64(a, 32), _mm_srli_epi64(b, 32));
+	return _mm_blend_epi16(_mm_srli_epi64(even, 32), odd, 0xCC);
+}
+
+static SPU2_FORCEINLINE s32 HSum_SSE4(__m128i r)
+{
+	r = _mm_add_epi32(r, _mm_shuffle_epi32(r, _MM_SHUFFLE(1, 0, 3, 2)));
+	r = _mm_add_epi32(r, _mm_shuffle_epi32(r, _MM_SHUFFLE(2, 3, 0, 1)));
+	return _mm_cvtsi128_si32(r);
+}
+
+static SPU2_FORCEINLINE void MixVoiceLanes(VoiceLanes& lanes, VoiceMixSet& dest)
+{
+	__m128i dryl = _mm_setzero_si128();
+	__m128i dryr = _mm_setzero_si128();
+	__m128i wetl = _mm_setzero_si128();
+	__m128i wetr = _mm_setzero_si128();
+
+#define LANES(arr) _mm_load_si128((const __m128i*)&(arr)[v])
+	for (uint v = 0; v < NUM_VOICES; v += 4)
+	{
+		/* Gaussian interpolation (or noise) */
+		__m128i value = LANES(lanes.Noise);
+		for (int k = 0; k < 4; k++)
+			value = _mm_add_epi32(value, _mm_srai_epi32(_mm_mullo_epi32(LANES(lanes.Coef[k]), LANES(lanes.PV[k])), 15));
+
+		/* Apply ADSR */
+		value = _mm_and_si128(MulShr32_SSE4(value, LANES(lanes.Envelope)), LANES(lanes.Active));
+		_mm_store_si128((__m128i*)&lanes.Out[v], value);
+
+		/* APPLY_VOLUME */
+		value             = _mm_slli_epi32(value, 1);
+		const __m128i l   = MulShr32_SSE4(value, LANES(lanes.VolL));
+		const __m128i r   = MulShr32_SSE4(value, LANES(lanes.VolR));
+
+		dryl = _mm_add_epi32(dryl, _mm_and_si128(l, LANES(lanes.Gates[0])));
+		dryr = _mm_add_epi32(dryr, _mm_and_si128(r, LANES(lanes.Gates[1])));
+		wetl = _mm_add_epi32(wetl, _mm_and_si128(l, LANES(lanes.Gates[2])));
+		wetr = _mm_add_epi32(wetr, _mm_and_si128(r, LANES(lanes.Gates[3])));
+	}
+#undef LANES
+
+	dest.Dry.Left  += HSum_SSE4(dryl);
+	dest.Dry.Right += HSum_SSE4(dryr);
+	dest.Wet.Left  += HSum_SSE4(wetl);
+	dest.Wet.Right += HSum_SSE4(wetr);
+}
+
+#endif
+
+static SPU2_FORCEINLINE void MixCoreVoicesSIMD(VoiceMixSet& dest, const uint coreidx)
+{
+	V_Core& thiscore(Cores[coreidx]);
+	VoiceLanes& lanes(voice_lanes);
+
+	for (uint voiceidx = 0; voiceidx < NUM_VOICES; ++voiceidx)
+	{
+		V_Voice& vc(thiscore.Voices[voiceidx]);
+
+		UpdateVoiceVolume(vc);
+
+		/* No pitch modulation here, see CanMixCoreVoicesSIMD */
+		vc.SP += std::min((s32)vc.Pitch, 0x3FFF);
+
+		if (vc.ADSR.Phase > 0)
+		{
+			if (vc.Noise)
+			{
+				lanes.Noise[voiceidx] = GetNoiseValue();
+				for (int k = 0; k < 4; k++)
+					lanes.Coef[k][voiceidx] = 0;
+			}
+			else
+			{
+				FetchVoiceSamples(thiscore, voiceidx);
+
+				const s32 i             = ((vc.SP + 0x1000) & 0x0FF0) >> 4;
+				lanes.Noise[voiceidx]   = 0;
+				lanes.Coef[0][voiceidx] = interpTable[0x0FF - i];
+				lanes.Coef[1][voiceidx] = interpTable[0x1FF - i];
+				lanes.Coef[2][voiceidx] = interpTable[0x100 + i];
+				lanes.Coef[3][voiceidx] = interpTable[0x000 + i];
+				lanes.PV[0][voiceidx]   = vc.PV4;
+				lanes.PV[1][voiceidx]   = vc.PV3;
+				lanes.PV[2][voiceidx]   = vc.PV2;
+				lanes.PV[3][voiceidx]   = vc.PV1;
+			}
+
+			UpdateVoiceEnvelope(vc);
+
+			lanes.Active[voiceidx]   = -1;
+			lanes.Envelope[voiceidx] = vc.ADSR.Value;
+			lanes.VolL[voiceidx]     = vc.Volume.Left.Value;
+			lanes.VolR[voiceidx]     = vc.Volume.Right.Value;
+		}
+		else
+		{
+			while (vc.SP >= 0)
+				GetNextDataDummy(thiscore, voiceidx); /* Dummy is enough */
+			lanes.Active[voiceidx] = 0;
+		}
+
+		lanes.Gates[0][voiceidx] = thiscore.VoiceGates[voiceidx].DryL;
+		lanes.Gates[1][voiceidx] = thiscore.VoiceGates[voiceidx].DryR;
+		lanes.Gates[2][voiceidx] = thiscore.VoiceGates[voiceidx].WetL;
+		lanes.Gates[3][voiceidx] = thiscore.VoiceGates[voiceidx].WetR;
+	}
+
+	MixVoiceLanes(lanes, dest);
+
+	for (uint voiceidx = 0; voiceidx < NUM_VOICES; ++voiceidx)
+	{
+		if (lanes.Active[voiceidx])
+			thiscore.Voices[voiceidx].OutX = lanes.Out[voiceidx];
+	}
+
+	// Write-back of raw voice data (post ADSR applied)
+	spu2M_WriteFast(((0 == coreidx) ? 0x400 : 0xc00) + OutPos, lanes.Out[1]);
+	spu2M_WriteFast(((0 == coreidx) ? 0x600 : 0xe00) + OutPos, lanes.Out[3]);
+}
+
+#endif
+
+static SPU2_FORCEINLINE void MixCore(VoiceMixSet& dest, const uint coreidx)
+{
+#ifdef SPU2_SIMD_MIXER
+	if (CanMixCoreVoicesSIMD(Cores[coreidx]))
+	{
+		MixCoreVoicesSIMD(dest, coreidx);
+		return;
+	}
+#endif
+	MixCoreVoices(dest, coreidx);
+}
+
 StereoOut32 V_Core::Mix(const VoiceMixSet& inVoices, const StereoOut32& Input, const StereoOut32& Ext)
 {
 	if ((MasterVol.Left.Mode & VOLFLAG_SLIDE_ENABLE)  && MasterVol.Left.Increment  != 0x7f)
@@ -498,7 +771,12 @@ StereoOut32 V_Core::Mix(const VoiceMixSet& inVoices, const StereoOut32& Input, c
 			TD.Right + right.Right);
 }
 
-void SPU2_Mix(void)
+/* Mixed samples are handed to the frontend one block at a time, the block
+ * being mixed is in place in the output ring (see SndOut.h) */
+static StereoOut16* OutBuffer;
+static u32 OutBufferPos = 0;
+
+static void SPU2_Mix(void)
 {
 	const StereoOut32& core0_data = Cores[0].ReadInput();
 	const StereoOut32& core1_data = Cores[1].ReadInput();
@@ -517,8 +795,8 @@ void SPU2_Mix(void)
 
 	/* Todo: Replace me with memzero initializer! */
 	VoiceMixSet VoiceData[2] = {VoiceMixSet::Empty, VoiceMixSet::Empty}; /* mixed voice data for each core. */
-	MixCoreVoices(VoiceData[0], 0);
-	MixCoreVoices(VoiceData[1], 1);
+	MixCore(VoiceData[0], 0);
+	MixCore(VoiceData[1], 1);
 
 	StereoOut32 Ext(Cores[0].Mix(VoiceData[0], InputData[0], StereoOut32(0, 0)));
 
@@ -549,13 +827,40 @@ void SPU2_Mix(void)
 		Out.Right = MULSHR32(Out.Right,Cores[1].MasterVol.Right.Value);
 	}
 
-	StereoOut16 out16;
+	if (OutBufferPos == 0)
+		OutBuffer = SndOut_Reserve();
+
+	StereoOut16& out16 = OutBuffer[OutBufferPos++];
 	out16.Left        = (s16)CLAMP_MIX(Out.Left);
 	out16.Right       = (s16)CLAMP_MIX(Out.Right);
-	sample_cb(out16.Left, out16.Right);
 
 	/* Update AutoDMA output positioning */
 	OutPos++;
 	if (OutPos >= 0x200)
 		OutPos = 0;
 }
+
+u32 SPU2_MixBlock(u32 ticks)
+{
+	u32 mixed = 0;
+
+	while (mixed < ticks)
+	{
+		Cycles++;
+		SPU2_Mix();
+		mixed++;
+
+		if (OutBufferPos == SPU2_MIX_BLOCK_SIZE)
+		{
+			SndOut_Commit();
+			OutBufferPos = 0;
+		}
+
+		/* End the block on the tick that requested an IRQ, so it still gets
+		 * raised on the next tick like it would with per-tick dispatch. */
+		if (has_to_call_irq)
+			break;
+	}
+
+	return mixed;
+}
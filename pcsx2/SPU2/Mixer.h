@@ -34,4 +34,6 @@ struct StereoOut32
 
 #define CLAMP_MIX(x) (std::min(std::max((x), -0x8000), 0x7fff))
 
-extern void SPU2_Mix(void);
+// Mixes up to 'ticks' samples and returns the number actually mixed, which
+// is less when a voice, DMA or effects access raised an SPU2 IRQ.
+extern u32 SPU2_MixBlock(u32 ticks);
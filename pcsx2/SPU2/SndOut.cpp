@@ -0,0 +1,208 @@
+/*  PCSX2 - PS2 Emulator for PCs
+ *  Copyright (C) 2002-2022  PCSX2 Dev Team
+ *
+ *  PCSX2 is free software: you can redistribute it and/or modify it under the terms
+ *  of the GNU Lesser General Public License as published by the Free Software Found-
+ *  ation, either version 3 of the License, or (at your option) any later version.
+ *
+ *  PCSX2 is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ *  without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ *  PURPOSE.  See the GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along with PCSX2.
+ *  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <atomic>
+
+#include <libretro.h>
+
+#include "Global.h"
+#include "SndOut.h"
+#include "../Config.h"
+
+extern retro_audio_sample_batch_t batch_cb;
+
+/* About 170 ms, a whole number of mixer blocks so that a block never wraps */
+#define SNDOUT_RING_SIZE 8192
+#define SNDOUT_RING_MASK (SNDOUT_RING_SIZE - 1)
+
+/* Largest deviation from the nominal rate, for the ring and for the frontend
+ * buffer each. The drain only settles while the clock skew between the EE and
+ * the frontend fits in it with some room, a whole percent covers the usual
+ * half a percent at half the frontend buffer's range. Still not audible. */
+#define SNDOUT_MAX_DEVIATION 0.01
+
+static StereoOut16 s_ring[SNDOUT_RING_SIZE];
+
+/* The block sent directly without rate control, or dropped when the ring is full */
+static StereoOut16 s_block[SPU2_MIX_BLOCK_SIZE];
+static StereoOut16* s_reserved = s_block;
+
+/* Running sample counts, the fill is their difference. On lines of their own
+ * since each is written by a different thread. */
+alignas(64) static std::atomic<u32> s_write_pos(0);
+alignas(64) static std::atomic<u32> s_read_pos(0);
+
+static std::atomic<bool> s_rate_control(false);
+static std::atomic<u64> s_underruns(0);
+static std::atomic<u64> s_overruns(0);
+static std::atomic<u32> s_fill(0);
+static std::atomic<float> s_ratio(1.0f);
+
+/* Frontend buffer occupancy in percent, -1 when it isn't reported */
+static std::atomic<int> s_host_occupancy(-1);
+
+/* Drain state, only touched by the frontend thread */
+static u32 s_last_write;
+static double s_frame_samples = 48000 / (60 / 1.001);
+static double s_in_frac, s_out_frac;
+static StereoOut16 s_last_sample;
+static StereoOut16 s_out[SNDOUT_RING_SIZE + SNDOUT_RING_SIZE / 64];
+
+void SndOut_Open(void)
+{
+	s_rate_control.store(EmuConfig.AudioRateControl, std::memory_order_relaxed);
+}
+
+StereoOut16* SndOut_Reserve(void)
+{
+	s_reserved = s_block;
+
+	if (s_rate_control.load(std::memory_order_relaxed))
+	{
+		const u32 write = s_write_pos.load(std::memory_order_relaxed);
+		if (write - s_read_pos.load(std::memory_order_acquire) <= SNDOUT_RING_SIZE - SPU2_MIX_BLOCK_SIZE)
+			s_reserved = &s_ring[write & SNDOUT_RING_MASK];
+	}
+
+	return s_reserved;
+}
+
+void SndOut_Commit(void)
+{
+	if (s_reserved != s_block)
+		s_write_pos.store(s_write_pos.load(std::memory_order_relaxed) + SPU2_MIX_BLOCK_SIZE, std::memory_order_release);
+	else if (s_rate_control.load(std::memory_order_relaxed))
+		s_overruns.fetch_add(SPU2_MIX_BLOCK_SIZE, std::memory_order_relaxed);
+	else
+		batch_cb((const int16_t*)s_block, SPU2_MIX_BLOCK_SIZE);
+}
+
+static double RateDeviation(double error)
+{
+	return std::min(std::max(error, -1.0), 1.0) * SNDOUT_MAX_DEVIATION;
+}
+
+void SndOut_Drain(void)
+{
+	if (!s_rate_control.load(std::memory_order_relaxed))
+		return;
+
+	const u32 read  = s_read_pos.load(std::memory_order_relaxed);
+	const u32 write = s_write_pos.load(std::memory_order_acquire);
+	const u32 fill  = write - read;
+
+	/* What the EE mixes per frame, averaged since it runs ahead in bursts.
+	 * Follows the video mode without having to know it. */
+	s_frame_samples += ((double)(write - s_last_write) - s_frame_samples) * 0.05;
+	s_last_write     = write;
+
+	/* The ring is kept two frames full, which covers the EE running ahead, and
+	 * the frontend buffer half full */
+	const double target = 2 * s_frame_samples;
+	double in_ratio     = 1.0 + RateDeviation((fill - target) / target);
+	double out_ratio    = 1.0;
+
+	const int occupancy = s_host_occupancy.load(std::memory_order_relaxed);
+	if (occupancy >= 0)
+		out_ratio += RateDeviation((50 - occupancy) / 50.0);
+
+	s_in_frac  += s_frame_samples * in_ratio;
+	s_out_frac += s_frame_samples * out_ratio;
+
+	u32 in  = (u32)s_in_frac;
+	u32 out = (u32)s_out_frac;
+	s_in_frac  -= in;
+	s_out_frac -= out;
+
+	if (in > fill)
+	{
+		/* Play what there is at the same rate, the rest is lost */
+		s_underruns.fetch_add(1, std::memory_order_relaxed);
+		out = (u32)((u64)out * fill / in);
+		in  = fill;
+	}
+
+	out = std::min<u32>(out, sizeof(s_out) / sizeof(s_out[0]));
+
+	s_fill.store(fill - in, std::memory_order_relaxed);
+	s_ratio.store(out ? (float)in / out : 1.0f, std::memory_order_relaxed);
+
+	if (in == 0 || out == 0)
+		return;
+
+	const u32 start = read & SNDOUT_RING_MASK;
+
+	if (in == out)
+	{
+		/* Straight from the ring */
+		const u32 first = std::min<u32>(in, SNDOUT_RING_SIZE - start);
+		batch_cb((const int16_t*)&s_ring[start], first);
+		if (in > first)
+			batch_cb((const int16_t*)s_ring, in - first);
+	}
+	else
+	{
+		/* Linear interpolation, output sample j sits at input position
+		 * (j + 1) * in / out - 1, so that the last one is the last input sample
+		 * and the first one follows the previous drain's last */
+		for (u32 j = 0; j < out; j++)
+		{
+			const s64 pos = (s64)(((u64)(j + 1) * in << 16) / out) - 0x10000;
+			const s32 i   = (s32)(pos >> 16);
+			const s32 f   = (s32)(pos & 0xffff);
+
+			const StereoOut16& a = i < 0 ? s_last_sample : s_ring[(read + i) & SNDOUT_RING_MASK];
+			const StereoOut16& b = s_ring[(read + std::min<u32>(i + 1, in - 1)) & SNDOUT_RING_MASK];
+
+			s_out[j].Left  = (s16)(a.Left + (((s64)(b.Left - a.Left) * f) >> 16));
+			s_out[j].Right = (s16)(a.Right + (((s64)(b.Right - a.Right) * f) >> 16));
+		}
+
+		batch_cb((const int16_t*)s_out, out);
+	}
+
+	s_last_sample = s_ring[(read + in - 1) & SNDOUT_RING_MASK];
+	s_read_pos.store(read + in, std::memory_order_release);
+}
+
+void SndOut_SetHostBufferStatus(bool active, unsigned occupancy)
+{
+	s_host_occupancy.store(active ? (int)occupancy : -1, std::memory_order_relaxed);
+}
+
+void SndOut_GetStats(SndOutStats& stats)
+{
+	stats.underruns = s_underruns.load(std::memory_order_relaxed);
+	stats.overruns  = s_overruns.load(std::memory_order_relaxed);
+	stats.fill      = s_fill.load(std::memory_order_relaxed);
+	stats.ratio     = s_ratio.load(std::memory_order_relaxed);
+}
+
+void SndOut_Reset(bool rate_control)
+{
+	s_write_pos.store(0, std::memory_order_relaxed);
+	s_read_pos.store(0, std::memory_order_relaxed);
+	s_underruns.store(0, std::memory_order_relaxed);
+	s_overruns.store(0, std::memory_order_relaxed);
+	s_fill.store(0, std::memory_order_relaxed);
+	s_ratio.store(1.0f, std::memory_order_relaxed);
+	s_host_occupancy.store(-1, std::memory_order_relaxed);
+	s_rate_control.store(rate_control, std::memory_order_relaxed);
+
+	s_last_write    = 0;
+	s_frame_samples = 48000 / (60 / 1.001);
+	s_in_frac = s_out_frac = 0;
+	s_last_sample   = StereoOut16();
+}
@@ -0,0 +1,55 @@
+/*  PCSX2 - PS2 Emulator for PCs
+ *  Copyright (C) 2002-2022  PCSX2 Dev Team
+ *
+ *  PCSX2 is free software: you can redistribute it and/or modify it under the terms
+ *  of the GNU Lesser General Public License as published by the Free Software Found-
+ *  ation, either version 3 of the License, or (at your option) any later version.
+ *
+ *  PCSX2 is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ *  without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ *  PURPOSE.  See the GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along with PCSX2.
+ *  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+struct StereoOut16;
+
+// Audio output, between the mixer (EE thread) and the frontend.
+//
+// With the "Audio Rate Control" option the mixer writes its blocks straight into a
+// single producer / single consumer ring, and the frontend thread drains it once per
+// frame. The drain resamples by a fraction of a percent to keep the ring near its
+// target fill (the EE runs ahead of the frontend by a varying amount) and, when the
+// frontend reports it, its own audio buffer half full. The EE never waits for the
+// frontend, a block that doesn't fit in the ring is dropped and counted.
+//
+// Without the option every block is sent to the frontend from the EE thread as soon
+// as it is mixed, like before.
+
+struct SndOutStats
+{
+	u64 underruns; // drains that found fewer samples than they meant to play
+	u64 overruns;  // samples dropped because the ring was full
+	u32 fill;      // samples in the ring after the last drain
+	float ratio;   // input / output samples of the last drain
+};
+
+// Called by SPU2open(), picks up the option
+extern void SndOut_Open(void);
+
+// Mixer side: space for SPU2_MIX_BLOCK_SIZE samples, then publishes them
+extern StereoOut16* SndOut_Reserve(void);
+extern void SndOut_Commit(void);
+
+// Frontend side, once per frame
+extern void SndOut_Drain(void);
+extern void SndOut_SetHostBufferStatus(bool active, unsigned occupancy);
+
+extern void SndOut_GetStats(SndOutStats& stats);
+
+// Empties the ring and restarts the drain's rate estimate, for the benchmark core.
+// Neither the mixer nor the drain may run meanwhile.
+extern void SndOut_Reset(bool rate_control);
@@ -506,6 +506,9 @@ namespace SPU2Savestate
 #define SPU2_TICK_INTERVAL 768
 #define SPU2_SANITY_INTERVAL 4800
 
+// Maximum number of ticks TimeUpdate hands to the mixer at once.
+#define SPU2_MIX_BLOCK_SIZE 64
+
 // --------------------------------------------------------------------------------------
 //  ADPCM Decoder Cache
 // --------------------------------------------------------------------------------------
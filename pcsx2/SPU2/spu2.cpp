@@ -19,6 +19,7 @@
 
 #include "Global.h"
 #include "spu2.h"
+#include "SndOut.h"
 #include "../R3000A.h"
 #include "../IopDma.h"
 #include "../../libretro/options_tools.h"
@@ -304,6 +305,26 @@ static int SampleRate = 48000;
 
 u32 lClocks = 0;
 
+//Update DMA4/DMA7 interrupt delay counter
+static void UpdateDMAICounter(V_Core& core, u32 ticks, void (*dmaIrq)(void))
+{
+	if (core.DMAICounter <= 0)
+		return;
+
+	core.DMAICounter -= SPU2_TICK_INTERVAL * ticks;
+	if (core.DMAICounter <= 0)
+	{
+		if (core.IsDMARead)
+			core.FinishDMAread();
+
+		core.MADR = core.TADR;
+		core.DMAICounter = 0;
+		dmaIrq();
+	}
+	else
+		core.MADR += (SPU2_TICK_INTERVAL << 1) * ticks;
+}
+
 static void TimeUpdate(u32 cClocks)
 {
 	u32 dClocks = cClocks - lClocks;
@@ -333,45 +354,36 @@ static void TimeUpdate(u32 cClocks)
 			spu2Irq();
 		}
 
-		//Update DMA4 interrupt delay counter
-		if (Cores[0].DMAICounter > 0)
+		u32 ticks = std::min<u32>(dClocks / SPU2_TICK_INTERVAL, SPU2_MIX_BLOCK_SIZE);
+
+		// A block never spans the tick where a DMA interrupt delay runs out,
+		// that tick is dispatched on its own.
+		for (int c = 0; c < 2; c++)
 		{
-			Cores[0].DMAICounter -= SPU2_TICK_INTERVAL;
-			if (Cores[0].DMAICounter <= 0)
+			if (Cores[c].DMAICounter > 0)
 			{
-				if (Cores[0].IsDMARead)
-					Cores[0].FinishDMAread();
-
-				Cores[0].MADR = Cores[0].TADR;
-				Cores[0].DMAICounter = 0;
-				spu2DMA4Irq();
+				const s32 expires = (Cores[c].DMAICounter + SPU2_TICK_INTERVAL - 1) / SPU2_TICK_INTERVAL;
+				ticks = std::min<u32>(ticks, std::max(expires - 1, 1));
 			}
-			else
-				Cores[0].MADR += SPU2_TICK_INTERVAL << 1;
 		}
 
-		//Update DMA7 interrupt delay counter
-		if (Cores[1].DMAICounter > 0)
+		if (ticks == 1)
 		{
-			Cores[1].DMAICounter -= SPU2_TICK_INTERVAL;
-			if (Cores[1].DMAICounter <= 0)
-			{
-				if (Cores[1].IsDMARead)
-					Cores[1].FinishDMAread();
-
-				Cores[1].MADR = Cores[1].TADR;
-				Cores[1].DMAICounter = 0;
-				spu2DMA7Irq();
-			}
-			else
-				Cores[1].MADR += SPU2_TICK_INTERVAL << 1;
+			UpdateDMAICounter(Cores[0], 1, spu2DMA4Irq);
+			UpdateDMAICounter(Cores[1], 1, spu2DMA7Irq);
+			SPU2_MixBlock(1);
+		}
+		else
+		{
+			// The mixer never looks at the DMA counters, so they can be
+			// advanced after the block.  None of them expires inside it.
+			ticks = SPU2_MixBlock(ticks);
+			UpdateDMAICounter(Cores[0], ticks, spu2DMA4Irq);
+			UpdateDMAICounter(Cores[1], ticks, spu2DMA7Irq);
 		}
 
-		dClocks -= SPU2_TICK_INTERVAL;
-		lClocks += SPU2_TICK_INTERVAL;
-		Cycles++;
-
-		SPU2_Mix();
+		dClocks -= SPU2_TICK_INTERVAL * ticks;
+		lClocks += SPU2_TICK_INTERVAL * ticks;
 	}
 }
 
@@ -497,6 +509,7 @@ s32 SPU2init(void)
 s32 SPU2open(void)
 {
 	lClocks  = psxRegs.cycle;
+	SndOut_Open();
 
 	return 0;
 }
@@ -622,7 +622,8 @@ void inline memcardInit(void)
 		if(numTimesAccessed == FORCED_MCD_EJECTION_MIN_TRIES)
 			mcd->ForceEjection_Timestamp = wxDateTime::UNow();
 
-		if(numTimesAccessed > FORCED_MCD_EJECTION_MIN_TRIES)
+		// the deterministic mode counts the tries only, the timeout is host time
+		if(numTimesAccessed > FORCED_MCD_EJECTION_MIN_TRIES && !EmuConfig.Deterministic)
 		{
 			wxTimeSpan delta = wxDateTime::UNow().Subtract(mcd->ForceEjection_Timestamp);
 			if(delta.GetMilliseconds() >= FORCED_MCD_EJECTION_MAX_MS_AFTER_MIN_TRIES)
@@ -0,0 +1,121 @@
+/*  PCSX2 - PS2 Emulator for PCs
+ *  Copyright (C) 2002-2022  PCSX2 Dev Team
+ *
+ *  PCSX2 is free software: you can redistribute it and/or modify it under the terms
+ *  of the GNU Lesser General Public License as published by the Free Software Found-
+ *  ation, either version 3 of the License, or (at your option) any later version.
+ *
+ *  PCSX2 is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ *  without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ *  PURPOSE.  See the GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along with PCSX2.
+ *  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "Common.h"
+#include "IopMem.h"
+#include "R3000A.h"
+#include "VUmicro.h"
+#include "MTVU.h"
+#include "GS.h"
+#include "SPU2/defs.h"
+#include "StateHash.h"
+
+#include <mutex>
+#include <vector>
+
+// The frontend reads them while the EE runs
+static std::mutex s_mutex;
+static std::vector<u64> s_hashes;
+#ifdef LRPS2_BENCH
+static bool s_forced = false;
+#endif
+
+// FNV-1a on qwords in four independent lanes, sizes are multiples of 32 bytes
+// except for the register structs, whose tail is hashed bytewise
+static void HashBlock(u64 (&h)[4], const void* data, uint size)
+{
+	const u64* p = (const u64*)data;
+	const uint qwords = size / 8 & ~3;
+
+	for (uint i = 0; i < qwords; i += 4)
+	{
+		h[0] = (h[0] ^ p[i + 0]) * 0x100000001b3ull;
+		h[1] = (h[1] ^ p[i + 1]) * 0x100000001b3ull;
+		h[2] = (h[2] ^ p[i + 2]) * 0x100000001b3ull;
+		h[3] = (h[3] ^ p[i + 3]) * 0x100000001b3ull;
+	}
+
+	const u8* tail = (const u8*)(p + qwords);
+	for (uint i = 0; i < size - qwords * 8; i++)
+		h[0] = (h[0] ^ tail[i]) * 0x100000001b3ull;
+}
+
+void StateHash::Reset()
+{
+	std::lock_guard<std::mutex> lock(s_mutex);
+	s_hashes.clear();
+}
+
+#ifdef LRPS2_BENCH
+void StateHash::Force(bool force)
+{
+	s_forced = force;
+}
+
+bool StateHash::Enabled()
+{
+	return EmuConfig.Deterministic || s_forced;
+}
+#else
+bool StateHash::Enabled()
+{
+	return EmuConfig.Deterministic;
+}
+#endif
+
+void StateHash::Update()
+{
+	if (!eeMem || !iopMem || !_spu2mem)
+		return;
+
+	// VU1 memory and registers are only stable with the VU thread idle
+	if (THREAD_VU1)
+		vu1Thread.WaitVU();
+
+	u64 h[4] = {0xcbf29ce484222325ull, 0xcbf29ce484222325ull, 0xcbf29ce484222325ull, 0xcbf29ce484222325ull};
+
+	HashBlock(h, eeMem->Main, Ps2MemSize::MainRam + Ps2MemSize::Scratch);
+	HashBlock(h, eeHw, Ps2MemSize::Hardware);
+	HashBlock(h, iopMem->Main, Ps2MemSize::IopRam);
+	HashBlock(h, iopHw, Ps2MemSize::IopHardware);
+	HashBlock(h, VU0.Micro, VU0_PROGSIZE + VU0_MEMSIZE + VU1_PROGSIZE + VU1_MEMSIZE);
+	HashBlock(h, _spu2mem, 0x200000);
+	HashBlock(h, spu2regs, 0x010000);
+	HashBlock(h, PS2MEM_GS, Ps2MemSize::GSregs);
+
+	HashBlock(h, &cpuRegs, sizeof(cpuRegs));
+	HashBlock(h, &fpuRegs, sizeof(fpuRegs));
+	HashBlock(h, &psxRegs, sizeof(psxRegs));
+	// VF, VI, ACC, Q and P, the rest holds pointers and host side state
+	HashBlock(h, &VU0, offsetof(VURegs, idx));
+	HashBlock(h, &VU1, offsetof(VURegs, idx));
+
+	const u64 hash = h[0] ^ (h[1] * 31) ^ (h[2] * 961) ^ (h[3] * 29791);
+
+	std::lock_guard<std::mutex> lock(s_mutex);
+	s_hashes.push_back(hash);
+}
+
+uint StateHash::Get(u64 first_frame, u64* hashes, uint max)
+{
+	std::lock_guard<std::mutex> lock(s_mutex);
+
+	if (first_frame >= s_hashes.size())
+		return 0;
+
+	const uint count = (uint)std::min<u64>(max, s_hashes.size() - first_frame);
+	memcpy(hashes, &s_hashes[first_frame], count * sizeof(u64));
+	return count;
+}
@@ -0,0 +1,43 @@
+/*  PCSX2 - PS2 Emulator for PCs
+ *  Copyright (C) 2002-2022  PCSX2 Dev Team
+ *
+ *  PCSX2 is free software: you can redistribute it and/or modify it under the terms
+ *  of the GNU Lesser General Public License as published by the Free Software Found-
+ *  ation, either version 3 of the License, or (at your option) any later version.
+ *
+ *  PCSX2 is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ *  without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ *  PURPOSE.  See the GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along with PCSX2.
+ *  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+// --------------------------------------------------------------------------------------
+//  StateHash
+// --------------------------------------------------------------------------------------
+// Per frame hash of the emulated machine state, taken in deterministic mode: EE main
+// memory and scratchpad, EE and IOP hardware registers, IOP main memory, VU memory,
+// SPU2 memory and registers, GS privileged registers, and the EE, FPU, IOP and VU
+// registers. Two runs of the same content with the same inputs have the same hashes,
+// the first frame that differs is where they diverged.
+//
+// Frames are numbered from the last hardware reset.
+namespace StateHash
+{
+	extern void Reset();
+
+#ifdef LRPS2_BENCH
+	// Also takes them without deterministic mode, to see how far apart runs drift
+	extern void Force(bool force);
+#endif
+	extern bool Enabled();
+
+	// EE thread, at vsync start
+	extern void Update();
+
+	// Copies the hashes of frames first_frame and up, returns how many there were
+	extern uint Get(u64 first_frame, u64* hashes, uint max);
+}
@@ -17,6 +17,7 @@
 #include "R3000A.h"
 #include "newVif.h"
 #include "MTVU.h"
+#include "MemorySnapshot.h"
 #include "x86emitter/x86_intrin.h"
 
 #include "Elfheader.h"
@@ -49,6 +50,7 @@ RecompiledCodeReserve::RecompiledCodeReserve( uint defCommit )
 	: VirtualMemoryReserve( defCommit )
 {
 	m_prot_mode		= PageAccess_Any();
+	m_huge_pages	= true;
 }
 
 RecompiledCodeReserve::~RecompiledCodeReserve() { }
@@ -227,6 +229,7 @@ void SysMainMemory::CommitAll()
 
 void SysMainMemory::ResetAll()
 {
+	MemorySnapshot::Release();
 	CommitAll();
 	m_ee.Reset();
 	m_iop.Reset();
@@ -238,6 +241,7 @@ void SysMainMemory::ResetAll()
 void SysMainMemory::DecommitAll()
 {
 	if (!m_ee.IsCommitted() && !m_iop.IsCommitted() && !m_vu.IsCommitted()) return;
+	MemorySnapshot::Release();
 	// On linux, the MTVU isn't empty and the thread still uses the m_ee/m_vu memory
 	vu1Thread.WaitVU();
 	// The EE thread must be stopped here command mustn't be send
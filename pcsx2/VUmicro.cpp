@@ -25,7 +25,10 @@ void BaseVUmicroCPU::ExecuteBlock(bool startUp) {
 
 	if (m_Idx && THREAD_VU1)
 	{
-		vu1Thread.Get_GSChanges();
+		if (!EmuConfig.Deterministic)
+			vu1Thread.Get_GSChanges();
+		else if (vu1Thread.ResultsDue())
+			vu1Thread.SyncPrograms();
 	}
 
 	if (!(stat & test)) return;
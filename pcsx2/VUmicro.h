@@ -195,6 +195,18 @@ public:
 extern BaseVUmicroCPU* CpuVU0;
 extern BaseVUmicroCPU* CpuVU1;
 
+struct microVUStats
+{
+	u32 programs;      // microPrograms currently cached
+	u32 resets;        // whole rec-cache flushes
+	u32 evictions;     // rec-cache segments recycled
+	u64 evicted;       // microPrograms discarded by segment recycling
+	u32 code_used;     // bytes of the rec-cache holding live code
+	u32 code_reserved; // size of the rec-cache
+};
+
+extern void mVUgetStats(u32 vuIndex, microVUStats& stats);
+
 
 // VU0
 extern void vu0ResetRegs(void);
@@ -14,7 +14,19 @@
  */
 
 #include <wx/ffile.h>
+#include <wx/filefn.h>
 #include <map>
+#include <vector>
+#include <mutex>
+#include <thread>
+#include <condition_variable>
+#include <zlib.h>
+
+#ifdef _WIN32
+#include <io.h>
+#else
+#include <unistd.h>
+#endif
 
 #include "Utilities/SafeArray.inl"
 #include "Utilities/MemcpyFast.h"
@@ -77,6 +89,8 @@ static u32 CalculateECC(u8* buf)
 	return column_parity | (line_parity_0 << 8) | (line_parity_1 << 16);
 }
 
+// Both conversions write to a temporary file renamed over file_out once complete, so a
+// crash in the middle leaves the previous file_out.
 static bool ConvertNoECCtoRAW(wxString file_in, wxString file_out)
 {
 	bool result = false;
@@ -84,28 +98,31 @@ static bool ConvertNoECCtoRAW(wxString file_in, wxString file_out)
 
 	if (fin.IsOpened())
 	{
-		wxFFile fout(file_out, "wb");
+		const wxString file_tmp(file_out + L".tmp");
+		wxFFile fout(file_tmp, "wb");
 
 		if (fout.IsOpened())
 		{
 			u8 buffer[512];
 			size_t size = fin.Length();
 
-			for (size_t i = 0; i < (size / 512); i++)
+			result = true;
+			for (size_t i = 0; i < (size / 512) && result; i++)
 			{
-				fin.Read(buffer, 512);
-				fout.Write(buffer, 512);
+				result = fin.Read(buffer, 512) == 512 && fout.Write(buffer, 512) == 512;
 
 				for (int j = 0; j < 4; j++)
 				{
 					u32 checksum = CalculateECC(&buffer[j * 128]);
-					fout.Write(&checksum, 3);
+					result = result && fout.Write(&checksum, 3) == 3;
 				}
 
-				fout.Write("\0\0\0\0", 4);
+				result = result && fout.Write("\0\0\0\0", 4) == 4;
 			}
 
-			result = true;
+			result = fout.Close() && result && wxRenameFile(file_tmp, file_out, true);
+			if (!result)
+				wxRemoveFile(file_tmp);
 		}
 	}
 
@@ -115,7 +132,8 @@ static bool ConvertNoECCtoRAW(wxString file_in, wxString file_out)
 static bool ConvertRAWtoNoECC(wxString file_in, wxString file_out)
 {
 	bool result = false;
-	wxFFile fout(file_out, "wb");
+	const wxString file_tmp(file_out + L".tmp");
+	wxFFile fout(file_tmp, "wb");
 
 	if (fout.IsOpened())
 	{
@@ -126,24 +144,146 @@ static bool ConvertRAWtoNoECC(wxString file_in, wxString file_out)
 			u8 buffer[512];
 			size_t size = fin.Length();
 
-			for (size_t i = 0; i < (size / 528); i++)
+			result = true;
+			for (size_t i = 0; i < (size / 528) && result; i++)
 			{
-				fin.Read(buffer, 512);
-				fout.Write(buffer, 512);
-				fin.Read(buffer, 16);
+				result = fin.Read(buffer, 512) == 512 && fout.Write(buffer, 512) == 512;
+				result = result && fin.Read(buffer, 16) == 16;
 			}
-
-			result = true;
 		}
+
+		result = fout.Close() && result && wxRenameFile(file_tmp, file_out, true);
+		if (!result)
+			wxRemoveFile(file_tmp);
 	}
 
 	return result;
 }
 
+// --------------------------------------------------------------------------------------
+//  Memory card write-back journal
+// --------------------------------------------------------------------------------------
+// A journal is a sequence of records, each one a McdJournalRecord followed by 'size'
+// bytes to be written at 'offset' in the card file.  Records are only trusted when they
+// are complete and their CRC matches, so a journal torn by a crash is replayed up to its
+// last good record.
+
+static const u32 McdJournalMagic = 0x4C4E524A; // "JRNL"
+static const u32 McdDirtyChunkSize = 528 * 16;  // one erase block
+
+struct McdJournalRecord
+{
+	u32 magic;
+	u32 offset;
+	u32 size;
+	u32 crc;
+};
+
+static wxString McdJournalName(const wxString& mcdFile)
+{
+	return mcdFile + L".journal";
+}
+
+// Pushes everything written to the file so far down to the storage device.
+static bool McdSyncFile(wxFFile& f)
+{
+	if (!f.Flush())
+		return false;
+#ifdef _WIN32
+	return _commit(_fileno(f.fp())) == 0;
+#else
+	return fsync(fileno(f.fp())) == 0;
+#endif
+}
+
+// Appends the chunks to the journal of the card file and syncs it.
+bool FileMcd_AppendJournal(const wxString& mcdFile, const std::vector<McdJournalChunk>& chunks)
+{
+	wxFFile journal(McdJournalName(mcdFile), L"ab");
+	if (!journal.IsOpened())
+		return false;
+
+	bool written = true;
+	for (const McdJournalChunk& chunk : chunks)
+	{
+		const McdJournalRecord rec = {McdJournalMagic, chunk.offset, (u32)chunk.data.size(), (u32)crc32(0, chunk.data.data(), chunk.data.size())};
+		written = written && journal.Write(&rec, sizeof(rec)) == sizeof(rec);
+		written = written && journal.Write(chunk.data.data(), chunk.data.size()) == chunk.data.size();
+	}
+	return written && McdSyncFile(journal);
+}
+
+// Applies what a previous session left in the journal of this card file, if anything.
+bool FileMcd_ReplayJournal(wxFFile& mcd)
+{
+	const wxString name(McdJournalName(mcd.GetName()));
+	if (!wxFileExists(name))
+		return true;
+
+	wxFFile journal(name, L"rb");
+	if (journal.IsOpened())
+	{
+		McdJournalRecord rec;
+		std::vector<u8> data;
+		uint replayed = 0;
+
+		while (journal.Read(&rec, sizeof(rec)) == sizeof(rec) && rec.magic == McdJournalMagic)
+		{
+			data.resize(rec.size);
+			if (journal.Read(data.data(), rec.size) != rec.size)
+				break;
+			if (crc32(0, data.data(), rec.size) != rec.crc)
+				break;
+			if (!mcd.Seek(rec.offset) || mcd.Write(data.data(), rec.size) != rec.size)
+				return false;
+			replayed++;
+		}
+		journal.Close();
+
+		if (replayed)
+		{
+			log_cb(RETRO_LOG_INFO, "(FileMcd) Replayed %u pending write(s) to %s\n", replayed, WX_STR(mcd.GetName()));
+			if (!McdSyncFile(mcd))
+				return false;
+		}
+	}
+
+	wxRemoveFile(name);
+	return true;
+}
+
+// A card without ECC (.bin) is used through a copy with ECC (.binx), converted back and
+// removed by Close.  A .binx still there was left by a session that crashed, with what
+// it wrote back and its journal on top, so it is used as is unless the .bin changed
+// since.  Points path to the .binx.
+bool FileMcd_OpenNoECC(wxString& path)
+{
+	const wxString raw(path + L"x");
+	wxStructStat bin, binx;
+	const bool reuse = wxStat(path, &bin) == 0 && wxStat(raw, &binx) == 0 &&
+		binx.st_mtime >= bin.st_mtime && (u64)binx.st_size == (u64)bin.st_size / 512 * 528;
+
+	if (reuse)
+		log_cb(RETRO_LOG_INFO, "(FileMcd) Using %s left by the last session\n", WX_STR(raw));
+	else
+	{
+		if (!ConvertNoECCtoRAW(path, raw))
+			return false;
+		wxRemoveFile(McdJournalName(raw));
+	}
+
+	path = raw;
+	return true;
+}
+
 // --------------------------------------------------------------------------------------
 //  FileMemoryCard
 // --------------------------------------------------------------------------------------
-// Provides thread-safe direct file IO mapping.
+// Keeps every open card resident in memory.  Reads and writes from the emulator only
+// touch that copy; dirty regions are written back to the card files by a background
+// writer thread.  Each write-back is appended to a journal next to the card file and
+// synced before the card file itself is modified, so a crash in the middle of a
+// write-back is replayed from the journal the next time the card is opened.
 //
 class FileMemoryCard
 {
@@ -151,10 +291,20 @@ protected:
 	wxFFile m_file[8];
 	u8 m_effeffs[528 * 16];
 	SafeArray<u8> m_currentdata;
+	std::vector<u8> m_image[8];   // resident copy of the whole card file
+	std::vector<bool> m_dirty[8]; // one flag per McdDirtyChunkSize bytes of m_image
+	u32 m_offset[8];              // header bytes in front of the card data (see Seek)
+	u32 m_crcend[8];              // end of the range covered by the PSX checksum
 	u64 m_chksum[8];
 	bool m_ispsx[8];
 	u32 m_chkaddr;
 
+	std::thread m_writer;
+	std::mutex m_lock; // protects m_image writes, m_dirty and the flags below
+	std::condition_variable m_notify;
+	bool m_writer_pending;
+	bool m_writer_quit;
+
 public:
 	FileMemoryCard();
 	virtual ~FileMemoryCard() = default;
@@ -174,6 +324,11 @@ protected:
 	bool Seek(wxFFile& f, u32 adr);
 	bool Create(const wxString& mcdFile, uint sizeInMB);
 
+	bool LoadImage(uint slot);
+	void WriteImage(uint slot, u32 pos, const u8* data, u32 size);
+	void WriterThread();
+	bool FlushSlot(uint slot);
+
 	wxString GetDisabledMessage(uint slot) const
 	{
 		return wxsFormat(L"The PS2-slot %d has been automatically disabled.  You can correct the problem\nand re-enable it at any time using Config:Memory cards from the main menu.", slot //TODO: translate internal slot index to human-readable slot description
@@ -240,6 +395,8 @@ FileMemoryCard::FileMemoryCard()
 {
 	memset8<0xff>(m_effeffs);
 	m_chkaddr = 0;
+	m_writer_pending = false;
+	m_writer_quit = false;
 }
 
 void FileMemoryCard::Open()
@@ -301,16 +458,10 @@ void FileMemoryCard::Open()
 		NTFS_CompressFile(str, g_Conf->McdCompressNTFS);
 #endif
 
-		if (str.EndsWith(".bin"))
+		if (str.EndsWith(".bin") && !FileMcd_OpenNoECC(str))
 		{
-			wxString newname = str + "x";
-			if (!ConvertNoECCtoRAW(str, newname))
-			{
-				log_cb(RETRO_LOG_ERROR, "Could convert memory card: %s", WX_STR(str));
-				wxRemoveFile(newname);
-				continue;
-			}
-			str = newname;
+			log_cb(RETRO_LOG_ERROR, "Could convert memory card: %s", WX_STR(str));
+			continue;
 		}
 
 		if (!m_file[slot].Open(str.c_str(), L"r+b"))
@@ -321,23 +472,64 @@ void FileMemoryCard::Open()
 					wxsFormat("Access denied to memory card: \n\n%s\n\n %s\n", str.c_str(), GetDisabledMessage(slot).c_str()).c_str()
 			      );
 		}
+		else if (!FileMcd_ReplayJournal(m_file[slot]) || !LoadImage(slot))
+		{
+			log_cb(RETRO_LOG_ERROR,
+					wxsFormat("Could not read memory card: \n\n%s\n\n %s\n", str.c_str(), GetDisabledMessage(slot).c_str()).c_str()
+			      );
+			m_file[slot].Close();
+		}
 		else // Load checksum
 		{
-			m_ispsx[slot] = m_file[slot].Length() == 0x20000;
+			const std::vector<u8>& image(m_image[slot]);
+
+			m_ispsx[slot] = image.size() == 0x20000;
 			m_chkaddr = 0x210;
+			m_chksum[slot] = 0;
 
-			if (!m_ispsx[slot] && !!m_file[slot].Seek(m_chkaddr))
-				m_file[slot].Read(&m_chksum[slot], 8);
+			if (m_ispsx[slot])
+			{
+				// Same range GetCRC used to read back in 4k chunks.
+				m_crcend[slot] = std::min<u32>(image.size(), m_offset[slot] + (image.size() / (528 * 8 * 8)) * (528 * 8 * 8));
+				for (u32 i = m_offset[slot]; i < m_crcend[slot]; i++)
+					m_chksum[slot] ^= (u64)image[i] << (8 * ((i - m_offset[slot]) & 7));
+			}
+			else if (image.size() >= m_chkaddr + 8)
+				memcpy(&m_chksum[slot], &image[m_chkaddr], 8);
+		}
+	}
+
+	for (int slot = 0; slot < 8; ++slot)
+	{
+		if (m_file[slot].IsOpened() && !m_writer.joinable())
+		{
+			m_writer_pending = false;
+			m_writer_quit = false;
+			m_writer = std::thread(&FileMemoryCard::WriterThread, this);
 		}
 	}
 }
 
 void FileMemoryCard::Close()
 {
+	if (m_writer.joinable())
+	{
+		{
+			std::lock_guard<std::mutex> guard(m_lock);
+			m_writer_quit = true;
+		}
+		m_notify.notify_one();
+		m_writer.join();
+	}
+
 	for (int slot = 0; slot < 8; ++slot)
 	{
 		if (m_file[slot].IsOpened())
 		{
+			FlushSlot(slot);
+			m_image[slot].clear();
+			m_dirty[slot].clear();
+
 			// Store checksum
 			if (!m_ispsx[slot] && !!m_file[slot].Seek(m_chkaddr))
 				m_file[slot].Write(&m_chksum[slot], 8);
@@ -403,7 +595,7 @@ void FileMemoryCard::GetSizeInfo(uint slot, McdSizeInfo& outways)
 	outways.Xor = 18;                     // 0x12, XOR 02 00 00 10
 
 	if (m_file[slot].IsOpened())
-		outways.McdSizeInSectors = m_file[slot].Length() / (outways.SectorSize + outways.EraseBlockSizeInSectors);
+		outways.McdSizeInSectors = m_image[slot].size() / (outways.SectorSize + outways.EraseBlockSizeInSectors);
 	else
 		outways.McdSizeInSectors = 0x4000;
 
@@ -416,39 +608,96 @@ bool FileMemoryCard::IsPSX(uint slot)
 	return m_ispsx[slot];
 }
 
-s32 FileMemoryCard::Read(uint slot, u8* dest, u32 adr, int size)
+bool FileMemoryCard::LoadImage(uint slot)
 {
 	wxFFile& mcfp(m_file[slot]);
-	if (!mcfp.IsOpened()) /* Ignoring attempted read from disabled slot */
+	const u32 size = mcfp.Length();
+
+	// See Seek for where these come from.
+	if (size == MCD_SIZE + 64)
+		m_offset[slot] = 64;
+	else if (size == MCD_SIZE + 3904)
+		m_offset[slot] = 3904;
+	else
+		m_offset[slot] = 0;
+
+	m_image[slot].assign(size, 0);
+	m_dirty[slot].assign((size + McdDirtyChunkSize - 1) / McdDirtyChunkSize, false);
+
+	return mcfp.Seek(0) && mcfp.Read(m_image[slot].data(), size) == size;
+}
+
+// Writes to the resident copy of the card and queues the range for write-back.
+void FileMemoryCard::WriteImage(uint slot, u32 pos, const u8* data, u32 size)
+{
+	std::vector<u8>& image(m_image[slot]);
+
+	size = std::min<u32>(size, image.size() - pos);
+	if (size == 0)
+		return;
+
+	if (m_ispsx[slot])
+	{
+		// Keep the whole-card checksum up to date: XOR the old bytes out and the new ones in.
+		const u32 end = std::min(pos + size, m_crcend[slot]);
+		for (u32 i = std::max(pos, m_offset[slot]); i < end; i++)
+			m_chksum[slot] ^= (u64)(image[i] ^ data[i - pos]) << (8 * ((i - m_offset[slot]) & 7));
+	}
+
+	{
+		std::lock_guard<std::mutex> guard(m_lock);
+		memcpy(&image[pos], data, size);
+		for (u32 chunk = pos / McdDirtyChunkSize; chunk <= (pos + size - 1) / McdDirtyChunkSize; chunk++)
+			m_dirty[slot][chunk] = true;
+		m_writer_pending = true;
+	}
+	m_notify.notify_one();
+}
+
+s32 FileMemoryCard::Read(uint slot, u8* dest, u32 adr, int size)
+{
+	if (!m_file[slot].IsOpened()) /* Ignoring attempted read from disabled slot */
 	{
 		memset(dest, 0, size);
 		return 1;
 	}
-	if (!Seek(mcfp, adr))
+
+	// Only the emulation thread writes to the image, no need to lock here.
+	const std::vector<u8>& image(m_image[slot]);
+	const u32 pos = adr + m_offset[slot];
+	if (pos >= image.size())
 		return 0;
-	return mcfp.Read(dest, size) != 0;
+
+	// Past the end of the card reads as zeroes.
+	const u32 count = std::min<u32>(size, image.size() - pos);
+	memcpy(dest, &image[pos], count);
+	memset(dest + count, 0, size - count);
+	return 1;
 }
 
 s32 FileMemoryCard::Save(uint slot, const u8* src, u32 adr, int size)
 {
-	wxFFile& mcfp(m_file[slot]);
-
-	if (!mcfp.IsOpened()) /* Ignoring attempted save/write to disabled slot */
+	if (!m_file[slot].IsOpened()) /* Ignoring attempted save/write to disabled slot */
 		return 1;
 
+	const std::vector<u8>& image(m_image[slot]);
+	const u32 pos = adr + m_offset[slot];
+	if (pos >= image.size())
+		return 0;
+
+	m_currentdata.MakeRoomFor(size);
+
 	if (m_ispsx[slot])
 	{
-		m_currentdata.MakeRoomFor(size);
 		for (int i = 0; i < size; i++)
 			m_currentdata[i] = src[i];
 	}
 	else
 	{
-		if (!Seek(mcfp, adr))
-			return 0;
-		m_currentdata.MakeRoomFor(size);
-		mcfp.Read(m_currentdata.GetPtr(), size);
-
+		// Past the end of the card is zeroes, left out of the checksum.
+		const u32 count = std::min<u32>(size, image.size() - pos);
+		memcpy(m_currentdata.GetPtr(), &image[pos], count);
+		memset(m_currentdata.GetPtr() + count, 0, size - count);
 
 		for (int i = 0; i < size; i++)
 			m_currentdata[i] &= src[i];
@@ -463,54 +712,107 @@ s32 FileMemoryCard::Save(uint slot, const u8* src, u32 adr, int size)
 		}
 	}
 
-	if (!Seek(mcfp, adr))
-		return 0;
-
-	if (mcfp.Write(m_currentdata.GetPtr(), size))
-		return 1;
-
-	return 0;
+	WriteImage(slot, pos, m_currentdata.GetPtr(), size);
+	return 1;
 }
 
 s32 FileMemoryCard::EraseBlock(uint slot, u32 adr)
 {
-	wxFFile& mcfp(m_file[slot]);
-
-	if (!mcfp.IsOpened()) /* Ignoring erase for disabled slot */
+	if (!m_file[slot].IsOpened()) /* Ignoring erase for disabled slot */
 		return 1;
 
-	if (!Seek(mcfp, adr))
+	const u32 pos = adr + m_offset[slot];
+	if (pos >= m_image[slot].size())
 		return 0;
-	return mcfp.Write(m_effeffs, sizeof(m_effeffs)) != 0;
+
+	WriteImage(slot, pos, m_effeffs, sizeof(m_effeffs));
+	return 1;
 }
 
 u64 FileMemoryCard::GetCRC(uint slot)
 {
-	wxFFile& mcfp(m_file[slot]);
-	if (!mcfp.IsOpened())
+	if (!m_file[slot].IsOpened())
 		return 0;
 
-	if (m_ispsx[slot])
-	{
-		u64 retval = 0;
-		if (!Seek(mcfp, 0))
-			return 0;
+	// Maintained incrementally by Open and WriteImage, for PSX and PS2 cards alike.
+	return m_chksum[slot];
+}
 
-		// Process the file in 4k chunks.  Speeds things up significantly.
+// Writes the dirty parts of the card back to its file, through the journal.
+bool FileMemoryCard::FlushSlot(uint slot)
+{
+	std::vector<McdJournalChunk> chunks;
 
-		u64 buffer[528 * 8]; // use 528 (sector size), ensures even divisibility
+	{
+		std::lock_guard<std::mutex> guard(m_lock);
+		const std::vector<u8>& image(m_image[slot]);
 
-		const uint filesize = mcfp.Length() / sizeof(buffer);
-		for (uint i = filesize; i; --i)
+		for (size_t chunk = 0; chunk < m_dirty[slot].size(); chunk++)
 		{
-			mcfp.Read(&buffer, sizeof(buffer));
-			for (uint t = 0; t < ARRAY_SIZE(buffer); ++t)
-				retval ^= buffer[t];
+			if (!m_dirty[slot][chunk])
+				continue;
+
+			const u32 offset = chunk * McdDirtyChunkSize;
+			const u32 size = std::min<u32>(McdDirtyChunkSize, image.size() - offset);
+			chunks.push_back({offset, std::vector<u8>(image.begin() + offset, image.begin() + offset + size)});
+			m_dirty[slot][chunk] = false;
 		}
-		return retval;
 	}
 
-	return m_chksum[slot];
+	if (chunks.empty())
+		return true;
+
+	wxFFile& mcfp(m_file[slot]);
+	const wxString journal_name(McdJournalName(mcfp.GetName()));
+
+	// Journal first, so that a crash while the card file is being written can be
+	// recovered from.  If the journal can't be written, write the card anyway.
+	const bool journaled = FileMcd_AppendJournal(mcfp.GetName(), chunks);
+	if (!journaled)
+		log_cb(RETRO_LOG_WARN, "(FileMcd) Could not write memory card journal: %s\n", WX_STR(journal_name));
+
+	bool written = true;
+	for (const McdJournalChunk& chunk : chunks)
+		written = written && mcfp.Seek(chunk.offset) && mcfp.Write(chunk.data.data(), chunk.data.size()) == chunk.data.size();
+	written = written && McdSyncFile(mcfp);
+
+	if (!written)
+	{
+		log_cb(RETRO_LOG_ERROR, "(FileMcd) Could not write to memory card: %s\n", WX_STR(mcfp.GetName()));
+
+		// Try again on the next write-back.
+		std::lock_guard<std::mutex> guard(m_lock);
+		for (const McdJournalChunk& chunk : chunks)
+			m_dirty[slot][chunk.offset / McdDirtyChunkSize] = true;
+		return false;
+	}
+
+	if (journaled)
+		wxRemoveFile(journal_name);
+	return true;
+}
+
+void FileMemoryCard::WriterThread()
+{
+	std::unique_lock<std::mutex> guard(m_lock);
+
+	while (!m_writer_quit)
+	{
+		m_notify.wait(guard, [this] { return m_writer_pending || m_writer_quit; });
+
+		// Games write a save a page at a time; give them a moment so the whole
+		// save goes out in a single write-back.
+		m_notify.wait_for(guard, std::chrono::milliseconds(100), [this] { return m_writer_quit; });
+		m_writer_pending = false;
+
+		guard.unlock();
+		for (uint slot = 0; slot < 8; ++slot)
+		{
+			if (m_file[slot].IsOpened())
+				FlushSlot(slot);
+		}
+		guard.lock();
+	}
 }
 
 // --------------------------------------------------------------------------------------
@@ -15,6 +15,10 @@
 
 #pragma once
 
+#include <vector>
+
+class wxFFile;
+
 struct McdSizeInfo
 {
 	u16 SectorSize; // Size of each sector, in bytes.  (only 512 and 1024 are valid)
@@ -37,3 +41,14 @@ s32 FileMcd_EraseBlock(uint port, uint slot, u32 adr);
 u64 FileMcd_GetCRC(uint port, uint slot);
 void FileMcd_NextFrame(uint port, uint slot);
 bool FileMcd_ReIndex(uint port, uint slot, const wxString& filter);
+
+// Card file helpers of FileMcd_EmuOpen, for the memory card check of the benchmark core
+struct McdJournalChunk
+{
+	u32 offset;
+	std::vector<u8> data;
+};
+
+bool FileMcd_AppendJournal(const wxString& mcdFile, const std::vector<McdJournalChunk>& chunks);
+bool FileMcd_ReplayJournal(wxFFile& mcd);
+bool FileMcd_OpenNoECC(wxString& path);
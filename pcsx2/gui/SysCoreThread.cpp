@@ -33,6 +33,8 @@
 
 #include "../DebugTools/MIPSAnalyst.h"
 #include "../DebugTools/SymbolMap.h"
+#include "../DebugTools/Profiler.h"
+#include "Utilities/ThreadPlacement.h"
 
 DEV9handler dev9Handler;
 USBhandler usbHandler;
@@ -260,6 +262,9 @@ void SysCoreThread::GameStartingInThread()
 	MIPSAnalyst::ScanForFunctions(ElfTextRange.first, ElfTextRange.first + ElfTextRange.second, true);
 	symbolMap.UpdateActiveSymbols();
 
+	if (EmuConfig.GuestProfiler)
+		GuestProfiler::Start(ElfCRC);
+
 	ApplyLoadedPatches(PPT_ONCE_ON_LOAD);
 }
 
@@ -279,6 +284,8 @@ void SysCoreThread::DoCpuExecute()
 
 void SysCoreThread::ExecuteTaskInThread()
 {
+	Threading::PlaceCurrentThread(Threading::ThreadRole_EE);
+
 	m_sem_event.Wait();
 
 	m_mxcsr_saved.bitmask = _mm_getcsr();
@@ -312,6 +319,8 @@ void SysCoreThread::OnCleanupInThread()
 	m_hasActiveMachine = false;
 	m_resetVirtualMachine = true;
 
+	GuestProfiler::Stop();
+
 	R3000A::ioman::reset();
 	// FIXME: temporary workaround for deadlock on exit, which actually should be a crash
 	vu1Thread.WaitVU();
@@ -300,6 +300,8 @@ void Threading::pxThread::_internal_execute()
     if (curthread_key)
         pthread_setspecific(curthread_key, this);
 
+    SetNameOfCurrentThread(m_name.ToUTF8());
+
     OnStartInThread();
     m_sem_startup.Post();
 
@@ -339,6 +341,10 @@ __forceinline void Threading::SpinWait()
 {
     _mm_pause();
 }
+
+void Threading::SetNameOfCurrentThread(const char *name)
+{
+}
 #else
 // Note: assuming multicore is safer because it forces the interlocked routines to use
 // the LOCK prefix.  The prefix works on single core CPUs fine (but is slow), but not
@@ -357,4 +363,16 @@ __forceinline void Threading::SpinWait()
     // performance hint and isn't required).
     __asm__("pause");
 }
+
+void Threading::SetNameOfCurrentThread(const char *name)
+{
+#if defined(__APPLE__)
+    pthread_setname_np(name);
+#else
+    char buf[16];
+    strncpy(buf, name, sizeof(buf) - 1);
+    buf[sizeof(buf) - 1] = 0;
+    pthread_setname_np(pthread_self(), buf);
+#endif
+}
 #endif
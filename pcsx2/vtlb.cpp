@@ -540,7 +540,11 @@ void vtlb_Core_Alloc(void)
 	{
 		bool okay = HostSys::MmapCommitPtr(vmap, VMAP_SIZE, PageProtectionMode().Read().Write());
 		if (okay)
+		{
+			// Looked up by every recompiled memory access
+			HostSys::MmapAdviseHugePages(vmap, VMAP_SIZE);
 			vtlbdata.vmap = vmap;
+		}
 		/* TODO/FIXME - find something else other than exception throwing */
 	}
 }
@@ -588,7 +592,9 @@ void vtlb_Core_Free(void)
 VtlbMemoryReserve::VtlbMemoryReserve( size_t size )
 	: m_reserve( size )
 {
-	m_reserve.SetPageAccessOnCommit( PageAccess_ReadWrite() );
+	// EE main memory included: the pages mmap_MarkCountedRamPage write protects
+	// are split back to 4kb by the OS, the rest of the RAM keeps large pages.
+	m_reserve.SetPageAccessOnCommit( PageAccess_ReadWrite() ).SetHugePagesOnCommit( true );
 }
 
 void VtlbMemoryReserve::Reserve( VirtualMemoryManagerPtr allocator, sptr offset )
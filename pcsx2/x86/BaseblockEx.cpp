@@ -53,3 +53,38 @@ void BaseBlocks::Link(u32 pc, s32* jumpptr)
 	links.insert(std::pair<u32, uptr>(pc, (uptr)jumpptr));
 }
 
+
+// Drops the blocks whose code lies in [lo, hi), so that range can be reused.
+// Jumps into those blocks go back to the recompiler, and the jumps they made
+// themselves are forgotten. Returns the number of blocks dropped.
+int BaseBlocks::Evict(uptr lo, uptr hi)
+{
+	for (linkiter_t i = links.begin(); i != links.end(); )
+	{
+		if (i->second >= lo && i->second < hi)
+			i = links.erase(i);
+		else
+			++i;
+	}
+
+	int kept = 0;
+	const int count = blocks.size();
+
+	for (int idx = 0; idx < count; idx++)
+	{
+		if (blocks[idx].fnptr >= lo && blocks[idx].fnptr < hi)
+		{
+			std::pair<linkiter_t, linkiter_t> range = links.equal_range(blocks[idx].startpc);
+			for (linkiter_t i = range.first; i != range.second; ++i)
+				*(u32*)i->second = recompiler - (i->second + 4);
+			continue;
+		}
+
+		if (kept != idx)
+			blocks[kept] = blocks[idx];
+		kept++;
+	}
+
+	blocks.truncate(kept);
+	return count - kept;
+}
@@ -112,6 +112,11 @@ public:
 		_Size = 0;
 	}
 
+	void truncate(s32 size)
+	{
+		_Size = size;
+	}
+
 	__fi u32 size() const
 	{
 		return _Size;
@@ -174,6 +179,11 @@ public:
 		return &blocks[idx];
 	}
 
+	__fi int Count() const
+	{
+		return blocks.size();
+	}
+
 	__fi BASEBLOCKEX* Get(u32 startpc)
 	{
 		return (*this)[Index(startpc)];
@@ -196,6 +206,7 @@ public:
 	}
 
 	void Link(u32 pc, s32* jumpptr);
+	int Evict(uptr lo, uptr hi);
 
 	__fi void Reset()
 	{
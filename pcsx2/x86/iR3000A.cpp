@@ -35,6 +35,7 @@
 #include "iCore.h"
 
 #include "AppConfig.h"
+#include "Utilities/Perf.h"
 
 using namespace x86Emitter;
 
@@ -200,6 +201,9 @@ static void _DynGen_Dispatchers(void)
 
 	HostSys::MemProtectStatic( iopRecDispatchers, PageAccess_ExecOnly() );
 
+	Perf::any.unmap((uptr)iopRecDispatchers, (uptr)iopRecDispatchers + PCSX2_PAGESIZE);
+	Perf::any.map((uptr)iopRecDispatchers, xGetPtr() - iopRecDispatchers, "IOP dispatchers");
+
 	recBlocks.SetJITCompile( iopJITCompile );
 }
 
@@ -599,6 +603,7 @@ void recResetIOP(void)
 
 	recBlocks.Reset();
 	g_psxMaxRecMem = 0;
+	Perf::iop.reset();
 
 	recPtr = *recMem;
 	psxbranch = 0;
@@ -1044,6 +1049,7 @@ StartRecomp:
 	}
 
 	s_pCurBlockEx->x86size = xGetPtr() - recPtr;
+	Perf::iop.map(s_pCurBlockEx->fnptr, s_pCurBlockEx->x86size, startpc);
 
 	recPtr = xGetPtr();
 
@@ -25,6 +25,20 @@ extern u32 pc;			         // recompiler pc
 extern int g_branch;	         // set for branch
 extern u32 target;		         // branch target
 
+// Snapshot of the EE recompiler cache, read by the benchmark runner.
+struct recStats
+{
+	u32 blocks;        // blocks currently live in the cache
+	u32 resets;        // full cache flushes since startup
+	u32 evictions;     // cache segments recycled since startup
+	u64 evicted;       // blocks dropped by segment recycling
+	u64 compiled;      // blocks compiled since startup
+	u32 code_used;     // bytes of x86 code held by the live blocks
+	u32 code_reserved; // size of the code reserve
+};
+
+extern void recGetStats(recStats& stats);
+
 //////////////////////////////////////////////////////////////////////////////////////////
 //
 
@@ -32,6 +32,7 @@
 #include <utility>
 
 #include "Utilities/FastJmp.h"
+#include "Utilities/Perf.h"
 
 using namespace x86Emitter;
 using namespace R5900;
@@ -99,6 +100,25 @@ static std::atomic<bool> eeRecIsReset(false);
 static std::atomic<bool> eeRecNeedsReset(false);
 static bool eeCpuExecuting = false;
 static bool g_resetEeScalingStats = false;
+static u32 s_recResetCount = 0;
+static u64 s_recCompiledCount = 0;
+
+// recMem is split in segments, filled in turn. Once the last one is full the
+// next block goes to the first one again, after dropping the blocks it held.
+static const uptr recSegmentSize = _16mb;
+static u32 s_recSegment = 0;
+static u32 s_recSegments = 1;
+static u32 s_recEvictions = 0;
+static u64 s_recEvictedCount = 0;
+static u32 s_recCodeUsed = 0; // bytes of x86 code held by the live blocks
+
+// Copy of the counters above for recGetStats, which runs outside the EE
+// thread. Only the thread driving the recompiler writes it (recPublishStats).
+static struct
+{
+	std::atomic<u32> blocks, resets, evictions, code_used, code_reserved;
+	std::atomic<u64> evicted, compiled;
+} s_recStats;
 static int g_patchesNeedRedo = 0;
 
 /* Forward declarations */
@@ -107,6 +127,7 @@ static int g_patchesNeedRedo = 0;
 void LoadAllPatchesAndStuff(const Pcsx2Config&);
 static void recRecompile( const u32 startpc );
 static void recClear(u32 addr, u32 size);
+static void recPublishStats();
 
 void _eeFlushAllUnused(void)
 {
@@ -416,6 +437,9 @@ static void _DynGen_Dispatchers(void)
 
 	HostSys::MemProtectStatic( eeRecDispatchers, PageAccess_ExecOnly() );
 
+	Perf::any.unmap((uptr)eeRecDispatchers, (uptr)eeRecDispatchers + PCSX2_PAGESIZE);
+	Perf::any.map((uptr)eeRecDispatchers, xGetPtr() - eeRecDispatchers, "EE dispatchers");
+
 	recBlocks.SetJITCompile( JITCompile );
 }
 
@@ -507,15 +531,23 @@ static void recResetRaw(void)
 
 	recBlocks.Reset();
 	mmap_ResetBlockTracking();
+	Perf::ee.reset();
 
 	x86SetPtr(*recMem);
 
 	recPtr = *recMem;
 	recConstBufPtr = recConstBuf;
+	s_recResetCount++;
+	s_recCodeUsed = 0;
+
+	s_recSegment  = 0;
+	s_recSegments = std::max<u32>(1, std::min<u32>((recMem->GetPtrEnd() - (u8*)*recMem) / recSegmentSize, 32));
 
 	g_branch = 0;
 	g_resetEeScalingStats = true;
 	g_patchesNeedRedo = 1;
+
+	recPublishStats();
 }
 
 static void memory_protect_recompiled_code(u32 startpc, u32 size)
@@ -666,16 +698,54 @@ static void doPlace0Patches(void)
     ApplyLoadedPatches(PPT_ONCE_ON_LOAD);
 }
 
+static u8* recSegmentStart(u32 segment)
+{
+	return (u8*)*recMem + segment * ((recMem->GetPtrEnd() - (u8*)*recMem) / s_recSegments);
+}
+
+// Moves recPtr to the next segment, dropping the blocks compiled there
+static void recNextSegment()
+{
+	s_recSegment = (s_recSegment + 1) % s_recSegments;
+
+	const uptr lo = (uptr)recSegmentStart(s_recSegment);
+	const uptr hi = lo + (recMem->GetPtrEnd() - (u8*)*recMem) / s_recSegments;
+
+	for (int i = 0; i < recBlocks.Count(); i++)
+	{
+		BASEBLOCKEX* pexblock = recBlocks[i];
+		if (pexblock->fnptr < lo || pexblock->fnptr >= hi)
+			continue;
+
+		BASEBLOCK* pblock = PC_GETBLOCK(pexblock->startpc);
+		if (pblock->m_pFnptr == pexblock->fnptr)
+			pblock->m_pFnptr = (uptr)JITCompile;
+		s_recCodeUsed -= pexblock->x86size;
+	}
+
+	s_recEvictedCount += recBlocks.Evict(lo, hi);
+	Perf::ee.unmap(lo, hi);
+	s_recEvictions++;
+
+	recPtr = (u8*)lo;
+}
+
 static void recRecompile( const u32 startpc )
 {
 	u32 i = 0;
 	u32 willbranch3 = 0;
 	u32 usecop2;
 
-	// if recPtr reached the mem limit reset whole mem
-	if (recPtr >= (recMem->GetPtrEnd() - _64kb))
-		eeRecNeedsReset = true;
-	else if ((recConstBufPtr - recConstBuf) >= RECCONSTBUF_SIZE - 64)
+	// if recPtr reached the end of its segment move on to the next one, or
+	// reset whole mem if there is only one
+	if (recPtr >= (s_recSegment + 1 < s_recSegments ? recSegmentStart(s_recSegment + 1) : recMem->GetPtrEnd()) - _64kb)
+	{
+		if (s_recSegments > 1)
+			recNextSegment();
+		else
+			eeRecNeedsReset = true;
+	}
+	if ((recConstBufPtr - recConstBuf) >= RECCONSTBUF_SIZE - 64)
 		eeRecNeedsReset = true;
 
 	if (eeRecNeedsReset) recResetRaw();
@@ -1074,13 +1144,24 @@ StartRecomp:
 	}
 
 	s_pCurBlockEx->x86size = xGetPtr() - recPtr;
+	Perf::ee.map(s_pCurBlockEx->fnptr, s_pCurBlockEx->x86size, startpc);
 
 	recPtr = xGetPtr();
+	s_recCompiledCount++;
+	s_recCodeUsed += s_pCurBlockEx->x86size;
+	recPublishStats();
 
 	s_pCurBlock = NULL;
 	s_pCurBlockEx = NULL;
 }
 
+static void recRemoveBlocks(int first, int last)
+{
+	for (int i = first; i <= last; i++)
+		s_recCodeUsed -= recBlocks[i]->x86size;
+	recBlocks.Remove(first, last);
+}
+
 // Size is in dwords (4 bytes)
 static void recClear(u32 addr, u32 size)
 {
@@ -1109,7 +1190,7 @@ static void recClear(u32 addr, u32 size)
 		if (pblock == s_pCurBlock)
 		{
 			if(toRemoveLast != blockidx)
-				recBlocks.Remove((blockidx + 1), toRemoveLast);
+				recRemoveBlocks((blockidx + 1), toRemoveLast);
 			toRemoveLast = --blockidx;
 			continue;
 		}
@@ -1129,7 +1210,7 @@ static void recClear(u32 addr, u32 size)
 	}
 
 	if(toRemoveLast != blockidx)
-		recBlocks.Remove((blockidx + 1), toRemoveLast);
+		recRemoveBlocks((blockidx + 1), toRemoveLast);
 
 	upperextent = std::min(upperextent, ceiling);
 
@@ -1140,6 +1221,8 @@ static void recClear(u32 addr, u32 size)
 		for (int i = 0; i < memsize/(int)sizeof(uptr); i++)
 			base[i].m_pFnptr = (uptr)JITCompile;
 	}
+
+	recPublishStats();
 }
 
 static void recReserveCache(void)
@@ -1174,6 +1257,8 @@ static void recShutdown(void)
 	safe_aligned_free( recLutReserve_RAM );
 
 	recBlocks.Reset();
+	s_recCodeUsed = 0;
+	recPublishStats();
 
 	recRAM = recROM = recROM1 = recROM2 = NULL;
 
@@ -1495,6 +1580,30 @@ static uint recGetCacheReserve(void)
 	return m_ConfiguredCacheReserve;
 }
 
+static void recPublishStats()
+{
+	s_recStats.blocks.store(recBlocks.Count(), std::memory_order_relaxed);
+	s_recStats.resets.store(s_recResetCount, std::memory_order_relaxed);
+	s_recStats.evictions.store(s_recEvictions, std::memory_order_relaxed);
+	s_recStats.evicted.store(s_recEvictedCount, std::memory_order_relaxed);
+	s_recStats.compiled.store(s_recCompiledCount, std::memory_order_relaxed);
+	s_recStats.code_used.store(s_recCodeUsed, std::memory_order_relaxed);
+	s_recStats.code_reserved.store(recMem ? (u32)(recMem->GetPtrEnd() - (u8*)*recMem) : 0, std::memory_order_relaxed);
+}
+
+// Called from outside the EE thread. Each counter is as of the last block
+// compiled or cleared, they may be a block apart from each other.
+void recGetStats(recStats& stats)
+{
+	stats.blocks        = s_recStats.blocks.load(std::memory_order_relaxed);
+	stats.resets        = s_recStats.resets.load(std::memory_order_relaxed);
+	stats.evictions     = s_recStats.evictions.load(std::memory_order_relaxed);
+	stats.evicted       = s_recStats.evicted.load(std::memory_order_relaxed);
+	stats.compiled      = s_recStats.compiled.load(std::memory_order_relaxed);
+	stats.code_used     = s_recStats.code_used.load(std::memory_order_relaxed);
+	stats.code_reserved = s_recStats.code_reserved.load(std::memory_order_relaxed);
+}
+
 R5900cpu recCpu =
 {
 	recReserve,
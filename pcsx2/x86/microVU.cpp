@@ -39,15 +39,21 @@ static __ri microProgram* mVUcreateProg(microVU& mVU, int startPC) {
 	prog->idx     = mVU.prog.total++;
 	prog->ranges  = new std::deque<microRange>();
 	prog->startPC = startPC;
+	prog->hashDirty = true;   // Indexed once the program stops being current
+	prog->entries = EmuConfig.VUProgramCache ? new std::vector<microPersistEntry>() : NULL;
 	mVUcacheProg(mVU, *prog); // Cache Micro Program
 	return prog;
 }
 
+static void mVUpersistHarvest(microVU& mVU, microProgram& prog);
+
 // Deletes a program
 static __ri void mVUdeleteProg(microVU& mVU, microProgram*& prog) {
+	mVUpersistHarvest(mVU, *prog);
 	for (u32 i = 0; i < (mVU.progSize / 2); i++)
 		safe_delete(prog->block[i]);
 	safe_delete(prog->ranges);
+	safe_delete(prog->entries);
 	safe_aligned_free(prog);
 }
 
@@ -73,6 +79,131 @@ static __fi bool mVUcmpProg(microVU& mVU, microProgram& prog, const bool cmpWhol
 	return true;
 }
 
+// Hashes mChunkSize bytes of micro memory
+static __fi u64 mVUhashChunk(const u8* data) {
+	const u64* p = (const u64*)data;
+	u64 h = 0xcbf29ce484222325ull;
+	for (uint i = 0; i < mChunkSize / 8; i++) {
+		h = (h ^ p[i]) * 0x9e3779b97f4a7c15ull;
+		h ^= h >> 29;
+	}
+	return h;
+}
+
+// Combines the hashes of the chunks in mask into a program hash key
+static __fi u64 mVUhashKey(microVU& mVU, u64 mask, const u64* chunkHash) {
+	u64 h = mask * 0x9e3779b97f4a7c15ull;
+	for (uint i = 0; i < mVU.microMemSize / mChunkSize; i++) {
+		if (!((mask >> i) & 1)) continue;
+		h = (h ^ chunkHash[i]) * 0xff51afd7ed558ccdull;
+		h ^= h >> 33;
+	}
+	return h;
+}
+
+// Rehashes the chunks of mVU.regs().Micro written since the last search
+static __fi void mVUupdateChunkHashes(microVU& mVU) {
+	if (!mVU.prog.chunkDirty) return;
+	for (uint i = 0; i < mVU.microMemSize / mChunkSize; i++) {
+		if ((mVU.prog.chunkDirty >> i) & 1)
+			mVU.prog.chunkHash[i] = mVUhashChunk(mVU.regs().Micro + i * mChunkSize);
+	}
+	mVU.prog.chunkDirty = 0;
+}
+
+// Removes a program from the hash index of its startPC
+static void mVUunindexProg(microVU& mVU, microProgram& prog) {
+	if (!prog.indexed) return;
+	microProgramIndex& index = *mVU.prog.index[prog.startPC];
+	auto range = index.progs.equal_range(prog.hashKey);
+	for (auto it = range.first; it != range.second; ++it) {
+		if (it->second == &prog) {
+			index.progs.erase(it);
+			break;
+		}
+	}
+	for (auto it = index.masks.begin(); it != index.masks.end(); ++it) {
+		if (it->first == prog.chunkMask) {
+			if (!--it->second) index.masks.erase(it);
+			break;
+		}
+	}
+	prog.indexed = false;
+}
+
+// (Re)adds a program to the hash index of its startPC, keyed by the hash of
+// the chunks its ranges cover. Chunks are coarser than ranges, so a changed
+// byte next to a range hides a match; the program is recompiled then.
+static void mVUindexProg(microVU& mVU, microProgram& prog) {
+	mVUunindexProg(mVU, prog);
+	prog.hashDirty = false;
+
+	u64 mask = 0;
+	for (const auto& range : *prog.ranges) {
+		if (range.end <= range.start) continue;
+		const u32 first = range.start / mChunkSize;
+		const u32 last  = (std::min<u32>(range.end, mVU.microMemSize) - 1) / mChunkSize;
+		for (u32 i = first; i <= last; i++)
+			mask |= 1ull << i;
+	}
+	if (!mask) return;
+
+	u64 chunkHash[mChunkCount];
+	for (uint i = 0; i < mVU.microMemSize / mChunkSize; i++) {
+		if ((mask >> i) & 1)
+			chunkHash[i] = mVUhashChunk((u8*)prog.data + i * mChunkSize);
+	}
+
+	microProgramIndex& index = *mVU.prog.index[prog.startPC];
+	prog.chunkMask = mask;
+	prog.hashKey   = mVUhashKey(mVU, mask, chunkHash);
+	prog.indexed   = true;
+	index.progs.emplace(prog.hashKey, &prog);
+
+	auto it = index.masks.begin();
+	for ( ; it != index.masks.end(); ++it) {
+		if (it->first == mask) break;
+	}
+	if (it == index.masks.end()) index.masks.emplace_back(mask, 1);
+	else it->second++;
+}
+
+#include "microVU_Persist.inl"
+
+// Searches the cached programs of the current start PC for one matching
+// mVU.regs().Micro, sets prog.cur to it and moves it to the front of its list
+static microProgram* mVUfindProg(microVU& mVU)
+{
+	microProgramList* list = mVU.prog.prog[mVU.regs().start_pc / 8];
+
+	mVUpersistUpdate(mVU);
+
+	auto found = [&](std::deque<microProgram*>::iterator it) {
+		microProgram* prog = it[0];
+		list->erase(it);
+		list->push_front(prog);
+		return prog;
+	};
+
+	// Look the program up by the hash of the chunks it covers, then
+	// confirm the hit with a compare of its ranges. Programs are indexed
+	// before their quick reference goes (mVUclear), so a miss is final.
+	microProgramIndex& index = *mVU.prog.index[mVU.regs().start_pc / 8];
+	if (index.progs.empty()) return nullptr;
+
+	mVUupdateChunkHashes(mVU);
+	for (const auto& mask : index.masks) {
+		auto range = index.progs.equal_range(mVUhashKey(mVU, mask.first, mVU.prog.chunkHash));
+		for (auto it = range.first; it != range.second; ++it) {
+			if (!mVUcmpProg(mVU, *it->second, 0)) continue;
+			auto pos = std::find(list->begin(), list->end(), it->second);
+			if (pos != list->end())
+				return found(pos);
+		}
+	}
+	return nullptr;
+}
+
 // Searches for Cached Micro Program and sets prog.cur to it (returns entry-point to program)
 _mVUt __fi void* mVUsearchProg(u32 startPC, uptr pState)
 {
@@ -81,28 +212,23 @@ _mVUt __fi void* mVUsearchProg(u32 startPC, uptr pState)
 	microProgramList* list = mVU.prog.prog[mVU.regs().start_pc / 8];
 
 	if(!quick.prog) { // If null, we need to search for new program
-		std::deque<microProgram*>::iterator it(list->begin());
-		for ( ; it != list->end(); ++it) {
-			bool b = mVUcmpProg(mVU, *it[0], 0);
-			if (b) {
-				quick.block = it[0]->block[startPC/8];
-				quick.prog  = it[0];
-				list->erase(it);
-				list->push_front(quick.prog);
-				// Sanity check, in case for some reason the program compilation aborted half way through (JALR for example)
-				if (quick.block == nullptr)
-				{
-					void* entryPoint = mVUblockFetch(mVU, startPC, pState);
-					return entryPoint;
-				}
-				return mVUentryGet(mVU, quick.block, startPC, pState);
+		if (microProgram* prog = mVUfindProg(mVU)) {
+			quick.block = prog->block[startPC/8];
+			quick.prog  = prog;
+			// Sanity check, in case for some reason the program compilation aborted half way through (JALR for example)
+			if (quick.block == nullptr)
+			{
+				void* entryPoint = mVUblockFetch(mVU, startPC, pState);
+				return entryPoint;
 			}
+			return mVUentryGet(mVU, quick.block, startPC, pState);
 		}
 
 		// If cleared and program not found, make a new program instance
 		mVU.prog.cleared	= 0;
 		mVU.prog.isSame		= 1;
 		mVU.prog.cur		= mVUcreateProg(mVU, mVU.regs().start_pc / 8);
+		mVUpersistCompile(mVU, *mVU.prog.cur, mVU.regs().Micro);
 		void* entryPoint	= mVUblockFetch(mVU,  startPC, pState);
 		quick.block			= mVU.prog.cur->block[startPC/8];
 		quick.prog			= mVU.prog.cur;
@@ -175,6 +301,15 @@ static void mVUinit(microVU& mVU, uint vuIndex)
 	mVU.regAlloc.reset(new microRegAlloc(mVU.index));
 }
 
+// Points the rec-cache at the start of a segment
+static void mVUsetSegment(microVU& mVU, u32 segment) {
+	const uptr segSize = (mVU.cacheSize / mVU.prog.segments) * _1mb;
+	mVU.prog.segment	= segment;
+	mVU.prog.x86start	= mVU.cache + segment * segSize;
+	mVU.prog.x86ptr		= mVU.prog.x86start;
+	mVU.prog.x86end		= mVU.prog.x86start + segSize - mVUcacheSafeZone * _1mb;
+}
+
 // Resets Rec Data
 void mVUreset(microVU& mVU, bool resetReserve) {
 	if (THREAD_VU1)
@@ -197,6 +332,9 @@ void mVUreset(microVU& mVU, bool resetReserve) {
 	mVUdispatcherCD(mVU);
 	mVUemitSearch();
 
+	Perf::vu[mVU.index].reset();
+	Perf::vu[mVU.index].map((uptr)mVU.dispCache, xGetPtr() - mVU.dispCache, "dispatchers");
+
 	mVU.regs().nextBlockCycles = 0;
 	memset(&mVU.prog.lpState, 0, sizeof(mVU.prog.lpState));
 
@@ -207,13 +345,19 @@ void mVUreset(microVU& mVU, bool resetReserve) {
 	mVU.prog.total		=  0;
 	mVU.prog.curFrame	=  0;
 
+	mVU.prog.resets++;
+
 	// Setup Dynarec Cache Limits for Each Program
-	u8* z = mVU.cache;
-	mVU.prog.x86start	= z;
-	mVU.prog.x86ptr		= z;
-	mVU.prog.x86end		= z + ((mVU.cacheSize - mVUcacheSafeZone) * _1mb);
+	mVU.prog.segments	= std::max(1u, std::min(mVU.cacheSize / mVUsegmentSize, 32u));
+	mVUsetSegment(mVU, 0);
+
+	mVU.prog.chunkDirty	= ~0ull;
 
 	for(u32 i = 0; i < (mVU.progSize / 2); i++) {
+		if(!mVU.prog.index[i])
+			mVU.prog.index[i] = new microProgramIndex();
+		mVU.prog.index[i]->masks.clear();
+		mVU.prog.index[i]->progs.clear();
 		if(!mVU.prog.prog[i]) {
 			mVU.prog.prog[i] = new std::deque<microProgram*>();
 			continue;
@@ -227,9 +371,74 @@ void mVUreset(microVU& mVU, bool resetReserve) {
 		mVU.prog.quick[i].prog  = NULL;
 	}
 
+	// A rec reset outside of cache full flushes is a VM reset/state load,
+	// a good time to save the programs and start over with the cached ones
+	if (resetReserve)
+		mVUpersistSave(mVU);
+
 	HostSys::MemProtect(mVU.dispCache, mVUdispCacheSize, PageAccess_ExecOnly());
 }
 
+// Moves on to the next rec-cache segment once the current one is full, and
+// discards the microPrograms having code there. Programs still in use get
+// recompiled into the new segment, so only code not run since the cache
+// last wrapped around is really lost.
+void mVUnextSegment(microVU& mVU) {
+	if (mVU.prog.segments <= 1) {
+		mVUreset(mVU, false);
+		return;
+	}
+
+	const u32 segment = (mVU.prog.segment + 1) % mVU.prog.segments;
+	mVUsetSegment(mVU, segment);
+	mVU.prog.evictions++;
+	Perf::vu[mVU.index].unmap((uptr)mVU.prog.x86start, (uptr)mVU.prog.x86end + mVUcacheSafeZone * _1mb);
+
+	for (u32 i = 0; i < (mVU.progSize / 2); i++) {
+		microProgramList* list = mVU.prog.prog[i];
+		for (auto it = list->begin(); it != list->end(); ) {
+			microProgram* prog = it[0];
+			if (!((prog->segMask >> segment) & 1)) {
+				++it;
+				continue;
+			}
+			if (mVU.prog.quick[i].prog == prog) {
+				mVU.prog.quick[i].block = NULL;
+				mVU.prog.quick[i].prog  = NULL;
+			}
+			if (mVU.prog.cur == prog) {
+				mVU.prog.cur	= NULL;
+				mVU.prog.isSame	= -1;
+			}
+			mVUunindexProg(mVU, *prog);
+			it = list->erase(it);
+			mVUdeleteProg(mVU, prog);
+			mVU.prog.evicted++;
+		}
+	}
+}
+
+void mVUgetStats(u32 vuIndex, microVUStats& stats) {
+	microVU& mVU = vuIndex ? microVU1 : microVU0;
+	if (!mVU.prog.segments) { // Not in use (interpreter)
+		memzero(stats);
+		return;
+	}
+
+	const uptr segSize = (mVU.cacheSize / mVU.prog.segments) * _1mb;
+	const uptr inSegment = mVU.prog.x86ptr - mVU.prog.x86start;
+
+	stats.programs = 0;
+	for (u32 i = 0; i < (mVU.progSize / 2); i++) {
+		if (mVU.prog.prog[i]) stats.programs += mVU.prog.prog[i]->size();
+	}
+	stats.resets		= mVU.prog.resets;
+	stats.evictions		= mVU.prog.evictions;
+	stats.evicted		= mVU.prog.evicted;
+	stats.code_used		= (u32)(mVU.prog.evictions ? (mVU.prog.segments - 1) * segSize + inSegment : mVU.prog.x86ptr - mVU.cache);
+	stats.code_reserved	= (u32)(mVU.cacheSize * _1mb);
+}
+
 // Free Allocated Resources
 static void mVUclose(microVU& mVU)
 {
@@ -244,21 +453,44 @@ static void mVUclose(microVU& mVU)
 		}
 		safe_delete(mVU.prog.prog[i]);
 	}
+	for (u32 i = 0; i < (mVU.progSize / 2); i++)
+		safe_delete(mVU.prog.index[i]);
+	mVUpersistSave(mVU);
+	mVU.prog.segments = 0;
 }
 
 // Clears Block Data in specified range
 static __fi void mVUclear(mV, u32 addr, u32 size)
 {
+	// Mark the chunks about to be written, they get rehashed on the next search
+	if (size) {
+		const u32 first = (addr & (mVU.microMemSize - 1)) / mChunkSize;
+		const u32 last  = std::min(addr + size - 1, mVU.microMemSize - 1) / mChunkSize;
+		for (u32 i = first; i <= last; i++)
+			mVU.prog.chunkDirty |= 1ull << i;
+	}
+
 	if(!mVU.prog.cleared) {
 		mVU.prog.cleared = 1;		// Next execution searches/creates a new microprogram
 		memzero(mVU.prog.lpState); // Clear pipeline state
+		if (mVU.prog.cur && mVU.prog.cur->hashDirty)
+			mVUindexProg(mVU, *mVU.prog.cur);
 		for(u32 i = 0; i < (mVU.progSize / 2); i++) {
+			if (mVU.prog.quick[i].prog && mVU.prog.quick[i].prog->hashDirty)
+				mVUindexProg(mVU, *mVU.prog.quick[i].prog);
 			mVU.prog.quick[i].block = NULL; // Clear current quick-reference block
 			mVU.prog.quick[i].prog  = NULL; // Clear current quick-reference prog
 		}
 	}
 }
 
+#include "microVU_Background.inl"
+
+// Called by mVUcompile() before each block
+void mVUbackgroundSync(microVU& mVU) {
+	if (mVU.index && mVUbackground) mVUbackground->Sync();
+}
+
 //------------------------------------------------------------------
 // recMicroVU0 / recMicroVU1
 //------------------------------------------------------------------
@@ -283,6 +515,7 @@ void recMicroVU0::Shutdown() noexcept {
 void recMicroVU1::Shutdown() noexcept {
 	if (m_Reserved.exchange(0) == 1) {
 		vu1Thread.WaitVU();
+		safe_delete(mVUbackground);
 		mVUclose(microVU1);
 	}
 }
@@ -294,6 +527,7 @@ void recMicroVU0::Reset() {
 void recMicroVU1::Reset() {
 	if(!m_Reserved) return;
 	vu1Thread.WaitVU();
+	if (mVUbackground) mVUbackground->Reset();
 	mVUreset(microVU1, true);
 }
 
@@ -325,10 +559,17 @@ void recMicroVU1::SetStartPC(u32 startPC)
 void recMicroVU1::Execute(u32 cycles) {
 	if (!THREAD_VU1) {
 		if(!(VU0.VI[REG_VPU_STAT].UL & 0x100)) return;
+		// Interpreter or recompiler depends on the worker's progress, not deterministic
+		if (EmuConfig.VUBackgroundCompile && !EmuConfig.Deterministic) {
+			if (!mVUbackground) mVUbackground = new microVUBackground();
+			if (mVUbackground->Execute(cycles)) return;
+		}
+		else if (mVUbackground) mVUbackground->Reset();
 	}
 	VU1.VI[REG_TPC].UL <<= 3;
 	((mVUrecCall)microVU1.startFunct)(VU1.VI[REG_TPC].UL, cycles);
 	VU1.VI[REG_TPC].UL >>= 3;
+	if (!THREAD_VU1 && mVUbackground) mVUbackground->Leave();
 	if(microVU1.regs().flags & 0x4)
 	{
 		microVU1.regs().flags &= ~0x4;
@@ -340,7 +581,8 @@ void recMicroVU0::Clear(u32 addr, u32 size) {
 	mVUclear(microVU0, addr, size);
 }
 void recMicroVU1::Clear(u32 addr, u32 size) {
-	mVUclear(microVU1, addr, size);
+	if (mVUbackground) mVUbackground->Clear(addr, size);
+	else mVUclear(microVU1, addr, size);
 }
 
 uint recMicroVU0::GetCacheReserve() const {
@@ -356,6 +598,7 @@ void recMicroVU0::SetCacheReserve(uint reserveInMegs) const {
 	mVUreserveCache(microVU0); // Need rec-reset after this
 }
 void recMicroVU1::SetCacheReserve(uint reserveInMegs) const {
+	if (mVUbackground) mVUbackground->Reset();
 	microVU1.cacheSize = std::min(reserveInMegs, mVUcacheReserve);
 	safe_delete(microVU1.cache_reserve); // I assume this unmaps the memory
 	mVUreserveCache(microVU1); // Need rec-reset after this
@@ -363,5 +606,10 @@ void recMicroVU1::SetCacheReserve(uint reserveInMegs) const {
 
 void recMicroVU1::ResumeXGkick() {
 	if(!(VU0.VI[REG_VPU_STAT].UL & 0x100)) return;
+	if (mVUbackground) {
+		if (mVUbackground->IsInterpreting()) return;
+		mVUbackground->Enter();
+	}
 	((mVUrecCallXG)microVU1.startFunctXG)();
+	if (mVUbackground) mVUbackground->Leave();
 }
@@ -20,6 +20,8 @@
 using namespace x86Emitter;
 
 #include <deque>
+#include <unordered_map>
+#include <vector>
 #include <algorithm>
 #include <memory>
 #include "Common.h"
@@ -30,6 +32,7 @@ using namespace x86Emitter;
 #include "iR5900.h"
 #include "R5900OpcodeTables.h"
 #include "System/RecTypes.h"
+#include "Utilities/Perf.h"
 #include "microVU_Misc.h"
 #include "microVU_IR.h"
 
@@ -114,17 +117,39 @@ struct microRange {
 	s32 end;   // End PC   (The opcode the block ends with)
 };
 
+// Block entry point, recorded for the persistent program cache
+struct microPersistEntry {
+	u32			 startPC;
+	microRegInfo state;
+};
+
 #define mProgSize (0x4000/4)
+#define mChunkSize 256 // Granularity of the micro memory hashes (in bytes)
+#define mChunkCount (mProgSize*4/mChunkSize)
 struct microProgram {
 	u32				   data [mProgSize];   // Holds a copy of the VU microProgram
 	microBlockManager* block[mProgSize/2]; // Array of Block Managers
 	std::deque<microRange>* ranges;			   // The ranges of the microProgram that have already been recompiled
 	u32 startPC; // Start PC of this program
 	int idx;	 // Program index
+	u64 chunkMask; // Micro memory chunks covered by ranges (as of the last indexing)
+	u64 hashKey;   // Hash of those chunks in data (as of the last indexing)
+	bool indexed;  // Program is in the hash index with chunkMask/hashKey
+	bool hashDirty;// Ranges or data changed since the program was indexed
+	u32 segMask;   // Rec-cache segments holding code of this program
+	std::vector<microPersistEntry>* entries; // Blocks compiled so far (NULL if the persistent cache is off)
 };
 
 typedef std::deque<microProgram*> microProgramList;
 
+// Hash index of the microPrograms sharing a startPC, keyed by the hash of the
+// micro memory chunks each program covers. Programs at one startPC usually
+// cover the same chunks, so a search is a handful of map lookups.
+struct microProgramIndex {
+	std::vector<std::pair<u64, u32>> masks;			   // Distinct chunk masks in use, with their user count
+	std::unordered_multimap<u64, microProgram*> progs; // hashKey -> microProgram
+};
+
 struct microProgramQuick {
 	microBlockManager*    block; // Quick reference to valid microBlockManager for current startPC
 	microProgram*		  prog;	 // The microProgram who is the owner of 'block'
@@ -134,6 +159,9 @@ struct microProgManager {
 	microIR<mProgSize>	IRinfo;				// IR information
 	microProgramList*	prog [mProgSize/2];	// List of microPrograms indexed by startPC values
 	microProgramQuick	quick[mProgSize/2];	// Quick reference to valid microPrograms for current execution
+	microProgramIndex*	index[mProgSize/2];	// Hash index of the microPrograms, by startPC
+	u64					chunkHash[mChunkCount];	// Hash of each mChunkSize bytes of mVU.regs().Micro
+	u64					chunkDirty;			// Chunks written since chunkHash was last updated
 	microProgram*		cur;				// Pointer to currently running MicroProgram
 	int					total;				// Total Number of valid MicroPrograms
 	int					isSame;				// Current cached microProgram is Exact Same program as mVU.regs().Micro (-1 = unknown, 0 = No, 1 = Yes)
@@ -142,12 +170,18 @@ struct microProgManager {
 	u8*					x86ptr;				// Pointer to program's recompilation code
 	u8*					x86start;			// Start of program's rec-cache
 	u8*					x86end;				// Limit of program's rec-cache
+	u32					segment;			// Rec-cache segment code is currently written to
+	u32					segments;			// Number of rec-cache segments (1 = flush the whole cache when full)
+	u32					resets;				// Whole rec-cache flushes
+	u32					evictions;			// Segments recycled
+	u64					evicted;			// microPrograms discarded by segment recycling
 	microRegInfo		lpState;			// Pipeline state from where program left off (useful for continuing execution)
 };
 
 static const uint mVUdispCacheSize	= PCSX2_PAGESIZE; // Dispatcher Cache Size (in bytes)
 static const uint mVUcacheSafeZone	= 3;		  // Safe-Zone for program recompilation (in megabytes)
 static const uint mVUcacheReserve = 64; // mVU0, mVU1 Reserve Cache Size (in megabytes)
+static const uint mVUsegmentSize	= 16;		  // Rec-cache segment size (in megabytes)
 
 struct microVU {
 
@@ -177,6 +211,7 @@ struct microVU {
 	u8*		exitFunctXG;  // Function Ptr to the recompiler dispatcher (xgkick exit)
 	u8*		resumePtrXG;  // Ptr to recompiled code position to resume xgkick
 	u32		code;		  // Contains the current Instruction
+	u8*		compileSrc;	  // Micro code being compiled, if not mVU.regs().Micro (background compile)
 	u32		divFlag;	  // 1 instance of I/D flags
 	u32		VIbackup;	  // Holds a backup of a VI reg if modified before a branch
 	u32		VIxgkick;	  // Holds a backup of a VI reg used for xgkick-delays
@@ -203,8 +238,10 @@ __aligned16 microVU microVU1;
 
 // Main Functions
 extern void  mVUreset(microVU& mVU, bool resetReserve);
+extern void  mVUnextSegment(microVU& mVU);
 extern void* mVUblockFetch(microVU& mVU, u32 startPC, uptr pState);
 _mVUt extern void* mVUcompileJIT(u32 startPC, uptr ptr);
+extern void  mVUbackgroundSync(microVU& mVU);
 
 // Prototypes for Linux
 mVUop(mVUopU);
@@ -0,0 +1,296 @@
+/*  PCSX2 - PS2 Emulator for PCs
+ *  Copyright (C) 2002-2010  PCSX2 Dev Team
+ *
+ *  PCSX2 is free software: you can redistribute it and/or modify it under the terms
+ *  of the GNU Lesser General Public License as published by the Free Software Found-
+ *  ation, either version 3 of the License, or (at your option) any later version.
+ *
+ *  PCSX2 is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ *  without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ *  PURPOSE.  See the GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along with PCSX2.
+ *  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+
+#include "Utilities/Threading.h"
+
+//------------------------------------------------------------------
+// Background Compilation (VU1)
+//------------------------------------------------------------------
+// A VU1 program that isn't cached yet is recompiled by a worker thread
+// while the interpreter runs it; once the worker is done the program is
+// added to the cache and the following runs use the recompiled code.
+// Only used when VU1 runs on the EE thread (with MTVU the compile doesn't
+// stall the EE already).
+//
+// The worker compiles from the program's copy of micro memory. It owns the
+// compile state of microVU1 until it is done, but hands it over to the EE
+// thread between two blocks: to run cached programs from their recompiled
+// code and to clear micro memory. The fields both sides keep their own
+// value in (microVUBackground::Context) are swapped at each handover.
+// Programs missing from the cache while the worker is busy are interpreted,
+// and so is a cached program needing a new block compiled once the worker
+// is done.
+
+class microVUBackground {
+	struct Context {
+		microProgram*	cur;
+		int				isSame;
+		int				cleared;
+		u8*				compileSrc;
+		microRegInfo	lpState;
+
+		void Save(microVU& mVU) {
+			cur			= mVU.prog.cur;
+			isSame		= mVU.prog.isSame;
+			cleared		= mVU.prog.cleared;
+			compileSrc	= mVU.compileSrc;
+			lpState		= mVU.prog.lpState;
+		}
+		void Restore(microVU& mVU) const {
+			mVU.prog.cur	 = cur;
+			mVU.prog.isSame	 = isSame;
+			mVU.prog.cleared = cleared;
+			mVU.compileSrc	 = compileSrc;
+			mVU.prog.lpState = lpState;
+		}
+	};
+
+	std::thread				m_thread;
+	std::mutex				m_mutex;
+	std::condition_variable	m_cv;
+	std::atomic<bool>		m_done;
+	bool					m_quit;
+	microProgram*			m_prog;			// Program being compiled (NULL = idle)
+	u32						m_startPC;
+	microRegInfo			m_state;
+	std::mutex				m_owner;		// Held by the side owning the compile state while the worker is busy
+	std::atomic<bool>		m_wanted;		// EE thread waits for the worker to hand the compile state over
+	bool					m_entered;		// EE thread holds m_owner
+	Context					m_ctx;			// EE thread's compile state while it doesn't own it
+	bool					m_interpreting;	// Current VU1 program runs in the interpreter
+	InterpVU1				m_interp;
+
+	void Compile() {
+		microVU& mVU = microVU1;
+		std::lock_guard<std::mutex> lock(m_owner);
+		xSetPtr(mVU.prog.x86ptr);
+		mVU.compileSrc	 = (u8*)m_prog->data;
+		mVU.prog.cur	 = m_prog;
+		mVU.prog.isSame	 = 1;
+		mVUpersistCompile(mVU, *m_prog, (u8*)m_prog->data);
+		mVUblockFetch(mVU, m_startPC, (uptr)&m_state);
+		mVU.prog.x86ptr	 = xGetPtr();
+		mVU.compileSrc	 = NULL;
+	}
+
+	void ThreadProc() {
+		SetNameOfCurrentThread("mVU1 Compile");
+		std::unique_lock<std::mutex> lock(m_mutex);
+		for (;;) {
+			m_cv.wait(lock, [&] { return m_quit || (m_prog && !m_done); });
+			if (m_quit) return;
+			lock.unlock();
+			Compile();
+			lock.lock();
+			m_done.store(true, std::memory_order_release);
+			m_cv.notify_all();
+		}
+	}
+
+	// Hands the compile state over to the EE thread if it waits for it,
+	// takes it back once the EE thread is done (worker, between blocks)
+	void Yield() {
+		if (!m_wanted.load(std::memory_order_acquire)) return;
+		microVU& mVU = microVU1;
+		Context ctx;
+		ctx.Save(mVU);
+		m_owner.unlock();
+		while (m_wanted.load(std::memory_order_acquire))
+			std::this_thread::yield();
+		m_owner.lock();
+		ctx.Restore(mVU);
+	}
+
+	// Adds the compiled program to the cache and gives the compile state
+	// back to the EE thread (EE thread)
+	void Install(bool running) {
+		microVU& mVU = microVU1;
+		m_ctx.Restore(mVU);
+		mVU.prog.prog[m_prog->startPC]->push_front(m_prog);
+		mVUindexProg(mVU, *m_prog);
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			m_prog = NULL;
+			m_done.store(false, std::memory_order_relaxed);
+		}
+
+		// Recompiled code being run can't move to the next segment, the end
+		// of the run (mVUcleanUp) does
+		if (!running && mVU.prog.x86ptr >= mVU.prog.x86end)
+			mVUnextSegment(mVU);
+	}
+
+	void Interpret(u32 cycles) {
+		m_interpreting = true;
+		m_interp.Execute(cycles);
+		if (VU0.VI[REG_VPU_STAT].UL & 0x100) return;
+
+		// Program ended, hand the flags over to the recompiler the way the
+		// end of a recompiled program does (status flag in mVU's format)
+		const u32 status = VU1.VI[REG_STATUS_FLAG].UL;
+		const u32 sFlag	 = ((status >> 3) & 0x18) | ((status << 11) & 0x1800) | ((status << 14) & 0x3cf0000);
+		for (int i = 0; i < 4; i++) {
+			VU1.micro_statusflags[i] = sFlag;
+			VU1.micro_macflags[i]	 = VU1.VI[REG_MAC_FLAG].UL;
+			VU1.micro_clipflags[i]	 = VU1.VI[REG_CLIP_FLAG].UL;
+		}
+		VU1.pending_q		= VU1.VI[REG_Q].UL;
+		VU1.pending_p		= VU1.VI[REG_P].UL;
+		VU1.nextBlockCycles = 0;
+
+		m_interpreting = false;
+		if (m_prog) memzero(m_ctx.lpState);
+		else		memzero(microVU1.prog.lpState);
+	}
+
+public:
+	microVUBackground()
+		: m_done(false), m_quit(false), m_prog(NULL), m_startPC(0)
+		, m_wanted(false), m_entered(false), m_interpreting(false) {
+		memzero(m_state);
+		memzero(m_ctx);
+		m_thread = std::thread(&microVUBackground::ThreadProc, this);
+	}
+
+	~microVUBackground() {
+		Wait();
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			m_quit = true;
+		}
+		m_cv.notify_all();
+		m_thread.join();
+	}
+
+	// Waits for the worker and installs its program (rec reset/shutdown)
+	void Wait() {
+		if (!m_prog) return;
+		std::unique_lock<std::mutex> lock(m_mutex);
+		m_cv.wait(lock, [&] { return m_done.load(std::memory_order_relaxed); });
+		lock.unlock();
+		Install(false);
+	}
+
+	void Reset() {
+		Wait();
+		m_interpreting = false;
+	}
+
+	// Takes the compile state over from the worker until Leave(), if it is
+	// busy (EE thread)
+	void Enter() {
+		if (m_prog && m_done.load(std::memory_order_acquire))
+			Install(false);
+		if (!m_prog || m_entered) return;
+		m_wanted.store(true, std::memory_order_release);
+		m_owner.lock();
+		m_wanted.store(false, std::memory_order_release);
+		m_ctx.Restore(microVU1);
+		m_entered = true;
+	}
+
+	void Leave() {
+		if (!m_entered) return;
+		m_ctx.Save(microVU1);
+		m_entered = false;
+		m_owner.unlock();
+	}
+
+	// Called before compiling a block (mVUcompile): the worker lets a waiting
+	// EE thread go first, the EE thread waits for the worker to finish and
+	// then goes on compiling at the end of its code
+	void Sync() {
+		if (std::this_thread::get_id() == m_thread.get_id()) {
+			Yield();
+			return;
+		}
+		if (!m_prog) return;
+
+		if (m_entered) {
+			m_ctx.Save(microVU1);
+			m_entered = false;
+			m_owner.unlock();
+		}
+		{
+			std::unique_lock<std::mutex> lock(m_mutex);
+			m_cv.wait(lock, [&] { return m_done.load(std::memory_order_relaxed); });
+		}
+		Install(true);
+		xSetPtr(microVU1.prog.x86ptr);
+	}
+
+	void Clear(u32 addr, u32 size) {
+		Enter();
+		mVUclear(microVU1, addr, size);
+		Leave();
+	}
+
+	// Returns true if the interpreter runs (or continues) the current program
+	bool IsInterpreting() const { return m_interpreting; }
+
+	// Runs VU1 for the given cycles if the current program is (or becomes)
+	// an interpreted one, returns false if the recompiler has to run it (and
+	// Leave() after)
+	bool Execute(u32 cycles) {
+		microVU& mVU = microVU1;
+
+		if (m_interpreting) {
+			Interpret(cycles);
+			return true;
+		}
+
+		// Known programs (and programs stopped half way) run recompiled
+		Enter();
+		microProgramQuick& quick = mVU.prog.quick[mVU.regs().start_pc / 8];
+		if (quick.prog)
+			return false;
+		if (microProgram* prog = mVUfindProg(mVU)) {
+			quick.prog = prog;
+			return false;
+		}
+
+		// New program while the worker is busy with another one: it gets
+		// compiled the next time it runs
+		if (m_prog) {
+			Leave();
+			Interpret(cycles);
+			return true;
+		}
+
+		// New program: the worker compiles it from a copy of micro memory
+		microProgram* prog = mVUcreateProg(mVU, mVU.regs().start_pc / 8);
+		m_ctx.Save(mVU);
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			m_prog	  = prog;
+			m_startPC = (VU1.VI[REG_TPC].UL << 3) & (mVU.microMemSize - 8);
+			m_state	  = mVU.prog.lpState;
+			m_done.store(false, std::memory_order_relaxed);
+		}
+		m_cv.notify_all();
+
+		Interpret(cycles);
+		return true;
+	}
+};
+
+static microVUBackground* mVUbackground = NULL;
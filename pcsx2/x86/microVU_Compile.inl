@@ -55,6 +55,7 @@ static void mVUsetupRange(microVU& mVU, s32 pc, bool isStartPC)
 		return;
 
 	mVUcheckIsSame(mVU);
+	mVUcurProg.hashDirty = true; // Re-index the program with its new ranges
 
 	if (isStartPC) {
 		microRange mRange = {pc, -1};
@@ -492,10 +493,18 @@ static void mVUDoTBit(microVU& mVU, microFlagCycles* mFC)
 
 void *mVUcompile(microVU& mVU, u32 startPC, uptr pState)
 {
+	mVUbackgroundSync(mVU);
+
 	microFlagCycles mFC;
 	u8* thisPtr = x86Ptr;
 	const u32 endCount = (((microRegInfo*)pState)->blockType) ? 1 : (mVU.microMemSize / 8);
 
+	mVUcurProg.segMask |= 1u << mVU.prog.segment; // Code lands in the current rec-cache segment
+	if (mVUcurProg.entries) { // Remember the entry point for the persistent program cache
+		microPersistEntry entry = { startPC, *(microRegInfo*)pState };
+		mVUcurProg.entries->push_back(entry);
+	}
+
 	// First Pass
 	iPC = startPC / 4;
 	mVUsetupRange(mVU, startPC, 1); // Setup Program Bounds/Range
@@ -698,7 +707,14 @@ __fi void* mVUentryGet(microVU& mVU, microBlockManager* block, u32 startPC, uptr
 	microBlock* pBlock = block->search((microRegInfo*)pState);
 	if (pBlock)
 		return pBlock->x86ptrStart;
-	return mVUcompile(mVU, startPC, pState);
+
+	void* ptr = mVUcompile(mVU, startPC, pState);
+	if (Perf::enabled) {
+		char symbol[32];
+		snprintf(symbol, sizeof(symbol), "prog %d 0x%04x", mVUcurProg.idx, startPC);
+		Perf::vu[mVU.index].map((uptr)ptr, (u8*)xGetPtr() - (u8*)ptr, symbol);
+	}
+	return ptr;
 }
 
  // Search for Existing Compiled Block (if found, return x86ptr; else, compile and return x86ptr)
@@ -718,9 +734,10 @@ _mVUt void* mVUcompileJIT(u32 startPC, uptr ptr)
                        microVU& mVU = mVUx;
                        microBlock* pBlock = (microBlock*)ptr;
                        microJumpCache& jc = pBlock->jumpCache[startPC / 8];
-                       if (jc.prog && jc.prog == mVU.prog.quick[startPC / 8].prog) return jc.x86ptrStart;
+                       if (jc.prog && jc.prog == mVU.prog.quick[startPC / 8].prog && jc.progIdx == jc.prog->idx) return jc.x86ptrStart;
                        void* v = mVUblockFetch(mVUx, startPC, (uptr)&pBlock->pStateEnd);
                        jc.prog = mVU.prog.quick[startPC / 8].prog;
+                       jc.progIdx = jc.prog ? jc.prog->idx : -1;
                        jc.x86ptrStart = v;
                        return v;
                }
@@ -733,10 +750,11 @@ _mVUt void* mVUcompileJIT(u32 startPC, uptr ptr)
                microVU& mVU       = mVUx;
                microBlock* pBlock = (microBlock*)ptr;
                microJumpCache& jc = pBlock->jumpCache[startPC/8];
-               if (jc.prog && jc.prog == mVU.prog.quick[startPC/8].prog)
+               if (jc.prog && jc.prog == mVU.prog.quick[startPC/8].prog && jc.progIdx == jc.prog->idx)
 		       return jc.x86ptrStart;
                void* v = mVUsearchProg<vuIndex>(startPC, (uptr)&pBlock->pStateEnd);
                jc.prog = mVU.prog.quick[startPC/8].prog;
+               jc.progIdx = jc.prog ? jc.prog->idx : -1;
                jc.x86ptrStart = v;
                return v;
        }
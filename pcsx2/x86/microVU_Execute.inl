@@ -27,7 +27,7 @@ static void mVUcleanUp(void)
 	mVU.prog.x86ptr = x86Ptr;
 
 	if ((xGetPtr() < mVU.prog.x86start) || (xGetPtr() >= mVU.prog.x86end))
-		mVUreset(mVU, false);
+		mVUnextSegment(mVU);
 
 	mVU.cycles = mVU.totalCycles - mVU.cycles;
 	mVU.regs().cycle += mVU.cycles;
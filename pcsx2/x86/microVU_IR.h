@@ -64,8 +64,9 @@ union __aligned16 microRegInfo {
 
 struct microProgram;
 struct microJumpCache {
-	microJumpCache() : prog(NULL), x86ptrStart(NULL) {}
+	microJumpCache() : prog(NULL), progIdx(-1), x86ptrStart(NULL) {}
 	microProgram* prog;	// Program to which the entry point below is part of
+	int progIdx;		// Index of that program (prog may be evicted and its memory reused)
 	void* x86ptrStart;	// Start of code (Entry point for block)
 };
 
@@ -0,0 +1,273 @@
+/*  PCSX2 - PS2 Emulator for PCs
+ *  Copyright (C) 2002-2010  PCSX2 Dev Team
+ *
+ *  PCSX2 is free software: you can redistribute it and/or modify it under the terms
+ *  of the GNU Lesser General Public License as published by the Free Software Found-
+ *  ation, either version 3 of the License, or (at your option) any later version.
+ *
+ *  PCSX2 is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ *  without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ *  PURPOSE.  See the GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along with PCSX2.
+ *  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <zlib.h>
+#include "Elfheader.h"
+#include "options_tools.h"
+
+//------------------------------------------------------------------
+// Persistent Program Cache
+//------------------------------------------------------------------
+// The micro code and the block entry points (start PC + pipeline state) of
+// every program are kept per game in the save directory. The recompiled
+// code itself is not position independent, so it isn't saved; instead when
+// mVUsearchProg() misses, the new program gets all the blocks a cached one
+// with the same start PC and micro code had compiled, not just the one it
+// is entered at. So a program recompiles in one go the first time the game
+// runs it, instead of a block at a time as its branches are first taken.
+//
+// File (gzip): u32 magic, u32 version, u32 config hash, u32 count, then
+// count times: u32 startPC, u32 ranges, microRange[ranges], u8 code[] (the
+// bytes covered by each range, back to back), u32 entries,
+// microPersistEntry[entries].
+
+#define MVU_CACHE_MAGIC		0x4355564d // 'MVUC'
+#define MVU_CACHE_VERSION	1
+
+static const u32 mVUpersistMaxProgs = 4096; // Per VU and game
+
+struct microPersistProg {
+	u32 startPC;
+	std::vector<microRange>		   ranges;
+	std::vector<u8>				   code;
+	std::vector<microPersistEntry> entries;
+};
+
+struct microPersistCache {
+	u32  crc;	// Game the programs belong to (0 = none)
+	bool dirty;	// Programs were added since the file was read/written
+	std::unordered_map<u64, microPersistProg> progs;
+	std::unordered_multimap<u32, u64> starts; // startPC -> keys of progs
+};
+
+static microPersistCache mVUpersist[2];
+
+static u64 mVUhashBytes(const void* data, size_t size, u64 h) {
+	const u8* p = (const u8*)data;
+	for (size_t i = 0; i < size; i++)
+		h = (h ^ p[i]) * 0x100000001b3ull;
+	return h;
+}
+
+// Everything the recompiled code depends on besides the micro code itself
+static u32 mVUpersistConfig(microVU& mVU) {
+	const u32 config[] = {
+		mVU.index,
+		EmuConfig.Cpu.Recompiler.bitset,
+		EmuConfig.Cpu.sseVUMXCSR.bitmask,
+		EmuConfig.Gamefixes.bitset,
+		EmuConfig.Speedhacks.bitset,
+		(u32)sizeof(microRegInfo),
+	};
+	return (u32)mVUhashBytes(config, sizeof(config), 0xcbf29ce484222325ull);
+}
+
+static std::string mVUpersistPath(microVU& mVU, u32 crc) {
+	char name[32];
+	snprintf(name, sizeof(name), "/mvu%u_%08X.cache", mVU.index, crc);
+	return retroarch_save_path + name;
+}
+
+// Records a program (if it compiled anything new) in the cache of the current game
+static void mVUpersistHarvest(microVU& mVU, microProgram& prog) {
+	microPersistCache& cache = mVUpersist[mVU.index];
+	if (!cache.crc || !prog.entries || prog.entries->empty()) return;
+
+	microPersistProg rec;
+	rec.startPC = prog.startPC;
+	for (const auto& range : *prog.ranges) {
+		if (range.end > range.start) rec.ranges.push_back(range);
+	}
+	if (rec.ranges.empty()) return;
+
+	// The range order depends on the compile order, sort them so the same
+	// program always gets the same key
+	std::sort(rec.ranges.begin(), rec.ranges.end(), [](const microRange& a, const microRange& b) {
+		return a.start < b.start || (a.start == b.start && a.end < b.end);
+	});
+	for (const auto& range : rec.ranges)
+		rec.code.insert(rec.code.end(), (u8*)prog.data + range.start, (u8*)prog.data + range.end);
+
+	u64 key = mVUhashBytes(&rec.startPC, sizeof(rec.startPC), 0xcbf29ce484222325ull);
+	key = mVUhashBytes(rec.ranges.data(), rec.ranges.size() * sizeof(microRange), key);
+	key = mVUhashBytes(rec.code.data(), rec.code.size(), key);
+
+	auto it = cache.progs.find(key);
+	if (it != cache.progs.end()) {
+		if (it->second.entries.size() >= prog.entries->size()) return;
+	}
+	else if (cache.progs.size() >= mVUpersistMaxProgs) return;
+
+	if (it == cache.progs.end())
+		cache.starts.emplace(rec.startPC, key);
+	rec.entries = *prog.entries;
+	cache.progs[key] = std::move(rec);
+	cache.dirty = true;
+}
+
+static void mVUpersistHarvestAll(microVU& mVU) {
+	for (u32 i = 0; i < (mVU.progSize / 2); i++) {
+		if (!mVU.prog.prog[i]) continue;
+		for (microProgram* prog : *mVU.prog.prog[i]) {
+			mVUpersistHarvest(mVU, *prog);
+			if (prog->entries) prog->entries->clear();
+		}
+	}
+}
+
+static void mVUpersistSave(microVU& mVU) {
+	microPersistCache& cache = mVUpersist[mVU.index];
+	if (!cache.crc || !cache.dirty) return;
+
+	// Written next to the cache and renamed over it, a crash or a full disk
+	// leaves the old one
+	const std::string path = mVUpersistPath(mVU, cache.crc);
+	const std::string temp = path + ".tmp";
+	gzFile f = gzopen(temp.c_str(), "wb");
+	if (!f) return;
+
+	const u32 header[4] = {MVU_CACHE_MAGIC, MVU_CACHE_VERSION, mVUpersistConfig(mVU), (u32)cache.progs.size()};
+	gzwrite(f, header, sizeof(header));
+
+	for (const auto& kv : cache.progs) {
+		const microPersistProg& rec = kv.second;
+		const u32 ranges  = rec.ranges.size();
+		const u32 entries = rec.entries.size();
+		gzwrite(f, &rec.startPC, 4);
+		gzwrite(f, &ranges, 4);
+		gzwrite(f, rec.ranges.data(), ranges * sizeof(microRange));
+		gzwrite(f, rec.code.data(), rec.code.size());
+		gzwrite(f, &entries, 4);
+		gzwrite(f, rec.entries.data(), entries * sizeof(microPersistEntry));
+	}
+
+	if (gzclose(f) != Z_OK || rename(temp.c_str(), path.c_str()) != 0) {
+		remove(temp.c_str());
+		return;
+	}
+	cache.dirty = false;
+}
+
+static void mVUpersistLoad(microVU& mVU) {
+	microPersistCache& cache = mVUpersist[mVU.index];
+
+	gzFile f = gzopen(mVUpersistPath(mVU, cache.crc).c_str(), "rb");
+	if (!f) return;
+
+	auto read = [&](void* dst, size_t size) { return gzread(f, dst, size) == (int)size; };
+
+	u32 header[4];
+	if (!read(header, sizeof(header)) || header[0] != MVU_CACHE_MAGIC ||
+		header[1] != MVU_CACHE_VERSION || header[2] != mVUpersistConfig(mVU)) {
+		gzclose(f);
+		return;
+	}
+
+	for (u32 i = 0; i < std::min(header[3], mVUpersistMaxProgs); i++) {
+		microPersistProg rec;
+		u32 ranges, entries;
+		if (!read(&rec.startPC, 4) || !read(&ranges, 4) || rec.startPC >= (mVU.progSize / 2) || ranges > mVU.microMemSize / 8)
+			break;
+
+		rec.ranges.resize(ranges);
+		if (!read(rec.ranges.data(), ranges * sizeof(microRange)))
+			break;
+
+		size_t codeSize = 0;
+		for (const auto& range : rec.ranges) {
+			if (range.start < 0 || range.end > (s32)mVU.microMemSize || range.end <= range.start)
+				codeSize = ~(size_t)0;
+			else if (codeSize != ~(size_t)0)
+				codeSize += range.end - range.start;
+		}
+		if (codeSize == ~(size_t)0 || codeSize > mVU.microMemSize * 2)
+			break;
+
+		rec.code.resize(codeSize);
+		if (!read(rec.code.data(), codeSize) || !read(&entries, 4) || entries > mProgSize)
+			break;
+
+		rec.entries.resize(entries);
+		if (!read(rec.entries.data(), entries * sizeof(microPersistEntry)))
+			break;
+
+		u64 key = mVUhashBytes(&rec.startPC, sizeof(rec.startPC), 0xcbf29ce484222325ull);
+		key = mVUhashBytes(rec.ranges.data(), rec.ranges.size() * sizeof(microRange), key);
+		key = mVUhashBytes(rec.code.data(), rec.code.size(), key);
+		if (!cache.progs.count(key))
+			cache.starts.emplace(rec.startPC, key);
+		cache.progs[key] = std::move(rec);
+	}
+
+	gzclose(f);
+}
+
+// Compiles the recorded blocks of the cached program that matches micro
+// memory (micro) into prog, a program just created for a search miss at its
+// start PC. Only the programs the game runs get compiled, the first time it
+// runs each of them, and as the current program. Blocks past the end of the
+// rec-cache segment are left to compile when they run.
+static void mVUpersistCompile(microVU& mVU, microProgram& prog, const u8* micro) {
+	microPersistCache& cache = mVUpersist[mVU.index];
+	if (!cache.crc || cache.progs.empty()) return;
+
+	auto starts = cache.starts.equal_range(prog.startPC);
+	for (auto it = starts.first; it != starts.second; ++it) {
+		auto rec = cache.progs.find(it->second);
+		if (rec == cache.progs.end()) continue;
+
+		bool match = true;
+		size_t pos = 0;
+		for (const auto& range : rec->second.ranges) {
+			match = !memcmp(micro + range.start, &rec->second.code[pos], range.end - range.start);
+			if (!match) break;
+			pos += range.end - range.start;
+		}
+		if (!match) continue;
+
+		// A copy, compiling records the entries of prog
+		std::vector<microPersistEntry> entries = rec->second.entries;
+		for (auto& entry : entries) {
+			if (xGetPtr() >= mVU.prog.x86end) break;
+			mVUblockFetch(mVU, entry.startPC, (uptr)&entry.state);
+		}
+		return;
+	}
+}
+
+// Called before searching for a program: follows game changes, saving the
+// programs of the previous game and loading the ones of the new game.
+static void mVUpersistUpdate(microVU& mVU) {
+	if (!EmuConfig.VUProgramCache) return;
+
+	microPersistCache& cache = mVUpersist[mVU.index];
+	if (cache.crc == ElfCRC) return;
+
+	if (cache.crc) {
+		mVUpersistHarvestAll(mVU);
+		mVUpersistSave(mVU);
+	}
+
+	cache.progs.clear();
+	cache.starts.clear();
+	cache.crc	= ElfCRC;
+	cache.dirty	= false;
+	if (!cache.crc) return;
+
+	mVUpersistLoad(mVU);
+	log_cb(RETRO_LOG_INFO, "microVU%u: %u cached programs for %08X\n", mVU.index, (u32)cache.progs.size(), cache.crc);
+}
@@ -19,6 +19,7 @@
 
 #include "newVif_UnpackSSE.h"
 #include "MTVU.h"
+#include "Utilities/Perf.h"
 
 static void recReset(int idx) {
 	nVif[idx].vifBlocks.reset();
@@ -26,6 +27,8 @@ static void recReset(int idx) {
 	nVif[idx].recReserve->Reset();
 
 	nVif[idx].recWritePtr = nVif[idx].recReserve->GetPtr();
+
+	Perf::vif.unmap((uptr)nVif[idx].recReserve->GetPtr(), (uptr)nVif[idx].recReserve->GetPtrEnd());
 }
 
 void dVifReserve(int idx) {
@@ -41,8 +44,10 @@ void dVifReset(int idx) {
 }
 
 void dVifClose(int idx) {
-	if (nVif[idx].recReserve)
+	if (nVif[idx].recReserve) {
 		nVif[idx].recReserve->Reset();
+		Perf::vif.unmap((uptr)nVif[idx].recReserve->GetPtr(), (uptr)nVif[idx].recReserve->GetPtrEnd());
+	}
 }
 
 void dVifRelease(int idx) {
@@ -287,6 +292,13 @@ _vifT __fi nVifBlock* dVifCompile(nVifBlock& block, bool isFill)
 
 	v.recWritePtr = xGetPtr();
 
+	if (Perf::enabled) {
+		char symbol[64];
+		snprintf(symbol, sizeof(symbol), "%d unpack 0x%02x num %u cl %u wl %u mode %u mask %08x",
+			idx, block.upkType, block.num, block.cl, block.wl, block.mode, block.mask);
+		Perf::vif.map(block.startPtr, v.recWritePtr - (u8*)block.startPtr, symbol);
+	}
+
 	return &block;
 }
 
@@ -14,6 +14,7 @@
  */
 
 #include "newVif_UnpackSSE.h"
+#include "Utilities/Perf.h"
 
 #define xMOV8(regX, loc)	xMOVSSZX(regX, loc)
 #define xMOV16(regX, loc)	xMOVSSZX(regX, loc)
@@ -430,10 +431,14 @@ void VifUnpackSSE_Init(void)
 				nVifGen(a, b, c);
 			}}}
 
+	Perf::any.map((uptr)nVifUpkExec->GetPtr(), xGetPtr() - nVifUpkExec->GetPtr(), "VIF unpack kernels");
+
 	nVifUpkExec->ForbidModification();
 }
 
 void VifUnpackSSE_Destroy(void)
 {
+	if (nVifUpkExec)
+		Perf::any.unmap((uptr)nVifUpkExec->GetPtr(), (uptr)nVifUpkExec->GetPtrEnd());
 	safe_delete( nVifUpkExec );
 }